@@ -0,0 +1,460 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+
+// Micro-benchmarks of the kernels elfref spends its time in (make bench).
+//
+// Each kernel is run over data made up here, the same every time: a symbol
+// table of NSYMS functions with names alike to mangled C++ ones and NRELOCS
+// relocations against them, kept in memory or written out as a relocatable
+// ELF file which is then read the way elfref reads its input. A kernel is run
+// WARMUP times, then timed REPS times, and the least, median, 90th percentile
+// and greatest of the times it takes per operation are printed, one line per
+// kernel, so that the output of two builds can be compared with diff(1).
+//
+// The string table lookups of the reader (get_str_$NN(), get_sym_name_$NN())
+// are static to it and are timed through the functions that make them for
+// every symbol and every relocation record: read_symtab and
+// process_relocations. Looking up the symbol a relocation is attributed to
+// (locate_group()) is timed through symtab_add_reloc(), with the offsets given
+// at random and, as the linkers mostly put them, in order.
+
+#include "globals.h"
+#include "args.h"
+#include "input.h"
+#include "symtab.h"
+#include "errors.h"
+
+#include <assert.h>
+#include <elf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NSYMS		65536		// symbols in the data made up
+#define SYM_SIZE	64		// bytes each of them takes
+#define NRELOCS		(1 << 20)	// relocations against them
+#define NVALUES		(1 << 20)	// values read by get_uintNN()
+#define WARMUP		3		// runs of a kernel before it is timed
+#define REPS		25		// timed runs of a kernel
+
+static const char *	names;		// of the symbols, one after another
+static size_t		names_size;
+static size_t *		name_off;	// of each symbol's name in names
+static size_t *		sym_addr;	// of each symbol, in random order
+static size_t *		rel_sorted;	// offsets of the relocations, in order
+static size_t *		rel_random;	// the same, shuffled
+static uint32_t *	rel_sym;	// index of the symbol each refers to
+static char *		values;		// read by get_uintNN()
+
+static symtab_t *	st;		// the symbol table a kernel works on
+static input_t *	in;		// the ELF file made up, once opened
+static elf_sections_t *	sec;
+static struct reader_funcs rdr;
+static volatile uint64_t sink;		// keeps the results computed from being optimized out
+
+static uint64_t	rng_state = 1;
+
+/**
+ * Returns the next pseudo-random number (splitmix64), the same sequence on every run.
+ */
+static uint64_t	rng_next(void)
+{
+	uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static void *	xmalloc(size_t size)
+{
+	void *p = malloc(size);
+	if (!p)
+	{
+		fatal_err("Not enough memory");
+	}
+	return p;
+}
+
+static int	cmp_size(const void* a, const void* b)
+{
+	const size_t x = *(const size_t*)a;
+	const size_t y = *(const size_t*)b;
+	return (x > y) - (x < y);
+}
+
+static int	cmp_double(const void* a, const void* b)
+{
+	const double x = *(const double*)a;
+	const double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * Makes up the symbols and relocations the kernels work on.
+ */
+static void	make_data(void)
+{
+	static const char *const parts[] = { "llvm", "detail", "Parser", "Value", "SmallVector", "Instruction",
+					     "getOperand", "Builder", "Context", "visit", "Analysis", "run" };
+	const size_t nparts = sizeof(parts)/sizeof(parts[0]);
+
+	char *buf = xmalloc(NSYMS*128 + 1);
+	name_off = xmalloc(NSYMS*sizeof(size_t));
+	size_t len = 1; // an empty name first, for the symbol at index 0 of an ELF symbol table
+	buf[0] = 0;
+	for (size_t i = 0; i < NSYMS; ++i)
+	{
+		name_off[i] = len;
+		len += (size_t)sprintf(buf + len, "_ZN");
+		for (uint64_t k = 2 + rng_next() % 3; k > 0; --k)
+		{
+			const char *p = parts[rng_next() % nparts];
+			len += (size_t)sprintf(buf + len, "%zu%s", strlen(p), p);
+		}
+		len += (size_t)sprintf(buf + len, "%zuEv", i) + 1;
+	}
+	names = buf;
+	names_size = len;
+
+	// Symbols are added in random order, and some of them share their address
+	sym_addr = xmalloc(NSYMS*sizeof(size_t));
+	for (size_t i = 0; i < NSYMS; ++i)
+	{
+		sym_addr[i] = (rng_next() % 16 == 0 && i > 0) ? sym_addr[i - 1] : i*SYM_SIZE;
+	}
+	for (size_t i = NSYMS - 1; i > 0; --i)
+	{
+		const size_t k = rng_next() % (i + 1);
+		const size_t t = sym_addr[i];
+		sym_addr[i] = sym_addr[k];
+		sym_addr[k] = t;
+	}
+
+	rel_sorted = xmalloc(NRELOCS*sizeof(size_t));
+	rel_random = xmalloc(NRELOCS*sizeof(size_t));
+	rel_sym = xmalloc(NRELOCS*sizeof(uint32_t));
+	for (size_t i = 0; i < NRELOCS; ++i)
+	{
+		rel_sorted[i] = rng_next() % ((size_t)NSYMS*SYM_SIZE);
+		rel_sym[i] = (uint32_t)(rng_next() % NSYMS);
+	}
+	qsort(rel_sorted, NRELOCS, sizeof(size_t), cmp_size);
+	memcpy(rel_random, rel_sorted, NRELOCS*sizeof(size_t));
+	for (size_t i = NRELOCS - 1; i > 0; --i)
+	{
+		const size_t k = rng_next() % (i + 1);
+		const size_t t = rel_random[i];
+		rel_random[i] = rel_random[k];
+		rel_random[k] = t;
+	}
+
+	values = xmalloc(NVALUES*sizeof(uint64_t));
+	for (size_t i = 0; i < NVALUES*sizeof(uint64_t); ++i)
+	{
+		values[i] = (char)rng_next();
+	}
+}
+
+/**
+ * Writes the data made up as a relocatable 64-bit ELF file of our byte order and opens it as the input.
+ */
+static void	make_input(void)
+{
+	enum { S_NULL, S_TEXT, S_SYMTAB, S_STRTAB, S_RELA, S_SHSTRTAB, NSECS };
+	static const char shstrtab[] = "\0.text\0.symtab\0.strtab\0.rela.text\0.shstrtab";
+
+	const size_t symtab_size = (NSYMS + 1)*sizeof(Elf64_Sym);
+	const size_t rela_size = NRELOCS*sizeof(Elf64_Rela);
+
+	size_t off = sizeof(Elf64_Ehdr);
+	Elf64_Shdr sh[NSECS] = { 0 };
+	sh[S_TEXT] = (Elf64_Shdr){ .sh_name = 1, .sh_type = SHT_NOBITS, .sh_flags = SHF_ALLOC | SHF_EXECINSTR,
+				   .sh_offset = off, .sh_size = (size_t)NSYMS*SYM_SIZE, .sh_addralign = 16 };
+	sh[S_SYMTAB] = (Elf64_Shdr){ .sh_name = 7, .sh_type = SHT_SYMTAB, .sh_offset = off, .sh_size = symtab_size,
+				     .sh_link = S_STRTAB, .sh_info = 1, .sh_addralign = 8,
+				     .sh_entsize = sizeof(Elf64_Sym) };
+	off += symtab_size;
+	sh[S_STRTAB] = (Elf64_Shdr){ .sh_name = 15, .sh_type = SHT_STRTAB, .sh_offset = off, .sh_size = names_size,
+				     .sh_addralign = 1 };
+	off += (names_size + 7) & ~(size_t)7;
+	sh[S_RELA] = (Elf64_Shdr){ .sh_name = 23, .sh_type = SHT_RELA, .sh_flags = SHF_INFO_LINK, .sh_offset = off,
+				   .sh_size = rela_size, .sh_link = S_SYMTAB, .sh_info = S_TEXT, .sh_addralign = 8,
+				   .sh_entsize = sizeof(Elf64_Rela) };
+	off += rela_size;
+	sh[S_SHSTRTAB] = (Elf64_Shdr){ .sh_name = 34, .sh_type = SHT_STRTAB, .sh_offset = off,
+				       .sh_size = sizeof(shstrtab), .sh_addralign = 1 };
+	off += (sizeof(shstrtab) + 7) & ~(size_t)7;
+	const size_t shoff = off;
+	const size_t size = shoff + sizeof(sh);
+
+	char *image = calloc(1, size);
+	if (!image)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	const uint16_t one = 1;
+	Elf64_Ehdr eh = { .e_type = ET_REL, .e_machine = EM_X86_64, .e_version = EV_CURRENT, .e_shoff = shoff,
+			  .e_ehsize = sizeof(Elf64_Ehdr), .e_shentsize = sizeof(Elf64_Shdr), .e_shnum = NSECS,
+			  .e_shstrndx = S_SHSTRTAB };
+	memcpy(eh.e_ident, ELFMAG, SELFMAG);
+	eh.e_ident[EI_CLASS] = ELFCLASS64;
+	eh.e_ident[EI_DATA] = (*(const char*)&one == 1) ? ELFDATA2LSB : ELFDATA2MSB;
+	eh.e_ident[EI_VERSION] = EV_CURRENT;
+	memcpy(image, &eh, sizeof(eh));
+
+	Elf64_Sym *syms = (Elf64_Sym*)(image + sh[S_SYMTAB].sh_offset);
+	for (size_t i = 0; i < NSYMS; ++i)
+	{
+		syms[i + 1] = (Elf64_Sym){ .st_name = (uint32_t)name_off[i], .st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC),
+					   .st_shndx = S_TEXT, .st_value = i*SYM_SIZE, .st_size = SYM_SIZE };
+	}
+	memcpy(image + sh[S_STRTAB].sh_offset, names, names_size);
+	Elf64_Rela *relas = (Elf64_Rela*)(image + sh[S_RELA].sh_offset);
+	for (size_t i = 0; i < NRELOCS; ++i)
+	{
+		relas[i] = (Elf64_Rela){ .r_offset = rel_sorted[i], .r_info = ELF64_R_INFO(rel_sym[i] + 1, R_X86_64_PLT32),
+					 .r_addend = -4 };
+	}
+	memcpy(image + sh[S_SHSTRTAB].sh_offset, shstrtab, sizeof(shstrtab));
+	memcpy(image + shoff, sh, sizeof(sh));
+
+	const char *tmpdir = getenv("TMPDIR");
+	static char path[4096];
+	snprintf(path, sizeof(path), "%s/elfref-bench.XXXXXX", tmpdir ? tmpdir : "/tmp");
+	const int fd = mkstemp(path);
+	if (fd == -1 || write(fd, image, size) != (ssize_t)size)
+	{
+		fatal_err("Cannot write the input made up");
+	}
+	close(fd);
+	free(image);
+
+	// The file stays mapped once removed
+	in = input_init();
+	input_open(in, path);
+	unlink(path);
+	rdr = input_read_elf_header(in);
+	sec = rdr.find_sections(in);
+}
+
+/**
+ * Makes up a sorted symbol table of the symbols, with their names kept as offsets (see symtab_add_strings()).
+ */
+static symtab_t *	make_symtab(bool sorted)
+{
+	symtab_t *s = symtab_alloc(NSYMS);
+	symtab_add_strings(s, names, names_size);
+	for (size_t i = 0; i < NSYMS; ++i)
+	{
+		symtab_add_sym(s, sym_addr[i], SYM_SIZE, STT_FUNC, 1, names + name_off[i]);
+	}
+	if (sorted)
+	{
+		symtab_sort(s, false);
+	}
+	return s;
+}
+
+static void	free_symtab(void)
+{
+	if (st)
+	{
+		symtab_free(st);
+		st = NULL;
+	}
+}
+
+static void	setup_none(void)
+{
+}
+
+static void	setup_unsorted(void)
+{
+	free_symtab();
+	st = make_symtab(false);
+}
+
+static void	setup_sorted(void)
+{
+	free_symtab();
+	st = make_symtab(true);
+}
+
+static void	setup_input_symtab(void)
+{
+	free_symtab();
+	st = rdr.read_symtab(in, sec);
+}
+
+static void	run_get_uint16(void)
+{
+	uint64_t sum = 0;
+	for (size_t i = 0; i < NVALUES; ++i)
+	{
+		sum += get_uint16(values + 2*i);
+	}
+	sink = sum;
+}
+
+static void	run_get_uint32(void)
+{
+	uint64_t sum = 0;
+	for (size_t i = 0; i < NVALUES; ++i)
+	{
+		sum += get_uint32(values + 4*i);
+	}
+	sink = sum;
+}
+
+static void	run_get_uint64(void)
+{
+	uint64_t sum = 0;
+	for (size_t i = 0; i < NVALUES; ++i)
+	{
+		sum += get_uint64(values + 8*i);
+	}
+	sink = sum;
+}
+
+static void	run_symtab_sort(void)
+{
+	symtab_sort(st, false);
+}
+
+static void	add_relocs(const size_t* offsets)
+{
+	for (size_t i = 0; i < NRELOCS; ++i)
+	{
+		symtab_add_reloc(st, offsets[i], names + name_off[rel_sym[i]], true, R_X86_64_PLT32, -4);
+	}
+}
+
+static void	run_add_reloc_sorted(void)
+{
+	add_relocs(rel_sorted);
+}
+
+static void	run_add_reloc_random(void)
+{
+	add_relocs(rel_random);
+}
+
+static void	run_read_symtab(void)
+{
+	free_symtab();
+	st = rdr.read_symtab(in, sec);
+}
+
+static void	run_process_relocations(void)
+{
+	rdr.process_relocations(in, sec, st);
+}
+
+/**
+ * A kernel to time: setup prepares the data for a run of it, untimed, and each run makes ops operations.
+ */
+typedef struct kernel
+{
+	const char *	name;
+	size_t		ops;
+	void		(*setup)(void);
+	void		(*run)(void);
+} kernel;
+
+static const kernel	kernels[] =
+{
+	{ "get_uint16",				NVALUES,	setup_none,		run_get_uint16 },
+	{ "get_uint32",				NVALUES,	setup_none,		run_get_uint32 },
+	{ "get_uint64",				NVALUES,	setup_none,		run_get_uint64 },
+	{ "symtab_sort",			NSYMS,		setup_unsorted,		run_symtab_sort },
+	{ "symtab_add_reloc/sorted",		NRELOCS,	setup_sorted,		run_add_reloc_sorted },
+	{ "symtab_add_reloc/random",		NRELOCS,	setup_sorted,		run_add_reloc_random },
+	{ "read_symtab",			NSYMS,		setup_none,		run_read_symtab },
+	{ "process_relocations",		NRELOCS,	setup_input_symtab,	run_process_relocations },
+};
+
+static double	now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec*1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * Runs the kernel WARMUP times and then REPS times more, printing the percentiles of the latter's times.
+ */
+static void	bench(const kernel* k)
+{
+	double t[REPS];
+	for (size_t i = 0; i < WARMUP + REPS; ++i)
+	{
+		k->setup();
+		const double start = now_ns();
+		k->run();
+		const double end = now_ns();
+		if (i >= WARMUP)
+		{
+			t[i - WARMUP] = (end - start)/(double)k->ops;
+		}
+	}
+	free_symtab();
+
+	qsort(t, REPS, sizeof(double), cmp_double);
+	printf("%-28s %10zu %10.2f %10.2f %10.2f %10.2f\n", k->name, k->ops, t[0], t[REPS/2], t[(REPS*90)/100],
+	       t[REPS - 1]);
+}
+
+extern int	main(int argc, char* argv[])
+{
+	glob_init(argc, argv);
+	args_init();
+
+	const char *only = (argc > 1) ? argv[1] : NULL; // run only the kernels of which this is a substring
+
+	make_data();
+	make_input();
+
+	printf("# %d runs after %d warmup ones; ns per operation\n", REPS, WARMUP);
+	printf("%-28s %10s %10s %10s %10s %10s\n", "# kernel", "ops", "min", "p50", "p90", "max");
+	for (size_t i = 0; i < sizeof(kernels)/sizeof(kernels[0]); ++i)
+	{
+		if (!only || strstr(kernels[i].name, only))
+		{
+			bench(&kernels[i]);
+		}
+	}
+
+	free(sec);
+	input_close(in);
+	input_free(in);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,482 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// Reading of ar(1) archives (static libraries) of ELF objects.
+//
+// Only the member headers are walked when an archive is opened; a member's
+// contents are not looked at until it is asked about. To answer a query about
+// some symbols without reading every member, the armap (the / member of SysV
+// and GNU archives, or /SYM64/ for the large ones) tells which members define
+// the global symbols that match, and the string and symbol tables of the rest
+// tell whether they can have anything to show: a member none of whose symbols
+// has the name pattern in it, or whose string table does not have the pattern
+// of the referenced names, is skipped without being read.
+
+#include "archive.h"
+#include "errors.h"
+#include "input.h"
+#include "symtab.h"
+
+#include <ar.h>
+#include <assert.h>
+#include <elf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THINMAG		"!<thin>\n"	// the magic of a thin archive, which only refers to its members' files
+
+/**
+ * An archive open for reading: its members and its armap, if there is one.
+ */
+struct archive_s
+{
+	const char *		fname;
+	archive_member_t *	members;	// in the order they are in the archive
+	size_t *		member_offs;	// offset of each member's header, which the armap refers to
+	size_t			nmembers;
+
+	const char *		syms;		// the armap's symbol names, one after another
+	size_t *		sym_member;	// the member that defines each one or SIZE_MAX
+	size_t			nsyms;
+
+	const char *		pattern;	// the name pattern that defines is for
+	bool *			defines;	// whether each member defines a global symbol that matches it
+};
+
+/**
+ * Returns true if the given data is an archive.
+ */
+extern bool	archive_detect(const char* data, size_t size)
+{
+	assert(data);
+
+	return size >= SARMAG && (memcmp(data, ARMAG, SARMAG) == 0 || memcmp(data, THINMAG, SARMAG) == 0);
+}
+
+/**
+ * Returns the number in the given space-padded field of a member header.
+ */
+static size_t	field_value(const char* field, size_t len)
+{
+	size_t v = 0;
+	for (size_t i = 0; i < len && field[i] >= '0' && field[i] <= '9'; ++i)
+	{
+		v = v*10 + (size_t)(field[i] - '0');
+	}
+	return v;
+}
+
+/**
+ * Returns the index of the member with its header at the given offset, or SIZE_MAX if there is none.
+ */
+static size_t	find_member(const archive_t* ar, size_t off)
+{
+	size_t lo = 0;
+	size_t hi = ar->nmembers;
+	while (lo < hi)
+	{
+		const size_t mid = lo + (hi - lo)/2;
+		if (ar->member_offs[mid] < off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return (lo < ar->nmembers && ar->member_offs[lo] == off) ? lo : SIZE_MAX;
+}
+
+/**
+ * Reads the armap of the given size with offsets of the given size (4 or 8 bytes), which are big endian
+ * whatever the members are. The members must be known.
+ */
+static void	read_armap(archive_t* ar, const char* data, size_t size, size_t off_size)
+{
+	if (size < off_size)
+	{
+		error("Malformed symbol map in %s; reading all members", ar->fname);
+		return;
+	}
+
+	const uint64_t nsyms = get_field(data, off_size, true);
+	if (nsyms > (size - off_size)/off_size)
+	{
+		error("Malformed symbol map in %s; reading all members", ar->fname);
+		return;
+	}
+
+	const char *offs = data + off_size;
+	const char *names = offs + nsyms*off_size;
+	const char *end = data + size;
+
+	ar->sym_member = malloc(nsyms*sizeof(size_t) + 1);
+	if (!ar->sym_member)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	// Names are NUL-terminated one after another; the last may lack the NUL if the map is cut short
+	const char *name = names;
+	for (size_t i = 0; i < nsyms && name < end; ++i)
+	{
+		ar->sym_member[i] = find_member(ar, (size_t)get_field(offs + i*off_size, off_size, true));
+		const char *nul = memchr(name, 0, (size_t)(end - name));
+		name = nul ? nul + 1 : end;
+		ar->nsyms = i + 1;
+	}
+	ar->syms = names;
+	if (name == end && ar->nsyms && end[-1] != 0)
+	{
+		--ar->nsyms; // no room to tell where the last one ends
+	}
+
+	report(VERB, "Found %zu symbols in the symbol map of %s", ar->nsyms, ar->fname);
+}
+
+/**
+ * Returns the name of the member with the given header, without the trailing '/' or padding, and stores
+ * its length in *len. Long names are looked up in the GNU table given or, for BSD archives, taken
+ * from the beginning of the member's data, the size of which is then adjusted.
+ */
+static const char *	member_name(const archive_t* ar, const struct ar_hdr* hdr, const char* longnames,
+				    size_t longnames_size, const char** data, size_t* size, size_t* len)
+{
+	const char *name = hdr->ar_name;
+	size_t max_len = sizeof(hdr->ar_name);
+
+	if (name[0] == '/' && name[1] >= '0' && name[1] <= '9')
+	{
+		const size_t off = field_value(name + 1, sizeof(hdr->ar_name) - 1);
+		if (!longnames || off >= longnames_size)
+		{
+			fatal("Malformed long member name in %s", ar->fname);
+		}
+		name = longnames + off;
+		max_len = longnames_size - off;
+	}
+	else if (memcmp(name, "#1/", 3) == 0)
+	{
+		const size_t n = field_value(name + 3, sizeof(hdr->ar_name) - 3);
+		if (n > *size)
+		{
+			fatal("Malformed long member name in %s", ar->fname);
+		}
+		name = *data;
+		max_len = n;
+		*data += n;
+		*size -= n;
+	}
+
+	size_t n = 0;
+	while (n < max_len && name[n] != '/' && name[n] != '\n' && name[n] != 0)
+	{
+		++n;
+	}
+	while (n > 0 && name[n - 1] == ' ')
+	{
+		--n;
+	}
+
+	*len = n;
+	return name;
+}
+
+/**
+ * Walks the member headers of the archive given and returns it open for reading with archive_get_members().
+ * The data must stay in memory until the archive is released with archive_free(). Exits on a malformed archive.
+ */
+extern archive_t *	archive_open(const char* data, size_t size, const char* fname)
+{
+	assert(data);
+	assert(fname);
+
+	if (size >= SARMAG && memcmp(data, THINMAG, SARMAG) == 0)
+	{
+		fatal("%s is a thin archive, which is not supported; give its members instead", fname);
+	}
+	assert(archive_detect(data, size));
+
+	archive_t *ar = calloc(1, sizeof(archive_t));
+	if (!ar)
+	{
+		fatal_err("Not enough memory");
+	}
+	ar->fname = fname;
+
+	const char *armap = NULL;
+	size_t armap_size = 0;
+	size_t armap_off_size = 0;
+	const char *longnames = NULL;
+	size_t longnames_size = 0;
+	size_t capacity = 0;
+
+	size_t off = SARMAG;
+	while (off + sizeof(struct ar_hdr) <= size)
+	{
+		const struct ar_hdr *hdr = (const struct ar_hdr *)(data + off);
+		if (memcmp(hdr->ar_fmag, ARFMAG, sizeof(hdr->ar_fmag)) != 0)
+		{
+			fatal("Malformed member header at offset %zu in %s", off, fname);
+		}
+
+		const char *mdata = data + off + sizeof(struct ar_hdr);
+		size_t msize = field_value(hdr->ar_size, sizeof(hdr->ar_size));
+		if (msize > size - off - sizeof(struct ar_hdr))
+		{
+			fatal("Member at offset %zu in %s is truncated", off, fname);
+		}
+		const size_t next = off + sizeof(struct ar_hdr) + msize + (msize & 1);
+
+		if (memcmp(hdr->ar_name, "/ ", 2) == 0 || memcmp(hdr->ar_name, "/SYM64/ ", 8) == 0)
+		{
+			armap = mdata;
+			armap_size = msize;
+			armap_off_size = (hdr->ar_name[1] == ' ') ? 4 : 8;
+		}
+		else if (memcmp(hdr->ar_name, "// ", 3) == 0)
+		{
+			longnames = mdata;
+			longnames_size = msize;
+		}
+		else if (memcmp(hdr->ar_name, "__.SYMDEF", 9) != 0) // the BSD armap is not used
+		{
+			size_t len = 0;
+			const char *name = member_name(ar, hdr, longnames, longnames_size, &mdata, &msize, &len);
+
+			if (ar->nmembers == capacity)
+			{
+				capacity = capacity ? capacity*2 : 64;
+				archive_member_t *members = realloc(ar->members, capacity*sizeof(archive_member_t));
+				size_t *member_offs = realloc(ar->member_offs, capacity*sizeof(size_t));
+				if (members)
+					ar->members = members;
+				if (member_offs)
+					ar->member_offs = member_offs;
+				if (!members || !member_offs)
+				{
+					fatal_err("Not enough memory");
+				}
+			}
+
+			const size_t name_size = strlen(fname) + len + 3;
+			char *full_name = malloc(name_size);
+			if (!full_name)
+			{
+				fatal_err("Not enough memory");
+			}
+			snprintf(full_name, name_size, "%s(%.*s)", fname, (int)len, name);
+
+			ar->members[ar->nmembers] = (archive_member_t){ .name = full_name, .data = mdata, .size = msize };
+			ar->member_offs[ar->nmembers] = off;
+			++ar->nmembers;
+		}
+
+		off = next;
+	}
+
+	report(VERB, "Found %zu members in %s", ar->nmembers, fname);
+
+	if (armap)
+	{
+		read_armap(ar, armap, armap_size, armap_off_size);
+	}
+	else
+	{
+		report(VERB, "No symbol map in %s; reading all members", fname);
+	}
+
+	return ar;
+}
+
+/**
+ * Releases the archive opened with archive_open().
+ */
+extern void	archive_free(archive_t* ar)
+{
+	if (!ar)
+		return;
+
+	for (size_t i = 0; i < ar->nmembers; ++i)
+	{
+		free((char *)ar->members[i].name);
+	}
+	free(ar->members);
+	free(ar->member_offs);
+	free(ar->sym_member);
+	free(ar->defines);
+	free(ar);
+}
+
+/**
+ * Stores the members of the archive in *members and returns their number.
+ */
+extern size_t	archive_get_members(archive_t* ar, const archive_member_t** members)
+{
+	assert(ar);
+	assert(members);
+
+	*members = ar->members;
+	return ar->nmembers;
+}
+
+/**
+ * Marks the members that the armap says define a global symbol matching the pattern given.
+ */
+static void	find_defining_members(archive_t* ar, const char* pattern)
+{
+	free(ar->defines);
+	ar->defines = calloc(ar->nmembers + 1, sizeof(bool));
+	if (!ar->defines)
+	{
+		fatal_err("Not enough memory");
+	}
+	ar->pattern = pattern;
+
+	size_t nfound = 0;
+	const char *name = ar->syms;
+	for (size_t i = 0; i < ar->nsyms; ++i)
+	{
+		const size_t m = ar->sym_member[i];
+		if (m != SIZE_MAX && !ar->defines[m] && strstr(name, pattern))
+		{
+			ar->defines[m] = true;
+			++nfound;
+		}
+		name += strlen(name) + 1;
+	}
+
+	report(VERB, "The symbol map of %s has %zu members defining global symbols that match", ar->fname, nfound);
+}
+
+/**
+ * Looks into the symbol tables of the ELF member given without reading it in, and returns false if none of
+ * them has a defined symbol the name pattern is a substring of or, for the referenced names, if their string
+ * table does not have the reference pattern. Returns true if the member is not ELF or can not be looked into.
+ */
+static bool	member_may_match(const archive_member_t* m, const char* name_pattern, const char* ref_pattern)
+{
+	const char *p = m->data;
+	if (m->size < EI_NIDENT || memcmp(p, ELFMAG, SELFMAG) != 0
+	    || (p[EI_CLASS] != ELFCLASS32 && p[EI_CLASS] != ELFCLASS64))
+		return true;
+
+	const bool is64 = (p[EI_CLASS] == ELFCLASS64);
+	const bool be = (p[EI_DATA] == ELFDATA2MSB);
+	const size_t ehdr_size = is64 ? sizeof(Elf64_Ehdr) : sizeof(Elf32_Ehdr);
+	const size_t shdr_size = is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr);
+	const size_t sym_size = is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+	if (m->size < ehdr_size)
+		return true;
+
+	const uint64_t shoff = ELF_FIELD(p, Ehdr, e_shoff, is64, be);
+	const uint64_t shentsize = ELF_FIELD(p, Ehdr, e_shentsize, is64, be);
+	uint64_t shnum = ELF_FIELD(p, Ehdr, e_shnum, is64, be);
+	if (shentsize < shdr_size || shoff == 0 || shoff > m->size || m->size - shoff < shentsize)
+		return true; // garbage: let the reader deal with it
+	if (shnum == 0)
+	{
+		shnum = ELF_FIELD(p + shoff, Shdr, sh_size, is64, be); // extended numbering
+	}
+	if (shnum == 0 || shnum > (m->size - shoff)/shentsize)
+		return true;
+
+	bool found = false;
+	for (size_t i = 0; i < shnum && !found; ++i)
+	{
+		const char *shdr = p + shoff + i*shentsize;
+		const uint64_t type = ELF_FIELD(shdr, Shdr, sh_type, is64, be);
+		if (type != SHT_SYMTAB && type != SHT_DYNSYM)
+			continue;
+
+		const uint64_t link = ELF_FIELD(shdr, Shdr, sh_link, is64, be);
+		if (link >= shnum)
+			return true;
+		const char *strhdr = p + shoff + link*shentsize;
+		const uint64_t str_off = ELF_FIELD(strhdr, Shdr, sh_offset, is64, be);
+		const uint64_t str_size = ELF_FIELD(strhdr, Shdr, sh_size, is64, be);
+		const uint64_t sym_off = ELF_FIELD(shdr, Shdr, sh_offset, is64, be);
+		const uint64_t sym_bytes = ELF_FIELD(shdr, Shdr, sh_size, is64, be);
+		if (str_off > m->size || str_size > m->size - str_off || sym_off > m->size || sym_bytes > m->size - sym_off)
+			return true;
+
+		const char *strtab = p + str_off;
+		if (ref_pattern && !memmem(strtab, (size_t)str_size, ref_pattern, strlen(ref_pattern)))
+			continue;
+		if (!name_pattern)
+		{
+			found = true;
+			continue;
+		}
+		if (!memmem(strtab, (size_t)str_size, name_pattern, strlen(name_pattern)))
+			continue;
+
+		// The name is there; see if it is a defined symbol's rather than only a referenced one's
+		for (size_t j = 0; j < sym_bytes/sym_size && !found; ++j)
+		{
+			const char *sym = p + sym_off + j*sym_size;
+			const uint64_t name = ELF_FIELD(sym, Sym, st_name, is64, be);
+			const uint64_t shndx = ELF_FIELD(sym, Sym, st_shndx, is64, be);
+			if (shndx == SHN_UNDEF || name >= str_size)
+				continue;
+
+			const char *sym_name = strtab + name;
+			const char *nul = memchr(sym_name, 0, (size_t)(str_size - name));
+			if (!nul)
+				return true;
+			found = (strstr(sym_name, name_pattern) != NULL);
+		}
+	}
+
+	return found;
+}
+
+/**
+ * Returns false if the i-th member of the archive can not have anything to show for the filter given:
+ * it neither defines a symbol that matches the filter's name pattern, nor refers to a name that matches
+ * its reference pattern. Only the armap and the member's symbol tables are looked at to tell that.
+ */
+extern bool	archive_member_may_match(archive_t* ar, size_t i, const symtab_filter_t* filter)
+{
+	assert(ar);
+	assert(i < ar->nmembers);
+	assert(filter);
+
+	if (!filter->name_pattern && !filter->ref_pattern)
+		return true;
+
+	if (filter->name_pattern && !filter->ref_pattern && ar->nsyms)
+	{
+		if (ar->pattern != filter->name_pattern)
+		{
+			find_defining_members(ar, filter->name_pattern);
+		}
+		if (ar->defines[i])
+			return true; // the armap knows, no need to look into the member
+	}
+
+	return member_may_match(&ar->members[i], filter->name_pattern, filter->ref_pattern);
+}
@@ -0,0 +1,53 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef ARCHIVE_H_
+#define ARCHIVE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct archive_s	archive_t;
+typedef struct symtab_filter	symtab_filter_t;
+
+/**
+ * Describes a member of an archive (see archive_get_members()).
+ */
+typedef struct archive_member
+{
+	const char *	name;		// as archive(member), for messages and output
+	const char *	data;		// in the archive's mapping
+	size_t		size;
+} archive_member_t;
+
+bool		archive_detect(const char* data, size_t size);
+archive_t *	archive_open(const char* data, size_t size, const char* fname);
+void		archive_free(archive_t* ar);
+size_t		archive_get_members(archive_t* ar, const archive_member_t** members);
+bool		archive_member_may_match(archive_t* ar, size_t i, const symtab_filter_t* filter);
+
+#endif
@@ -29,6 +29,8 @@
 #include "errors.h"
 #include "globals.h"
 #include "symtab.h"
+#include "prefetch.h"
+#include "reltype.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -36,34 +38,131 @@
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
-#include <elf.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <ctype.h>
 
-static const char *	fname;			// name of input ELF file
+static const char **	fnames;			// names of input ELF files
+static size_t		nfnames;
 static unsigned int	verbosity;
-static const char *	name_pattern;		// if set, only report symbols matching this pattern
-static bool		funcs_only;		// only report about functions
-static bool		offsets_decimal;	// show offsets in the decimal form
+static symtab_filter_t	filter;			// which symbols and references to report and how
+static const char *	serve_sock;		// if set, run as a query server listening on this socket
+static const char *	connect_sock;		// if set, send the query to the server listening on this socket
+static size_t		cache_mem;		// memory budget of the server's cache, bytes
+static const char *	index_dir;		// if set, index the files under this directory
+static const char *	db_name;		// the index database
+static bool		watch;			// keep the index up to date as files change
+static const char *	scan_dir;		// if set, find the files under this directory referring to a symbol
+static bool		addr_mode;		// look up the addresses rather than show all symbols
+static bool		lines;			// show source lines of the references
+static const char *	section_pattern;	// only read relocation sections with names containing this
+static unsigned		kinds;			// only keep relocations of these kinds (reltype_kind_t bits)
+static const char **	addrs;			// the addresses to look up
+static size_t		naddrs;
+static bool		summary;		// show reference statistics rather than the references
+static size_t		top;			// how many symbols to show in the statistics
+static double		sample_rate;		// the share of relocations the statistics are estimated from
+static uint64_t		seed;			// of the pseudo-random choice of the relocations
+static const char *	reach_from;		// show the symbols reachable from this one
+static const char *	path_to;		// show a chain of references leading to this symbol
+static bool		diff_mode;		// compare the references of two files
+static const char *	io_engine;		// how to read the input files ahead of parsing them
+static size_t		mem_limit;		// if set, bytes of references kept in memory, the rest go to files
+static const char *	trace_file;		// if set, write the timeline of the work done to this file
+static size_t		threads;		// to split the work among, 0 for one per CPU
 
 static const char *usage_str =
-"Usage: %s [OPTIONS]... ELF-FILE\n"
-"\tfind what symbols (funcs and global variables) reference in ELF-FILE\n"
+"Usage: %s [OPTIONS]... ELF-FILE...\n"
+"       %s --serve SOCKET [--cache-mem SIZE]\n"
+"       %s --index DIR --db FILE [--watch] [OPTIONS]...\n"
+"       %s --scan-dir DIR [OPTIONS]... SYMBOL[@VERSION]\n"
+"       %s --addr [OPTIONS]... ELF-FILE [ADDRESS]...\n"
+"       %s --diff [OPTIONS]... OLD-ELF-FILE NEW-ELF-FILE\n"
+"\tfind what symbols (funcs and global variables) reference in ELF-FILE(s)\n"
 "\n"
 "Options:\n"
 "    -s pattern\tonly show info about symbols of which pattern is a substring\n"
+"    -S name\tonly show info about symbols named exactly name, only reading\n"
+"    \t\tthe relocations within them\n"
+"    -r pattern\tonly show references to symbols of which pattern is a substring\n"
 "    -f\t\tonly show info about functions (symbol type FUNC);\n"
 "    \t\tby default, OBJECTs are also shown\n"
 "    -d\t\tprint offsets in decimal instead of hex\n"
+"    -l\t\tshow the source file:line of each reference (needs .debug_line)\n"
+"    -t\t\tshow the relocation type of each reference\n"
+"    --kind KIND[,KIND]...\n"
+"    \t\tonly show references of the given kinds: call (calls and\n"
+"    \t\tbranches), data (taking an address), got (through the GOT),\n"
+"    \t\ttls (to thread-local variables) and other\n"
+"    --section PATTERN\n"
+"    \t\tonly read relocation sections of which PATTERN is a substring;\n"
+"    \t\tby default, all but those for sections not loaded in memory\n"
+"    \t\t(such as .rela.debug_info) are read\n"
+"    --serve SOCKET\n"
+"    \t\tkeep parsed files in memory and answer queries on the SOCKET\n"
+"    --cache-mem SIZE\n"
+"    \t\tmemory budget for the files kept by --serve, in megabytes\n"
+"    \t\tor with a suffix as for --mem-limit (default %zu)\n"
+"    --connect SOCKET\n"
+"    \t\tsend the query to elfref --serve running on the SOCKET\n"
+"    --index DIR --db FILE\n"
+"    \t\tshow info about all ELF files under DIR, only reading those\n"
+"    \t\tthat changed since the index in FILE was last updated\n"
+"    --watch\tkeep the index up to date as the files under DIR change\n"
+"    --scan-dir DIR\n"
+"    \t\tshow the references to SYMBOL (of VERSION, if given) made in\n"
+"    \t\tthe ELF files under DIR, only reading those that have it in\n"
+"    \t\ttheir dynamic symbol table\n"
+"    --addr\tshow the symbol containing each ADDRESS and its references;\n"
+"    \t\tADDRESS is hex, possibly relative to a section (.text+0x1a2c);\n"
+"    \t\tread from the standard input if none given\n"
+"    --summary\tshow statistics rather than the references: the most\n"
+"    \t\treferenced symbols, the symbols making the most references\n"
+"    \t\tand the number of references to each section\n"
+"    --top N\tshow N symbols in each --summary list (default %zu)\n"
+"    --sample RATE\n"
+"    \t\testimate the --summary statistics, with 95%% confidence bounds,\n"
+"    \t\tfrom a random sample of RATE (0 to 1) of the relocations\n"
+"    --seed N\tchoose the --sample relocations with seed N (default %llu)\n"
+"    --reach-from SYMBOL\n"
+"    \t\tshow the symbols that SYMBOL references, directly or not\n"
+"    --path-to SYMBOL\n"
+"    \t\tshow a shortest chain of references leading to SYMBOL from\n"
+"    \t\tthe --reach-from one or, if none given, from a symbol that\n"
+"    \t\tnothing references (an entry point or an exported function)\n"
+"    --diff\tshow the references added (+), removed (-) and moved within\n"
+"    \t\ttheir symbols (~) in NEW-ELF-FILE compared to OLD-ELF-FILE\n"
+"    --mem-limit SIZE\n"
+"    \t\tkeep no more than SIZE megabytes (or kilobytes with the k\n"
+"    \t\tor K suffix, gigabytes with g or G) of references in memory,\n"
+"    \t\tsorting the rest in temporary files in $TMPDIR\n"
+"    --io ENGINE\n"
+"    \t\thow to read ELF-FILEs: uring (the default for several files)\n"
+"    \t\tand pread read the sections needed ahead while the preceding\n"
+"    \t\tfiles are parsed, mmap (the default for one) does not\n"
+"    --trace FILE\n"
+"    \t\twrite the timeline of reading each file (stages, relocation\n"
+"    \t\tsections, threads) to FILE in the Trace Event Format, which\n"
+"    \t\tPerfetto and chrome://tracing show\n"
+"    --threads N\tsplit the work that can be split (sorting, decompressing,\n"
+"    \t\tformatting the output) among N threads (default: one per CPU)\n"
 "    -h\t\tdisplay help\n"
 "    -v\t\tverbose output\n"
 "    -vv\t\tverbose and debug output\n"
 ;
 
+#define DEFAULT_CACHE_MEM_MB	((size_t)1024)
+#define DEFAULT_TOP		((size_t)10)
+#define DEFAULT_SEED		1ULL
+
 /**
  * Prints out program's usage info.
  */
 extern void 	args_usage(void)
 {
-	printf(usage_str, glob_get_program_name());
+	printf(usage_str, glob_get_program_name(), glob_get_program_name(), glob_get_program_name(),
+	       glob_get_program_name(), glob_get_program_name(), glob_get_program_name(), DEFAULT_CACHE_MEM_MB,
+	       DEFAULT_TOP, DEFAULT_SEED);
 	printf("\nOutput format:\n");
 	symtab_print_legend();
 }
@@ -75,6 +174,107 @@ extern void 	args_usage(void)
 extern void 	args_init(void)
 {
 	verbosity = NORM;
+	cache_mem = DEFAULT_CACHE_MEM_MB << 20;
+	top = DEFAULT_TOP;
+	sample_rate = 1;
+	seed = DEFAULT_SEED;
+	kinds = RELTYPE_ALL;
+}
+
+/**
+ * Parses the count given to an option: a positive number. Returns false if it is not such or does not fit
+ * a size_t.
+ */
+static bool	parse_count(const char* arg, size_t* count)
+{
+	// strtoull() would take "-1" or " 1" too, so the count must start with a digit
+	char *end = NULL;
+	const unsigned long long n = strtoull(arg, &end, 10);
+	if (!isdigit((unsigned char)*arg) || *end != 0 || n == 0 || n > SIZE_MAX)
+		return false;
+
+	*count = (size_t)n;
+	return true;
+}
+
+/**
+ * Parses the size given to an option: a positive number of megabytes or, with a k, m or g suffix (in any
+ * case), of kilobytes, megabytes or gigabytes. Returns false if it is not such or does not fit a size_t.
+ */
+static bool	parse_size(const char* arg, size_t* size)
+{
+	// strtoull() would take "-1" or " 1" too, so the size must start with a digit
+	char *end = NULL;
+	const unsigned long long n = strtoull(arg, &end, 10);
+	const int unit = !*end ? 0 : end[1] ? -1 : tolower((unsigned char)*end);
+	const int shift = (unit == 'k') ? 10 : (unit == 'g') ? 30 : (unit == 0 || unit == 'm') ? 20 : -1;
+	if (!isdigit((unsigned char)*arg) || n == 0 || shift < 0 || n > (SIZE_MAX >> shift))
+		return false;
+
+	*size = (size_t)n << shift;
+	return true;
+}
+
+/**
+ * Fetches the argument of the option at argv[*i] advancing *i; issues an error and returns NULL if there is none.
+ */
+static const char *	get_opt_arg(int argc, char* argv[], int* i)
+{
+	const char *opt = argv[*i];
+
+	(*i)++;
+	if (*i < argc)
+	{
+		return argv[*i];
+	}
+
+	report(NORM, "%s option requires argument", opt);
+	return NULL;
+}
+
+/**
+ * Recognizes an option at argv[*i] that affects what symtab_dump_to() shows and updates filter accordingly.
+ * Returns 1 if the option was consumed (*i then points at its last argument), 0 if argv[*i] is not such option,
+ * and -1 if the option is malformed (the error is reported).
+ */
+extern int	args_parse_filter_opt(int argc, char* argv[], int* i, symtab_filter_t* f)
+{
+	assert(i && *i < argc);
+	assert(f);
+
+	const char *arg = argv[*i];
+
+	if (strcmp(arg, "-f") == 0)
+	{
+		f->funcs_only = true;
+	}
+	else if (strcmp(arg, "-d") == 0)
+	{
+		f->offsets_decimal = true;
+	}
+	else if (strcmp(arg, "-t") == 0)
+	{
+		f->show_types = true;
+	}
+	else if (strcmp(arg, "-s") == 0 || strcmp(arg, "-S") == 0)
+	{
+		f->name_exact = (arg[1] == 'S');
+		f->name_pattern = get_opt_arg(argc, argv, i);
+		if (!f->name_pattern)
+			return -1;
+	}
+	else if (strcmp(arg, "-r") == 0)
+	{
+		f->ref_pattern = get_opt_arg(argc, argv, i);
+		if (!f->ref_pattern)
+			return -1;
+	}
+	else
+	{
+		return 0;
+	}
+
+	return 1;
 }
 
 /**
@@ -88,6 +288,16 @@ extern bool	args_parse(int argc, char* argv[], input_t* in)
 	{
 		const char *arg = argv[i];
 
+		const int filter_opt = args_parse_filter_opt(argc, argv, &i, &filter);
+		if (filter_opt < 0)
+		{
+			return false;
+		}
+		else if (filter_opt > 0)
+		{
+			continue;
+		}
+
 		if (strcmp(arg, "-v") == 0)
 		{
 			verbosity = VERB;
@@ -96,59 +306,341 @@ extern bool	args_parse(int argc, char* argv[], input_t* in)
 		{
 			verbosity = DBG;
 		}
-		else if (strcmp(arg, "-f") == 0)
+		else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-?") == 0 || strcmp(arg, "-h") == 0)
 		{
-			funcs_only = true;
+			return false;
 		}
-		else if (strcmp(arg, "-d") == 0)
+		else if (strcmp(arg, "--serve") == 0)
 		{
-			offsets_decimal = true;
+			serve_sock = get_opt_arg(argc, argv, &i);
+			if (!serve_sock)
+				return false;
 		}
-		else if (strcmp(arg, "--help") == 0 || strcmp(arg, "-?") == 0 || strcmp(arg, "-h") == 0)
+		else if (strcmp(arg, "--connect") == 0)
 		{
-			return false;
+			connect_sock = get_opt_arg(argc, argv, &i);
+			if (!connect_sock)
+				return false;
 		}
-		else if (strcmp(arg, "-s") == 0)
+		else if (strcmp(arg, "--cache-mem") == 0)
 		{
-			i++;
-			if (i < argc)
+			const char *size = get_opt_arg(argc, argv, &i);
+			if (!size)
+				return false;
+
+			if (!parse_size(size, &cache_mem))
 			{
-				name_pattern = argv[i];
+				report(NORM, "--cache-mem requires a positive size in megabytes, or with a k, m or g suffix");
+				return false;
 			}
-			else
+		}
+		else if (strcmp(arg, "--index") == 0)
+		{
+			index_dir = get_opt_arg(argc, argv, &i);
+			if (!index_dir)
+				return false;
+		}
+		else if (strcmp(arg, "--db") == 0)
+		{
+			db_name = get_opt_arg(argc, argv, &i);
+			if (!db_name)
+				return false;
+		}
+		else if (strcmp(arg, "--watch") == 0)
+		{
+			watch = true;
+		}
+		else if (strcmp(arg, "--scan-dir") == 0)
+		{
+			scan_dir = get_opt_arg(argc, argv, &i);
+			if (!scan_dir)
+				return false;
+		}
+		else if (strcmp(arg, "--addr") == 0)
+		{
+			addr_mode = true;
+		}
+		else if (strcmp(arg, "-l") == 0)
+		{
+			lines = true;
+		}
+		else if (strcmp(arg, "--section") == 0)
+		{
+			section_pattern = get_opt_arg(argc, argv, &i);
+			if (!section_pattern)
+				return false;
+		}
+		else if (strcmp(arg, "--kind") == 0)
+		{
+			const char *list = get_opt_arg(argc, argv, &i);
+			if (!list)
+				return false;
+
+			if (!reltype_parse_kinds(list, &kinds))
 			{
-				report(NORM, "-s option requires argument");
+				report(NORM, "--kind takes a list of call, data, got, tls and other");
 				return false;
 			}
 		}
-		else
+		else if (strcmp(arg, "--summary") == 0)
+		{
+			summary = true;
+		}
+		else if (strcmp(arg, "--top") == 0)
 		{
-			if (!fname)
+			const char *n = get_opt_arg(argc, argv, &i);
+			if (!n)
+				return false;
+
+			if (!parse_count(n, &top))
 			{
-				fname = arg;
+				report(NORM, "--top requires a positive number");
+				return false;
+			}
+		}
+		else if (strcmp(arg, "--sample") == 0)
+		{
+			const char *rate = get_opt_arg(argc, argv, &i);
+			if (!rate)
+				return false;
+
+			char *end = NULL;
+			sample_rate = strtod(rate, &end);
+			if (*end != 0 || !(sample_rate > 0 && sample_rate <= 1))
+			{
+				report(NORM, "--sample requires a rate above 0 and up to 1");
+				return false;
 			}
-			else
+		}
+		else if (strcmp(arg, "--seed") == 0)
+		{
+			const char *n = get_opt_arg(argc, argv, &i);
+			if (!n)
+				return false;
+
+			char *end = NULL;
+			seed = strtoull(n, &end, 10);
+			if (*end != 0 || *n == 0)
 			{
-				report(NORM, "Only one file name argument is supported (%s will be ignored)", arg);
+				report(NORM, "--seed requires a number");
+				return false;
 			}
 		}
+		else if (strcmp(arg, "--reach-from") == 0)
+		{
+			reach_from = get_opt_arg(argc, argv, &i);
+			if (!reach_from)
+				return false;
+		}
+		else if (strcmp(arg, "--path-to") == 0)
+		{
+			path_to = get_opt_arg(argc, argv, &i);
+			if (!path_to)
+				return false;
+		}
+		else if (strcmp(arg, "--diff") == 0)
+		{
+			diff_mode = true;
+		}
+		else if (strcmp(arg, "--mem-limit") == 0)
+		{
+			const char *size = get_opt_arg(argc, argv, &i);
+			if (!size)
+				return false;
+
+			if (!parse_size(size, &mem_limit))
+			{
+				report(NORM, "--mem-limit requires a positive size in megabytes, or with a k, m or g suffix");
+				return false;
+			}
+		}
+		else if (strcmp(arg, "--io") == 0)
+		{
+			io_engine = get_opt_arg(argc, argv, &i);
+			if (!io_engine)
+				return false;
+
+			prefetch_engine_t engine;
+			if (!prefetch_parse_engine(io_engine, &engine))
+			{
+				report(NORM, "Unknown --io engine %s", io_engine);
+				return false;
+			}
+		}
+		else if (strcmp(arg, "--trace") == 0)
+		{
+			trace_file = get_opt_arg(argc, argv, &i);
+			if (!trace_file)
+				return false;
+		}
+		else if (strcmp(arg, "--threads") == 0)
+		{
+			const char *n = get_opt_arg(argc, argv, &i);
+			if (!n)
+				return false;
+
+			if (!parse_count(n, &threads))
+			{
+				report(NORM, "--threads requires a positive number");
+				return false;
+			}
+		}
+		else
+		{
+			if (!fnames)
+			{
+				fnames = malloc((size_t)argc*sizeof(*fnames));
+				if (!fnames)
+					fatal_err("Not enough memory");
+			}
+			fnames[nfnames++] = arg;
+		}
+	}
+
+	// With --addr, the file name is followed by the addresses
+	if (addr_mode && nfnames > 1)
+	{
+		addrs = fnames + 1;
+		naddrs = nfnames - 1;
+		nfnames = 1;
+	}
+
+	if (trace_file && (serve_sock || connect_sock))
+	{
+		report(NORM, "--trace does not go with --serve or --connect");
+		return false;
+	}
+
+	if (serve_sock)
+	{
+		if (nfnames || connect_sock)
+		{
+			report(NORM, "--serve does not take file name or --connect arguments");
+			return false;
+		}
+		return true;
 	}
 
-	if (!fname)
+	if (index_dir || db_name || watch)
+	{
+		if (!index_dir || !db_name)
+		{
+			report(NORM, "--index and --db go together");
+			return false;
+		}
+		if (kinds != RELTYPE_ALL || filter.show_types)
+		{
+			report(NORM, "--index does not go with --kind or -t");
+			return false;
+		}
+		if (nfnames || connect_sock)
+		{
+			report(NORM, "--index does not take file name or --connect arguments");
+			return false;
+		}
+		return true;
+	}
+
+	if (scan_dir)
+	{
+		if (nfnames != 1)
+		{
+			report(NORM, "--scan-dir takes one symbol name");
+			return false;
+		}
+		if (filter.ref_pattern || addr_mode || lines || diff_mode || summary || reach_from || path_to || mem_limit
+		    || connect_sock)
+		{
+			report(NORM, "--scan-dir does not go with -r, --addr, -l, --diff, --summary, --reach-from, "
+			       "--path-to, --mem-limit or --connect");
+			return false;
+		}
+		return true;
+	}
+
+	if (!nfnames)
 	{
 		report(NORM, "ELF file name required");
 		return false;
 	}
 
+	if ((reach_from || path_to) && (addr_mode || lines || diff_mode || summary || connect_sock))
+	{
+		report(NORM, "--reach-from and --path-to do not go with --addr, -l, --diff, --summary or --connect");
+		return false;
+	}
+
+	if (mem_limit && (addr_mode || diff_mode || reach_from || path_to || connect_sock))
+	{
+		report(NORM, "--mem-limit does not go with --addr, --diff, --reach-from, --path-to or --connect");
+		return false;
+	}
+
+	if (summary && (addr_mode || lines || diff_mode || connect_sock))
+	{
+		report(NORM, "--summary does not go with --addr, -l, --diff or --connect");
+		return false;
+	}
+
+	if (sample_rate < 1 && !summary)
+	{
+		report(NORM, "--sample goes with --summary");
+		return false;
+	}
+
+	if (diff_mode)
+	{
+		if (nfnames != 2)
+		{
+			report(NORM, "--diff takes two file names");
+			return false;
+		}
+		if (addr_mode || lines || connect_sock)
+		{
+			report(NORM, "--diff does not go with --addr, -l or --connect");
+			return false;
+		}
+		return true;
+	}
+
+	if (nfnames > 1 && connect_sock)
+	{
+		report(NORM, "--connect takes one file name");
+		return false;
+	}
+
+	if ((addr_mode || lines) && connect_sock)
+	{
+		report(NORM, "--addr and -l do not go with --connect");
+		return false;
+	}
+
+	if (kinds != RELTYPE_ALL && connect_sock)
+	{
+		report(NORM, "--kind does not go with --connect; give it to --serve instead");
+		return false;
+	}
+
 	return true;
 }
 
 /**
- * Returns the input ELF file name.
+ * Returns the (first) input ELF file name.
  */
 extern const char * 	args_get_input_file_name(void)
 {
-	return fname;
+	return nfnames ? fnames[0] : NULL;
+}
+
+/**
+ * Returns the input ELF file names and stores their number in *n.
+ */
+extern const char **	args_get_input_files(size_t* n)
+{
+	assert(n);
+
+	*n = nfnames;
+	return fnames;
 }
 
 
@@ -165,7 +657,15 @@ extern unsigned int 	args_get_verbosity(void)
  */
 extern const char * 	args_get_name_pattern(void)
 {
-	return name_pattern;
+	return filter.name_pattern;
+}
+
+/**
+ * Returns the naming pattern of the referenced symbols the user is interested in (the -r option).
+ */
+extern const char * 	args_get_ref_pattern(void)
+{
+	return filter.ref_pattern;
 }
 
 /**
@@ -173,7 +673,7 @@ extern const char * 	args_get_name_pattern(void)
  */
 extern bool 		args_get_is_funcs_only(void)
 {
-	return funcs_only;
+	return filter.funcs_only;
 }
 
 /**
@@ -181,22 +681,206 @@ extern bool 		args_get_is_funcs_only(void)
  */
 extern bool 		args_get_is_offsets_decimal(void)
 {
-	return offsets_decimal;
+	return filter.offsets_decimal;
 }
 
 /**
- * Returns true if the symbol name and type satisfy filter specified by the user.
+ * Returns the filter that selects what is shown to the user (see symtab_dump_to()).
  */
-extern bool		args_sym_is_interesting(const char *name, int type)
+extern const symtab_filter_t *	args_get_filter(void)
 {
-	if (type != STT_FUNC && type != STT_OBJECT)
-		return false;
+	return &filter;
+}
 
-	if (args_get_is_funcs_only() && type != STT_FUNC)
-		return false;
+/**
+ * Returns the socket name to serve queries on (the --serve option) or NULL.
+ */
+extern const char *	args_get_serve_socket(void)
+{
+	return serve_sock;
+}
 
-	if (args_get_name_pattern() && strstr(name, args_get_name_pattern()) == NULL)
-		return false;
+/**
+ * Returns the socket name of the server to send the query to (the --connect option) or NULL.
+ */
+extern const char *	args_get_connect_socket(void)
+{
+	return connect_sock;
+}
 
-	return true;
+/**
+ * Returns the memory budget in bytes for the files kept in memory by the server (the --cache-mem option).
+ */
+extern size_t		args_get_cache_mem(void)
+{
+	return cache_mem;
+}
+
+/**
+ * Returns the directory to index (the --index option) or NULL.
+ */
+extern const char *	args_get_index_dir(void)
+{
+	return index_dir;
+}
+
+/**
+ * Returns the directory to find the files referring to a symbol in (the --scan-dir option) or NULL.
+ */
+extern const char *	args_get_scan_dir(void)
+{
+	return scan_dir;
+}
+
+/**
+ * Returns the name of the index database (the --db option) or NULL.
+ */
+extern const char *	args_get_db_name(void)
+{
+	return db_name;
+}
+
+/**
+ * Returns true if the index is to be kept up to date as the files change (the --watch option).
+ */
+extern bool		args_get_is_watch(void)
+{
+	return watch;
+}
+
+/**
+ * Returns the naming pattern of the relocation sections to read (the --section option) or NULL.
+ */
+extern const char *	args_get_section_pattern(void)
+{
+	return section_pattern;
+}
+
+/**
+ * Returns the kinds of relocations to keep (the --kind option) as a mask of reltype_kind_t bits.
+ */
+extern unsigned		args_get_kinds(void)
+{
+	return kinds;
+}
+
+/**
+ * Returns true if the source lines of the references are to be shown (the -l option).
+ */
+extern bool		args_get_is_lines(void)
+{
+	return lines;
+}
+
+/**
+ * Returns true if the symbols containing given addresses are to be shown (the --addr option).
+ */
+extern bool		args_get_is_addr_mode(void)
+{
+	return addr_mode;
+}
+
+/**
+ * Returns true if reference statistics are to be shown rather than the references (the --summary option).
+ */
+extern bool		args_get_is_summary(void)
+{
+	return summary;
+}
+
+/**
+ * Returns how many symbols to show in each list of the statistics (the --top option).
+ */
+extern size_t		args_get_top(void)
+{
+	return top;
+}
+
+/**
+ * Returns the share of relocations to estimate the statistics from (the --sample option), 1 for all of them.
+ */
+extern double		args_get_sample_rate(void)
+{
+	return sample_rate;
+}
+
+/**
+ * Returns the seed of the pseudo-random choice of relocations to estimate the statistics from (the --seed option).
+ */
+extern uint64_t		args_get_seed(void)
+{
+	return seed;
+}
+
+/**
+ * Returns the symbol to show the reachable symbols from (the --reach-from option) or NULL.
+ */
+extern const char *	args_get_reach_from(void)
+{
+	return reach_from;
+}
+
+/**
+ * Returns the symbol to show a chain of references to (the --path-to option) or NULL.
+ */
+extern const char *	args_get_path_to(void)
+{
+	return path_to;
+}
+
+/**
+ * Returns true if the references of two files are to be compared (the --diff option).
+ */
+extern bool		args_get_is_diff_mode(void)
+{
+	return diff_mode;
+}
+
+/**
+ * Returns the addresses given after the file name for the --addr option and stores their number in *n.
+ */
+extern const char **	args_get_addrs(size_t* n)
+{
+	assert(n);
+
+	*n = naddrs;
+	return addrs;
+}
+
+/**
+ * Returns the engine to read the input files with (the --io option). Unless given, several files
+ * are prefetched with io_uring and a single one is just mapped.
+ */
+extern prefetch_engine_t	args_get_io_engine(void)
+{
+	prefetch_engine_t engine = (nfnames > 1) ? PREFETCH_URING : PREFETCH_MMAP;
+	if (io_engine)
+	{
+		prefetch_parse_engine(io_engine, &engine);
+	}
+	return engine;
+}
+
+/**
+ * Returns the memory budget in bytes for the references (the --mem-limit option), 0 if there is none.
+ */
+extern size_t		args_get_mem_limit(void)
+{
+	return mem_limit;
+}
+
+/**
+ * Returns the file to write the timeline of the work done to (the --trace option) or NULL.
+ */
+extern const char *	args_get_trace_file(void)
+{
+	return trace_file;
+}
+
+/**
+ * Returns the number of threads to split the work among (the --threads option), 0 if not given.
+ */
+extern size_t		args_get_threads(void)
+{
+	return threads;
 }
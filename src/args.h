@@ -29,22 +29,56 @@
 #define ARGS_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "prefetch.h"
 
 typedef struct input_s 	input_t;
+typedef struct symtab_filter	symtab_filter_t;
 
 
 void 		args_init(void);
 
 bool 		args_parse(int argc, char* argv[], input_t*);
+int		args_parse_filter_opt(int argc, char* argv[], int* i, symtab_filter_t* f);
 void 		args_usage();
 
 const char * 	args_get_input_file_name(void);
+const char **	args_get_input_files(size_t* n);
 unsigned int 	args_get_verbosity(void);
 const char * 	args_get_name_pattern(void);
+const char * 	args_get_ref_pattern(void);
 bool 		args_get_is_funcs_only(void);
 bool 		args_get_is_offsets_decimal(void);
+const symtab_filter_t *	args_get_filter(void);
+
+const char *	args_get_serve_socket(void);
+const char *	args_get_connect_socket(void);
+size_t		args_get_cache_mem(void);
+
+const char *	args_get_index_dir(void);
+const char *	args_get_db_name(void);
+bool		args_get_is_watch(void);
+
+const char *	args_get_scan_dir(void);
 
-bool		args_sym_is_interesting(const char *name, int type);
+const char *	args_get_section_pattern(void);
+unsigned	args_get_kinds(void);
+bool		args_get_is_lines(void);
+bool		args_get_is_addr_mode(void);
+const char **	args_get_addrs(size_t* n);
+bool		args_get_is_diff_mode(void);
+bool		args_get_is_summary(void);
+const char *	args_get_reach_from(void);
+const char *	args_get_path_to(void);
+size_t		args_get_top(void);
+double		args_get_sample_rate(void);
+uint64_t	args_get_seed(void);
+prefetch_engine_t	args_get_io_engine(void);
+size_t		args_get_mem_limit(void);
+const char *	args_get_trace_file(void);
+size_t		args_get_threads(void);
 
 #endif
 
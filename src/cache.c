@@ -0,0 +1,461 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// Keeps parsed input files (their symbol tables with the relocations attributed)
+// in memory for the query server (see server.c). The files are evicted in the
+// least recently used order once the memory they occupy exceeds the budget.
+
+#include "cache.h"
+#include "input.h"
+#include "symtab.h"
+#include "errors.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define CACHE_RESPONSES	8	// number of the recent query responses kept per file
+
+/**
+ * Describes a query response that is kept around for the case the query is repeated.
+ */
+typedef struct response
+{
+	char *		query;
+	char *		text;
+	size_t		len;
+} response;
+
+/**
+ * Describes an input file kept in memory.
+ */
+typedef struct cache_entry_s
+{
+	char *			fname;		// name of the input file
+	dev_t			dev;		// the file's identity at the time it was read;
+	ino_t			ino;		// if any of these change, the file is re-read
+	off_t			size;
+	struct timespec		mtime;
+
+	input_t *		in;		// the input file (stays mapped: symtab refers to its strings)
+	symtab_t *		st;		// the file's symbols along with their relocations
+
+	size_t			mem;		// memory accounted against the cache budget
+	unsigned int		refs;		// number of clients using the entry
+	bool			ready;		// the file has been read in
+	bool			detached;	// not in the LRU list anymore; freed when refs drop to 0
+
+	response		resp[CACHE_RESPONSES];
+	unsigned int		resp_next;	// the slot in resp to replace next
+
+	struct cache_entry_s *	prev;		// LRU list links, most recently used first
+	struct cache_entry_s *	next;
+} cache_entry_s;
+
+/**
+ * Describes a collection of input files kept in memory.
+ */
+typedef struct cache_s
+{
+	pthread_mutex_t		lock;		// guards everything here and the entries' state
+	pthread_cond_t		loaded;		// signalled when an entry has been read in (or failed to)
+
+	cache_entry_s *		head;		// LRU list of entries, most recently used first
+	cache_entry_s *		tail;
+
+	size_t			mem;		// memory occupied by all entries in the list
+	size_t			budget;		// the limit for mem
+} cache_s;
+
+/**
+ * Allocates the cache of input files that will try to occupy no more than mem_budget bytes.
+ * The allocated resources must be released with cache_free().
+ */
+extern cache_t *	cache_alloc(size_t mem_budget)
+{
+	cache_s *c = calloc(1, sizeof(cache_s));
+	if (!c)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	pthread_mutex_init(&c->lock, NULL);
+	pthread_cond_init(&c->loaded, NULL);
+	c->budget = mem_budget;
+
+	return c;
+}
+
+static void	entry_free(cache_entry_s* e)
+{
+	assert(e->refs == 0);
+
+	if (e->st)
+	{
+		symtab_free(e->st);
+	}
+
+	if (e->in)
+	{
+		input_close(e->in);
+		input_free(e->in);
+	}
+
+	for (unsigned int i = 0; i < CACHE_RESPONSES; ++i)
+	{
+		free(e->resp[i].query);
+		free(e->resp[i].text);
+	}
+
+	free(e->fname);
+	free(e);
+}
+
+static void	entry_unlink(cache_s* c, cache_entry_s* e)
+{
+	assert(!e->detached);
+
+	if (e->prev)
+		e->prev->next = e->next;
+	else
+		c->head = e->next;
+
+	if (e->next)
+		e->next->prev = e->prev;
+	else
+		c->tail = e->prev;
+
+	e->prev = e->next = NULL;
+	e->detached = true;
+	c->mem -= e->mem;
+}
+
+static void	entry_link_first(cache_s* c, cache_entry_s* e)
+{
+	e->prev = NULL;
+	e->next = c->head;
+	if (c->head)
+		c->head->prev = e;
+	c->head = e;
+	if (!c->tail)
+		c->tail = e;
+}
+
+/**
+ * Evicts the least recently used entries nobody is using until the cache fits into the budget.
+ * Must be called with the lock held.
+ */
+static void	evict(cache_s* c)
+{
+	cache_entry_s *e = c->tail;
+	while (e && c->mem > c->budget)
+	{
+		cache_entry_s *prev = e->prev;
+		if (e->refs == 0 && e->ready)
+		{
+			report(VERB, "Evicting %s (%zuK)", e->fname, e->mem/1024);
+			entry_unlink(c, e);
+			entry_free(e);
+		}
+		e = prev;
+	}
+}
+
+/**
+ * Drops a reference to the entry freeing it if it is no longer needed. Must be called with the lock held.
+ */
+static void	entry_release(cache_s* c, cache_entry_s* e)
+{
+	assert(e->refs > 0);
+
+	e->refs--;
+	if (e->refs == 0)
+	{
+		if (e->detached)
+		{
+			entry_free(e);
+		}
+		else
+		{
+			evict(c);
+		}
+	}
+}
+
+/**
+ * Releases all the resources of the cache. No entry may be in use.
+ */
+extern void	cache_free(cache_t* c)
+{
+	assert(c);
+
+	while (c->head)
+	{
+		cache_entry_s *e = c->head;
+		entry_unlink(c, e);
+		entry_free(e);
+	}
+
+	pthread_cond_destroy(&c->loaded);
+	pthread_mutex_destroy(&c->lock);
+	free(c);
+}
+
+/**
+ * Reads in the input file of the entry given; returns false and puts the reason into err if that fails.
+ * Called without the lock held.
+ */
+static bool	entry_load(cache_entry_s* e, char* err, size_t err_size)
+{
+	input_t *in = input_init();
+	symtab_t *st = input_read_refs(in, e->fname, err, err_size);
+	if (!st)
+	{
+		report(NORM, "Cannot read %s: %s", e->fname, err);
+		input_free(in);
+		return false;
+	}
+
+	// The queries walk the table from several threads at once, which must not be the first to do it
+	symtab_build_rows(st);
+
+	e->in = in;
+	e->st = st;
+	e->mem = sizeof(cache_entry_s) + symtab_get_mem_usage(st);
+	return true;
+}
+
+/**
+ * Returns the entry for the given input file reading it in if necessary, or NULL with the reason in err
+ * if the file can't be read. The returned entry must be released with cache_release().
+ */
+extern cache_entry_t *	cache_acquire(cache_t* c, const char* fname, char* err, size_t err_size)
+{
+	assert(c);
+	assert(fname);
+
+	struct stat sb;
+	if (stat(fname, &sb) == -1)
+	{
+		snprintf(err, err_size, "Cannot open input file (%s)", fname);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&c->lock);
+
+	cache_entry_s *e = c->head;
+	for (; e; e = e->next)
+	{
+		if (strcmp(e->fname, fname) == 0)
+		{
+			break;
+		}
+	}
+
+	if (e && e->ready
+	    && (e->dev != sb.st_dev || e->ino != sb.st_ino || e->size != sb.st_size
+		|| e->mtime.tv_sec != sb.st_mtim.tv_sec || e->mtime.tv_nsec != sb.st_mtim.tv_nsec))
+	{
+		report(VERB, "%s changed, re-reading", fname);
+		entry_unlink(c, e);
+		if (e->refs == 0)
+		{
+			entry_free(e);
+		}
+		e = NULL;
+	}
+
+	if (e)
+	{
+		// Hit, possibly still being read in by another client
+		e->refs++;
+		if (e != c->head)
+		{
+			// move to the front of the LRU list
+			e->prev->next = e->next;
+			if (e->next)
+				e->next->prev = e->prev;
+			else
+				c->tail = e->prev;
+			entry_link_first(c, e);
+		}
+
+		while (!e->ready && !e->detached)
+		{
+			pthread_cond_wait(&c->loaded, &c->lock);
+		}
+
+		if (!e->ready)
+		{
+			snprintf(err, err_size, "Cannot read input file (%s)", fname);
+			entry_release(c, e);
+			e = NULL;
+		}
+		pthread_mutex_unlock(&c->lock);
+		return e;
+	}
+
+	// Miss: read the file in without holding the lock so that others can be served meanwhile
+	e = calloc(1, sizeof(cache_entry_s));
+	if (!e || !(e->fname = strdup(fname)))
+	{
+		fatal_err("Not enough memory");
+	}
+	e->dev = sb.st_dev;
+	e->ino = sb.st_ino;
+	e->size = sb.st_size;
+	e->mtime = sb.st_mtim;
+	e->refs = 1;
+	entry_link_first(c, e);
+	pthread_mutex_unlock(&c->lock);
+
+	const bool ok = entry_load(e, err, err_size);
+
+	pthread_mutex_lock(&c->lock);
+	if (ok)
+	{
+		e->ready = true;
+		if (!e->detached)
+		{
+			c->mem += e->mem;
+			report(VERB, "Read in %s (%zuK), cache now holds %zuK", fname, e->mem/1024, c->mem/1024);
+			evict(c);
+		}
+	}
+	else if (!e->detached)
+	{
+		entry_unlink(c, e);
+	}
+	pthread_cond_broadcast(&c->loaded);
+
+	if (!ok)
+	{
+		entry_release(c, e);
+		e = NULL;
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	return e;
+}
+
+/**
+ * Tells the cache the entry is no longer used by the caller.
+ */
+extern void	cache_release(cache_t* c, cache_entry_t* e)
+{
+	assert(c);
+	assert(e);
+
+	pthread_mutex_lock(&c->lock);
+	entry_release(c, e);
+	pthread_mutex_unlock(&c->lock);
+}
+
+/**
+ * Returns the symbol table of the input file the entry describes.
+ */
+extern symtab_t *	cache_entry_get_symtab(cache_entry_t* e)
+{
+	assert(e);
+	assert(e->ready);
+
+	return e->st;
+}
+
+/**
+ * Returns a copy of the response previously given to the query on the entry or NULL if there is none.
+ * The copy must be released with free().
+ */
+extern char *	cache_entry_get_response(cache_t* c, cache_entry_t* e, const char* query, size_t* len)
+{
+	assert(c && e && query && len);
+
+	char *ret = NULL;
+
+	pthread_mutex_lock(&c->lock);
+	for (unsigned int i = 0; i < CACHE_RESPONSES; ++i)
+	{
+		response *r = &e->resp[i];
+		if (r->query && strcmp(r->query, query) == 0)
+		{
+			ret = malloc(r->len + 1);
+			if (!ret)
+			{
+				fatal_err("Not enough memory");
+			}
+			memcpy(ret, r->text, r->len + 1);
+			*len = r->len;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	return ret;
+}
+
+/**
+ * Remembers the response to the query on the entry given, replacing the oldest one remembered.
+ */
+extern void	cache_entry_add_response(cache_t* c, cache_entry_t* e, const char* query, const char* text, size_t len)
+{
+	assert(c && e && query && text);
+
+	char *q = strdup(query);
+	char *t = malloc(len + 1);
+	if (!q || !t)
+	{
+		fatal_err("Not enough memory");
+	}
+	memcpy(t, text, len);
+	t[len] = 0;
+
+	pthread_mutex_lock(&c->lock);
+
+	response *r = &e->resp[e->resp_next];
+	e->resp_next = (e->resp_next + 1) % CACHE_RESPONSES;
+
+	const size_t old_mem = r->query ? strlen(r->query) + r->len : 0;
+	free(r->query);
+	free(r->text);
+	r->query = q;
+	r->text = t;
+	r->len = len;
+
+	const size_t new_mem = strlen(q) + len;
+	e->mem = e->mem - old_mem + new_mem;
+	if (!e->detached)
+	{
+		c->mem = c->mem - old_mem + new_mem;
+		evict(c);
+	}
+
+	pthread_mutex_unlock(&c->lock);
+}
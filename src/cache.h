@@ -0,0 +1,47 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <stddef.h>
+
+typedef struct symtab_s		symtab_t;
+typedef struct cache_s		cache_t;
+typedef struct cache_entry_s	cache_entry_t;
+
+cache_t *	cache_alloc(size_t mem_budget);
+void		cache_free(cache_t* c);
+
+cache_entry_t *	cache_acquire(cache_t* c, const char* fname, char* err, size_t err_size);
+void		cache_release(cache_t* c, cache_entry_t* e);
+
+symtab_t *	cache_entry_get_symtab(cache_entry_t* e);
+char *		cache_entry_get_response(cache_t* c, cache_entry_t* e, const char* query, size_t* len);
+void		cache_entry_add_response(cache_t* c, cache_entry_t* e, const char* query, const char* resp, size_t len);
+
+#endif
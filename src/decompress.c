@@ -0,0 +1,580 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+
+// Decompression of gzip- and zstd-compressed input files into memory.
+//
+// The image is decompressed into an anonymous mapping, and only as far as the
+// readers are going to look: the ELF header tells where the section header
+// table ends, and that tells where the furthest section ends. Zstd input made
+// of several frames with their sizes recorded (as pzstd and zstd --block-size
+// write it) has its frames decompressed by several threads at once, each
+// straight into its place in the image. Zstd support depends on libzstd
+// being found at build time (HAVE_ZSTD).
+
+#include "decompress.h"
+#include "errors.h"
+#include "globals.h"
+#include "input.h"
+
+#include <assert.h>
+#include <elf.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#define CHUNK			((size_t)1 << 20)	// decompressed past what is needed at most
+#define PARALLEL_MIN_SIZE	((size_t)8 << 20)	// don't bother with threads for less than this
+#define MAX_THREADS		16
+
+#define ZSTD_MAGIC		0xFD2FB528U
+#define ZSTD_SKIPPABLE_MAGIC	0x184D2A50U		// the low 4 bits are any
+#define ZSTD_SKIPPABLE_MASK	0xFFFFFFF0U
+
+/**
+ * The image being decompressed.
+ */
+typedef struct image
+{
+	char **		map;		// the caller's, so that it can release the mapping on a fatal error
+	size_t *	map_size;
+	size_t		size;		// bytes decompressed
+} image;
+
+/**
+ * Makes the image's mapping at least size bytes large.
+ */
+static void	image_reserve(image* im, size_t size)
+{
+	static size_t page_size;
+	if (!page_size)
+	{
+		page_size = (size_t)sysconf(_SC_PAGESIZE);
+	}
+
+	size = (size + page_size - 1) & ~(page_size - 1);
+	if (size <= *im->map_size)
+		return;
+
+	void *p = *im->map
+		? mremap(*im->map, *im->map_size, size, MREMAP_MAYMOVE)
+		: mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED)
+	{
+		fatal_err("Not enough memory to decompress input");
+	}
+	*im->map = p;
+	*im->map_size = size;
+}
+
+/**
+ * Returns where the section header table of the ELF image ends given the first have bytes of it (at least
+ * its header), 0 if the image is not ELF, or SIZE_MAX if the table can not be told. With SHN_LORESERVE
+ * sections or more, their number is in the first section header: until it's there, that's where it ends.
+ */
+static size_t	elf_shdrs_end(const unsigned char* img, size_t have)
+{
+	if (memcmp(img, ELFMAG, SELFMAG) != 0 || (img[EI_CLASS] != ELFCLASS32 && img[EI_CLASS] != ELFCLASS64))
+		return 0;
+
+	const bool is64 = (img[EI_CLASS] == ELFCLASS64);
+	const bool be = (img[EI_DATA] == ELFDATA2MSB);
+	const uint64_t shoff = ELF_FIELD(img, Ehdr, e_shoff, is64, be);
+	const uint64_t shentsize = ELF_FIELD(img, Ehdr, e_shentsize, is64, be);
+	uint64_t shnum = ELF_FIELD(img, Ehdr, e_shnum, is64, be);
+	const uint64_t min_shentsize = is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr);
+
+	if (shoff == 0 || shentsize < min_shentsize || shoff > SIZE_MAX - shentsize)
+		return SIZE_MAX;
+
+	if (shnum == 0)
+	{
+		if (have < shoff + shentsize)
+			return (size_t)(shoff + shentsize);
+		shnum = ELF_FIELD(img + shoff, Shdr, sh_size, is64, be);
+	}
+
+	if (shnum == 0 || shnum > (SIZE_MAX - shoff)/shentsize)
+		return SIZE_MAX;
+
+	return (size_t)(shoff + shentsize*shnum);
+}
+
+/**
+ * Returns where the furthest section of the ELF image ends given its header and section header table
+ * of shnum entries.
+ */
+static size_t	elf_sections_end(const unsigned char* ehdr, const unsigned char* shdrs, uint64_t shnum)
+{
+	const bool is64 = (ehdr[EI_CLASS] == ELFCLASS64);
+	const bool be = (ehdr[EI_DATA] == ELFDATA2MSB);
+	const uint64_t shentsize = ELF_FIELD(ehdr, Ehdr, e_shentsize, is64, be);
+
+	size_t end = 0;
+	for (uint64_t k = 0; k < shnum; ++k)
+	{
+		const unsigned char *shdr = shdrs + k*shentsize;
+		const uint64_t off = ELF_FIELD(shdr, Shdr, sh_offset, is64, be);
+		const uint64_t size = ELF_FIELD(shdr, Shdr, sh_size, is64, be);
+		if (ELF_FIELD(shdr, Shdr, sh_type, is64, be) == SHT_NOBITS || off > SIZE_MAX - size)
+			continue;
+
+		if (off + size > end)
+		{
+			end = (size_t)(off + size);
+		}
+	}
+
+	return end;
+}
+
+/**
+ * Returns how much of the ELF image must be decompressed given the first have bytes of it: the ELF header
+ * first, then the section header table, then the sections. SIZE_MAX means all of it.
+ */
+static size_t	elf_extent(const char* img, size_t have)
+{
+	const unsigned char *p = (const unsigned char*)img;
+
+	if (have < sizeof(Elf64_Ehdr))
+		return sizeof(Elf64_Ehdr);
+
+	const size_t shdrs_end = elf_shdrs_end(p, have);
+	if (shdrs_end == 0)
+		return have; // not ELF, which the caller finds out
+	if (shdrs_end == SIZE_MAX || have < shdrs_end)
+		return shdrs_end;
+
+	const bool is64 = (p[EI_CLASS] == ELFCLASS64);
+	const bool be = (p[EI_DATA] == ELFDATA2MSB);
+	const uint64_t shoff = ELF_FIELD(p, Ehdr, e_shoff, is64, be);
+	const uint64_t shnum = (shdrs_end - shoff)/ELF_FIELD(p, Ehdr, e_shentsize, is64, be);
+	const size_t sections_end = elf_sections_end(p, p + shoff, shnum);
+
+	return (sections_end > shdrs_end) ? sections_end : shdrs_end;
+}
+
+/**
+ * Returns the format the data is compressed in, judging by its magic number.
+ */
+extern decompress_format_t	decompress_detect(const char* data, size_t size)
+{
+	const unsigned char *p = (const unsigned char*)data;
+
+	if (size >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+		return DECOMPRESS_GZIP;
+
+	if (size >= 4)
+	{
+		const uint32_t magic = (uint32_t)get_field(p, 4, false);
+		if (magic == ZSTD_MAGIC || (magic & ZSTD_SKIPPABLE_MASK) == ZSTD_SKIPPABLE_MAGIC)
+			return DECOMPRESS_ZSTD;
+	}
+
+	return DECOMPRESS_NONE;
+}
+
+/**
+ * Returns the name of the compression format.
+ */
+extern const char *	decompress_format_name(decompress_format_t fmt)
+{
+	switch (fmt)
+	{
+	case DECOMPRESS_GZIP:
+		return "gzip";
+	case DECOMPRESS_ZSTD:
+		return "zstd";
+	default:
+		return "uncompressed";
+	}
+}
+
+/**
+ * Decompresses gzip data (possibly several members) into the image as far as elf_extent() says.
+ */
+static void	inflate_image(const char* data, size_t size, image* im)
+{
+	// The size of the last member is at the end of the data, modulo 4GB: a good guess for a single one
+	const size_t isize = (size >= 4) ? (size_t)get_field((const unsigned char*)data + size - 4, 4, false) : 0;
+	image_reserve(im, (isize > size) ? isize : 4*size);
+
+	z_stream zs;
+	memset(&zs, 0, sizeof(zs));
+	if (inflateInit2(&zs, 15 + 32) != Z_OK) // 32: gzip or zlib header
+	{
+		fatal("Cannot decompress input: %s", zs.msg ? zs.msg : "zlib failed");
+	}
+
+	size_t in_pos = 0;
+	for (size_t need = elf_extent(*im->map, 0); im->size < need; need = elf_extent(*im->map, im->size))
+	{
+		if (im->size == *im->map_size)
+		{
+			image_reserve(im, 2*im->size);
+		}
+
+		const size_t want = (need - im->size > CHUNK) ? need - im->size : CHUNK;
+		const size_t room = *im->map_size - im->size;
+		const size_t out = (want < room) ? want : room;
+		zs.next_out = (Bytef*)*im->map + im->size;
+		zs.avail_out = (uInt)((out < UINT_MAX) ? out : UINT_MAX);
+		zs.next_in = (Bytef*)data + in_pos;
+		zs.avail_in = (uInt)((size - in_pos < UINT_MAX) ? size - in_pos : UINT_MAX);
+
+		const int ret = inflate(&zs, Z_NO_FLUSH);
+		im->size = (size_t)((char*)zs.next_out - *im->map);
+		in_pos = (size_t)((const char*)zs.next_in - data);
+
+		if (ret == Z_STREAM_END)
+		{
+			// Another member may follow, unless it's the padding some tools add
+			if (in_pos + 2 > size || (unsigned char)data[in_pos] != 0x1f || (unsigned char)data[in_pos + 1] != 0x8b)
+				break;
+			inflateReset(&zs);
+		}
+		else if (ret == Z_BUF_ERROR && in_pos == size)
+		{
+			inflateEnd(&zs);
+			fatal("Compressed input is truncated");
+		}
+		else if (ret != Z_OK)
+		{
+			const char *msg = zs.msg ? zs.msg : "corrupted data";
+			inflateEnd(&zs);
+			fatal("Cannot decompress input: %s", msg);
+		}
+	}
+
+	inflateEnd(&zs);
+}
+
+#ifdef HAVE_ZSTD
+
+/**
+ * A zstd frame: where it is in the data and where it goes in the image.
+ */
+typedef struct frame
+{
+	size_t		off;
+	size_t		size;
+	size_t		image_off;
+	size_t		image_size;
+	bool		done;
+} frame;
+
+/**
+ * The frames to decompress in parallel, taken by the threads one at a time.
+ */
+typedef struct frame_job
+{
+	const char *	data;
+	char *		map;
+	frame **	frames;
+	size_t		nframes;
+	size_t		next;		// the frame to be taken next
+	pthread_mutex_t	lock;
+	const char *	err;		// of the first frame that failed
+} frame_job;
+
+static void *	decompress_frames(void* arg)
+{
+	frame_job *job = arg;
+
+	ZSTD_DCtx *dctx = ZSTD_createDCtx();
+	for (;;)
+	{
+		pthread_mutex_lock(&job->lock);
+		const size_t i = job->next++;
+		const bool stop = (i >= job->nframes || job->err || !dctx);
+		if (!dctx && !job->err)
+		{
+			job->err = "Not enough memory";
+		}
+		pthread_mutex_unlock(&job->lock);
+		if (stop)
+			break;
+
+		frame *f = job->frames[i];
+		const size_t n = ZSTD_decompressDCtx(dctx, job->map + f->image_off, f->image_size, job->data + f->off, f->size);
+		if (ZSTD_isError(n) || n != f->image_size)
+		{
+			pthread_mutex_lock(&job->lock);
+			job->err = ZSTD_isError(n) ? ZSTD_getErrorName(n) : "frame size mismatch";
+			pthread_mutex_unlock(&job->lock);
+			break;
+		}
+		f->done = true;
+	}
+	ZSTD_freeDCtx(dctx);
+
+	return NULL;
+}
+
+/**
+ * Decompresses the frames of the image that lie, at least partly, in [from, to) and are not decompressed
+ * yet with several threads.
+ */
+static void	decompress_frames_parallel(const char* data, image* im, frame* frames, size_t nframes,
+					   size_t from, size_t to)
+{
+	frame **todo = malloc(nframes*sizeof(frame*));
+	if (!todo)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	frame_job job = { .data = data, .map = *im->map, .frames = todo, .nframes = 0 };
+	for (size_t i = 0; i < nframes && frames[i].image_off < to; ++i)
+	{
+		if (!frames[i].done && frames[i].image_off + frames[i].image_size > from)
+		{
+			todo[job.nframes++] = &frames[i];
+		}
+	}
+	pthread_mutex_init(&job.lock, NULL);
+
+	size_t nthreads = glob_get_threads();
+	nthreads = (nthreads < job.nframes) ? nthreads : job.nframes;
+	nthreads = (nthreads < MAX_THREADS) ? nthreads : MAX_THREADS;
+
+	pthread_t tids[MAX_THREADS];
+	size_t nstarted = 1;
+	for (; nstarted < nthreads; ++nstarted)
+	{
+		if (pthread_create(&tids[nstarted], NULL, decompress_frames, &job) != 0)
+			break; // the threads that started do the rest
+	}
+	decompress_frames(&job);
+	for (size_t t = 1; t < nstarted; ++t)
+	{
+		pthread_join(tids[t], NULL);
+	}
+	pthread_mutex_destroy(&job.lock);
+	free(todo);
+
+	if (job.err)
+	{
+		fatal("Cannot decompress input: %s", job.err);
+	}
+}
+
+/**
+ * Lists the frames of the data if they all have their decompressed sizes recorded. Returns the number of
+ * the frames, 0 if any does not, and stores the size of the whole image in *total.
+ */
+static size_t	list_frames(const char* data, size_t size, frame** frames, size_t* total)
+{
+	size_t n = 0;
+	size_t cap = 0;
+	*frames = NULL;
+	*total = 0;
+
+	for (size_t off = 0; off < size; )
+	{
+		const size_t csize = ZSTD_findFrameCompressedSize(data + off, size - off);
+		const unsigned long long dsize = ZSTD_getFrameContentSize(data + off, size - off);
+		if (ZSTD_isError(csize) || dsize == ZSTD_CONTENTSIZE_UNKNOWN || dsize == ZSTD_CONTENTSIZE_ERROR
+		    || dsize > SIZE_MAX - *total)
+		{
+			free(*frames);
+			*frames = NULL;
+			return 0;
+		}
+
+		if (n == cap)
+		{
+			cap = cap ? 2*cap : 64;
+			frame *p = realloc(*frames, cap*sizeof(frame));
+			if (!p)
+			{
+				fatal_err("Not enough memory");
+			}
+			*frames = p;
+		}
+
+		// Skippable frames (pzstd writes one in front of each frame) have no content
+		(*frames)[n++] = (frame){ .off = off, .size = csize, .image_off = *total, .image_size = (size_t)dsize,
+					   .done = (dsize == 0) };
+		*total += (size_t)dsize;
+		off += csize;
+	}
+
+	return n;
+}
+
+/**
+ * Decompresses zstd data into the image as far as elf_extent() says.
+ */
+static void	zstd_image(const char* data, size_t size, image* im)
+{
+	frame *frames = NULL;
+	size_t total = 0;
+	const size_t nframes = list_frames(data, size, &frames, &total);
+	if (nframes > 1 && total >= PARALLEL_MIN_SIZE)
+	{
+		image_reserve(im, total);
+
+		// The headers first, to know which frames are needed
+		decompress_frames_parallel(data, im, frames, nframes, 0, sizeof(Elf64_Ehdr));
+		const unsigned char *ehdr = (unsigned char*)*im->map;
+		size_t shdrs_end = (total >= sizeof(Elf64_Ehdr)) ? elf_shdrs_end(ehdr, sizeof(Elf64_Ehdr)) : 0;
+		size_t need = total;
+		if (shdrs_end == 0)
+		{
+			need = sizeof(Elf64_Ehdr); // not ELF
+		}
+		else if (shdrs_end <= total)
+		{
+			const bool is64 = (ehdr[EI_CLASS] == ELFCLASS64);
+			const bool be = (ehdr[EI_DATA] == ELFDATA2MSB);
+			const size_t shoff = (size_t)ELF_FIELD(ehdr, Ehdr, e_shoff, is64, be);
+			decompress_frames_parallel(data, im, frames, nframes, shoff, shdrs_end);
+
+			// With extended numbering, that was only the first section header, which tells the rest
+			if (ELF_FIELD(ehdr, Ehdr, e_shnum, is64, be) == 0)
+			{
+				shdrs_end = elf_shdrs_end(ehdr, shdrs_end);
+				if (shdrs_end <= total)
+					decompress_frames_parallel(data, im, frames, nframes, shoff, shdrs_end);
+			}
+
+			if (shdrs_end <= total)
+			{
+				const uint64_t shnum = (shdrs_end - shoff)/ELF_FIELD(ehdr, Ehdr, e_shentsize, is64, be);
+				const size_t sections_end = elf_sections_end(ehdr, ehdr + shoff, shnum);
+				need = (sections_end > shdrs_end) ? sections_end : shdrs_end;
+				need = (need < total) ? need : total;
+			}
+		}
+
+		decompress_frames_parallel(data, im, frames, nframes, sizeof(Elf64_Ehdr), need);
+
+		im->size = sizeof(Elf64_Ehdr);
+		for (size_t i = 0; i < nframes && frames[i].image_off < need; ++i)
+		{
+			im->size = frames[i].image_off + frames[i].image_size;
+		}
+		report(VERB, "Decompressed %zu zstd frames in parallel", nframes);
+		free(frames);
+		return;
+	}
+	free(frames);
+
+	image_reserve(im, total ? total : 4*size);
+
+	ZSTD_DCtx *dctx = ZSTD_createDCtx();
+	if (!dctx)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	ZSTD_inBuffer in = { data, size, 0 };
+	for (size_t need = elf_extent(*im->map, 0); im->size < need; need = elf_extent(*im->map, im->size))
+	{
+		if (im->size == *im->map_size)
+		{
+			image_reserve(im, 2*im->size);
+		}
+
+		const size_t want = (need - im->size > CHUNK) ? need - im->size : CHUNK;
+		const size_t room = *im->map_size - im->size;
+		ZSTD_outBuffer out = { *im->map + im->size, (want < room) ? want : room, 0 };
+
+		const size_t ret = ZSTD_decompressStream(dctx, &out, &in);
+		im->size += out.pos;
+		if (ZSTD_isError(ret))
+		{
+			ZSTD_freeDCtx(dctx);
+			fatal("Cannot decompress input: %s", ZSTD_getErrorName(ret));
+		}
+		if (in.pos == in.size && out.pos < out.size)
+		{
+			// All the input is consumed and the output is not full: that's all there is
+			if (ret != 0)
+			{
+				ZSTD_freeDCtx(dctx);
+				fatal("Compressed input is truncated");
+			}
+			break;
+		}
+	}
+
+	ZSTD_freeDCtx(dctx);
+}
+
+#endif // HAVE_ZSTD
+
+/**
+ * Decompresses the data in the given format into a new anonymous mapping, which is stored in *map with its
+ * size in *map_size as soon as it is made or grows: the caller releases it with munmap(), also if a fatal
+ * error occurs. Returns the number of bytes decompressed, which is no more than the readers look at.
+ */
+extern size_t	decompress_image(const char* data, size_t size, decompress_format_t fmt, char** map,
+				 size_t* map_size)
+{
+	assert(data);
+	assert(map && map_size);
+
+	*map = NULL;
+	*map_size = 0;
+	image im = { .map = map, .map_size = map_size, .size = 0 };
+
+	switch (fmt)
+	{
+	case DECOMPRESS_GZIP:
+		inflate_image(data, size, &im);
+		break;
+
+	case DECOMPRESS_ZSTD:
+#ifdef HAVE_ZSTD
+		zstd_image(data, size, &im);
+		break;
+#else
+		fatal("Input is zstd-compressed, and elfref was built without libzstd");
+#endif
+
+	default:
+		assert(false);
+	}
+
+	if (im.size == 0)
+	{
+		fatal("Compressed input is empty");
+	}
+
+	return im.size;
+}
@@ -29,17 +29,63 @@
 #ifndef DEPINPUT_H_
 #define DEPINPUT_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
 typedef struct input_s		input_t;
 typedef struct symtab_s		symtab_t;
 typedef struct elf_sections_s 	elf_sections_t;
+typedef struct input_section	input_section_t;
+typedef struct input_reloc	input_reloc_t;
+typedef struct summary_s	summary_t;
+typedef struct spill_s		spill_t;
+typedef struct symtab_filter	symtab_filter_t;
 
-// Bitness-dependent versions, implementations are in depintpu[32|64].c, which is produced by pre-processing depinput.inc
+// Bitness- and byte order-dependent versions, implementations are in depinput[32|64][x].c, which are produced
+// by pre-processing depinput.inc: the x ones read input of the byte order other than ours
 elf_sections_t *	find_sections_32(input_t* in);
-symtab_t*		read_in_symtab_32(input_t* in, elf_sections_t*);
+symtab_t *		read_in_symtab_32(input_t* in, elf_sections_t*);
 void			process_relocations_32(input_t* in, elf_sections_t*, symtab_t*);
+void			summarize_relocations_32(input_t* in, elf_sections_t*, symtab_t*, summary_t*);
+void			spill_relocations_32(input_t* in, elf_sections_t*, symtab_t*, spill_t*);
+void			process_symbol_relocations_32(input_t* in, elf_sections_t*, symtab_t*, const char*);
+bool			stream_relocations_32(input_t* in, elf_sections_t*, symtab_t*, FILE* out,
+					       const symtab_filter_t* filter, size_t* nrefs);
+bool			find_section_32(input_t* in, elf_sections_t*, const char* name, input_section_t* sec);
+size_t			read_section_relocs_32(input_t* in, elf_sections_t*, const char* name, input_reloc_t** relocs);
+
+elf_sections_t *	find_sections_32x(input_t* in);
+symtab_t *		read_in_symtab_32x(input_t* in, elf_sections_t*);
+void			process_relocations_32x(input_t* in, elf_sections_t*, symtab_t*);
+void			summarize_relocations_32x(input_t* in, elf_sections_t*, symtab_t*, summary_t*);
+void			spill_relocations_32x(input_t* in, elf_sections_t*, symtab_t*, spill_t*);
+void			process_symbol_relocations_32x(input_t* in, elf_sections_t*, symtab_t*, const char*);
+bool			stream_relocations_32x(input_t* in, elf_sections_t*, symtab_t*, FILE* out,
+					       const symtab_filter_t* filter, size_t* nrefs);
+bool			find_section_32x(input_t* in, elf_sections_t*, const char* name, input_section_t* sec);
+size_t			read_section_relocs_32x(input_t* in, elf_sections_t*, const char* name, input_reloc_t** relocs);
 
-elf_sections_t*		find_sections_64(input_t* in);
-symtab_t*		read_in_symtab_64(input_t* in, elf_sections_t*);
+elf_sections_t *	find_sections_64(input_t* in);
+symtab_t *		read_in_symtab_64(input_t* in, elf_sections_t*);
 void			process_relocations_64(input_t* in, elf_sections_t*, symtab_t*);
+void			summarize_relocations_64(input_t* in, elf_sections_t*, symtab_t*, summary_t*);
+void			spill_relocations_64(input_t* in, elf_sections_t*, symtab_t*, spill_t*);
+void			process_symbol_relocations_64(input_t* in, elf_sections_t*, symtab_t*, const char*);
+bool			stream_relocations_64(input_t* in, elf_sections_t*, symtab_t*, FILE* out,
+					       const symtab_filter_t* filter, size_t* nrefs);
+bool			find_section_64(input_t* in, elf_sections_t*, const char* name, input_section_t* sec);
+size_t			read_section_relocs_64(input_t* in, elf_sections_t*, const char* name, input_reloc_t** relocs);
+
+elf_sections_t *	find_sections_64x(input_t* in);
+symtab_t *		read_in_symtab_64x(input_t* in, elf_sections_t*);
+void			process_relocations_64x(input_t* in, elf_sections_t*, symtab_t*);
+void			summarize_relocations_64x(input_t* in, elf_sections_t*, symtab_t*, summary_t*);
+void			spill_relocations_64x(input_t* in, elf_sections_t*, symtab_t*, spill_t*);
+void			process_symbol_relocations_64x(input_t* in, elf_sections_t*, symtab_t*, const char*);
+bool			stream_relocations_64x(input_t* in, elf_sections_t*, symtab_t*, FILE* out,
+					       const symtab_filter_t* filter, size_t* nrefs);
+bool			find_section_64x(input_t* in, elf_sections_t*, const char* name, input_section_t* sec);
+size_t			read_section_relocs_64x(input_t* in, elf_sections_t*, const char* name, input_reloc_t** relocs);
 
 #endif // DEPINPUT_H_
\ No newline at end of file
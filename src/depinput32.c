@@ -0,0 +1,1596 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// This file contains bitness- and byte order-dependent routines for reading and
+// processing ELF file. It must be pre-processed before use by replacing 32 with
+// 32 or 64, false with true if the input's byte order is not ours and false if
+// it is, and  with the suffix telling the former readers from the latter (see
+// src/Makefile). As the byte order is known at compile time, the checks for it
+// are folded and the readers for the native one carry no conversion code at all.
+
+#include "depinput.h"
+#include "input.h"
+#include "errors.h"
+#include "symtab.h"
+#include "globals.h"
+#include "args.h"
+#include "summary.h"
+#include "spill.h"
+#include "reltype.h"
+#include "trace.h"
+
+#include <stdbool.h>
+#include <elf.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <sys/mman.h>
+#include <string.h>
+
+#define SWAPPED		false	// the input's byte order is not ours
+
+typedef struct	Elf32
+{
+	Elf32_Shdr *	sections;	// array of all sections
+	uint32_t	shnum;		// number of elements in that array (extended numbering included)
+
+	Elf32_Shdr *	shstrtab;	// string table for section names
+
+	// symtab
+	Elf32_Shdr *	symtab;		// the .symtab section
+	uint32_t	symtab_idx;	// the section's index
+	Elf32_Shdr *	strtab;		// corresponding string section for symbol names
+	Elf32_Shdr *	symtab_shndx;	// its SHT_SYMTAB_SHNDX section, if any
+
+	// dynsym
+	Elf32_Shdr *	dsymtab;	// the .dynsym section
+	uint32_t	dsymtab_idx;	// the section's index
+	Elf32_Shdr *	dstrtab;	// corresponding string section for symbol names
+	Elf32_Shdr *	dsymtab_shndx;
+} Elf32;
+
+typedef struct	Elf64
+{
+	Elf64_Shdr *	sections;
+	uint32_t	shnum;
+
+	Elf64_Shdr *	shstrtab;
+
+	// symtab
+	Elf64_Shdr *	symtab;
+	uint32_t	symtab_idx;
+	Elf64_Shdr *	strtab;
+	Elf64_Shdr *	symtab_shndx;
+
+	// dynsym
+	Elf64_Shdr *	dsymtab;
+	uint32_t	dsymtab_idx;
+	Elf64_Shdr *	dstrtab;
+	Elf64_Shdr *	dsymtab_shndx;
+} Elf64;
+
+typedef struct	elf_sections_s
+{
+	char *	map;	// the input's mapping (see input_get_mem_map())
+
+	union
+	{
+		Elf32	elf32;
+		Elf64	elf64;
+	};
+} elf_sections_s;
+
+// Return the value at p, which is of the byte order other than ours
+static inline uint16_t	swap16(const void* p)
+{
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	return __builtin_bswap16(v);
+}
+
+static inline uint32_t	swap32(const void* p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return __builtin_bswap32(v);
+}
+
+static inline uint64_t	swap64(const void* p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return __builtin_bswap64(v);
+}
+
+static const char*	get_sh_str_32(elf_sections_s* descr, uint32_t i)
+{
+	assert( descr->elf32.shstrtab );
+
+	// The following is not out of range (we checked already)
+	const char* sh_strings = &descr->map[descr->elf32.shstrtab->sh_offset];
+	if ( i >= descr->elf32.shstrtab->sh_size )
+	{
+		fatal("Section header string table index %d out of range (%d)",
+			i, descr->elf32.shstrtab->sh_size);
+	}
+
+	// our resulting string is always null-terminated (we checked already)
+	const char *s = sh_strings+i;
+	return s;
+}
+
+static const char*	get_str_32(elf_sections_s* descr, void* sec, uint32_t i)
+{
+	assert( sec );
+
+	Elf32_Shdr* strtab = sec;
+	// The following is not out of range (we checked already)
+	const char* strings = &descr->map[strtab->sh_offset];
+	if ( i >= strtab->sh_size )
+	{
+		fatal("String table index %d out of range (%d)", i, strtab->sh_size);
+	}
+
+	// our resulting string is always null-terminated (we checked already)
+	const char* s = strings + i;
+	return s;
+}
+
+static void	check_sec_size(input_t* in, elf_sections_s* descr, Elf32_Shdr* sec)
+{
+	if ( (uint64_t)sec->sh_offset + sec->sh_size > input_get_file_size(in) )
+	{
+		const char* sec_name = get_sh_str_32(descr, sec->sh_name);
+		fatal("section %s goes past end of file (corrupted ELF header?)", sec_name);
+	}
+}
+
+static void	check_str_sec(input_t* in, elf_sections_s* descr, Elf32_Shdr* sec)
+{
+	check_sec_size(in, descr, sec);
+
+	if ( descr->map[sec->sh_offset + sec->sh_size - 1] != 0 )
+	{
+		const char* s = get_sh_str_32(descr, sec->sh_name); // could be no null terminator here
+
+		// makes sure sec_name is null-terminated
+		static char sec_name[64];
+		strncpy(sec_name, s, sizeof(sec_name));
+		sec_name[63] = 0;
+
+		fatal("String table section %s not null-terminated (corrupted ELF file?)", sec_name);
+	}
+}
+
+/**
+ * Reads an ELF program header that has different endianness than us and
+ * replaces its every data member so that is has the same endianness.
+ */
+static void	make_ehdr_native_endian_32(Elf32_Ehdr* ehdr)
+{
+	assert( ehdr );
+
+	ehdr->e_type = swap16(&ehdr->e_type);
+	ehdr->e_machine = swap16(&ehdr->e_machine);
+	ehdr->e_version = swap32(&ehdr->e_version);
+	ehdr->e_entry = swap32(&ehdr->e_entry);
+	ehdr->e_phoff = swap32(&ehdr->e_phoff);
+	ehdr->e_shoff = swap32(&ehdr->e_shoff);
+	ehdr->e_flags = swap32(&ehdr->e_flags);
+	ehdr->e_ehsize = swap16(&ehdr->e_ehsize);
+	ehdr->e_phentsize = swap16(&ehdr->e_phentsize);
+	ehdr->e_phnum = swap16(&ehdr->e_phnum);
+	ehdr->e_shentsize = swap16(&ehdr->e_shentsize);
+	ehdr->e_shnum = swap16(&ehdr->e_shnum);
+	ehdr->e_shstrndx = swap16(&ehdr->e_shstrndx);
+}
+
+/**
+ * Reads an ELF section header that has different endianness than us and
+ * replaces its every data member so that is has the same endianness.
+ */
+static void	make_shdr_native_endian_32(Elf32_Shdr* shdr)
+{
+	assert( shdr );
+
+	shdr->sh_name = swap32(&shdr->sh_name);
+	shdr->sh_type = swap32(&shdr->sh_type);
+	shdr->sh_flags = swap32(&shdr->sh_flags);
+	shdr->sh_addr = swap32(&shdr->sh_addr);
+	shdr->sh_offset = swap32(&shdr->sh_offset);
+	shdr->sh_size = swap32(&shdr->sh_size);
+	shdr->sh_link = swap32(&shdr->sh_link);
+	shdr->sh_info = swap32(&shdr->sh_info);
+	shdr->sh_addralign = swap32(&shdr->sh_addralign);
+	shdr->sh_entsize = swap32(&shdr->sh_entsize);
+}
+
+static void	find_sym_sec(input_t* in, elf_sections_s* descr)
+{
+	Elf32_Shdr* sections = descr->elf32.sections;
+	uint32_t shnum = descr->elf32.shnum;
+
+	for (uint32_t i = 0; i < shnum; ++i)
+	{
+		Elf32_Shdr* sec = &sections[i];
+		if ( sec->sh_type == SHT_SYMTAB || sec->sh_type == SHT_DYNSYM )
+		{
+			report(VERB, "Found symtab (%d) and strtab (%d)", i, sec->sh_link);
+			if ( sec->sh_link >= shnum )
+			{
+				fatal("SYMTAB associated string table index %d out of range (%d)", sec->sh_link, shnum);
+			}
+			Elf32_Shdr* strsec = &sections[sec->sh_link];
+			if ( strsec->sh_type != SHT_STRTAB )
+			{
+				fatal("Type of string table at index %d is not STRTAB", i);
+			}
+
+			if( sec->sh_type == SHT_SYMTAB )
+			{
+				descr->elf32.symtab = sec;
+				descr->elf32.strtab = strsec;
+				descr->elf32.symtab_idx = i;
+			}
+			else
+			{
+				descr->elf32.dsymtab = sec;
+				descr->elf32.dstrtab = strsec;
+				descr->elf32.dsymtab_idx = i;
+			}
+		}
+		else if ( sec->sh_type == SHT_SYMTAB_SHNDX )
+		{
+			// The section indexes of the symbols of the table at sh_link that do not fit in st_shndx
+			Elf32_Shdr* table = (sec->sh_link < shnum) ? &sections[sec->sh_link] : NULL;
+			if ( !table || (table->sh_type != SHT_SYMTAB && table->sh_type != SHT_DYNSYM) )
+			{
+				fatal("SYMTAB_SHNDX section %d is not associated with a symbol table", i);
+			}
+			check_sec_size(in, descr, sec);
+
+			report(VERB, "Found section indexes (%d) of symtab (%d)", i, sec->sh_link);
+			if ( table->sh_type == SHT_SYMTAB )
+				descr->elf32.symtab_shndx = sec;
+			else
+				descr->elf32.dsymtab_shndx = sec;
+		}
+	}
+
+	if ( !descr->elf32.symtab && !descr->elf32.dsymtab )
+	{
+		fatal("No .symtab or .dynsym section in %s", glob_get_program_name());
+	}
+
+	// Check the symtab/strtab sections
+	if ( descr->elf32.symtab )
+	{
+		assert(descr->elf32.strtab); // they always go in pairs
+		check_sec_size(in, descr, descr->elf32.symtab);
+		check_str_sec(in, descr, descr->elf32.strtab);
+
+		// We're going to be reading symtab sequentially real soon
+		input_advise(in, descr->elf32.symtab->sh_offset, descr->elf32.symtab->sh_size, MADV_WILLNEED);
+		input_advise(in, descr->elf32.strtab->sh_offset, descr->elf32.strtab->sh_size, MADV_RANDOM);
+	}
+
+	if ( descr->elf32.dsymtab )
+	{
+		assert(descr->elf32.dstrtab); // they always go in pairs
+		check_sec_size(in, descr, descr->elf32.dsymtab);
+		check_str_sec(in, descr, descr->elf32.dstrtab);
+
+		// We're going to be reading symtab sequentially real soon
+		input_advise(in, descr->elf32.dsymtab->sh_offset, descr->elf32.dsymtab->sh_size, MADV_WILLNEED);
+		input_advise(in, descr->elf32.dstrtab->sh_offset, descr->elf32.dstrtab->sh_size, MADV_RANDOM);
+	}
+}
+
+/**
+ * Locates all SYMTAB and their corresponding STRTAB sections and returns
+ * pointers to them. Also converts the section headers to the same endianness
+ * as us, if necessary. The returned object must be released with free().
+ */
+extern elf_sections_s*	find_sections_32(input_t* in)
+{
+	elf_sections_t * descr = calloc(1, sizeof(elf_sections_s));
+	if ( !descr )
+	{
+		fatal_err("Not enough memory");
+	}
+
+	assert( SWAPPED == !input_get_is_same_endian(in) );
+	descr->map = input_get_mem_map(in);
+
+	Elf32_Ehdr* ehdr = (Elf32_Ehdr*)descr->map;
+	if ( SWAPPED )
+	{
+		// Need to modify the program headers in-place in order for us to be able
+		// simply read it even though it is of a different endianness
+		make_ehdr_native_endian_32(ehdr);
+	}
+
+	if ( ehdr->e_shoff == 0 )
+	{
+		fatal("No section info in %s", glob_get_program_name());
+	}
+
+	if ( ehdr->e_shentsize != sizeof(Elf32_Shdr) )
+	{
+		fatal("Bad section header size: expected %d, found %d", sizeof(Elf32_Shdr), ehdr->e_shentsize);
+	}
+
+	const size_t file_size = input_get_file_size(in);
+	if ( ehdr->e_shoff > file_size || file_size - ehdr->e_shoff < sizeof(Elf32_Shdr) )
+	{
+		fatal("Section header table goes past end of file (corrupted ELF header?)");
+	}
+
+	// With SHN_LORESERVE sections or more, e_shnum is 0 and the first section's sh_size has their number
+	Elf32_Shdr* sections = (Elf32_Shdr*)&descr->map[ehdr->e_shoff];
+	uint64_t shnum = ehdr->e_shnum;
+	if ( shnum == 0 )
+	{
+		shnum = SWAPPED ? swap32(&sections[0].sh_size) : sections[0].sh_size;
+		report(VERB, "Found %lu sections (extended numbering)", (unsigned long)shnum);
+	}
+	if ( shnum > (file_size - ehdr->e_shoff)/sizeof(Elf32_Shdr) || shnum > UINT32_MAX )
+	{
+		fatal("Section header table goes past end of file (corrupted ELF header?)");
+	}
+
+	descr->elf32.sections = sections;
+	descr->elf32.shnum = (uint32_t)shnum;
+
+	// Find out about the .shstrtab section:
+	if ( ehdr->e_shstrndx == SHN_UNDEF )
+	{
+		fatal("No .strtab section in %s", glob_get_program_name());
+	}
+
+	if ( SWAPPED )
+	{
+		// Need to modify section headers in-place in order for us to be able
+		// simply read them even though they are of a different endianness
+		for (uint32_t i = 0; i < descr->elf32.shnum; ++i)
+		{
+			make_shdr_native_endian_32(&sections[i]);
+		}
+	}
+
+	if ( ehdr->e_shstrndx >= SHN_LORESERVE )
+	{
+		if ( ehdr->e_shstrndx != SHN_XINDEX )
+		{
+			fatal("Bad .shstrtab section index (%x)", ehdr->e_shstrndx);
+		}
+		// actual index is in sh_link field of the first entry
+		if ( sections[0].sh_link >= descr->elf32.shnum )
+		{
+			fatal(".shstrtab section index (%x) out of range (%d)", sections[0].sh_link, descr->elf32.shnum);
+		}
+		descr->elf32.shstrtab = &sections[sections[0].sh_link];
+
+		report(VERB, "Found .shstrtab at index %d", sections[0].sh_link);
+	}
+	else if ( ehdr->e_shstrndx >= descr->elf32.shnum )
+	{
+		fatal("Out of range .shstrtab section index (corrupted ELF header?)");
+	}
+	else
+	{
+		descr->elf32.shstrtab = &sections[ehdr->e_shstrndx];
+		report(VERB, "Found .shstrtab at index %d", ehdr->e_shstrndx);
+	}
+
+	// Check the .shstrtab section
+	check_str_sec(in, descr, descr->elf32.shstrtab);
+
+	// Start reading the section table
+	find_sym_sec(in, descr);
+
+	return descr;
+}
+
+static void	make_sym_same_endian_32(Elf32_Sym* s)
+{
+	s->st_name = swap32(&s->st_name);
+	s->st_value = swap32(&s->st_value);
+	s->st_size = swap32(&s->st_size);
+	s->st_shndx = swap16(&s->st_shndx);
+}
+
+/**
+ * Returns the index of the section that the i-th symbol of the symbol table is defined in, kept in the table's
+ * SHT_SYMTAB_SHNDX section if it does not fit in st_shndx (extended numbering). Returns SHN_UNDEF if the symbol
+ * is not defined in any of the sections, as those absolute or common, or the index is out of range.
+ */
+static uint32_t	get_sym_shndx_32(elf_sections_s* descr, const Elf32_Shdr* symtab, size_t i, const Elf32_Sym* s)
+{
+	uint32_t shndx = s->st_shndx;
+	if ( shndx == SHN_XINDEX )
+	{
+		const Elf32_Shdr* xsec = (symtab == descr->elf32.dsymtab) ? descr->elf32.dsymtab_shndx
+									       : descr->elf32.symtab_shndx;
+		if ( !xsec || i >= xsec->sh_size/sizeof(Elf32_Word) )
+			return SHN_UNDEF;
+
+		// The section is read where it is, as it is not converted to our endianness
+		const char* p = &descr->map[xsec->sh_offset + i*sizeof(Elf32_Word)];
+		if ( SWAPPED )
+			shndx = swap32(p);
+		else
+			memcpy(&shndx, p, sizeof(shndx));
+	}
+	else if ( shndx >= SHN_LORESERVE )
+	{
+		return SHN_UNDEF;
+	}
+
+	return (shndx < descr->elf32.shnum) ? shndx : SHN_UNDEF;
+}
+
+static size_t	read_symtab_sec(elf_sections_s* descr,
+				Elf32_Shdr* symtab,
+				Elf32_Shdr* strtab,
+				symtab_t* syms)
+{
+	const Elf32_Off symsoff = symtab->sh_offset;
+	const size_t symtab_nelem = symtab->sh_size / symtab->sh_entsize;
+	size_t syms_idx = 0;
+	for( size_t i = 0; i < symtab_nelem; ++i)
+	{
+		size_t symoff = symsoff + i*symtab->sh_entsize;
+		Elf32_Sym* s = (Elf32_Sym*)&descr->map[symoff];
+		if ( SWAPPED )
+		{
+			make_sym_same_endian_32(s);
+		}
+
+		int symtype = ELF32_ST_TYPE(s->st_info);
+		size_t symval = s->st_value;
+		const char * symname = get_str_32(descr, strtab, s->st_name);
+		// The reserved indexes, as SHN_ABS, are kept as they are
+		const uint32_t shndx = (s->st_shndx == SHN_XINDEX) ? get_sym_shndx_32(descr, symtab, i, s) : s->st_shndx;
+		syms_idx = symtab_add_sym(syms, symval, s->st_size, symtype, shndx, symname);
+		report(VERB, "Symbol \"%s\" at index %d", symname, i*symtab->sh_entsize);
+	}
+
+	return syms_idx;
+}
+
+/**
+ * Reads in the input ELF file and returns a pointer to the file's symbol table as symtab_t (see).
+ * The returned object must be deallocated with symtab_free().
+ */
+extern symtab_t*	read_in_symtab_32(input_t* in, elf_sections_s* descr)
+{
+	size_t nsyms = 0;
+	if ( descr->elf32.symtab )
+	{
+		nsyms += descr->elf32.symtab->sh_size / descr->elf32.symtab->sh_entsize;
+	}
+	if ( descr->elf32.dsymtab )
+	{
+		nsyms += descr->elf32.dsymtab->sh_size / descr->elf32.dsymtab->sh_entsize;
+	}
+
+	report(VERB, "Found %d symbols total", nsyms);
+
+	symtab_t* symtab = symtab_alloc(nsyms);
+	assert(symtab);
+	symtab_set_reltypes(symtab, reltype_table(input_get_machine(in)));
+	if ( descr->elf32.strtab )
+	{
+		symtab_add_strings(symtab, &descr->map[descr->elf32.strtab->sh_offset], descr->elf32.strtab->sh_size);
+	}
+	if ( descr->elf32.dstrtab )
+	{
+		symtab_add_strings(symtab, &descr->map[descr->elf32.dstrtab->sh_offset], descr->elf32.dstrtab->sh_size);
+	}
+
+	size_t syms_read = 0;
+	if ( descr->elf32.symtab )
+	{
+		syms_read = read_symtab_sec(descr, descr->elf32.symtab, descr->elf32.strtab, symtab);
+		assert(syms_read <= nsyms);
+	}
+
+	if ( descr->elf32.dsymtab )
+	{
+		syms_read = read_symtab_sec(descr, descr->elf32.dsymtab, descr->elf32.dstrtab, symtab);
+		assert(syms_read <= nsyms);
+	}
+
+	if ( syms_read == 0 )
+	{
+		report(NORM, "No symbols found in .symtab and .dynsym; nothing to do.");
+		return NULL;
+	}
+
+	symtab_sort(symtab, ((Elf32_Ehdr*)descr->map)->e_type == ET_REL);
+
+	return symtab;
+}
+
+static const char*	get_sym_name_32(elf_sections_s* descr, uint32_t symtab_sec_idx, size_t sym_idx, bool *is_func)
+{
+	// We expect symtab_sec_idx to point to either symtab or dynsym:
+	Elf32_Shdr* symtab = descr->elf32.symtab;
+	Elf32_Shdr* strtab = descr->elf32.strtab;
+	if ( symtab_sec_idx == descr->elf32.dsymtab_idx )
+	{
+		symtab = descr->elf32.dsymtab;
+		strtab = descr->elf32.dstrtab;
+	}
+	else if ( symtab_sec_idx != descr->elf32.symtab_idx )
+	{
+		error("relocation section references unknown symtab (section index %d)", symtab_sec_idx);
+		return NULL;
+	}
+
+	if ( !symtab || !strtab)
+	{
+		// May happen when relocation doesn't reference symbols and  only has
+		// addends
+		return NULL;
+	}
+
+	size_t symoff = sym_idx*symtab->sh_entsize;
+	if ( symoff >= symtab->sh_size )
+	{
+		const char* sec_name = get_sh_str_32(descr, symtab->sh_name);
+		error("offset %d into '%s' of symbol index %d is out of range (%d)",
+			symoff, sec_name, sym_idx, symtab->sh_size);
+	}
+	Elf32_Sym* s = (Elf32_Sym*)&descr->map[symtab->sh_offset + symoff];
+	*is_func = (ELF32_ST_TYPE(s->st_info) == STT_FUNC);
+	return get_str_32(descr, strtab, s->st_name);
+}
+
+/**
+ * Returns the name of the section that the relocation refers to: that of the symbol it refers to, or, if it
+ * does not refer to any (as R_X86_64_RELATIVE), the loaded section containing the address in its addend.
+ */
+static const char*	get_target_sec_name_32(elf_sections_s* descr, uint32_t symtab_sec_idx, size_t sym_idx,
+						int64_t addend)
+{
+	Elf32_Shdr* symtab = (symtab_sec_idx == descr->elf32.dsymtab_idx) ? descr->elf32.dsymtab : descr->elf32.symtab;
+
+	if ( sym_idx != 0 && symtab && sym_idx*symtab->sh_entsize < symtab->sh_size )
+	{
+		// Symbols have been converted to our endianness by read_symtab_sec()
+		const Elf32_Sym* s = (const Elf32_Sym*)&descr->map[symtab->sh_offset + sym_idx*symtab->sh_entsize];
+		switch ( s->st_shndx )
+		{
+		case SHN_UNDEF:
+			return "*UND*";
+		case SHN_ABS:
+			return "*ABS*";
+		case SHN_COMMON:
+			return "*COM*";
+		default:
+		{
+			const uint32_t shndx = get_sym_shndx_32(descr, symtab, sym_idx, s);
+			if ( shndx != SHN_UNDEF )
+				return get_sh_str_32(descr, descr->elf32.sections[shndx].sh_name);
+			return "*unknown*";
+		}
+		}
+	}
+
+	const size_t addr = (size_t)addend;
+	for (uint32_t i = 1; i < descr->elf32.shnum; ++i)
+	{
+		const Elf32_Shdr* sec = &descr->elf32.sections[i];
+		if ( (sec->sh_flags & SHF_ALLOC) && sec->sh_addr <= addr && addr - sec->sh_addr < sec->sh_size )
+			return get_sh_str_32(descr, sec->sh_name);
+	}
+
+	return "*none*";
+}
+
+static void	make_rel_same_endian_32(Elf32_Rel* r)
+{
+	r->r_offset = swap32(&r->r_offset);
+	r->r_info   = swap32(&r->r_info);
+}
+
+static void	make_rela_same_endian_32(Elf32_Rela* r)
+{
+	r->r_offset = swap32(&r->r_offset);
+	r->r_info   = swap32(&r->r_info);
+	r->r_addend = (int32_t)swap32(&r->r_addend);
+}
+
+/**
+ * Returns the index of the section with the given name or SHN_UNDEF if the input file has no such section.
+ */
+static uint32_t	find_section_idx_32(elf_sections_s* descr, const char* name)
+{
+	for (uint32_t i = 1; i < descr->elf32.shnum; ++i)
+	{
+		Elf32_Shdr* sec = &descr->elf32.sections[i];
+		if ( strcmp(get_sh_str_32(descr, sec->sh_name), name) == 0 )
+		{
+			return i;
+		}
+	}
+
+	return SHN_UNDEF;
+}
+
+/**
+ * Looks up the section with the given name and describes it in *res.
+ * Returns false if the input file has no such section.
+ */
+extern bool	find_section_32(input_t* in, elf_sections_s* descr, const char* name, input_section_t* res)
+{
+	const uint32_t i = find_section_idx_32(descr, name);
+	if ( i == SHN_UNDEF )
+	{
+		return false;
+	}
+
+	Elf32_Shdr* sec = &descr->elf32.sections[i];
+	res->addr = sec->sh_addr;
+	res->flags = sec->sh_flags;
+	if ( sec->sh_type == SHT_NOBITS )
+	{
+		res->data = NULL;
+		res->size = 0;
+	}
+	else
+	{
+		check_sec_size(in, descr, sec);
+		res->data = &descr->map[sec->sh_offset];
+		res->size = sec->sh_size;
+	}
+
+	return true;
+}
+
+static int	cmp_input_reloc(const void* a, const void* b)
+{
+	const input_reloc_t *ra = a;
+	const input_reloc_t *rb = b;
+	return (ra->offset > rb->offset) - (ra->offset < rb->offset);
+}
+
+/**
+ * Returns the value of the symbol with the given index in the symbol table at section index symtab_sec_idx.
+ */
+static size_t	get_sym_value_32(elf_sections_s* descr, uint32_t symtab_sec_idx, size_t sym_idx)
+{
+	if ( symtab_sec_idx >= descr->elf32.shnum )
+	{
+		return 0;
+	}
+
+	Elf32_Shdr* symtab = &descr->elf32.sections[symtab_sec_idx];
+	const size_t symoff = sym_idx*symtab->sh_entsize;
+	if ( symoff >= symtab->sh_size )
+	{
+		return 0;
+	}
+
+	Elf32_Sym* s = (Elf32_Sym*)&descr->map[symtab->sh_offset + symoff];
+	return s->st_value;
+}
+
+/**
+ * Collects the relocations applied to the section with the given name into *relocs sorted by offset
+ * and returns their number. Must be called after read_in_symtab_32(), which brings the symbols
+ * to the native endianness. The result must be released with free().
+ */
+extern size_t	read_section_relocs_32(input_t* in, elf_sections_s* descr, const char* name, input_reloc_t** relocs)
+{
+	*relocs = NULL;
+
+	const uint32_t target = find_section_idx_32(descr, name);
+	if ( target == SHN_UNDEF )
+	{
+		return 0;
+	}
+
+	size_t n = 0;
+	size_t cap = 0;
+	for (uint32_t i = 0; i < descr->elf32.shnum; ++i)
+	{
+		Elf32_Shdr* sec = &descr->elf32.sections[i];
+		if ( (sec->sh_type != SHT_RELA && sec->sh_type != SHT_REL) || sec->sh_info != target
+		     || sec->sh_entsize == 0 )
+			continue;
+
+		check_sec_size(in, descr, sec);
+		const bool is_rela = (sec->sh_type == SHT_RELA);
+		const size_t nelem = sec->sh_size / sec->sh_entsize;
+		for (size_t j = 0; j < nelem; ++j)
+		{
+			const char* rec = &descr->map[sec->sh_offset + j*sec->sh_entsize];
+			Elf32_Rela r = { 0 };
+			memcpy(&r, rec, is_rela ? sizeof(Elf32_Rela) : sizeof(Elf32_Rel));
+			if ( SWAPPED )
+			{
+				if ( is_rela )
+					make_rela_same_endian_32(&r);
+				else
+					make_rel_same_endian_32((Elf32_Rel*)&r);
+			}
+
+			if ( n == cap )
+			{
+				cap = cap ? 2*cap : 64;
+				*relocs = realloc(*relocs, cap*sizeof(input_reloc_t));
+				if ( !*relocs )
+				{
+					fatal_err("Not enough memory");
+				}
+			}
+
+			input_reloc_t* res = &(*relocs)[n++];
+			res->offset = r.r_offset;
+			res->value = get_sym_value_32(descr, sec->sh_link, ELF32_R_SYM(r.r_info));
+			res->addend = r.r_addend;
+			res->is_rela = is_rela;
+		}
+	}
+
+	qsort(*relocs, n, sizeof(input_reloc_t), cmp_input_reloc);
+
+	return n;
+}
+
+#define RELOC_WINDOW	((size_t)16 << 20)	// bytes of relocation records processed at a time
+
+/**
+ * Returns true if the relocation section is to be processed: its name contains the --section pattern or,
+ * if there is none, the section it applies to gets loaded in memory (relocations of debug info are of
+ * no interest and could take the most of the file).
+ */
+static bool	reloc_sec_is_interesting_32(elf_sections_s* descr, Elf32_Shdr* sec)
+{
+	const char* pattern = args_get_section_pattern();
+	if ( pattern )
+	{
+		return strstr(get_sh_str_32(descr, sec->sh_name), pattern) != NULL;
+	}
+
+	// sh_info of dynamic relocation sections may be 0, they apply to the whole image
+	if ( sec->sh_info != 0 && sec->sh_info < descr->elf32.shnum )
+	{
+		return (descr->elf32.sections[sec->sh_info].sh_flags & SHF_ALLOC) != 0;
+	}
+
+	return true;
+}
+
+/**
+ * Reads the i-th relocation record of the section into *r, converted to our byte order.
+ */
+static void	read_reloc_32(elf_sections_s* descr, const Elf32_Shdr* sec, size_t i, Elf32_Rela* r)
+{
+	const char* rec = &descr->map[sec->sh_offset + i*sec->sh_entsize];
+	*r = (Elf32_Rela){ 0 };
+	if ( sec->sh_type == SHT_REL ) // .rel section
+	{
+		memcpy(r, rec, sizeof(Elf32_Rel));
+		if ( SWAPPED )
+		{
+			make_rel_same_endian_32((Elf32_Rel*)r);
+		}
+	}
+	else  // .rela section
+	{
+		memcpy(r, rec, sizeof(Elf32_Rela));
+		if ( SWAPPED )
+		{
+			make_rela_same_endian_32(r);
+		}
+	}
+}
+
+/**
+ * Reads the relocation records of a section, or a range of them, in order, a window of RELOC_WINDOW bytes at
+ * a time: the window following the one being read is read ahead and the windows passed are released.
+ */
+typedef struct reloc_cursor_32
+{
+	Elf32_Shdr *	sec;
+	size_t		first;		// index of the first record in the range
+	size_t		end;		// and past the last one
+	size_t		window;		// records in a window
+	size_t		next;		// index of the record to be read next
+	size_t		released;	// records before this one have been released
+	Elf32_Rela	r;		// the record read last, in our byte order
+} reloc_cursor_32;
+
+static void	cursor_init_32(input_t* in, reloc_cursor_32* c, Elf32_Shdr* sec, size_t first, size_t end)
+{
+	c->sec = sec;
+	c->first = first;
+	c->end = end;
+	c->window = (RELOC_WINDOW / sec->sh_entsize) ? RELOC_WINDOW / sec->sh_entsize : 1;
+	c->next = first;
+	c->released = first;
+
+	const size_t n = (end - first < c->window) ? end - first : c->window;
+	input_advise(in, sec->sh_offset + first*sec->sh_entsize, n*sec->sh_entsize, MADV_WILLNEED);
+}
+
+/**
+ * Reads the next record into c->r. Returns false if there are no more records, all of them released.
+ */
+static bool	cursor_read_32(input_t* in, elf_sections_s* descr, reloc_cursor_32* c)
+{
+	Elf32_Shdr* sec = c->sec;
+	if ( (c->next - c->first) % c->window == 0 || c->next == c->end )
+	{
+		input_advise(in, sec->sh_offset + c->released*sec->sh_entsize, (c->next - c->released)*sec->sh_entsize,
+			     MADV_DONTNEED);
+		c->released = c->next;
+
+		const size_t ahead = c->next + c->window;
+		if ( ahead < c->end )
+		{
+			const size_t n = (c->end - ahead < c->window) ? c->end - ahead : c->window;
+			input_advise(in, sec->sh_offset + ahead*sec->sh_entsize, n*sec->sh_entsize, MADV_WILLNEED);
+		}
+	}
+
+	if ( c->next == c->end )
+	{
+		return false;
+	}
+
+	// Records are converted to our endianness in a copy, so that the window can be released
+	read_reloc_32(descr, sec, c->next, &c->r);
+
+	c->next++;
+	return true;
+}
+
+/**
+ * A symbol that the relocations against the symbol of its section may point into (see resolve_sec_sym_32()).
+ */
+typedef struct sec_sym_32
+{
+	uint64_t	value;
+	uint64_t	size;
+	const char *	name;
+	size_t		idx;		// in the symbol table
+	uint32_t	shndx;
+	uint8_t		rank;		// of the symbols at the same address, the highest is chosen
+	bool		is_func;
+} sec_sym_32;
+
+/**
+ * The symbols of a symbol table sorted by section and address.
+ */
+typedef struct sec_syms_32
+{
+	uint32_t	symtab_idx;	// the symbol table indexed, 0 if none yet
+	sec_sym_32 *	syms;
+	size_t *	first;		// for each section, the index of its first symbol in syms (and past the last)
+} sec_syms_32;
+
+/**
+ * Orders the symbols by section and address and, at the same address, the one to choose last: a global
+ * one over a local, a sized one over a label, and the first in the symbol table over the rest.
+ */
+static int	cmp_sec_sym_32(const void* a, const void* b)
+{
+	const sec_sym_32* x = a;
+	const sec_sym_32* y = b;
+	if ( x->shndx != y->shndx )
+		return (x->shndx < y->shndx) ? -1 : 1;
+	if ( x->value != y->value )
+		return (x->value < y->value) ? -1 : 1;
+	if ( x->rank != y->rank )
+		return (x->rank < y->rank) ? -1 : 1;
+
+	return (x->idx > y->idx) ? -1 : (x->idx < y->idx);
+}
+
+/**
+ * Sorts the symbols of the symbol table at symtab_idx by section and address into ss, dropping those that
+ * are not in a section or are not the objects and functions there (section, file and mapping symbols, local labels).
+ */
+static void	index_sec_syms_32(sec_syms_32* ss, elf_sections_s* descr, uint32_t symtab_idx)
+{
+	free(ss->syms);
+	free(ss->first);
+	*ss = (sec_syms_32){ .symtab_idx = symtab_idx };
+
+	Elf32_Shdr* symtab = descr->elf32.symtab;
+	Elf32_Shdr* strtab = descr->elf32.strtab;
+	if ( symtab_idx == descr->elf32.dsymtab_idx )
+	{
+		symtab = descr->elf32.dsymtab;
+		strtab = descr->elf32.dstrtab;
+	}
+
+	const uint32_t shnum = descr->elf32.shnum;
+	const size_t nelem = (symtab && strtab) ? symtab->sh_size / symtab->sh_entsize : 0;
+	ss->first = calloc((size_t)shnum + 1, sizeof(size_t));
+	ss->syms = malloc((nelem ? nelem : 1)*sizeof(sec_sym_32));
+	if ( !ss->first || !ss->syms )
+	{
+		fatal_err("Not enough memory");
+	}
+
+	size_t n = 0;
+	for (size_t i = 1; i < nelem; ++i)
+	{
+		// Symbols have been converted to our endianness by read_symtab_sec()
+		const Elf32_Sym* sym = (const Elf32_Sym*)&descr->map[symtab->sh_offset + i*symtab->sh_entsize];
+		const int type = ELF32_ST_TYPE(sym->st_info);
+		const uint32_t shndx = get_sym_shndx_32(descr, symtab, i, sym);
+		if ( type == STT_SECTION || type == STT_FILE || shndx == SHN_UNDEF )
+			continue;
+
+		const char* name = get_str_32(descr, strtab, sym->st_name);
+		if ( !*name || *name == '$' || strncmp(name, ".L", 2) == 0 )
+			continue;
+
+		const int bind = ELF32_ST_BIND(sym->st_info);
+		ss->syms[n++] = (sec_sym_32){ .value = sym->st_value, .size = sym->st_size, .name = name, .idx = i,
+					       .shndx = shndx,
+					       .rank = (uint8_t)(2*(bind != STB_LOCAL) + (sym->st_size != 0)),
+					       .is_func = (type == STT_FUNC) };
+	}
+	qsort(ss->syms, n, sizeof(sec_sym_32), cmp_sec_sym_32);
+
+	for (size_t k = 0, j = 0; k <= (size_t)shnum; ++k)
+	{
+		while ( j < n && ss->syms[j].shndx < k )
+		{
+			++j;
+		}
+		ss->first[k] = j;
+	}
+}
+
+/**
+ * Describes what is done with the relocation records read (see add_reloc_32()).
+ */
+typedef struct reloc_walk_32
+{
+	elf_sections_s *	descr;
+	symtab_t *		symtab;		// to add the relocations to
+	summary_t *		summary;	// if set, to count the relocations in instead
+	spill_t *		spill;		// if set, to sort the relocations in instead
+	const symtab_range_t *	range;		// if set, the relocations are within it (see add_range_relocs_32())
+	const reltype_table_t *	reltypes;	// of the input's machine
+	unsigned		kinds;		// of the relocations to keep (the --kind option)
+	size_t			ndropped;	// relocations of other kinds
+	size_t			nrecords;	// relocation records in the sections walked
+	size_t			nsampled;	// of those, read (see summary_sample_gap())
+	uint16_t		machine;	// of the input
+	size_t			file_size;	// of the input, to tell if the code relocated can be looked into
+	sec_syms_32		sec_syms;	// to resolve the relocations against section symbols, built when needed
+} reloc_walk_32;
+
+static void	walk_begin_32(input_t* in, elf_sections_s* descr, symtab_t* symtab, summary_t* summary, reloc_walk_32* w)
+{
+	*w = (reloc_walk_32){ .descr = descr, .symtab = symtab, .summary = summary,
+			       .reltypes = reltype_table(input_get_machine(in)), .kinds = args_get_kinds(),
+			       .machine = input_get_machine(in), .file_size = input_get_file_size(in) };
+	if ( !w->reltypes )
+	{
+		report(VERB, "Relocation types of machine %d are not known", input_get_machine(in));
+	}
+}
+
+static void	walk_end_32(reloc_walk_32* w)
+{
+	if ( w->kinds != RELTYPE_ALL )
+	{
+		report(VERB, "Dropped %zu relocations of other kinds", w->ndropped);
+	}
+	if ( w->summary && summary_is_sampled(w->summary) )
+	{
+		report(VERB, "Sampled %zu of %zu relocations", w->nsampled, w->nrecords);
+	}
+
+	free(w->sec_syms.syms);
+	free(w->sec_syms.first);
+}
+
+/**
+ * Returns the size of the immediate operand following the 32-bit field at offset off of the x86-64 code in the
+ * section, which the operand the field addresses relative to the instruction's end is that much short of, or
+ * -1 if it can not be told. Only the bytes in front of the field are looked at: a call, jump or conditional
+ * jump is followed by nothing, and an instruction addressing its operand relative to %rip by the immediate
+ * its opcode takes, if any.
+ */
+static int	x86_imm_size_32(const reloc_walk_32* w, const Elf32_Shdr* code, uint64_t off)
+{
+	if ( code->sh_type == SHT_NOBITS || code->sh_offset > w->file_size || code->sh_size > w->file_size - code->sh_offset
+	     || off < code->sh_addr + 2 || off - code->sh_addr > code->sh_size - 4 )
+		return -1;
+
+	const size_t at = off - code->sh_addr;
+	const unsigned char* p = (const unsigned char*)&w->descr->map[code->sh_offset + at];
+	const unsigned char b1 = p[-1];
+	const unsigned char b2 = p[-2];
+	const unsigned char b3 = (at >= 3) ? p[-3] : 0;
+	const unsigned char b4 = (at >= 4) ? p[-4] : 0;
+	if ( b1 == 0xe8 || b1 == 0xe9 || (b2 == 0x0f && (b1 & 0xf0) == 0x80) )
+		return 0;
+	if ( (b1 & 0xc7) != 0x05 )
+		return -1; // not a ModRM byte of %rip-relative addressing
+
+	const int reg = (b1 >> 3) & 7;
+	const bool opsize = (b3 == 0x66 || ((b3 & 0xf0) == 0x40 && b4 == 0x66)); // 16-bit operands
+	if ( b3 == 0x0f )
+	{
+		switch ( b2 )
+		{
+		case 0x70: case 0x71: case 0x72: case 0x73: case 0xa4: case 0xac: case 0xba:
+		case 0xc2: case 0xc4: case 0xc5: case 0xc6:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+	if ( b4 == 0x0f && b3 == 0x3a )
+		return 1;
+
+	switch ( b2 )
+	{
+	case 0x80: case 0x82: case 0x83: case 0xc0: case 0xc1: case 0xc6: case 0x6b:
+		return 1;
+	case 0x81: case 0xc7: case 0x69:
+		return opsize ? 2 : 4;
+	case 0xf6:
+		return (reg < 2) ? 1 : 0;
+	case 0xf7:
+		return (reg < 2) ? (opsize ? 2 : 4) : 0;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * If the relocation refers to a section symbol, as those in object files mostly do (.rodata+0x140 rather than
+ * the table there), finds the symbol of the section it points into and replaces *name and *is_func with it and
+ * *addend with the offset from it. Leaves them alone if there is no symbol at that point of the section.
+ * The addends of SHT_REL records are in the section relocated, which is not read, so those are left alone too.
+ */
+static void	resolve_sec_sym_32(reloc_walk_32* w, const Elf32_Shdr* sec, const Elf32_Rela* r, uint32_t type,
+				    const char** name, bool* is_func, int64_t* addend)
+{
+	elf_sections_s* descr = w->descr;
+	const uint32_t symtab_idx = sec->sh_link;
+	const size_t sym_idx = ELF32_R_SYM(r->r_info);
+	const Elf32_Shdr* symtab = (symtab_idx == descr->elf32.dsymtab_idx) ? descr->elf32.dsymtab : descr->elf32.symtab;
+	if ( sec->sh_type != SHT_RELA || sym_idx == 0 || !symtab || sym_idx >= symtab->sh_size / symtab->sh_entsize )
+		return;
+
+	const Elf32_Sym* s = (const Elf32_Sym*)&descr->map[symtab->sh_offset + sym_idx*symtab->sh_entsize];
+	if ( ELF32_ST_TYPE(s->st_info) != STT_SECTION )
+		return;
+	const uint32_t shndx = get_sym_shndx_32(descr, symtab, sym_idx, s);
+	if ( shndx == SHN_UNDEF )
+		return;
+
+	if ( w->sec_syms.symtab_idx != symtab_idx )
+	{
+		index_sec_syms_32(&w->sec_syms, descr, symtab_idx);
+	}
+
+	// x86 code addresses its operands relative to the end of the instruction, that is past the field and any
+	// immediate operand that follows, hence the addends 4 to 8 short of the target; the instruction tells
+	// how many, as a rule
+	const int64_t at = (int64_t)s->st_value + r->r_addend;
+	int64_t lo = at;
+	int64_t hi = at;
+	if ( w->machine == EM_X86_64 && (type == R_X86_64_PC32 || type == R_X86_64_PLT32)
+	     && sec->sh_info < descr->elf32.shnum && (descr->elf32.sections[sec->sh_info].sh_flags & SHF_EXECINSTR) )
+	{
+		const int imm = x86_imm_size_32(w, &descr->elf32.sections[sec->sh_info], r->r_offset);
+		lo += 4 + ((imm > 0) ? imm : 0);
+		hi += 4 + ((imm >= 0) ? imm : 4);
+	}
+
+	// The first symbol of the section from lo to hi, which is where the operand is if the instruction has an
+	// immediate one after it, or else the last one below lo if it extends to it
+	const sec_syms_32* ss = &w->sec_syms;
+	const size_t first = ss->first[shndx];
+	const size_t end = ss->first[shndx + 1];
+	size_t b = first;
+	for (size_t e = end; b < e; )
+	{
+		const size_t mid = b + (e - b)/2;
+		if ( (int64_t)ss->syms[mid].value < lo )
+			b = mid + 1;
+		else
+			e = mid;
+	}
+
+	const sec_sym_32* f = NULL;
+	if ( b < end && (int64_t)ss->syms[b].value <= hi )
+	{
+		while ( b + 1 < end && ss->syms[b + 1].value == ss->syms[b].value )
+		{
+			++b;
+		}
+		f = &ss->syms[b];
+	}
+	else if ( b > first && (ss->syms[b - 1].size == 0 || lo < (int64_t)(ss->syms[b - 1].value + ss->syms[b - 1].size)) )
+	{
+		f = &ss->syms[b - 1];
+	}
+
+	if ( f )
+	{
+		*name = f->name;
+		*is_func = f->is_func;
+		*addend = at - (int64_t)f->value;
+	}
+}
+
+/**
+ * Adds the relocation record read from the given section to the symbol table or counts it in the summary.
+ * Records of the kinds not asked for (the --kind option) are dropped as soon as their type is known.
+ */
+static void	add_reloc_32(reloc_walk_32* w, const Elf32_Shdr* sec, const Elf32_Rela* r)
+{
+	const uint32_t type = ELF32_R_TYPE(r->r_info);
+	if ( !(reltype_kind(w->reltypes, type) & w->kinds) )
+	{
+		w->ndropped++;
+		return;
+	}
+
+	uint32_t symtab_sec_idx = sec->sh_link; // this relocation section uses this symtab
+	size_t sym_idx = ELF32_R_SYM(r->r_info);
+	bool is_func = false;
+	const char* sym_name = get_sym_name_32(w->descr, symtab_sec_idx, sym_idx, &is_func);
+	int64_t addend = r->r_addend;
+	resolve_sec_sym_32(w, sec, r, type, &sym_name, &is_func, &addend);
+	if ( w->summary )
+	{
+		const char* target_sec = get_target_sec_name_32(w->descr, symtab_sec_idx, sym_idx, r->r_addend);
+		summary_add_ref(w->summary, w->symtab, r->r_offset, sym_name, is_func, target_sec);
+	}
+	else if ( w->spill )
+	{
+		spill_add(w->spill, r->r_offset, sym_name, is_func, type, addend);
+	}
+	else if ( w->range )
+	{
+		symtab_add_range_reloc(w->symtab, w->range, r->r_offset, sym_name, is_func, type, addend);
+	}
+	else
+	{
+		symtab_add_reloc(w->symtab, r->r_offset, sym_name, is_func, type, addend);
+	}
+}
+
+/**
+ * Returns the next relocation section to be processed starting from index *i, which is advanced past it,
+ * or NULL if there are no more.
+ */
+static Elf32_Shdr*	next_reloc_sec_32(input_t* in, elf_sections_s* descr, uint32_t* i)
+{
+	for (; *i < descr->elf32.shnum; ++*i)
+	{
+		Elf32_Shdr* sec = &descr->elf32.sections[*i];
+		uint32_t typ = sec->sh_type;
+		if ( (typ != SHT_RELA && typ != SHT_REL) || sec->sh_entsize == 0 )
+			continue;
+
+		if ( !reloc_sec_is_interesting_32(descr, sec) )
+		{
+			report(VERB, "Skipping rel[a] section \"%s\" at index %d", get_sh_str_32(descr, sec->sh_name), *i);
+			continue;
+		}
+
+		report(DBG, "Processing rel[a] section \"%s\" at index %d", get_sh_str_32(descr, sec->sh_name), *i);
+		check_sec_size(in, descr, sec);
+
+		++*i;
+		return sec;
+	}
+
+	return NULL;
+}
+
+/**
+ * Processes relocation records in the given input ELF file, adding information to the given symbol table or,
+ * if summary or spill is given, counting them or sorting them there.
+ */
+static void	walk_relocations_32(input_t* in, elf_sections_s* descr, symtab_t* symtab, summary_t* summary,
+				     spill_t* spill)
+{
+	reloc_walk_32 w;
+	walk_begin_32(in, descr, symtab, summary, &w);
+	w.spill = spill;
+
+	uint32_t i = 0;
+	for (Elf32_Shdr* sec; (sec = next_reloc_sec_32(in, descr, &i)) != NULL; )
+	{
+		const uint64_t span = trace_begin();
+		if ( summary && summary_is_sampled(summary) )
+		{
+			// Only the records sampled are read, striding over the rest
+			const size_t n = sec->sh_size / sec->sh_entsize;
+			for (size_t k = summary_sample_gap(summary); k < n; k += 1 + summary_sample_gap(summary))
+			{
+				Elf32_Rela r;
+				read_reloc_32(descr, sec, k, &r);
+				add_reloc_32(&w, sec, &r);
+				w.nsampled++;
+			}
+			w.nrecords += n;
+			trace_end(span, "relocations", get_sh_str_32(descr, sec->sh_name), input_get_file_name(in), n);
+			continue;
+		}
+
+		reloc_cursor_32 c;
+		cursor_init_32(in, &c, sec, 0, sec->sh_size / sec->sh_entsize);
+		while ( cursor_read_32(in, descr, &c) )
+		{
+			add_reloc_32(&w, sec, &c.r);
+		}
+		trace_end(span, "relocations", get_sh_str_32(descr, sec->sh_name), input_get_file_name(in), c.end);
+	}
+
+	walk_end_32(&w);
+}
+
+/**
+ * Processes relocation records in the given input ELF file, adding information to the given symbol table.
+ */
+extern void process_relocations_32(input_t* in, elf_sections_s* descr, symtab_t* symtab)
+{
+	walk_relocations_32(in, descr, symtab, NULL, NULL);
+}
+
+/**
+ * Counts relocation records in the given input ELF file in the given summary, without keeping them.
+ */
+extern void summarize_relocations_32(input_t* in, elf_sections_s* descr, symtab_t* symtab, summary_t* summary)
+{
+	assert(summary);
+
+	walk_relocations_32(in, descr, symtab, summary, NULL);
+}
+
+/**
+ * Passes relocation records in the given input ELF file to the given external sort instead of the symbol table
+ * (the --mem-limit option).
+ */
+extern void spill_relocations_32(input_t* in, elf_sections_s* descr, symtab_t* symtab, spill_t* spill)
+{
+	assert(spill);
+
+	walk_relocations_32(in, descr, symtab, NULL, spill);
+}
+
+/**
+ * Returns the index of the first relocation record of the section, of the n ones, at or past the given offset,
+ * found by binary search as if the records went in the order of their offsets, which they mostly do within
+ * a section applying to another one. Sets *sorted to false if the records probed show they do not.
+ */
+static size_t	reloc_lower_bound_32(elf_sections_s* descr, const Elf32_Shdr* sec, size_t n, size_t offset,
+				      bool* sorted)
+{
+	size_t lo = 0, hi = n;
+	Elf32_Addr lo_off = 0, hi_off = (Elf32_Addr)-1;
+	while ( lo < hi )
+	{
+		const size_t mid = lo + (hi - lo)/2;
+		Elf32_Rela r;
+		read_reloc_32(descr, sec, mid, &r);
+		if ( r.r_offset < lo_off || r.r_offset > hi_off )
+		{
+			*sorted = false;
+			return 0;
+		}
+
+		if ( r.r_offset < offset )
+		{
+			lo = mid + 1;
+			lo_off = r.r_offset;
+		}
+		else
+		{
+			hi = mid;
+			hi_off = r.r_offset;
+		}
+	}
+
+	*sorted = true;
+	return lo;
+}
+
+/**
+ * Adds the relocation records of the section that apply within the given range to the symbol table. Those of
+ * a section applying to another one are looked up by binary search and read until the range is over; if they
+ * turn out not to go in the order of their offsets, or the section applies to the whole image (.rela.dyn
+ * mixes the kinds of records), all of them are read.
+ */
+static void	add_range_relocs_32(reloc_walk_32* w, const Elf32_Shdr* sec, const symtab_range_t* range)
+{
+	const size_t n = sec->sh_size / sec->sh_entsize;
+
+	w->range = range;
+	bool sorted = false;
+	const size_t start = (sec->sh_info != 0) ? reloc_lower_bound_32(w->descr, sec, n, range->begin, &sorted) : 0;
+
+	Elf32_Addr last = 0;
+	for (size_t i = start; i < n; ++i)
+	{
+		Elf32_Rela r;
+		read_reloc_32(w->descr, sec, i, &r);
+		w->nrecords++;
+		if ( sorted && r.r_offset < last )
+		{
+			// Out of order after all, the records skipped may be in the range as well
+			report(VERB, "Relocations of section \"%s\" are not sorted, reading all of them",
+			       get_sh_str_32(w->descr, sec->sh_name));
+			sorted = false;
+			for (size_t k = 0; k < start; ++k)
+			{
+				Elf32_Rela rk;
+				read_reloc_32(w->descr, sec, k, &rk);
+				w->nrecords++;
+				if ( rk.r_offset >= range->begin && rk.r_offset < range->end )
+				{
+					add_reloc_32(w, sec, &rk);
+				}
+			}
+		}
+		if ( sorted && r.r_offset >= range->end )
+			break;
+
+		last = r.r_offset;
+		if ( r.r_offset >= range->begin && r.r_offset < range->end )
+		{
+			add_reloc_32(w, sec, &r);
+		}
+	}
+	w->range = NULL;
+}
+
+/**
+ * Processes the relocation records in the given input ELF file that apply within the functions and objects
+ * named exactly name (the -S option), adding them to the given symbol table, without reading the rest if
+ * the records are in the order of their offsets. In a relocatable file, only the records applying to the
+ * section of a symbol are read for it.
+ */
+extern void process_symbol_relocations_32(input_t* in, elf_sections_s* descr, symtab_t* symtab, const char* name)
+{
+	symtab_range_t* ranges = NULL;
+	const size_t nranges = symtab_find_ranges(symtab, name, &ranges);
+	const bool is_rel = (((Elf32_Ehdr*)descr->map)->e_type == ET_REL);
+
+	reloc_walk_32 w;
+	walk_begin_32(in, descr, symtab, NULL, &w);
+
+	size_t ntotal = 0;
+	uint32_t i = 0;
+	for (Elf32_Shdr* sec; nranges > 0 && (sec = next_reloc_sec_32(in, descr, &i)) != NULL; )
+	{
+		ntotal += sec->sh_size / sec->sh_entsize;
+		const uint64_t span = trace_begin();
+		const size_t nread = w.nrecords;
+		for (size_t k = 0; k < nranges; ++k)
+		{
+			if ( is_rel && sec->sh_info != ranges[k].shndx )
+				continue;
+
+			add_range_relocs_32(&w, sec, &ranges[k]);
+		}
+		trace_end(span, "relocations", get_sh_str_32(descr, sec->sh_name), input_get_file_name(in),
+			  w.nrecords - nread);
+	}
+	report(VERB, "Read %zu of %zu relocations for %zu symbols named \"%s\"", w.nrecords, ntotal, nranges, name);
+
+	walk_end_32(&w);
+	free(ranges);
+}
+
+#define STREAM_RUNS	64	// sorted runs of relocation records always merged, and their least average length
+
+/**
+ * Sorted runs of relocation records, each read with its own cursor (see stream_relocations_32()).
+ */
+typedef struct reloc_runs_32
+{
+	reloc_cursor_32 *	runs;
+	size_t			nruns;
+	size_t			size;		// runs allocated
+	size_t			nrecs;		// records in all the runs
+} reloc_runs_32;
+
+/**
+ * Splits the records of the relocation section into runs that go in the order of their offsets and
+ * adds a cursor for each of them to runs.
+ */
+static void	add_reloc_runs_32(input_t* in, elf_sections_s* descr, Elf32_Shdr* sec, reloc_runs_32* runs)
+{
+	const size_t nelem = sec->sh_size / sec->sh_entsize;
+
+	reloc_cursor_32 c;
+	cursor_init_32(in, &c, sec, 0, nelem);
+
+	size_t first = 0;
+	for (Elf32_Addr last = 0; first < nelem; )
+	{
+		const bool more = cursor_read_32(in, descr, &c);
+		if ( more && c.r.r_offset >= last )
+		{
+			last = c.r.r_offset;
+			continue;
+		}
+
+		// The record just read, if any, starts the next run
+		const size_t end = more ? c.next - 1 : nelem;
+		if ( end > first )
+		{
+			if ( runs->nruns == runs->size )
+			{
+				runs->size = runs->size ? 2*runs->size : 16;
+				runs->runs = realloc(runs->runs, runs->size*sizeof(reloc_cursor_32));
+				if ( !runs->runs )
+				{
+					fatal_err("Not enough memory");
+				}
+			}
+			runs->runs[runs->nruns++] = (reloc_cursor_32){ .sec = sec, .first = first, .end = end };
+		}
+		first = end;
+		last = more ? c.r.r_offset : 0;
+	}
+
+	runs->nrecs += nelem;
+}
+
+/**
+ * Returns true if the next record of cursor a goes before that of b: the lower offset first and, for the same
+ * offset, in the order the records are in the file, which is the order walk_relocations_32() adds them in.
+ */
+static bool	cursor_less_32(const reloc_cursor_32* a, const reloc_cursor_32* b)
+{
+	if ( a->r.r_offset != b->r.r_offset )
+		return a->r.r_offset < b->r.r_offset;
+
+	return a->sec < b->sec || (a->sec == b->sec && a->first < b->first);
+}
+
+static void	heap_sift_down_32(reloc_cursor_32** heap, size_t n, size_t i)
+{
+	for (size_t least = i; ; i = least)
+	{
+		const size_t l = 2*i + 1;
+		const size_t r = l + 1;
+		if ( l < n && cursor_less_32(heap[l], heap[least]) )
+			least = l;
+		if ( r < n && cursor_less_32(heap[r], heap[least]) )
+			least = r;
+		if ( least == i )
+			break;
+
+		reloc_cursor_32* t = heap[i];
+		heap[i] = heap[least];
+		heap[least] = t;
+	}
+}
+
+/**
+ * Processes relocation records in the given input ELF file in the order of their offsets, printing out each
+ * symbol and its references (see symtab_dump_upto()) as soon as the records for it are over, and stores
+ * the number of references printed in *nrefs. Linkers put the records mostly in the order of their offsets,
+ * so the runs of the records that are in order are merged. If the runs are too short for that to pay off, or
+ * there are enough records for symtab_dump_to() to format with several threads, returns false having added
+ * nothing, and the relocations are to be processed the usual way.
+ */
+extern bool	stream_relocations_32(input_t* in, elf_sections_s* descr, symtab_t* symtab, FILE* out,
+					  const symtab_filter_t* filter, size_t* nrefs)
+{
+	reloc_runs_32 runs = { 0 };
+	uint32_t i = 0;
+	for (Elf32_Shdr* sec; (sec = next_reloc_sec_32(in, descr, &i)) != NULL; )
+	{
+		const uint64_t span = trace_begin();
+		add_reloc_runs_32(in, descr, sec, &runs);
+		trace_end(span, "relocations", get_sh_str_32(descr, sec->sh_name), input_get_file_name(in),
+			  sec->sh_size / sec->sh_entsize);
+	}
+
+	if ( runs.nruns > STREAM_RUNS && runs.nruns > runs.nrecs / STREAM_RUNS )
+	{
+		report(VERB, "%zu relocations are in %zu sorted runs, reading all before printing", runs.nrecs, runs.nruns);
+		free(runs.runs);
+		return false;
+	}
+
+	// Merging is done by this thread alone, while several can format the references read all first, and
+	// faster; the memory spared by printing as they are read matters if it is limited, though
+	if ( !args_get_mem_limit() && symtab_dump_threads(filter, runs.nrecs) > 1 )
+	{
+		report(VERB, "%zu relocations are in %zu sorted runs, reading all to print with several threads",
+		       runs.nrecs, runs.nruns);
+		free(runs.runs);
+		return false;
+	}
+
+	report(VERB, "%zu relocations are in %zu sorted runs, printing references as they are read",
+	       runs.nrecs, runs.nruns);
+
+	reloc_cursor_32** heap = malloc((runs.nruns + 1)*sizeof(reloc_cursor_32*));
+	if ( !heap )
+	{
+		fatal_err("Not enough memory");
+	}
+
+	size_t n = 0;
+	for (size_t k = 0; k < runs.nruns; ++k)
+	{
+		reloc_cursor_32* c = &runs.runs[k];
+		cursor_init_32(in, c, c->sec, c->first, c->end);
+		if ( cursor_read_32(in, descr, c) )
+		{
+			heap[n++] = c;
+		}
+	}
+	for (size_t k = n; k-- > 0; )
+	{
+		heap_sift_down_32(heap, n, k);
+	}
+
+	reloc_walk_32 w;
+	walk_begin_32(in, descr, symtab, NULL, &w);
+
+	const uint64_t span = trace_begin();
+	*nrefs = 0;
+	while ( n > 0 )
+	{
+		reloc_cursor_32* c = heap[0];
+
+		// The symbols before the one this record is for are complete
+		*nrefs += symtab_dump_upto(symtab, out, filter, c->r.r_offset);
+		add_reloc_32(&w, c->sec, &c->r);
+
+		if ( !cursor_read_32(in, descr, c) )
+		{
+			heap[0] = heap[--n];
+		}
+		heap_sift_down_32(heap, n, 0);
+	}
+	*nrefs += symtab_dump_upto(symtab, out, filter, SIZE_MAX);
+	trace_end(span, "dump", "merge and dump", input_get_file_name(in), runs.nrecs);
+
+	walk_end_32(&w);
+
+	free(heap);
+	free(runs.runs);
+	return true;
+}
@@ -0,0 +1,310 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// Comparison of the references made in two builds of the same file (--diff OLD NEW).
+//
+// A reference is an edge from the referring symbol to the referenced one with
+// the addend; the offset of the reference within the referring symbol is what
+// may change between builds without the reference itself changing. The edges of
+// both files are hash-joined twice: on the edge with the offset first, which
+// pairs up the references that stayed in place, then on the edge alone, which
+// pairs up the rest as moved. What remains unpaired was added or removed. Both
+// joins take time linear in the number of edges.
+
+#include "diff.h"
+#include "input.h"
+#include "symtab.h"
+#include "errors.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A reference made in one of the files.
+ */
+typedef struct edge
+{
+	const char *	sym_name;	// the referring symbol
+	int		sym_type;
+	const char *	ref_name;	// the referenced symbol or NULL
+	bool		ref_is_func;
+	int64_t		addend;
+	uint32_t	type;		// relocation type, shown with -t
+	const char *	type_name;
+	size_t		offset;		// of the reference from the referring symbol's address
+	uint64_t	hash;		// of sym_name, ref_name and addend
+	size_t		next;		// next edge in the same hash table bucket list (see join())
+	bool		paired;		// found in the other file
+} edge;
+
+/**
+ * The references made in a file.
+ */
+typedef struct edges
+{
+	edge *	e;
+	size_t	n;
+	size_t	capacity;
+} edges;
+
+#define NONE	SIZE_MAX
+
+static uint64_t	hash_str(uint64_t h, const char* s)
+{
+	for (; s && *s; ++s)
+	{
+		h = (h ^ (unsigned char)*s) * 0x100000001b3ULL;
+	}
+	return (h ^ 0xff) * 0x100000001b3ULL; // so that "ab","c" differs from "a","bc"
+}
+
+static void	add_edge(void* ctx, const symtab_ref_t* ref)
+{
+	edges *es = ctx;
+
+	if (es->n == es->capacity)
+	{
+		es->capacity = es->capacity ? 2*es->capacity : 1024;
+		es->e = realloc(es->e, es->capacity*sizeof(edge));
+		if (!es->e)
+		{
+			fatal_err("Not enough memory");
+		}
+	}
+
+	uint64_t h = hash_str(0xcbf29ce484222325ULL, ref->sym_name);
+	h = hash_str(h, ref->ref_name);
+	h = (h ^ (uint64_t)ref->addend) * 0x100000001b3ULL;
+
+	es->e[es->n++] = (edge){ .sym_name = ref->sym_name, .sym_type = ref->sym_type, .ref_name = ref->ref_name,
+				 .ref_is_func = ref->ref_is_func, .addend = ref->addend, .type = ref->type,
+				 .type_name = ref->type_name, .offset = ref->offset, .hash = h, .next = NONE };
+}
+
+static bool	same_str(const char* a, const char* b)
+{
+	return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+static bool	same_edge(const edge* a, const edge* b, bool with_offset)
+{
+	return a->hash == b->hash && a->addend == b->addend && (!with_offset || a->offset == b->offset)
+		&& same_str(a->sym_name, b->sym_name) && same_str(a->ref_name, b->ref_name);
+}
+
+static uint64_t	edge_hash(const edge* e, bool with_offset)
+{
+	return with_offset ? (e->hash ^ e->offset) * 0x100000001b3ULL : e->hash;
+}
+
+/**
+ * Pairs up the edges of old and new that are not paired yet and are the same (including the offset
+ * if with_offset), marking them paired. The pairs are passed to fn, if given, in the order of new.
+ */
+static void	join(edges* old, edges* new, bool with_offset, void (*fn)(const edge* was, const edge* is, void* ctx), void* ctx)
+{
+	size_t nbuckets = 1;
+	while (nbuckets < old->n)
+	{
+		nbuckets *= 2;
+	}
+
+	size_t *heads = malloc(nbuckets*sizeof(size_t));
+	size_t *tails = malloc(nbuckets*sizeof(size_t));
+	if (!heads || !tails)
+	{
+		fatal_err("Not enough memory");
+	}
+	memset(heads, 0xff, nbuckets*sizeof(size_t)); // NONE
+	memset(tails, 0xff, nbuckets*sizeof(size_t));
+
+	// Build on old: bucket lists keep the edges in their order, so that pairing goes first to first
+	for (size_t i = 0; i < old->n; ++i)
+	{
+		edge *e = &old->e[i];
+		if (e->paired)
+			continue;
+
+		const size_t b = edge_hash(e, with_offset) & (nbuckets - 1);
+		e->next = NONE;
+		if (heads[b] == NONE)
+			heads[b] = i;
+		else
+			old->e[tails[b]].next = i;
+		tails[b] = i;
+	}
+
+	// Probe with new
+	for (size_t i = 0; i < new->n; ++i)
+	{
+		edge *e = &new->e[i];
+		if (e->paired)
+			continue;
+
+		const size_t b = edge_hash(e, with_offset) & (nbuckets - 1);
+		for (size_t *link = &heads[b]; *link != NONE; link = &old->e[*link].next)
+		{
+			edge *was = &old->e[*link];
+			if (same_edge(was, e, with_offset))
+			{
+				was->paired = e->paired = true;
+				*link = was->next; // no one else is to pair with it
+				if (fn)
+					fn(was, e, ctx);
+				break;
+			}
+		}
+	}
+
+	free(tails);
+	free(heads);
+}
+
+struct print_ctx
+{
+	const symtab_filter_t *	filter;
+	size_t			nmoved;
+};
+
+/**
+ * Prints out a reference prefixed with its change: '+' (added), '-' (removed) or '~' (moved
+ * from the offset of was).
+ */
+static void	print_edge(const symtab_filter_t* filter, char change, const edge* was, const edge* e)
+{
+	printf("%c %s", change, e->sym_name);
+	if (change == '~')
+	{
+		printf(filter->offsets_decimal ? " (was +%ld)" : " (was +0x%04lx)", was->offset);
+	}
+
+	const symtab_ref_t ref = { .sym_name = e->sym_name, .sym_type = e->sym_type, .offset = e->offset,
+				   .ref_name = e->ref_name, .ref_is_func = e->ref_is_func, .addend = e->addend,
+				   .type = e->type, .type_name = e->type_name };
+	symtab_print_ref(stdout, filter, &ref, false);
+}
+
+static void	print_moved(const edge* was, const edge* is, void* vctx)
+{
+	struct print_ctx *ctx = vctx;
+
+	print_edge(ctx->filter, '~', was, is);
+	ctx->nmoved++;
+}
+
+/**
+ * Reads in the references made in the given file that pass the filter.
+ * Returns false (having issued the error) if the file can't be read.
+ */
+static bool	read_edges(input_t* in, const char* fname, const symtab_filter_t* filter, symtab_t** st, edges* es)
+{
+	char err[256];
+
+	*st = input_read_refs(in, fname, err, sizeof(err));
+	if (!*st)
+	{
+		error("%s: %s", fname, err);
+		return false;
+	}
+
+	symtab_walk(*st, filter, add_edge, es);
+
+	return true;
+}
+
+/**
+ * Prints out the references that were added, removed or moved in new_name compared to old_name,
+ * leaving out the symbols and references that do not pass the filter. Returns the exit code.
+ */
+extern int	diff_run(const char* old_name, const char* new_name, const symtab_filter_t* filter)
+{
+	assert(old_name && new_name);
+	assert(filter);
+
+	int rc = EXIT_FAILURE;
+
+	input_t *old_in = input_init();
+	input_t *new_in = input_init();
+	symtab_t *old_st = NULL;
+	symtab_t *new_st = NULL;
+	edges old = { 0 };
+	edges new = { 0 };
+
+	if (read_edges(old_in, old_name, filter, &old_st, &old)
+	    && read_edges(new_in, new_name, filter, &new_st, &new))
+	{
+		struct print_ctx ctx = { filter, 0 };
+
+		join(&old, &new, true, NULL, NULL);		// the references that stayed in place
+		join(&old, &new, false, print_moved, &ctx);	// those that moved
+
+		size_t nremoved = 0;
+		for (size_t i = 0; i < old.n; ++i)
+		{
+			if (!old.e[i].paired)
+			{
+				print_edge(filter, '-', NULL, &old.e[i]);
+				nremoved++;
+			}
+		}
+
+		size_t nadded = 0;
+		for (size_t i = 0; i < new.n; ++i)
+		{
+			if (!new.e[i].paired)
+			{
+				print_edge(filter, '+', NULL, &new.e[i]);
+				nadded++;
+			}
+		}
+
+		fflush(stdout); // keep the summary after the references
+		report(NORM, "%zu references added, %zu removed, %zu moved (of %zu in %s, %zu in %s)",
+		       nadded, nremoved, ctx.nmoved, old.n, old_name, new.n, new_name);
+		rc = EXIT_SUCCESS;
+	}
+
+	free(new.e);
+	free(old.e);
+	if (new_st)
+	{
+		symtab_free(new_st);
+		input_close(new_in);
+	}
+	if (old_st)
+	{
+		symtab_free(old_st);
+		input_close(old_in);
+	}
+	input_free(new_in);
+	input_free(old_in);
+
+	return rc;
+}
@@ -0,0 +1,1225 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// Source line attribution from the DWARF line number programs (.debug_line).
+//
+// Nothing is decoded up front. If the file has .debug_aranges, an address is
+// mapped through it and .debug_info to the compilation unit it belongs to, and
+// only that unit's line program is decoded when first needed. Otherwise (as
+// with relocatable files, where .debug_aranges would need relocating and
+// sections overlap anyway), all line programs are decoded at the first lookup.
+// A decoded program is kept as rows sorted by address, each row covering the
+// addresses from its own up to the next row's one.
+
+#include "dwarf.h"
+#include "errors.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <elf.h>
+
+// The constants below are from the DWARF 5 standard
+#define DW_LNS_copy			0x01
+#define DW_LNS_advance_pc		0x02
+#define DW_LNS_advance_line		0x03
+#define DW_LNS_set_file			0x04
+#define DW_LNS_set_column		0x05
+#define DW_LNS_negate_stmt		0x06
+#define DW_LNS_set_basic_block		0x07
+#define DW_LNS_const_add_pc		0x08
+#define DW_LNS_fixed_advance_pc		0x09
+#define DW_LNS_set_prologue_end		0x0a
+#define DW_LNS_set_epilogue_begin	0x0b
+#define DW_LNS_set_isa			0x0c
+
+#define DW_LNE_end_sequence		0x01
+#define DW_LNE_set_address		0x02
+#define DW_LNE_define_file		0x03
+
+#define DW_LNCT_path			0x1
+#define DW_LNCT_directory_index		0x2
+
+#define DW_AT_stmt_list			0x10
+
+#define DW_UT_type			0x02
+#define DW_UT_skeleton			0x04
+#define DW_UT_split_compile		0x05
+#define DW_UT_split_type		0x06
+
+#define DW_FORM_addr			0x01
+#define DW_FORM_block2			0x03
+#define DW_FORM_block4			0x04
+#define DW_FORM_data2			0x05
+#define DW_FORM_data4			0x06
+#define DW_FORM_data8			0x07
+#define DW_FORM_string			0x08
+#define DW_FORM_block			0x09
+#define DW_FORM_block1			0x0a
+#define DW_FORM_data1			0x0b
+#define DW_FORM_flag			0x0c
+#define DW_FORM_sdata			0x0d
+#define DW_FORM_strp			0x0e
+#define DW_FORM_udata			0x0f
+#define DW_FORM_ref_addr		0x10
+#define DW_FORM_ref1			0x11
+#define DW_FORM_ref2			0x12
+#define DW_FORM_ref4			0x13
+#define DW_FORM_ref8			0x14
+#define DW_FORM_ref_udata		0x15
+#define DW_FORM_indirect		0x16
+#define DW_FORM_sec_offset		0x17
+#define DW_FORM_exprloc			0x18
+#define DW_FORM_flag_present		0x19
+#define DW_FORM_strx			0x1a
+#define DW_FORM_addrx			0x1b
+#define DW_FORM_ref_sup4		0x1c
+#define DW_FORM_strp_sup		0x1d
+#define DW_FORM_data16			0x1e
+#define DW_FORM_line_strp		0x1f
+#define DW_FORM_ref_sig8		0x20
+#define DW_FORM_implicit_const		0x21
+#define DW_FORM_loclistx		0x22
+#define DW_FORM_rnglistx		0x23
+#define DW_FORM_ref_sup8		0x24
+#define DW_FORM_strx1			0x25
+#define DW_FORM_strx2			0x26
+#define DW_FORM_strx3			0x27
+#define DW_FORM_strx4			0x28
+#define DW_FORM_addrx1			0x29
+#define DW_FORM_addrx2			0x2a
+#define DW_FORM_addrx3			0x2b
+#define DW_FORM_addrx4			0x2c
+#define DW_FORM_GNU_addr_index		0x1f01
+#define DW_FORM_GNU_str_index		0x1f02
+#define DW_FORM_GNU_ref_alt		0x1f20
+#define DW_FORM_GNU_strp_alt		0x1f21
+
+#define END_SEQ		UINT32_MAX		// row.file of the row that ends a sequence
+#define NO_FILE		(UINT32_MAX - 1)	// row.file of the rows with a bad file index
+#define NO_UNIT		SIZE_MAX		// arange.unit of a range not yet resolved
+#define BAD_UNIT	(SIZE_MAX - 1)		// arange.unit of a range that could not be resolved
+
+/**
+ * A row of the line number table: the addresses from addr up to the next row's one come from file:line.
+ */
+typedef struct row
+{
+	uint64_t	addr;
+	uint32_t	file;		// index into the unit's files or END_SEQ
+	uint32_t	line;
+} row;
+
+/**
+ * A line number program, which describes one compilation unit.
+ */
+typedef struct unit
+{
+	size_t		off;		// of the program in .debug_line
+	bool		decoded;
+	row *		rows;		// sorted by address
+	size_t		nrows;
+	char **		files;		// file names, prefixed with the directory unless it's the compilation one
+	size_t		nfiles;
+} unit;
+
+/**
+ * An address range from .debug_aranges.
+ */
+typedef struct arange
+{
+	uint64_t	lo;
+	uint64_t	hi;
+	size_t		info_off;	// of the compilation unit in .debug_info
+	size_t		unit;		// index of the unit's line program or NO_UNIT/BAD_UNIT
+} arange;
+
+/**
+ * An address range described by a sequence of rows of a line program.
+ */
+typedef struct seq
+{
+	uint64_t	lo;
+	uint64_t	hi;
+	size_t		unit;
+} seq;
+
+struct dwarf_lines_s
+{
+	bool		big_endian;	// of the input file
+	input_section_t	sec_line;	// .debug_line
+	input_section_t	sec_line_str;	// .debug_line_str
+	input_section_t	sec_str;	// .debug_str
+	input_section_t	sec_info;	// .debug_info
+	input_section_t	sec_abbrev;	// .debug_abbrev
+	input_reloc_t *	relocs;		// applied to .debug_line in relocatable files
+	size_t		nrelocs;
+
+	unit *		units;		// sorted by offset
+	size_t		nunits;
+	arange *	aranges;	// sorted by address
+	size_t		naranges;
+	seq *		seqs;		// of all the units decoded
+	size_t		nseqs;
+	bool		seqs_sorted;	// all units are decoded and seqs are sorted by address
+};
+
+/**
+ * Reads a DWARF section sequentially.
+ */
+typedef struct cursor
+{
+	const char *		base;		// start of the section
+	const char *		p;
+	const char *		end;
+	bool			bad;		// attempted to read past the end
+	bool			big_endian;
+	const input_reloc_t *	relocs;		// applied to the section, sorted by offset
+	size_t			nrelocs;
+} cursor;
+
+/**
+ * Header fields of a DWARF unit that affect how its data is read.
+ */
+typedef struct unit_hdr
+{
+	unsigned int	version;
+	unsigned int	offsize;	// 4 or 8 for 32- and 64-bit DWARF respectively
+	unsigned int	addr_size;
+} unit_hdr;
+
+static cursor	make_cursor(const dwarf_lines_t* dl, const input_section_t* sec, size_t off)
+{
+	cursor c = { .base = sec->data, .p = sec->data, .end = sec->data + sec->size, .big_endian = dl->big_endian };
+	if (off > sec->size)
+	{
+		c.bad = true;
+		off = sec->size;
+	}
+	c.p += off;
+
+	if (sec == &dl->sec_line)
+	{
+		c.relocs = dl->relocs;
+		c.nrelocs = dl->nrelocs;
+	}
+
+	return c;
+}
+
+static void	skip(cursor* c, uint64_t n)
+{
+	if ((uint64_t)(c->end - c->p) < n)
+	{
+		c->bad = true;
+		c->p = c->end;
+		return;
+	}
+	c->p += n;
+}
+
+static uint64_t	read_u(cursor* c, size_t n)
+{
+	assert(n <= 8);
+
+	if ((size_t)(c->end - c->p) < n)
+	{
+		c->bad = true;
+		c->p = c->end;
+		return 0;
+	}
+
+	uint64_t v = 0;
+	for (size_t i = 0; i < n; ++i)
+	{
+		const uint64_t b = (unsigned char)c->p[i];
+		if (c->big_endian)
+			v = (v << 8) | b;
+		else
+			v |= b << (8*i);
+	}
+	c->p += n;
+
+	return v;
+}
+
+static uint64_t	read_uleb(cursor* c)
+{
+	uint64_t v = 0;
+	for (unsigned int shift = 0; c->p < c->end; shift += 7)
+	{
+		const uint64_t b = (unsigned char)*c->p++;
+		if (shift < 64)
+			v |= (b & 0x7f) << shift;
+		if (!(b & 0x80))
+			return v;
+	}
+
+	c->bad = true;
+	return 0;
+}
+
+static int64_t	read_sleb(cursor* c)
+{
+	uint64_t v = 0;
+	for (unsigned int shift = 0; c->p < c->end; )
+	{
+		const uint64_t b = (unsigned char)*c->p++;
+		if (shift < 64)
+			v |= (b & 0x7f) << shift;
+		shift += 7;
+		if (!(b & 0x80))
+		{
+			if (shift < 64 && (b & 0x40))
+				v |= ~(uint64_t)0 << shift;
+			return (int64_t)v;
+		}
+	}
+
+	c->bad = true;
+	return 0;
+}
+
+static const char *	read_str(cursor* c)
+{
+	const char *s = c->p;
+	const char *nul = memchr(c->p, 0, (size_t)(c->end - c->p));
+	if (!nul)
+	{
+		c->bad = true;
+		c->p = c->end;
+		return NULL;
+	}
+	c->p = nul + 1;
+
+	return s;
+}
+
+/**
+ * Reads a value of n bytes, applying the relocation found at its offset if any.
+ */
+static uint64_t	read_reloc(cursor* c, size_t n)
+{
+	const size_t off = (size_t)(c->p - c->base);
+	const uint64_t v = read_u(c, n);
+
+	size_t lo = 0;
+	size_t hi = c->nrelocs;
+	while (lo < hi)
+	{
+		const size_t mid = lo + (hi - lo)/2;
+		if (c->relocs[mid].offset < off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < c->nrelocs && c->relocs[lo].offset == off)
+	{
+		const input_reloc_t *r = &c->relocs[lo];
+		return r->value + (uint64_t)(r->is_rela ? r->addend : (int64_t)v);
+	}
+
+	return v;
+}
+
+/**
+ * Reads the initial length of a unit and sets the cursor's end to the unit's end.
+ * Returns false if the unit does not fit the section.
+ */
+static bool	read_unit_length(cursor* c, unit_hdr* h)
+{
+	uint64_t len = read_u(c, 4);
+	h->offsize = 4;
+	if (len == 0xffffffff)
+	{
+		len = read_u(c, 8);
+		h->offsize = 8;
+	}
+
+	if (c->bad || len > (uint64_t)(c->end - c->p))
+	{
+		return false;
+	}
+	c->end = c->p + len;
+
+	return true;
+}
+
+/**
+ * Returns the null-terminated string at the given offset in the section or NULL if there is none.
+ */
+static const char *	str_at(const input_section_t* sec, uint64_t off)
+{
+	if (!sec->data || off >= sec->size || !memchr(sec->data + off, 0, sec->size - off))
+	{
+		return NULL;
+	}
+
+	return sec->data + off;
+}
+
+/**
+ * Reads an attribute value of the given form, storing it in *val or, if it's a string, in *str.
+ * Returns false if the form is not known.
+ */
+static bool	read_form(const dwarf_lines_t* dl, cursor* c, uint64_t form, const unit_hdr* h, uint64_t* val, const char** str)
+{
+	*val = 0;
+	*str = NULL;
+
+	switch (form)
+	{
+	case DW_FORM_addr:
+		*val = read_reloc(c, h->addr_size);
+		break;
+	case DW_FORM_block1:
+		skip(c, read_u(c, 1));
+		break;
+	case DW_FORM_block2:
+		skip(c, read_u(c, 2));
+		break;
+	case DW_FORM_block4:
+		skip(c, read_u(c, 4));
+		break;
+	case DW_FORM_block:
+	case DW_FORM_exprloc:
+		skip(c, read_uleb(c));
+		break;
+	case DW_FORM_data16:
+		skip(c, 16);
+		break;
+	case DW_FORM_data1:
+	case DW_FORM_ref1:
+	case DW_FORM_flag:
+	case DW_FORM_strx1:
+	case DW_FORM_addrx1:
+		*val = read_u(c, 1);
+		break;
+	case DW_FORM_data2:
+	case DW_FORM_ref2:
+	case DW_FORM_strx2:
+	case DW_FORM_addrx2:
+		*val = read_u(c, 2);
+		break;
+	case DW_FORM_strx3:
+	case DW_FORM_addrx3:
+		*val = read_u(c, 3);
+		break;
+	case DW_FORM_data4:
+	case DW_FORM_ref4:
+	case DW_FORM_ref_sup4:
+	case DW_FORM_strx4:
+	case DW_FORM_addrx4:
+		*val = read_reloc(c, 4);
+		break;
+	case DW_FORM_data8:
+	case DW_FORM_ref8:
+	case DW_FORM_ref_sig8:
+	case DW_FORM_ref_sup8:
+		*val = read_reloc(c, 8);
+		break;
+	case DW_FORM_string:
+		*str = read_str(c);
+		break;
+	case DW_FORM_strp:
+		*str = str_at(&dl->sec_str, read_reloc(c, h->offsize));
+		break;
+	case DW_FORM_line_strp:
+		*str = str_at(&dl->sec_line_str, read_reloc(c, h->offsize));
+		break;
+	case DW_FORM_sec_offset:
+	case DW_FORM_strp_sup:
+	case DW_FORM_GNU_ref_alt:
+	case DW_FORM_GNU_strp_alt:
+		*val = read_reloc(c, h->offsize);
+		break;
+	case DW_FORM_ref_addr:
+		*val = read_reloc(c, h->version <= 2 ? h->addr_size : h->offsize);
+		break;
+	case DW_FORM_sdata:
+		*val = (uint64_t)read_sleb(c);
+		break;
+	case DW_FORM_udata:
+	case DW_FORM_ref_udata:
+	case DW_FORM_strx:
+	case DW_FORM_addrx:
+	case DW_FORM_loclistx:
+	case DW_FORM_rnglistx:
+	case DW_FORM_GNU_addr_index:
+	case DW_FORM_GNU_str_index:
+		*val = read_uleb(c);
+		break;
+	case DW_FORM_flag_present:
+	case DW_FORM_implicit_const:
+		break;
+	case DW_FORM_indirect:
+		return read_form(dl, c, read_uleb(c), h, val, str);
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Returns the file name, prefixed with the directory if there is one, as a newly allocated string.
+ */
+static char *	make_file_name(const char* dir, const char* name)
+{
+	if (!name)
+		name = "??";
+
+	const size_t len = strlen(name) + (dir ? strlen(dir) + 1 : 0) + 1;
+	char *res = malloc(len);
+	if (!res)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	if (dir && name[0] != '/')
+		snprintf(res, len, "%s/%s", dir, name);
+	else
+		snprintf(res, len, "%s", name);
+
+	return res;
+}
+
+static void	add_file(unit* u, const char* dir, const char* name)
+{
+	char **files = realloc(u->files, (u->nfiles + 1)*sizeof(char*));
+	if (!files)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	u->files = files;
+	u->files[u->nfiles++] = make_file_name(dir, name);
+}
+
+/**
+ * Appends a row to the unit, replacing the previous row of the sequence if they start at the same address.
+ */
+static void	add_row(unit* u, size_t seq_start, uint64_t addr, uint32_t file, uint32_t line)
+{
+	row *last = (u->nrows > seq_start) ? &u->rows[u->nrows - 1] : NULL;
+	if (!last || last->addr != addr)
+	{
+		// Grow by doubling; the capacity is the next power of two
+		if (u->nrows == 0 || (u->nrows & (u->nrows - 1)) == 0)
+		{
+			row *rows = realloc(u->rows, (u->nrows ? 2*u->nrows : 16)*sizeof(row));
+			if (!rows)
+			{
+				fatal_err("Not enough memory");
+			}
+			u->rows = rows;
+		}
+		last = &u->rows[u->nrows++];
+	}
+
+	last->addr = addr;
+	last->file = file;
+	last->line = line;
+}
+
+static void	add_seq(dwarf_lines_t* dl, uint64_t lo, uint64_t hi, size_t unit_idx)
+{
+	seq *seqs = realloc(dl->seqs, (dl->nseqs + 1)*sizeof(seq));
+	if (!seqs)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	dl->seqs = seqs;
+	dl->seqs[dl->nseqs++] = (seq){ lo, hi, unit_idx };
+}
+
+/**
+ * Orders rows by address, the row that ends a sequence going before the one that starts another at the same address.
+ */
+static int	cmp_rows(const void* a, const void* b)
+{
+	const row *ra = a;
+	const row *rb = b;
+	if (ra->addr != rb->addr)
+		return ra->addr < rb->addr ? -1 : 1;
+
+	return (rb->file == END_SEQ) - (ra->file == END_SEQ);
+}
+
+/**
+ * Reads the directories or files table of a version 5 line program header. Directories are
+ * stored in dirs (which is allocated), files are added to the unit.
+ */
+static void	read_entries_v5(dwarf_lines_t* dl, cursor* c, const unit_hdr* h, const char*** dirs, size_t* ndirs, unit* u)
+{
+	uint64_t formats[16][2];
+	const size_t nformats = read_u(c, 1);
+	for (size_t i = 0; i < nformats; ++i)
+	{
+		const uint64_t type = read_uleb(c);
+		const uint64_t form = read_uleb(c);
+		if (i < sizeof(formats)/sizeof(formats[0]))
+		{
+			formats[i][0] = type;
+			formats[i][1] = form;
+		}
+	}
+
+	if (nformats > sizeof(formats)/sizeof(formats[0]))
+	{
+		c->bad = true;
+		return;
+	}
+
+	const uint64_t count = read_uleb(c);
+	for (uint64_t k = 0; k < count && !c->bad; ++k)
+	{
+		const char *path = NULL;
+		uint64_t dir_idx = 0;
+		for (size_t i = 0; i < nformats; ++i)
+		{
+			uint64_t val = 0;
+			const char *str = NULL;
+			if (!read_form(dl, c, formats[i][1], h, &val, &str))
+			{
+				c->bad = true;
+				return;
+			}
+
+			if (formats[i][0] == DW_LNCT_path)
+				path = str;
+			else if (formats[i][0] == DW_LNCT_directory_index)
+				dir_idx = val;
+		}
+
+		if (u)
+		{
+			// Directory 0 is the compilation directory, not shown
+			add_file(u, (dir_idx > 0 && dir_idx < *ndirs) ? (*dirs)[dir_idx] : NULL, path);
+		}
+		else
+		{
+			const char **d = realloc(*dirs, (*ndirs + 1)*sizeof(char*));
+			if (!d)
+			{
+				fatal_err("Not enough memory");
+			}
+			*dirs = d;
+			(*dirs)[(*ndirs)++] = path;
+		}
+	}
+}
+
+/**
+ * Decodes the line program of the unit with the given index.
+ */
+static void	decode_unit(dwarf_lines_t* dl, size_t unit_idx)
+{
+	unit *u = &dl->units[unit_idx];
+	assert(!u->decoded);
+	u->decoded = true;
+
+	cursor c = make_cursor(dl, &dl->sec_line, u->off);
+	unit_hdr h = { .addr_size = 8 };
+	if (!read_unit_length(&c, &h))
+	{
+		error("Line program at offset 0x%lx in .debug_line is truncated", u->off);
+		return;
+	}
+
+	h.version = (unsigned int)read_u(&c, 2);
+	if (h.version < 2 || h.version > 5)
+	{
+		error("Line program at offset 0x%lx in .debug_line has unsupported version %u", u->off, h.version);
+		return;
+	}
+
+	if (h.version >= 5)
+	{
+		h.addr_size = (unsigned int)read_u(&c, 1);
+		read_u(&c, 1); // segment selector size
+	}
+
+	const uint64_t hdr_len = read_u(&c, h.offsize);
+	cursor prog = c;
+	skip(&prog, hdr_len);
+
+	const uint64_t min_inst = read_u(&c, 1);
+	if (h.version >= 4)
+		read_u(&c, 1); // max ops per instruction, only matters for VLIW
+	read_u(&c, 1); // default is_stmt
+	const int64_t line_base = (int8_t)read_u(&c, 1);
+	const uint64_t line_range = read_u(&c, 1);
+	const uint64_t opcode_base = read_u(&c, 1);
+	const char *std_lengths = c.p;
+	skip(&c, opcode_base ? opcode_base - 1 : 0);
+
+	if (c.bad || prog.bad || line_range == 0 || opcode_base == 0)
+	{
+		error("Line program at offset 0x%lx in .debug_line has malformed header", u->off);
+		return;
+	}
+
+	const char **dirs = NULL;
+	size_t ndirs = 0;
+	if (h.version >= 5)
+	{
+		read_entries_v5(dl, &c, &h, &dirs, &ndirs, NULL);
+		read_entries_v5(dl, &c, &h, &dirs, &ndirs, u);
+	}
+	else
+	{
+		// Directory 0 is the compilation directory, the listed ones start from 1
+		for (const char *d = read_str(&c); d && *d; d = read_str(&c))
+		{
+			const char **nd = realloc(dirs, (ndirs + 2)*sizeof(char*));
+			if (!nd)
+			{
+				fatal_err("Not enough memory");
+			}
+			dirs = nd;
+			if (ndirs == 0)
+				dirs[ndirs++] = NULL;
+			dirs[ndirs++] = d;
+		}
+		for (const char *f = read_str(&c); f && *f; f = read_str(&c))
+		{
+			const uint64_t dir_idx = read_uleb(&c);
+			read_uleb(&c); // modification time
+			read_uleb(&c); // file size
+			add_file(u, (dir_idx > 0 && dir_idx < ndirs) ? dirs[dir_idx] : NULL, f);
+		}
+	}
+
+	if (c.bad)
+	{
+		error("Line program at offset 0x%lx in .debug_line has malformed file table", u->off);
+	}
+
+	// Files are numbered from 1 before version 5
+	const uint64_t file_base = (h.version >= 5) ? 0 : 1;
+
+	uint64_t addr = 0;
+	uint64_t file = 1;
+	int64_t line = 1;
+	size_t seq_start = u->nrows;
+
+	while (prog.p < prog.end && !prog.bad)
+	{
+		const uint64_t op = read_u(&prog, 1);
+		bool emit = false;
+
+		if (op >= opcode_base)
+		{
+			const uint64_t adj = op - opcode_base;
+			addr += (adj / line_range)*min_inst;
+			line += line_base + (int64_t)(adj % line_range);
+			emit = true;
+		}
+		else switch (op)
+		{
+		case 0: // extended opcode
+		{
+			const uint64_t len = read_uleb(&prog);
+			cursor next = prog;
+			skip(&next, len);
+			if (next.bad || len == 0)
+			{
+				prog.bad = true;
+				break;
+			}
+
+			const uint64_t sub = read_u(&prog, 1);
+			if (sub == DW_LNE_end_sequence)
+			{
+				add_row(u, seq_start, addr, END_SEQ, 0);
+				if (u->nrows - seq_start > 1)
+				{
+					add_seq(dl, u->rows[seq_start].addr, addr, unit_idx);
+				}
+				else
+				{
+					u->nrows = seq_start; // empty sequence
+				}
+
+				addr = 0;
+				file = 1;
+				line = 1;
+				seq_start = u->nrows;
+			}
+			else if (sub == DW_LNE_set_address && len - 1 <= 8)
+			{
+				addr = read_reloc(&prog, len - 1);
+			}
+			else if (sub == DW_LNE_define_file && h.version < 5)
+			{
+				const char *f = read_str(&prog);
+				const uint64_t dir_idx = read_uleb(&prog);
+				add_file(u, (dir_idx > 0 && dir_idx < ndirs) ? dirs[dir_idx] : NULL, f);
+			}
+			prog.p = next.p;
+			break;
+		}
+		case DW_LNS_copy:
+			emit = true;
+			break;
+		case DW_LNS_advance_pc:
+			addr += read_uleb(&prog)*min_inst;
+			break;
+		case DW_LNS_advance_line:
+			line += read_sleb(&prog);
+			break;
+		case DW_LNS_set_file:
+			file = read_uleb(&prog);
+			break;
+		case DW_LNS_const_add_pc:
+			addr += ((255 - opcode_base) / line_range)*min_inst;
+			break;
+		case DW_LNS_fixed_advance_pc:
+			addr += read_u(&prog, 2);
+			break;
+		case DW_LNS_negate_stmt:
+		case DW_LNS_set_basic_block:
+		case DW_LNS_set_prologue_end:
+		case DW_LNS_set_epilogue_begin:
+			break;
+		case DW_LNS_set_column:
+		case DW_LNS_set_isa:
+		default:
+			// Skip the operands, which are all ULEB128
+			for (int i = 0; i < std_lengths[op - 1]; ++i)
+				read_uleb(&prog);
+			break;
+		}
+
+		if (emit)
+		{
+			const uint64_t idx = file - file_base;
+			add_row(u, seq_start, addr, (file >= file_base && idx < u->nfiles) ? (uint32_t)idx : NO_FILE,
+				(uint32_t)line);
+		}
+	}
+
+	if (prog.bad)
+	{
+		error("Line program at offset 0x%lx in .debug_line is malformed", u->off);
+	}
+	u->nrows = seq_start; // drop the unterminated sequence, if any
+
+	for (size_t i = 1; i < u->nrows; ++i)
+	{
+		if (cmp_rows(&u->rows[i - 1], &u->rows[i]) > 0)
+		{
+			qsort(u->rows, u->nrows, sizeof(row), cmp_rows);
+			break;
+		}
+	}
+
+	free(dirs);
+}
+
+/**
+ * Returns the row covering the address in the decoded unit or NULL if there is none.
+ */
+static const row *	unit_find_row(const unit* u, uint64_t addr)
+{
+	size_t lo = 0;
+	size_t hi = u->nrows;
+	while (lo < hi)
+	{
+		const size_t mid = lo + (hi - lo)/2;
+		if (u->rows[mid].addr <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == 0 || u->rows[lo - 1].file == END_SEQ)
+	{
+		return NULL;
+	}
+
+	return &u->rows[lo - 1];
+}
+
+/**
+ * Returns the index of the unit which line program is at the given offset in .debug_line or BAD_UNIT.
+ */
+static size_t	find_unit(const dwarf_lines_t* dl, size_t off)
+{
+	size_t lo = 0;
+	size_t hi = dl->nunits;
+	while (lo < hi)
+	{
+		const size_t mid = lo + (hi - lo)/2;
+		if (dl->units[mid].off < off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return (lo < dl->nunits && dl->units[lo].off == off) ? lo : BAD_UNIT;
+}
+
+/**
+ * Returns the index of the line program of the compilation unit at the given offset in .debug_info or BAD_UNIT.
+ * That's the DW_AT_stmt_list attribute of the unit's first entry.
+ */
+static size_t	resolve_unit(const dwarf_lines_t* dl, size_t info_off)
+{
+	cursor c = make_cursor(dl, &dl->sec_info, info_off);
+	unit_hdr h = { 0 };
+	if (!read_unit_length(&c, &h))
+	{
+		return BAD_UNIT;
+	}
+
+	h.version = (unsigned int)read_u(&c, 2);
+	uint64_t abbrev_off = 0;
+	if (h.version >= 5)
+	{
+		const uint64_t unit_type = read_u(&c, 1);
+		h.addr_size = (unsigned int)read_u(&c, 1);
+		abbrev_off = read_u(&c, h.offsize);
+		if (unit_type == DW_UT_skeleton || unit_type == DW_UT_split_compile)
+			skip(&c, 8);
+		else if (unit_type == DW_UT_type || unit_type == DW_UT_split_type)
+			skip(&c, 8 + h.offsize);
+	}
+	else
+	{
+		abbrev_off = read_u(&c, h.offsize);
+		h.addr_size = (unsigned int)read_u(&c, 1);
+	}
+	const uint64_t code = read_uleb(&c);
+
+	// Find the abbreviation of the entry...
+	cursor a = make_cursor(dl, &dl->sec_abbrev, abbrev_off);
+	for (;;)
+	{
+		const uint64_t acode = read_uleb(&a);
+		if (acode == 0 || a.bad)
+			return BAD_UNIT;
+
+		read_uleb(&a); // tag
+		read_u(&a, 1); // has children
+		if (acode == code)
+			break;
+
+		for (uint64_t attr = read_uleb(&a), form = read_uleb(&a); (attr || form) && !a.bad;
+		     attr = read_uleb(&a), form = read_uleb(&a))
+		{
+			if (form == DW_FORM_implicit_const)
+				read_sleb(&a);
+		}
+	}
+
+	// ...and go through its attributes
+	for (;;)
+	{
+		const uint64_t attr = read_uleb(&a);
+		const uint64_t form = read_uleb(&a);
+		if ((attr == 0 && form == 0) || a.bad || c.bad)
+			return BAD_UNIT;
+
+		if (form == DW_FORM_implicit_const)
+			read_sleb(&a);
+
+		uint64_t val = 0;
+		const char *str = NULL;
+		if (!read_form(dl, &c, form, &h, &val, &str))
+			return BAD_UNIT;
+
+		if (attr == DW_AT_stmt_list)
+			return find_unit(dl, val);
+	}
+}
+
+static int	cmp_aranges(const void* a, const void* b)
+{
+	const arange *ra = a;
+	const arange *rb = b;
+	return (ra->lo > rb->lo) - (ra->lo < rb->lo);
+}
+
+static int	cmp_seqs(const void* a, const void* b)
+{
+	const seq *sa = a;
+	const seq *sb = b;
+	return (sa->lo > sb->lo) - (sa->lo < sb->lo);
+}
+
+/**
+ * Reads the address ranges of .debug_aranges, which is given.
+ */
+static void	read_aranges(dwarf_lines_t* dl, const input_section_t* sec)
+{
+	size_t cap = 0;
+	for (size_t off = 0; off < sec->size; )
+	{
+		cursor c = make_cursor(dl, sec, off);
+		const char *set = c.p;
+		unit_hdr h = { 0 };
+		if (!read_unit_length(&c, &h))
+			break;
+		off = (size_t)(c.end - c.base);
+
+		read_u(&c, 2); // version
+		const size_t info_off = read_u(&c, h.offsize);
+		const size_t addr_size = read_u(&c, 1);
+		read_u(&c, 1); // segment selector size
+		if (addr_size != 4 && addr_size != 8)
+			continue;
+
+		// The tuples are aligned to their size from the start of the set
+		const size_t tuple = 2*addr_size;
+		skip(&c, (tuple - (size_t)(c.p - set) % tuple) % tuple);
+
+		while (!c.bad && c.p < c.end)
+		{
+			const uint64_t lo = read_u(&c, addr_size);
+			const uint64_t len = read_u(&c, addr_size);
+			if (c.bad || (lo == 0 && len == 0))
+				break;
+			if (len == 0)
+				continue;
+
+			if (dl->naranges == cap)
+			{
+				cap = cap ? 2*cap : 64;
+				arange *ar = realloc(dl->aranges, cap*sizeof(arange));
+				if (!ar)
+				{
+					fatal_err("Not enough memory");
+				}
+				dl->aranges = ar;
+			}
+			dl->aranges[dl->naranges++] = (arange){ lo, lo + len, info_off, NO_UNIT };
+		}
+	}
+
+	qsort(dl->aranges, dl->naranges, sizeof(arange), cmp_aranges);
+}
+
+/**
+ * Lists the line programs of .debug_line, which takes reading just their lengths.
+ */
+static void	list_units(dwarf_lines_t* dl)
+{
+	size_t cap = 0;
+	for (size_t off = 0; off < dl->sec_line.size; )
+	{
+		cursor c = make_cursor(dl, &dl->sec_line, off);
+		unit_hdr h = { 0 };
+		if (!read_unit_length(&c, &h))
+		{
+			error("Truncated line program at offset 0x%lx in .debug_line", off);
+			break;
+		}
+
+		if (dl->nunits == cap)
+		{
+			cap = cap ? 2*cap : 64;
+			unit *units = realloc(dl->units, cap*sizeof(unit));
+			if (!units)
+			{
+				fatal_err("Not enough memory");
+			}
+			dl->units = units;
+		}
+		dl->units[dl->nunits++] = (unit){ .off = off };
+
+		off = (size_t)(c.end - c.base);
+	}
+}
+
+/**
+ * Prepares the line number information of the input file for lookups with dwarf_lines_find().
+ * Returns NULL (having let the user know) if the file has none. The result must be released with dwarf_lines_free().
+ */
+extern dwarf_lines_t *	dwarf_lines_alloc(input_t* in, struct reader_funcs* rdr, elf_sections_t* sec)
+{
+	assert(in);
+	assert(rdr);
+
+	input_section_t line;
+	if (!rdr->find_section(in, sec, ".debug_line", &line) || !line.data)
+	{
+		report(NORM, "No .debug_line section in %s; source lines are not shown.", input_get_file_name(in));
+		return NULL;
+	}
+	if (line.flags & SHF_COMPRESSED)
+	{
+		report(NORM, "Compressed .debug_line section in %s is not supported; source lines are not shown.",
+		       input_get_file_name(in));
+		return NULL;
+	}
+
+	dwarf_lines_t *dl = calloc(1, sizeof(dwarf_lines_t));
+	if (!dl)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	const uint16_t one = 1;
+	const bool host_big_endian = (*(const char*)&one == 0);
+	dl->big_endian = (host_big_endian == input_get_is_same_endian(in));
+
+	dl->sec_line = line;
+	rdr->find_section(in, sec, ".debug_line_str", &dl->sec_line_str);
+	rdr->find_section(in, sec, ".debug_str", &dl->sec_str);
+	dl->nrelocs = rdr->read_section_relocs(in, sec, ".debug_line", &dl->relocs);
+
+	list_units(dl);
+
+	// .debug_aranges of a relocatable file is of no use: it needs relocating, and its code sections overlap
+	input_section_t aranges;
+	input_reloc_t *aranges_relocs = NULL;
+	if (rdr->find_section(in, sec, ".debug_aranges", &aranges) && aranges.data
+	    && rdr->find_section(in, sec, ".debug_info", &dl->sec_info) && dl->sec_info.data
+	    && rdr->find_section(in, sec, ".debug_abbrev", &dl->sec_abbrev) && dl->sec_abbrev.data
+	    && !((dl->sec_info.flags | dl->sec_abbrev.flags | aranges.flags) & SHF_COMPRESSED)
+	    && rdr->read_section_relocs(in, sec, ".debug_aranges", &aranges_relocs) == 0)
+	{
+		read_aranges(dl, &aranges);
+	}
+	free(aranges_relocs);
+
+	report(VERB, "Found %zu line programs and %zu address ranges", dl->nunits, dl->naranges);
+
+	return dl;
+}
+
+/**
+ * Releases the line number information.
+ */
+extern void	dwarf_lines_free(dwarf_lines_t* dl)
+{
+	if (!dl)
+		return;
+
+	for (size_t i = 0; i < dl->nunits; ++i)
+	{
+		unit *u = &dl->units[i];
+		for (size_t k = 0; k < u->nfiles; ++k)
+			free(u->files[k]);
+		free(u->files);
+		free(u->rows);
+	}
+
+	free(dl->units);
+	free(dl->aranges);
+	free(dl->seqs);
+	free(dl->relocs);
+	free(dl);
+}
+
+/**
+ * Returns the unit covering the address, decoding as little as possible, or NULL if there is none.
+ */
+static unit *	locate_unit(dwarf_lines_t* dl, uint64_t addr)
+{
+	if (dl->naranges)
+	{
+		size_t lo = 0;
+		size_t hi = dl->naranges;
+		while (lo < hi)
+		{
+			const size_t mid = lo + (hi - lo)/2;
+			if (dl->aranges[mid].lo <= addr)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		arange *a = lo ? &dl->aranges[lo - 1] : NULL;
+		if (!a || addr >= a->hi)
+			return NULL;
+
+		if (a->unit == NO_UNIT)
+			a->unit = resolve_unit(dl, a->info_off);
+		if (a->unit == BAD_UNIT)
+			return NULL;
+
+		if (!dl->units[a->unit].decoded)
+			decode_unit(dl, a->unit);
+
+		return &dl->units[a->unit];
+	}
+
+	if (!dl->seqs_sorted)
+	{
+		for (size_t i = 0; i < dl->nunits; ++i)
+		{
+			if (!dl->units[i].decoded)
+				decode_unit(dl, i);
+		}
+		qsort(dl->seqs, dl->nseqs, sizeof(seq), cmp_seqs);
+		dl->seqs_sorted = true;
+	}
+
+	size_t lo = 0;
+	size_t hi = dl->nseqs;
+	while (lo < hi)
+	{
+		const size_t mid = lo + (hi - lo)/2;
+		if (dl->seqs[mid].lo <= addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	const seq *s = lo ? &dl->seqs[lo - 1] : NULL;
+	return (s && addr < s->hi) ? &dl->units[s->unit] : NULL;
+}
+
+/**
+ * Finds the source file and line the code at the given address comes from.
+ * Returns false if that is not known.
+ */
+extern bool	dwarf_lines_find(dwarf_lines_t* dl, size_t addr, const char** file, unsigned int* line)
+{
+	assert(dl);
+	assert(file);
+	assert(line);
+
+	const unit *u = locate_unit(dl, addr);
+	const row *r = u ? unit_find_row(u, addr) : NULL;
+	if (!r)
+	{
+		return false;
+	}
+
+	*file = (r->file < u->nfiles) ? u->files[r->file] : "??";
+	*line = r->line;
+
+	return true;
+}
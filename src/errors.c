@@ -37,6 +37,37 @@
 #include <string.h>
 #include <stdarg.h>
 
+static _Thread_local jmp_buf *	fatal_env;		// if set, fatal errors jump here instead of exiting
+static _Thread_local char	fatal_msg[256];		// the last fatal error message issued by this thread
+
+/**
+ * Makes fatal() and fatal_err() issued by the calling thread longjmp() to env instead of
+ * reporting the error and terminating the program; the message is then available from
+ * errors_get_fatal_message(). This lets a long-running process (see server.c) survive a bad input.
+ * Passing NULL restores the default behavior.
+ */
+extern void	errors_set_fatal_handler(jmp_buf* env)
+{
+	fatal_env = env;
+}
+
+/**
+ * Returns the handler set with errors_set_fatal_handler() by the calling thread, NULL if none, for the code
+ * setting its own to put it back.
+ */
+extern jmp_buf *	errors_get_fatal_handler(void)
+{
+	return fatal_env;
+}
+
+/**
+ * Returns the text of the last fatal error issued by the calling thread.
+ */
+extern const char *	errors_get_fatal_message(void)
+{
+	return fatal_msg;
+}
+
 /**
  * Issues the given error message to stderr using printf() formatting.
  */
@@ -79,11 +110,16 @@ extern void	fatal(const char *fmt, ...)
 	va_list ap;
 
 	va_start(ap, fmt);
-	fprintf(stderr, "%s: fatal error: ", glob_get_program_name());
-	vfprintf(stderr, fmt, ap);
-	fputc('\n', stderr);
+	vsnprintf(fatal_msg, sizeof(fatal_msg), fmt, ap);
 	va_end(ap);
 
+	if (fatal_env)
+	{
+		longjmp(*fatal_env, 1); // it's up to the handler to report the error
+	}
+
+	fprintf(stderr, "%s: fatal error: %s\n", glob_get_program_name(), fatal_msg);
+
 	exit(EXIT_FAILURE);
 }
 
@@ -96,6 +132,12 @@ extern void	fatal_err(const char *msg)
 	const bool was_error = (errno > 0);
 	const char *errdescr = strerror(errno);
 
+	if (fatal_env)
+	{
+		snprintf(fatal_msg, sizeof(fatal_msg), "%s (%s)", msg, errdescr);
+		longjmp(*fatal_env, 1);
+	}
+
 	// Not using fprintf() here because this function may be called what malloc() failed and fprintf() might try to allocate memory.
 	fputs(glob_get_program_name(), stderr);
 	fputs(": fatal error : ", stderr);
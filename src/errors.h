@@ -28,6 +28,8 @@
 #ifndef ERRORS_H_
 #define ERRORS_H_
 
+#include <setjmp.h>
+
 #define NORETURN __attribute__((noreturn))
 
 enum Verbosity {
@@ -41,5 +43,9 @@ void	fatal_err(const char* msg) NORETURN; // also print errno description
 void	report(enum Verbosity v, const char* fmt, ...);
 void	error(const char* fmt, ...);
 
+void		errors_set_fatal_handler(jmp_buf* env); // per-thread; NULL restores exit()
+jmp_buf *	errors_get_fatal_handler(void);
+const char *	errors_get_fatal_message(void);
+
 #endif
 
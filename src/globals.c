@@ -32,8 +32,10 @@
 #include <libgen.h>
 #include <string.h>
 #include <limits.h>
+#include <unistd.h>
 
 static char *	prg_name;	// the name of self for error reporting
+static size_t	nthreads;	// to split the work among, 0 for as many as there are CPUs
 
 /**
  * Releses the global resources allocated by glob_init(). Should be called right before exit.
@@ -67,3 +69,24 @@ extern const char *	glob_get_program_name(void)
 {
 	return prg_name;
 }
+
+/**
+ * Sets the number of threads to split the work among (the --threads option), 0 for one per CPU.
+ */
+extern void		glob_set_threads(size_t n)
+{
+	nthreads = n;
+}
+
+/**
+ * Returns the number of threads to split the work among, at least 1: the one set with glob_set_threads()
+ * or, if none is, the number of CPUs online. The modules doing the work cap it at what they can use.
+ */
+extern size_t		glob_get_threads(void)
+{
+	if (nthreads)
+		return nthreads;
+
+	const long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return (ncpus > 1) ? (size_t)ncpus : 1;
+}
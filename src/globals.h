@@ -28,10 +28,15 @@
 #ifndef GLOBALS_H_
 #define GLOBALS_H_
 
+#include <stddef.h>
+
 void 		glob_init(int argc, char* argv[]);
 
 const char *	glob_get_program_name(void);
 
+void		glob_set_threads(size_t n);
+size_t		glob_get_threads(void);
+
 
 #endif
 
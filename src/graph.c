@@ -0,0 +1,643 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// Transitive reachability over the references (--reach-from F, --path-to X).
+//
+// The references are turned into a graph in the compressed sparse row form: a
+// node per group of symbols sharing an address, plus one per referenced name
+// that is not defined in the file; the edges out of node u are
+// out_adj[out_idx[u]..out_idx[u+1]). Referenced names are resolved to the
+// symbols defining them in the same file. The transposed graph is kept as well,
+// for the bottom-up steps and for searching backwards.
+//
+// The breadth-first search keeps the frontier and the visited set as bitmaps.
+// While the frontier is small, a level is expanded top-down, from the frontier
+// nodes along their edges. Once the edges out of the frontier outnumber those
+// into the unvisited nodes, it goes bottom-up instead: the unvisited nodes,
+// found 64 at a time in the words of the visited bitmap, look for a parent
+// among their in-neighbours with a bit test each, stopping at the first one.
+
+#include "graph.h"
+#include "symtab.h"
+#include "errors.h"
+
+#include <assert.h>
+#include <elf.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NONE		UINT32_MAX
+#define ALPHA		14	// go bottom-up once the frontier has 1/ALPHA of the unvisited nodes' edges...
+#define BETA		24	// ...and back top-down once it has less than 1/BETA of the nodes
+
+/**
+ * Maps a symbol name to its node.
+ */
+typedef struct name_slot
+{
+	const char *	name;	// NULL in an empty slot
+	uint64_t	hash;
+	uint32_t	node;
+} name_slot;
+
+struct graph_s
+{
+	size_t		n;		// nodes
+	size_t		ngroups;	// nodes below this are defined in the file, the rest are not
+	const char **	names;
+	int *		types;		// STT_*
+	size_t *	addrs;		// of the defined nodes
+	size_t		capacity;	// of the above arrays
+
+	name_slot *	slots;
+	size_t		nslots;		// a power of 2
+	size_t		nnames;
+
+	name_slot *	ptrs;		// names to nodes by the address of the name string (see resolve())
+	size_t		nptrs;		// a power of 2
+	size_t		nsyms;		// symbols in the file, of which each pointer is a name
+
+	size_t		m;		// edges
+	uint32_t *	src;		// edges as found, until turned into CSR
+	uint32_t *	dst;
+	size_t		edges_capacity;
+
+	uint32_t *	out_idx;	// n + 1 elements
+	uint32_t *	out_adj;	// m elements
+	uint32_t *	in_idx;
+	uint32_t *	in_adj;
+};
+
+static uint64_t	hash_name(const char* s)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (; *s; ++s)
+	{
+		h = (h ^ (unsigned char)*s) * 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/**
+ * Returns the slot for the given name: either the one holding it or the empty one where it would go.
+ */
+static name_slot *	find_slot(graph_t* g, const char* name, uint64_t h)
+{
+	size_t k = h & (g->nslots - 1);
+	for (; g->slots[k].name; k = (k + 1) & (g->nslots - 1))
+	{
+		if (g->slots[k].hash == h && (g->slots[k].name == name || strcmp(g->slots[k].name, name) == 0))
+			break;
+	}
+	return &g->slots[k];
+}
+
+/**
+ * Returns the node of the given name, or NONE if there is no such.
+ */
+static uint32_t	lookup(graph_t* g, const char* name)
+{
+	const name_slot *slot = find_slot(g, name, hash_name(name));
+	return slot->name ? slot->node : NONE;
+}
+
+/**
+ * Maps the name to the node unless the name is already mapped.
+ */
+static void	add_name(graph_t* g, const char* name, uint32_t node)
+{
+	if (2*(g->nnames + 1) > g->nslots)
+	{
+		name_slot *old = g->slots;
+		const size_t old_nslots = g->nslots;
+
+		g->nslots = old_nslots ? 2*old_nslots : 1024;
+		g->slots = calloc(g->nslots, sizeof(name_slot));
+		if (!g->slots)
+		{
+			fatal_err("Not enough memory");
+		}
+		for (size_t i = 0; i < old_nslots; ++i)
+		{
+			if (old[i].name)
+				*find_slot(g, old[i].name, old[i].hash) = old[i];
+		}
+		free(old);
+	}
+
+	const uint64_t h = hash_name(name);
+	name_slot *slot = find_slot(g, name, h);
+	if (!slot->name)
+	{
+		*slot = (name_slot){ name, h, node };
+		g->nnames++;
+	}
+}
+
+/**
+ * Adds a node for a name not defined in the file.
+ */
+static uint32_t	add_external(graph_t* g, const char* name, bool is_func)
+{
+	if (g->n == g->capacity)
+	{
+		g->capacity *= 2;
+		g->names = realloc(g->names, g->capacity*sizeof(*g->names));
+		g->types = realloc(g->types, g->capacity*sizeof(*g->types));
+		if (!g->names || !g->types)
+		{
+			fatal_err("Not enough memory");
+		}
+	}
+	if (g->n >= NONE)
+	{
+		fatal("Too many symbols for a graph");
+	}
+
+	const uint32_t node = (uint32_t)g->n++;
+	g->names[node] = name;
+	g->types[node] = is_func ? STT_FUNC : STT_NOTYPE;
+	add_name(g, name, node);
+
+	return node;
+}
+
+/**
+ * Names the node of the group after its first function or object (or its first symbol if there are none
+ * of those) and maps the names of all those defined to it.
+ */
+static void	add_sym(void* ctx, size_t group, const char* name, int type, bool defined, size_t addr)
+{
+	graph_t *g = ctx;
+	const bool is_func_or_object = (type == STT_FUNC || type == STT_OBJECT);
+
+	g->nsyms++;
+
+	if (!g->names[group] || (is_func_or_object && g->types[group] != STT_FUNC && g->types[group] != STT_OBJECT))
+	{
+		g->names[group] = name;
+		g->types[group] = type;
+		g->addrs[group] = addr;
+	}
+
+	if (defined && name && *name && (is_func_or_object || type == STT_NOTYPE))
+	{
+		add_name(g, name, (uint32_t)group);
+	}
+}
+
+static uint64_t	hash_ptr(const char* p)
+{
+	return ((uint64_t)(uintptr_t)p * 0x9e3779b97f4a7c15ULL) >> 20;
+}
+
+/**
+ * Returns the node of the referenced name, adding one if the name is not defined in the file.
+ *
+ * References to the same symbol have the same name string, so the node is first looked up by the
+ * address of the string, which spares reading the string itself, and only then by the name.
+ */
+static uint32_t	resolve(graph_t* g, const char* ref_name, bool ref_is_func)
+{
+	size_t k = hash_ptr(ref_name) & (g->nptrs - 1);
+	for (; g->ptrs[k].name; k = (k + 1) & (g->nptrs - 1))
+	{
+		if (g->ptrs[k].name == ref_name)
+			return g->ptrs[k].node;
+	}
+
+	uint32_t node = lookup(g, ref_name);
+	if (node == NONE)
+	{
+		node = add_external(g, ref_name, ref_is_func);
+	}
+
+	// The table is sized for all the symbols of the file, any name in a reference is one of those
+	g->ptrs[k] = (name_slot){ ref_name, 0, node };
+	return node;
+}
+
+static void	add_ref(void* ctx, size_t group, const char* ref_name, bool ref_is_func)
+{
+	graph_t *g = ctx;
+
+	if (!ref_name || !*ref_name)
+		return;
+
+	const uint32_t to = resolve(g, ref_name, ref_is_func);
+	if (to == group)
+		return;
+
+	if (g->m == g->edges_capacity)
+	{
+		g->edges_capacity = g->edges_capacity ? 2*g->edges_capacity : 4096;
+		g->src = realloc(g->src, g->edges_capacity*sizeof(uint32_t));
+		g->dst = realloc(g->dst, g->edges_capacity*sizeof(uint32_t));
+		if (!g->src || !g->dst)
+		{
+			fatal_err("Not enough memory");
+		}
+	}
+	if (g->m >= NONE)
+	{
+		fatal("Too many references for a graph");
+	}
+
+	g->src[g->m] = (uint32_t)group;
+	g->dst[g->m] = to;
+	g->m++;
+}
+
+/**
+ * Lays out the edges from -> to in the compressed sparse row form by counting sort.
+ */
+static void	make_csr(size_t n, size_t m, const uint32_t* from, const uint32_t* to, uint32_t** idx, uint32_t** adj)
+{
+	*idx = calloc(n + 1, sizeof(uint32_t));
+	*adj = malloc((m ? m : 1)*sizeof(uint32_t));
+	if (!*idx || !*adj)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	for (size_t e = 0; e < m; ++e)
+	{
+		(*idx)[from[e] + 1]++;
+	}
+	for (size_t u = 0; u < n; ++u)
+	{
+		(*idx)[u + 1] += (*idx)[u];
+	}
+
+	// Fill using idx[u] as the insertion point, then shift it back
+	for (size_t e = 0; e < m; ++e)
+	{
+		(*adj)[(*idx)[from[e]]++] = to[e];
+	}
+	for (size_t u = n; u > 0; --u)
+	{
+		(*idx)[u] = (*idx)[u - 1];
+	}
+	(*idx)[0] = 0;
+}
+
+/**
+ * Builds the graph of references between the symbols of the given symbol table.
+ * The allocated resources must be released with graph_free().
+ */
+extern graph_t *	graph_build(symtab_t* st)
+{
+	assert(st);
+
+	graph_t *g = calloc(1, sizeof(graph_t));
+	if (!g)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	// Defined names first, so that references are resolved to them no matter where they are
+	g->ngroups = symtab_walk_groups(st, NULL, NULL, NULL);
+	g->n = g->ngroups;
+	g->capacity = g->ngroups ? 2*g->ngroups : 1;
+	g->names = calloc(g->capacity, sizeof(*g->names));
+	g->types = calloc(g->capacity, sizeof(*g->types));
+	g->addrs = calloc(g->ngroups ? g->ngroups : 1, sizeof(*g->addrs));
+	if (!g->names || !g->types || !g->addrs)
+	{
+		fatal_err("Not enough memory");
+	}
+	symtab_walk_groups(st, add_sym, NULL, g);
+
+	for (g->nptrs = 1024; g->nptrs < 2*g->nsyms; g->nptrs *= 2)
+		;
+	g->ptrs = calloc(g->nptrs, sizeof(name_slot));
+	if (!g->ptrs)
+	{
+		fatal_err("Not enough memory");
+	}
+	symtab_walk_groups(st, NULL, add_ref, g);
+	free(g->ptrs);
+	g->ptrs = NULL;
+
+	make_csr(g->n, g->m, g->src, g->dst, &g->out_idx, &g->out_adj);
+	make_csr(g->n, g->m, g->dst, g->src, &g->in_idx, &g->in_adj);
+	free(g->src);
+	free(g->dst);
+	g->src = g->dst = NULL;
+
+	report(VERB, "Reference graph has %zu nodes (%zu undefined) and %zu edges", g->n, g->n - g->ngroups, g->m);
+
+	return g;
+}
+
+/**
+ * Releases resources associated with the given graph.
+ */
+extern void	graph_free(graph_t* g)
+{
+	if (!g)
+		return;
+
+	free(g->in_adj);
+	free(g->in_idx);
+	free(g->out_adj);
+	free(g->out_idx);
+	free(g->slots);
+	free(g->addrs);
+	free(g->types);
+	free(g->names);
+	free(g);
+}
+
+/**
+ * The result of a breadth-first search.
+ */
+typedef struct bfs
+{
+	uint32_t *	parent;		// the node each one was reached from, NONE if not reached
+	uint32_t *	depth;
+	uint32_t *	order;		// the nodes in the order reached, level by level
+	size_t		nreached;
+} bfs;
+
+static void	bfs_free(bfs* b)
+{
+	free(b->order);
+	free(b->depth);
+	free(b->parent);
+}
+
+/**
+ * Searches the graph breadth-first from src along the edges, or against them if backwards, until
+ * stop_at (if not NONE) is reached.
+ */
+static void	bfs_run(const graph_t* g, uint32_t src, bool backwards, uint32_t stop_at, bfs* b)
+{
+	const uint32_t *fwd_idx = backwards ? g->in_idx : g->out_idx;
+	const uint32_t *fwd_adj = backwards ? g->in_adj : g->out_adj;
+	const uint32_t *rev_idx = backwards ? g->out_idx : g->in_idx;
+	const uint32_t *rev_adj = backwards ? g->out_adj : g->in_adj;
+
+	const size_t nwords = (g->n + 63)/64;
+	uint64_t *visited = calloc(nwords, sizeof(uint64_t));
+	uint64_t *frontier = calloc(nwords, sizeof(uint64_t));
+	b->parent = malloc(g->n*sizeof(uint32_t));
+	b->depth = malloc(g->n*sizeof(uint32_t));
+	b->order = malloc(g->n*sizeof(uint32_t));
+	if (!visited || !frontier || !b->parent || !b->depth || !b->order)
+	{
+		fatal_err("Not enough memory");
+	}
+	memset(b->parent, 0xff, g->n*sizeof(uint32_t)); // NONE
+
+	b->parent[src] = src;
+	b->depth[src] = 0;
+	b->order[0] = src;
+	b->nreached = 1;
+	visited[src/64] |= 1ULL << (src % 64);
+
+	size_t unvisited_edges = g->m - (fwd_idx[src + 1] - fwd_idx[src]);
+	bool bottom_up = false;
+
+	for (size_t level = 0; level < b->nreached && (stop_at == NONE || b->parent[stop_at] == NONE); )
+	{
+		const size_t level_end = b->nreached;
+
+		size_t frontier_edges = 0;
+		for (size_t i = level; i < level_end; ++i)
+		{
+			frontier_edges += fwd_idx[b->order[i] + 1] - fwd_idx[b->order[i]];
+		}
+
+		if (!bottom_up && frontier_edges > unvisited_edges/ALPHA)
+			bottom_up = true;
+		else if (bottom_up && level_end - level < g->n/BETA)
+			bottom_up = false;
+
+		if (bottom_up)
+		{
+			memset(frontier, 0, nwords*sizeof(uint64_t));
+			for (size_t i = level; i < level_end; ++i)
+			{
+				frontier[b->order[i]/64] |= 1ULL << (b->order[i] % 64);
+			}
+
+			for (size_t w = 0; w < nwords; ++w)
+			{
+				uint64_t todo = ~visited[w];
+				if (w == nwords - 1 && g->n % 64)
+					todo &= (1ULL << (g->n % 64)) - 1;
+
+				for (; todo; todo &= todo - 1)
+				{
+					const uint32_t v = (uint32_t)(w*64 + (size_t)__builtin_ctzll(todo));
+					for (uint32_t k = rev_idx[v]; k < rev_idx[v + 1]; ++k)
+					{
+						const uint32_t u = rev_adj[k];
+						if (frontier[u/64] & (1ULL << (u % 64)))
+						{
+							visited[w] |= 1ULL << (v % 64);
+							b->parent[v] = u;
+							b->depth[v] = b->depth[u] + 1;
+							b->order[b->nreached++] = v;
+							unvisited_edges -= fwd_idx[v + 1] - fwd_idx[v];
+							break;
+						}
+					}
+				}
+			}
+		}
+		else
+		{
+			for (size_t i = level; i < level_end; ++i)
+			{
+				const uint32_t u = b->order[i];
+				for (uint32_t k = fwd_idx[u]; k < fwd_idx[u + 1]; ++k)
+				{
+					const uint32_t v = fwd_adj[k];
+					if (!(visited[v/64] & (1ULL << (v % 64))))
+					{
+						visited[v/64] |= 1ULL << (v % 64);
+						b->parent[v] = u;
+						b->depth[v] = b->depth[u] + 1;
+						b->order[b->nreached++] = v;
+						unvisited_edges -= fwd_idx[v + 1] - fwd_idx[v];
+					}
+				}
+			}
+		}
+
+		level = level_end;
+	}
+
+	free(frontier);
+	free(visited);
+}
+
+/**
+ * Returns the node of the given symbol name, reporting an error if there is none.
+ */
+static uint32_t	find_node(graph_t* g, const char* name)
+{
+	const uint32_t node = lookup(g, name);
+	if (node == NONE || node >= g->ngroups)
+	{
+		error("No symbol %s defined", name);
+		return NONE;
+	}
+	return node;
+}
+
+static void	print_node(const graph_t* g, FILE* out, uint32_t node)
+{
+	fprintf(out, "%s%s", g->names[node], (g->types[node] == STT_FUNC) ? "()" : "");
+	if (node >= g->ngroups)
+	{
+		fprintf(out, " (undefined)");
+	}
+}
+
+/**
+ * Prints out the symbols reachable by references from the given one, nearest first, with the number of
+ * references on the way. Only those that pass the reference part of the filter (-r, -f) are shown.
+ * Returns false if there is no such symbol.
+ */
+extern bool	graph_print_reach(graph_t* g, FILE* out, const symtab_filter_t* filter, const char* from)
+{
+	assert(g);
+	assert(out);
+	assert(filter);
+
+	const uint32_t src = find_node(g, from);
+	if (src == NONE)
+		return false;
+
+	bfs b;
+	bfs_run(g, src, false, NONE, &b);
+
+	fprintf(out, "%s (addr 0x%08lx) reaches %zu symbols\n", g->names[src], g->addrs[src], b.nreached - 1);
+	for (size_t i = 1; i < b.nreached; ++i)
+	{
+		const uint32_t v = b.order[i];
+		if (!symtab_filter_match_ref(filter, g->names[v]) || (filter->funcs_only && g->types[v] != STT_FUNC))
+			continue;
+
+		fprintf(out, "\t%u  ", b.depth[v]);
+		print_node(g, out, v);
+		fprintf(out, "\n");
+	}
+
+	bfs_free(&b);
+	return true;
+}
+
+/**
+ * Prints out one of the shortest chains of references leading to the given symbol from the given one or,
+ * if from is NULL, from the nearest symbol not referenced by any other (such as an entry point or an
+ * exported function). Returns false if either symbol can't be found.
+ */
+extern bool	graph_print_path(graph_t* g, FILE* out, const char* from, const char* to)
+{
+	assert(g);
+	assert(out);
+	assert(to);
+
+	uint32_t dst = lookup(g, to);
+	if (dst == NONE)
+	{
+		error("No symbol %s referenced or defined", to);
+		return false;
+	}
+
+	bfs b;
+	uint32_t *path = NULL;
+	size_t len = 0;
+
+	if (from)
+	{
+		const uint32_t src = find_node(g, from);
+		if (src == NONE)
+			return false;
+
+		bfs_run(g, src, false, dst, &b);
+		if (b.parent[dst] != NONE)
+		{
+			len = b.depth[dst] + 1;
+			path = malloc(len*sizeof(uint32_t));
+			if (!path)
+			{
+				fatal_err("Not enough memory");
+			}
+			for (size_t i = len, v = dst; i > 0; v = b.parent[v])
+			{
+				path[--i] = (uint32_t)v;
+			}
+		}
+	}
+	else
+	{
+		bfs_run(g, dst, true, NONE, &b);
+		for (size_t i = 0; i < b.nreached; ++i)
+		{
+			const uint32_t v = b.order[i];
+			if (g->in_idx[v] == g->in_idx[v + 1]) // nothing references it
+			{
+				len = b.depth[v] + 1;
+				path = malloc(len*sizeof(uint32_t));
+				if (!path)
+				{
+					fatal_err("Not enough memory");
+				}
+				for (size_t k = 0, u = v; k < len; u = b.parent[u])
+				{
+					path[k++] = (uint32_t)u;
+				}
+				break;
+			}
+		}
+	}
+
+	if (!path)
+	{
+		report(NORM, "No chain of references leads to %s%s%s", to, from ? " from " : "", from ? from : "");
+	}
+	else
+	{
+		fprintf(out, "%s (addr 0x%08lx)\n", g->names[path[0]], g->addrs[path[0]]);
+		for (size_t i = 1; i < len; ++i)
+		{
+			fprintf(out, "\t-> ");
+			print_node(g, out, path[i]);
+			fprintf(out, "\n");
+		}
+	}
+
+	free(path);
+	bfs_free(&b);
+	return true;
+}
@@ -0,0 +1,1023 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// The incremental directory index (--index DIR --db FILE).
+//
+// The database keeps, for every file found under DIR, the file's identity (size,
+// mtime and contents hash) along with the references made from its symbols.
+// Only the files that are new or have changed since the last run are read, the
+// records of the rest are carried over without being looked at.
+//
+// The database is a log: the records of the files read are appended to it,
+// followed by the directory of all live records and the trailer pointing at the
+// directory. Superseded records become garbage, which is compacted away once it
+// outweighs the live records. The format is that of the host that created it.
+
+#include "index.h"
+#include "input.h"
+#include "symtab.h"
+#include "errors.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <assert.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DB_MAGIC		"ELFREFDB"
+#define DB_VERSION		1
+#define DB_MIN_COMPACT		(1 << 20)	// don't bother compacting less garbage than this
+#define WATCH_QUIET_MS		200		// wait for this long after the last change before updating
+
+/**
+ * Ends the database; points at the directory of the live records.
+ */
+typedef struct db_trailer
+{
+	uint64_t	dir_off;
+	uint64_t	dir_len;
+	uint64_t	garbage;	// bytes of the file not referenced from the directory
+	char		magic[8];
+} db_trailer;
+
+enum obj_kind
+{
+	OBJ_ELF,	// the record holds the references of the file
+	OBJ_NOT_ELF,	// not an ELF file; no record
+	OBJ_BAD		// an ELF file that couldn't be read; no record
+};
+
+/**
+ * Describes a file under the indexed directory.
+ */
+typedef struct obj
+{
+	char *		path;		// relative to the indexed directory
+	uint64_t	size;
+	int64_t		mtime_sec;
+	int64_t		mtime_nsec;
+	uint64_t	hash;		// of the contents
+	uint64_t	rec_off;	// the record with the file's references in the database
+	uint64_t	rec_len;
+	uint8_t		kind;		// see enum obj_kind
+	bool		fresh;		// the record is new: rec_off is into the buffer of new records
+} obj;
+
+/**
+ * Describes a growing array of files.
+ */
+typedef struct objs
+{
+	obj *		v;
+	size_t		n;
+	size_t		cap;
+} objs;
+
+/**
+ * Describes a growing memory buffer.
+ */
+typedef struct buf
+{
+	char *		p;
+	size_t		len;
+	size_t		cap;
+} buf;
+
+/**
+ * Describes the database and the directory it indexes.
+ */
+typedef struct index_s
+{
+	const char *	dir;		// the indexed directory
+	const char *	db_name;
+	dev_t		db_dev;		// to skip the database if it's under dir
+	ino_t		db_ino;
+
+	char *		map;		// the database mapped
+	size_t		map_size;
+	objs		objs;		// the live records, sorted by path
+	uint64_t	garbage;	// see db_trailer
+} index_s;
+
+static void	buf_put(buf* b, const void* p, size_t n)
+{
+	if (b->len + n > b->cap)
+	{
+		b->cap = (b->len + n)*2 + 256;
+		b->p = realloc(b->p, b->cap);
+		if (!b->p)
+		{
+			fatal_err("Not enough memory");
+		}
+	}
+	memcpy(b->p + b->len, p, n);
+	b->len += n;
+}
+
+static void	buf_put_str(buf* b, const char* s)
+{
+	const uint32_t len = s ? (uint32_t)strlen(s) : 0;
+	buf_put(b, &len, sizeof(len));
+	buf_put(b, s, len);
+}
+
+/**
+ * Reads n bytes of a record at *p into dst advancing *p; fails if that goes past end.
+ */
+static void	rec_get(const char** p, const char* end, void* dst, size_t n)
+{
+	if ((size_t)(end - *p) < n)
+	{
+		fatal("Index database is corrupted (record out of bounds)");
+	}
+	memcpy(dst, *p, n);
+	*p += n;
+}
+
+static const char *	rec_get_str(const char** p, const char* end, uint32_t* len)
+{
+	rec_get(p, end, len, sizeof(*len));
+	if ((size_t)(end - *p) < *len)
+	{
+		fatal("Index database is corrupted (string out of bounds)");
+	}
+	const char *s = *p;
+	*p += *len;
+	return s;
+}
+
+static obj *	objs_add(objs* a)
+{
+	if (a->n == a->cap)
+	{
+		a->cap = a->cap*2 + 64;
+		a->v = realloc(a->v, a->cap*sizeof(obj));
+		if (!a->v)
+		{
+			fatal_err("Not enough memory");
+		}
+	}
+	obj *o = &a->v[a->n++];
+	memset(o, 0, sizeof(*o));
+	return o;
+}
+
+static void	objs_free(objs* a)
+{
+	for (size_t i = 0; i < a->n; ++i)
+	{
+		free(a->v[i].path);
+	}
+	free(a->v);
+	memset(a, 0, sizeof(*a));
+}
+
+static int	obj_compare(const void* o1, const void* o2)
+{
+	return strcmp(((const obj *)o1)->path, ((const obj *)o2)->path);
+}
+
+///////////////////////////// The database file ///////////////////////////////
+
+static void	db_unmap(index_s* ix)
+{
+	if (ix->map)
+	{
+		munmap(ix->map, ix->map_size);
+		ix->map = NULL;
+		ix->map_size = 0;
+	}
+}
+
+/**
+ * Maps the database and reads in its directory. A missing database is an empty one.
+ */
+static void	db_load(index_s* ix)
+{
+	db_unmap(ix);
+	objs_free(&ix->objs);
+	ix->garbage = 0;
+
+	int fd = open(ix->db_name, O_RDONLY);
+	if (fd == -1)
+	{
+		report(VERB, "Index database %s not found, creating one", ix->db_name);
+		return;
+	}
+
+	struct stat sb;
+	if (fstat(fd, &sb) == -1)
+	{
+		fatal_err("Cannot stat index database");
+	}
+	ix->db_dev = sb.st_dev;
+	ix->db_ino = sb.st_ino;
+
+	const size_t hdr_len = sizeof(DB_MAGIC) - 1 + sizeof(uint32_t);
+	if ((size_t)sb.st_size < hdr_len + sizeof(db_trailer))
+	{
+		fatal("%s is not an index database", ix->db_name);
+	}
+
+	ix->map_size = (size_t)sb.st_size;
+	ix->map = mmap(NULL, ix->map_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ix->map == MAP_FAILED)
+	{
+		ix->map = NULL;
+		fatal_err("Cannot read in index database");
+	}
+
+	uint32_t version;
+	memcpy(&version, ix->map + sizeof(DB_MAGIC) - 1, sizeof(version));
+	if (memcmp(ix->map, DB_MAGIC, sizeof(DB_MAGIC) - 1) != 0 || version != DB_VERSION)
+	{
+		fatal("%s is not an index database (or of another version)", ix->db_name);
+	}
+
+	db_trailer tr;
+	memcpy(&tr, ix->map + ix->map_size - sizeof(tr), sizeof(tr));
+	if (memcmp(tr.magic, DB_MAGIC, sizeof(tr.magic)) != 0
+	    || tr.dir_off > ix->map_size || tr.dir_len > ix->map_size - tr.dir_off)
+	{
+		fatal("Index database %s is corrupted (interrupted update?); remove it to re-index", ix->db_name);
+	}
+	ix->garbage = tr.garbage;
+
+	const char *p = ix->map + tr.dir_off;
+	const char *end = p + tr.dir_len;
+	uint64_t n;
+	rec_get(&p, end, &n, sizeof(n));
+	for (uint64_t i = 0; i < n; ++i)
+	{
+		obj *o = objs_add(&ix->objs);
+		uint32_t path_len;
+		const char *path = rec_get_str(&p, end, &path_len);
+		o->path = strndup(path, path_len);
+		rec_get(&p, end, &o->size, sizeof(o->size));
+		rec_get(&p, end, &o->mtime_sec, sizeof(o->mtime_sec));
+		rec_get(&p, end, &o->mtime_nsec, sizeof(o->mtime_nsec));
+		rec_get(&p, end, &o->hash, sizeof(o->hash));
+		rec_get(&p, end, &o->rec_off, sizeof(o->rec_off));
+		rec_get(&p, end, &o->rec_len, sizeof(o->rec_len));
+		rec_get(&p, end, &o->kind, sizeof(o->kind));
+		if (!o->path || o->rec_off > tr.dir_off || o->rec_len > tr.dir_off - o->rec_off)
+		{
+			fatal("Index database %s is corrupted (bad directory)", ix->db_name);
+		}
+	}
+
+	report(VERB, "Index database %s holds %zu files", ix->db_name, ix->objs.n);
+}
+
+static void	write_all(int fd, const char* p, size_t len)
+{
+	while (len > 0)
+	{
+		const ssize_t n = write(fd, p, len);
+		if (n <= 0)
+		{
+			fatal_err("Cannot write index database");
+		}
+		p += n;
+		len -= (size_t)n;
+	}
+}
+
+static void	put_dir(buf* b, const objs* a)
+{
+	const uint64_t n = a->n;
+	buf_put(b, &n, sizeof(n));
+	for (size_t i = 0; i < a->n; ++i)
+	{
+		const obj *o = &a->v[i];
+		buf_put_str(b, o->path);
+		buf_put(b, &o->size, sizeof(o->size));
+		buf_put(b, &o->mtime_sec, sizeof(o->mtime_sec));
+		buf_put(b, &o->mtime_nsec, sizeof(o->mtime_nsec));
+		buf_put(b, &o->hash, sizeof(o->hash));
+		buf_put(b, &o->rec_off, sizeof(o->rec_off));
+		buf_put(b, &o->rec_len, sizeof(o->rec_len));
+		buf_put(b, &o->kind, sizeof(o->kind));
+	}
+}
+
+/**
+ * Writes the records of the given objects, new ones taken from recs, to the file at offset off.
+ * Returns the offset past the last record written.
+ */
+static uint64_t	write_recs(index_s* ix, int fd, objs* cur, const buf* recs, uint64_t off, bool all)
+{
+	if (!all)
+	{
+		// only the new records go, they are in recs already in the right order
+		for (size_t i = 0; i < cur->n; ++i)
+		{
+			if (cur->v[i].fresh)
+			{
+				cur->v[i].rec_off += off;
+				cur->v[i].fresh = false;
+			}
+		}
+		write_all(fd, recs->p, recs->len);
+		return off + recs->len;
+	}
+
+	for (size_t i = 0; i < cur->n; ++i)
+	{
+		obj *o = &cur->v[i];
+		if (o->kind != OBJ_ELF)
+			continue;
+
+		const char *rec = o->fresh ? recs->p + o->rec_off : ix->map + o->rec_off;
+		write_all(fd, rec, o->rec_len);
+		o->rec_off = off;
+		o->fresh = false;
+		off += o->rec_len;
+	}
+
+	return off;
+}
+
+/**
+ * Writes out the directory describing cur and the trailer.
+ */
+static void	write_dir(int fd, const objs* cur, uint64_t off, uint64_t garbage)
+{
+	buf dir = {0};
+	put_dir(&dir, cur);
+
+	db_trailer tr = { .dir_off = off, .dir_len = dir.len, .garbage = garbage };
+	memcpy(tr.magic, DB_MAGIC, sizeof(tr.magic));
+	buf_put(&dir, &tr, sizeof(tr));
+
+	write_all(fd, dir.p, dir.len);
+	free(dir.p);
+}
+
+static uint64_t	write_header(int fd)
+{
+	const uint32_t version = DB_VERSION;
+	write_all(fd, DB_MAGIC, sizeof(DB_MAGIC) - 1);
+	write_all(fd, (const char *)&version, sizeof(version));
+	return sizeof(DB_MAGIC) - 1 + sizeof(version);
+}
+
+/**
+ * Stores the records of cur in the database. The new records (marked as fresh) are in recs;
+ * garbage is the size of the records in the database no longer needed.
+ */
+static void	db_store(index_s* ix, objs* cur, const buf* recs, uint64_t garbage)
+{
+	uint64_t live = 0;
+	for (size_t i = 0; i < cur->n; ++i)
+	{
+		live += cur->v[i].rec_len;
+	}
+
+	if (ix->map)
+	{
+		// the old directory and trailer are not needed either
+		db_trailer old;
+		memcpy(&old, ix->map + ix->map_size - sizeof(old), sizeof(old));
+		garbage += old.dir_len + sizeof(old);
+	}
+
+	if (!ix->map || (garbage > live && garbage > DB_MIN_COMPACT))
+	{
+		// Write out a compact copy of the database and replace the old one with it
+		char tmp_name[PATH_MAX];
+		snprintf(tmp_name, sizeof(tmp_name), "%s.tmp", ix->db_name);
+		int fd = open(tmp_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+		if (fd == -1)
+		{
+			fatal_err("Cannot create index database");
+		}
+
+		uint64_t off = write_header(fd);
+		off = write_recs(ix, fd, cur, recs, off, true);
+		write_dir(fd, cur, off, 0);
+
+		if (fsync(fd) == -1 || close(fd) == -1 || rename(tmp_name, ix->db_name) == -1)
+		{
+			fatal_err("Cannot write index database");
+		}
+		if (ix->map)
+		{
+			report(VERB, "Compacted index database, %luK of garbage removed", garbage/1024);
+		}
+	}
+	else
+	{
+		// Append the new records, the new directory and trailer. Until the trailer is
+		// written, the old one remains at the end of the (longer) file.
+		int fd = open(ix->db_name, O_WRONLY);
+		if (fd == -1)
+		{
+			fatal_err("Cannot open index database");
+		}
+
+		const off_t end = lseek(fd, 0, SEEK_END);
+		if (end == -1)
+		{
+			fatal_err("Cannot write index database");
+		}
+
+		uint64_t off = write_recs(ix, fd, cur, recs, (uint64_t)end, false);
+		write_dir(fd, cur, off, garbage);
+
+		if (fsync(fd) == -1 || close(fd) == -1)
+		{
+			fatal_err("Cannot write index database");
+		}
+	}
+}
+
+///////////////////////// The files being indexed /////////////////////////////
+
+static char *	full_path(const index_s* ix, const char* rel, char* path)
+{
+	if (snprintf(path, PATH_MAX, "%s/%s", ix->dir, rel) >= PATH_MAX)
+	{
+		fatal("Path name too long (%s/%s)", ix->dir, rel);
+	}
+	return path;
+}
+
+/**
+ * Computes the hash (FNV-1a) of the file's contents; also finds out if that's an ELF file.
+ * Returns false if the file can't be read.
+ */
+static bool	hash_file(const char* path, uint64_t* hash, bool* is_elf)
+{
+	*hash = 0xcbf29ce484222325ULL;
+	*is_elf = false;
+
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat sb;
+	if (fstat(fd, &sb) == -1)
+	{
+		close(fd);
+		return false;
+	}
+
+	if (sb.st_size > 0)
+	{
+		const size_t size = (size_t)sb.st_size;
+		const unsigned char *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED)
+		{
+			close(fd);
+			return false;
+		}
+		madvise((void *)p, size, MADV_SEQUENTIAL);
+
+		*is_elf = size >= SELFMAG && memcmp(p, ELFMAG, SELFMAG) == 0;
+
+		uint64_t h = *hash;
+		for (size_t i = 0; i < size; ++i)
+		{
+			h = (h ^ p[i]) * 0x100000001b3ULL;
+		}
+		*hash = h;
+
+		munmap((void *)p, size);
+	}
+
+	close(fd);
+	return true;
+}
+
+// The scan in progress: nftw() callbacks take no context, so scan() is not reentrant (nor thread-safe)
+static index_s *	scan_ix;
+static objs *		scan_objs;
+
+static int	scan_one(const char* path, const struct stat* sb, int type, struct FTW* ftw __attribute__((unused)))
+{
+	if (type != FTW_F || !S_ISREG(sb->st_mode))
+		return 0;
+
+	if (sb->st_dev == scan_ix->db_dev && sb->st_ino == scan_ix->db_ino)
+		return 0; // that's us
+
+	const size_t dir_len = strlen(scan_ix->dir);
+	const char *rel = path + dir_len;
+	while (*rel == '/')
+		rel++;
+
+	obj *o = objs_add(scan_objs);
+	o->path = strdup(rel);
+	if (!o->path)
+	{
+		fatal_err("Not enough memory");
+	}
+	o->size = (uint64_t)sb->st_size;
+	o->mtime_sec = sb->st_mtim.tv_sec;
+	o->mtime_nsec = sb->st_mtim.tv_nsec;
+
+	return 0;
+}
+
+/**
+ * Adds the files found under the given path (a file or a directory) to a. Not reentrant.
+ */
+static void	scan(index_s* ix, const char* path, objs* a)
+{
+	assert(!scan_ix);
+
+	scan_ix = ix;
+	scan_objs = a;
+	if (nftw(path, scan_one, 64, FTW_PHYS) == -1 && errno != ENOENT)
+	{
+		error("Cannot scan %s (%s)", path, strerror(errno));
+	}
+	scan_ix = NULL;
+	scan_objs = NULL;
+}
+
+struct rec_ctx
+{
+	buf *		b;
+	size_t		nrefs_pos;	// where the number of references of the current symbol is
+	uint32_t	nrefs;
+	uint32_t	nsyms;
+};
+
+static void	rec_end_sym(struct rec_ctx* ctx)
+{
+	if (ctx->nsyms > 0)
+	{
+		memcpy(ctx->b->p + ctx->nrefs_pos, &ctx->nrefs, sizeof(ctx->nrefs));
+	}
+}
+
+static void	rec_add_ref(void* vctx, const symtab_ref_t* ref)
+{
+	struct rec_ctx *ctx = vctx;
+	buf *b = ctx->b;
+
+	if (ref->first)
+	{
+		rec_end_sym(ctx);
+
+		const uint8_t type = (uint8_t)ref->sym_type;
+		const uint64_t addr = ref->sym_addr;
+		buf_put(b, &type, sizeof(type));
+		buf_put(b, &addr, sizeof(addr));
+		buf_put_str(b, ref->sym_name);
+
+		ctx->nrefs_pos = b->len;
+		ctx->nrefs = 0;
+		buf_put(b, &ctx->nrefs, sizeof(ctx->nrefs));
+		ctx->nsyms++;
+	}
+
+	const uint64_t offset = ref->offset;
+	const uint8_t flags = (uint8_t)((ref->ref_name ? 1 : 0) | (ref->ref_is_func ? 2 : 0));
+	buf_put(b, &offset, sizeof(offset));
+	buf_put(b, &ref->addend, sizeof(ref->addend));
+	buf_put(b, &flags, sizeof(flags));
+	buf_put_str(b, ref->ref_name);
+	ctx->nrefs++;
+}
+
+/**
+ * Reads in the object and appends the record with its references to recs.
+ */
+static void	analyze(index_s* ix, obj* o, buf* recs)
+{
+	char path[PATH_MAX];
+	char err[256];
+
+	input_t *in = input_init();
+	symtab_t *st = input_read_refs(in, full_path(ix, o->path, path), err, sizeof(err));
+	if (!st)
+	{
+		error("%s: %s", o->path, err);
+		o->kind = OBJ_BAD;
+		input_free(in);
+		return;
+	}
+
+	const size_t start = recs->len;
+	const uint32_t nsyms_placeholder = 0;
+	buf_put(recs, &nsyms_placeholder, sizeof(nsyms_placeholder));
+
+	struct rec_ctx ctx = { .b = recs };
+	const symtab_filter_t all = {0};
+	symtab_walk(st, &all, rec_add_ref, &ctx);
+	rec_end_sym(&ctx);
+	memcpy(recs->p + start, &ctx.nsyms, sizeof(ctx.nsyms));
+
+	o->kind = OBJ_ELF;
+	o->fresh = true;
+	o->rec_off = start;
+	o->rec_len = recs->len - start;
+
+	symtab_free(st);
+	input_close(in);
+	input_free(in);
+}
+
+/**
+ * Brings the database up to date with the files in cur (sorted by path). Reads only the files that
+ * are not in the database or have changed since.
+ */
+static void	update(index_s* ix, objs* cur)
+{
+	buf recs = {0};
+	uint64_t garbage = ix->garbage;
+	size_t nread = 0, nremoved = 0, nchanged = 0;
+
+	const objs *old = &ix->objs;
+	size_t j = 0;
+	for (size_t i = 0; i < cur->n; ++i)
+	{
+		obj *o = &cur->v[i];
+
+		int cmp = 1;
+		for (; j < old->n && (cmp = strcmp(old->v[j].path, o->path)) < 0; ++j)
+		{
+			garbage += old->v[j].rec_len; // removed
+			nremoved++;
+		}
+
+		const obj *was = (j < old->n && cmp == 0) ? &old->v[j++] : NULL;
+		if (was && was->size == o->size && was->mtime_sec == o->mtime_sec && was->mtime_nsec == o->mtime_nsec)
+		{
+			o->hash = was->hash;
+			o->kind = was->kind;
+			o->rec_off = was->rec_off;
+			o->rec_len = was->rec_len;
+			continue;
+		}
+
+		nchanged++;
+
+		char path[PATH_MAX];
+		bool is_elf;
+		if (!hash_file(full_path(ix, o->path, path), &o->hash, &is_elf))
+		{
+			o->kind = OBJ_BAD;
+		}
+		else if (was && was->hash == o->hash && was->size == o->size)
+		{
+			// touched, but the contents are the same
+			o->kind = was->kind;
+			o->rec_off = was->rec_off;
+			o->rec_len = was->rec_len;
+			continue;
+		}
+		else if (!is_elf)
+		{
+			o->kind = OBJ_NOT_ELF;
+		}
+		else
+		{
+			report(VERB, "Reading %s", o->path);
+			analyze(ix, o, &recs);
+			nread++;
+		}
+
+		if (was)
+		{
+			garbage += was->rec_len;
+		}
+	}
+	for (; j < old->n; ++j)
+	{
+		garbage += old->v[j].rec_len;
+		nremoved++;
+	}
+
+	report(NORM, "Index of %s: %zu files, %zu read, %zu removed", ix->dir, cur->n, nread, nremoved);
+
+	if (nchanged > 0 || nremoved > 0 || !ix->map)
+	{
+		db_store(ix, cur, &recs, garbage);
+	}
+	free(recs.p);
+
+	db_load(ix);
+}
+
+/**
+ * Prints out the references of all the objects in the index that pass the filter.
+ */
+static void	print(index_s* ix, const symtab_filter_t* filter)
+{
+	bool empty_output = true;
+
+	for (size_t i = 0; i < ix->objs.n; ++i)
+	{
+		const obj *o = &ix->objs.v[i];
+		if (o->kind != OBJ_ELF)
+			continue;
+
+		const char *p = ix->map + o->rec_off;
+		const char *end = p + o->rec_len;
+		bool obj_printed = false;
+
+		uint32_t nsyms;
+		rec_get(&p, end, &nsyms, sizeof(nsyms));
+		for (uint32_t k = 0; k < nsyms; ++k)
+		{
+			symtab_ref_t ref = {0};
+			uint8_t type;
+			uint64_t addr;
+			uint32_t len, nrefs;
+			rec_get(&p, end, &type, sizeof(type));
+			rec_get(&p, end, &addr, sizeof(addr));
+			const char *name = rec_get_str(&p, end, &len);
+			char *sym_name = strndupa(name, len);
+			rec_get(&p, end, &nrefs, sizeof(nrefs));
+
+			ref.sym_name = sym_name;
+			ref.sym_type = type;
+			ref.sym_addr = addr;
+
+			bool sym_printed = false;
+			for (uint32_t r = 0; r < nrefs; ++r)
+			{
+				uint64_t offset;
+				uint8_t flags;
+				rec_get(&p, end, &offset, sizeof(offset));
+				rec_get(&p, end, &ref.addend, sizeof(ref.addend));
+				rec_get(&p, end, &flags, sizeof(flags));
+				const char *ref_name = rec_get_str(&p, end, &len);
+
+				char ref_name_buf[len + 1];
+				memcpy(ref_name_buf, ref_name, len);
+				ref_name_buf[len] = 0;
+
+				ref.offset = offset;
+				ref.ref_name = (flags & 1) ? ref_name_buf : NULL;
+				ref.ref_is_func = (flags & 2) != 0;
+
+				if (symtab_filter_match(filter, &ref))
+				{
+					if (!obj_printed)
+					{
+						fprintf(stdout, "%s:\n", o->path);
+						obj_printed = true;
+					}
+					symtab_print_ref(stdout, filter, &ref, !sym_printed);
+					sym_printed = true;
+					empty_output = false;
+				}
+			}
+		}
+	}
+
+	if (empty_output)
+	{
+		symtab_report_empty(filter);
+	}
+}
+
+//////////////////////////////// Watch mode ///////////////////////////////////
+
+// The watch mode state, for the nftw() callback that adds the watches: one index_run() at a time
+static int	watch_fd = -1;
+static char **	watch_dirs;	// directory (relative to the indexed one) by watch descriptor
+static size_t	watch_ndirs;
+
+static int	watch_dir(const char* path, const struct stat* sb __attribute__((unused)), int type, struct FTW* ftw __attribute__((unused)))
+{
+	if (type != FTW_D)
+		return 0;
+
+	const int wd = inotify_add_watch(watch_fd, path,
+					 IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_ATTRIB);
+	if (wd == -1)
+	{
+		error("Cannot watch %s (%s)", path, strerror(errno));
+		return 0;
+	}
+
+	if ((size_t)wd >= watch_ndirs)
+	{
+		const size_t n = (size_t)wd*2 + 16;
+		watch_dirs = realloc(watch_dirs, n*sizeof(char *));
+		if (!watch_dirs)
+		{
+			fatal_err("Not enough memory");
+		}
+		memset(watch_dirs + watch_ndirs, 0, (n - watch_ndirs)*sizeof(char *));
+		watch_ndirs = n;
+	}
+
+	free(watch_dirs[wd]);
+	watch_dirs[wd] = strdup(path);
+	if (!watch_dirs[wd])
+	{
+		fatal_err("Not enough memory");
+	}
+	return 0;
+}
+
+/**
+ * Adds to cur the paths (relative to the indexed directory) reported changed by inotify
+ * and waits for them to settle. Returns false if interrupted.
+ */
+static bool	watch_wait(objs* changed)
+{
+	char events[64*1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	int timeout = -1;
+	for (;;)
+	{
+		struct pollfd pfd = { .fd = watch_fd, .events = POLLIN };
+		const int rc = poll(&pfd, 1, timeout);
+		if (rc == -1)
+		{
+			if (errno == EINTR)
+				return false;
+			fatal_err("Cannot wait for inotify events");
+		}
+		if (rc == 0)
+		{
+			return true; // quiet for long enough
+		}
+
+		const ssize_t len = read(watch_fd, events, sizeof(events));
+		if (len <= 0)
+		{
+			fatal_err("Cannot read inotify events");
+		}
+
+		for (char *p = events; p < events + len; )
+		{
+			const struct inotify_event *ev = (const struct inotify_event *)p;
+			p += sizeof(struct inotify_event) + ev->len;
+
+			if (ev->wd < 0 || (size_t)ev->wd >= watch_ndirs || !watch_dirs[ev->wd] || ev->len == 0)
+				continue;
+
+			char path[PATH_MAX];
+			snprintf(path, sizeof(path), "%s/%s", watch_dirs[ev->wd], ev->name);
+
+			if ((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO)))
+			{
+				nftw(path, watch_dir, 64, FTW_PHYS);
+			}
+
+			obj *o = objs_add(changed);
+			o->path = strdup(path);
+			if (!o->path)
+			{
+				fatal_err("Not enough memory");
+			}
+		}
+
+		timeout = WATCH_QUIET_MS;
+	}
+}
+
+/**
+ * Returns the files the index will consist of after the changes given: those in the index with
+ * the changed paths (files or whole directories) re-examined.
+ */
+static void	apply_changes(index_s* ix, objs* changed, objs* cur)
+{
+	const size_t dir_len = strlen(ix->dir);
+
+	for (size_t i = 0; i < ix->objs.n; ++i)
+	{
+		const obj *o = &ix->objs.v[i];
+
+		bool affected = false;
+		for (size_t k = 0; k < changed->n && !affected; ++k)
+		{
+			const char *rel = changed->v[k].path + dir_len;
+			while (*rel == '/')
+				rel++;
+			const size_t len = strlen(rel);
+			affected = strncmp(o->path, rel, len) == 0 && (o->path[len] == 0 || o->path[len] == '/');
+		}
+
+		if (!affected)
+		{
+			obj *c = objs_add(cur);
+			*c = *o;
+			c->path = strdup(o->path);
+			if (!c->path)
+			{
+				fatal_err("Not enough memory");
+			}
+		}
+	}
+
+	for (size_t k = 0; k < changed->n; ++k)
+	{
+		scan(ix, changed->v[k].path, cur);
+	}
+
+	qsort(cur->v, cur->n, sizeof(obj), obj_compare);
+
+	// The same file may have been reported more than once
+	size_t n = 0;
+	for (size_t i = 0; i < cur->n; ++i)
+	{
+		if (n > 0 && strcmp(cur->v[n - 1].path, cur->v[i].path) == 0)
+		{
+			free(cur->v[n - 1].path);
+			n--;
+		}
+		cur->v[n++] = cur->v[i];
+	}
+	cur->n = n;
+}
+
+/**
+ * Updates the index of the files under dir kept in the database db_name and prints out the references
+ * that pass the filter. In the watch mode, keeps the index up to date as the files change instead.
+ */
+extern void	index_run(const char* dir, const char* db_name, const symtab_filter_t* filter, bool watch)
+{
+	assert(dir && db_name && filter);
+
+	index_s ix = { .dir = dir, .db_name = db_name, .db_dev = (dev_t)-1, .db_ino = (ino_t)-1 };
+
+	db_load(&ix);
+
+	objs cur = {0};
+	scan(&ix, dir, &cur);
+	qsort(cur.v, cur.n, sizeof(obj), obj_compare);
+	update(&ix, &cur);
+	objs_free(&cur);
+
+	if (!watch)
+	{
+		print(&ix, filter);
+	}
+	else
+	{
+		watch_fd = inotify_init1(IN_CLOEXEC);
+		if (watch_fd == -1)
+		{
+			fatal_err("Cannot initialize inotify");
+		}
+		nftw(dir, watch_dir, 64, FTW_PHYS);
+
+		report(NORM, "Watching %s for changes", dir);
+
+		objs changed = {0};
+		while (watch_wait(&changed))
+		{
+			apply_changes(&ix, &changed, &cur);
+			update(&ix, &cur);
+			objs_free(&cur);
+			objs_free(&changed);
+		}
+
+		close(watch_fd);
+		for (size_t i = 0; i < watch_ndirs; ++i)
+		{
+			free(watch_dirs[i]);
+		}
+		free(watch_dirs);
+	}
+
+	db_unmap(&ix);
+	objs_free(&ix.objs);
+}
@@ -30,6 +30,9 @@
 #include "errors.h"
 #include "globals.h"
 #include "args.h"
+#include "symtab.h"
+#include "decompress.h"
+#include "archive.h"
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -38,21 +41,38 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <setjmp.h>
 
 /**
  * Describes the input ELF file, its properties and auxiliary data obtained by parsing its ELF structure.
  */
 struct	input_s
 {
+	const char *		fname;		// name of the input ELF file
 	int 			fd;		// file descriptor of that file
 	unsigned long long 	fsize;
 
-	char * 			map;		// mmap'ed input ELF file
+	char * 			map;		// mmap'ed input ELF file or, if it is compressed, its decompressed image
+	size_t			map_size;
+	char *			packed;		// mmap'ed compressed input file while it is decompressed
+	bool			is_image;	// map is anonymous memory rather than the file's pages
 
 	bool			same_endian;	// input ELF has same endianness as us?
 	bool			is_64;		// input ELF is 64-bit?
+	uint16_t		machine;	// e_machine of the input ELF
 };
 
+/**
+ * Returns the name of the input file.
+ */
+extern const char *		input_get_file_name(input_t* in)
+{
+	assert(in);
+	return in->fname;
+}
+
 /**
  * Returns the size of the input file in bytes.
  */
@@ -72,6 +92,54 @@ extern char *			input_get_mem_map(input_t* in)
 	return in->map;
 }
 
+/**
+ * Returns true if the input file is an archive rather than an ELF file (see input_open_member()).
+ */
+extern bool			input_get_is_archive(input_t* in)
+{
+	assert(in);
+	assert(in->map);
+	return archive_detect(in->map, in->fsize);
+}
+
+/**
+ * Passes the advice about the given range of the input file to madvise(2). MADV_DONTNEED only applies
+ * to the pages that lie entirely within the range, so that data around it, possibly converted
+ * to our endianness in place, is kept. Other advice applies to all the pages the range touches.
+ */
+extern void			input_advise(input_t* in, size_t off, size_t size, int advice)
+{
+	assert(in);
+	assert(in->map);
+
+	static size_t page_size;
+	if (!page_size)
+	{
+		page_size = (size_t)sysconf(_SC_PAGESIZE);
+	}
+
+	// The decompressed image would be lost rather than read again
+	if (in->is_image)
+		return;
+
+	size_t start = off;
+	size_t end = (off + size < in->fsize) ? off + size : in->fsize;
+	if (advice == MADV_DONTNEED)
+	{
+		start = (start + page_size - 1) & ~(page_size - 1);
+		end &= ~(page_size - 1);
+	}
+	else
+	{
+		start &= ~(page_size - 1);
+	}
+
+	if (start < end)
+	{
+		madvise(in->map + start, end - start, advice);
+	}
+}
+
 /**
  * Returns true if we are the same endianness as the input ELF file.
  */
@@ -82,29 +150,55 @@ extern bool			input_get_is_same_endian(input_t* in)
 }
 
 /**
- * Returns initialized input.
+ * Returns the machine (e_machine) the input ELF file is for.
+ */
+extern uint16_t			input_get_machine(input_t* in)
+{
+	assert(in);
+	return in->machine;
+}
+
+/**
+ * Returns initialized input. The returned object must be released with input_free().
  */
 extern input_t*	input_init(void)
 {
-	static struct input_s in = {0};
+	struct input_s *in = calloc(1, sizeof(struct input_s));
+	if (!in)
+	{
+		fatal_err("Not enough memory");
+	}
 
 	// Do only non-default init here
-	in.fd = -1;
+	in->fd = -1;
 
-	return &in;
+	return in;
 }
 
 /**
- * Opens the input for reading. Issues appropriate errors if they occur during opening and does not return in that case.
+ * Releases the input allocated with input_init(). The input must not be open.
  */
-extern void	input_open(input_t* in)
+extern void	input_free(input_t* in)
 {
 	assert(in);
+	assert(!in->map);
 
-	in->fd = open(args_get_input_file_name(), O_RDONLY);
+	free(in);
+}
+
+/**
+ * Opens the given file for reading. Issues appropriate errors if they occur during opening and does not return in that case.
+ */
+extern void	input_open(input_t* in, const char* fname)
+{
+	assert(in);
+	assert(fname);
+
+	in->fname = fname;
+	in->fd = open(fname, O_RDONLY);
 	if (in->fd == -1)
 	{
-		fatal("Cannot open input file (%s)", args_get_input_file_name());
+		fatal("Cannot open input file (%s)", fname);
 	}
 
 	struct stat sb;
@@ -131,8 +225,55 @@ extern void	input_open(input_t* in)
 	in->map = mmap(NULL, in->fsize, PROT_READ | PROT_WRITE, MAP_PRIVATE, in->fd, 0);
 	if (in->map == MAP_FAILED)
 	{
+		in->map = NULL;
 		fatal_err("Cannot read in input file");
 	}
+	in->map_size = in->fsize;
+
+	// A compressed file is replaced with its image decompressed into memory
+	const decompress_format_t fmt = decompress_detect(in->map, in->fsize);
+	if (fmt != DECOMPRESS_NONE)
+	{
+		in->packed = in->map;
+		in->map = NULL;
+		in->map_size = 0;
+		in->is_image = true;
+
+		const size_t size = decompress_image(in->packed, in->fsize, fmt, &in->map, &in->map_size);
+		report(VERB, "Decompressed %llu bytes of %s input into %zu", in->fsize, decompress_format_name(fmt), size);
+
+		munmap(in->packed, in->fsize);
+		in->packed = NULL;
+		in->fsize = size;
+	}
+}
+
+/**
+ * Opens the given member of an archive for reading. The member is copied into memory of its own, as in the
+ * archive it is not aligned as the readers expect; only the members asked about are ever copied.
+ */
+extern void	input_open_member(input_t* in, const archive_member_t* member)
+{
+	assert(in);
+	assert(member);
+
+	in->fname = member->name;
+	if (member->size == 0)
+	{
+		fatal("Input file is empty");
+	}
+
+	in->map = mmap(NULL, member->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (in->map == MAP_FAILED)
+	{
+		in->map = NULL;
+		fatal_err("Not enough memory");
+	}
+	in->map_size = member->size;
+	in->fsize = member->size;
+	in->is_image = true;
+
+	memcpy(in->map, member->data, member->size);
 }
 
 /**
@@ -141,9 +282,12 @@ extern void	input_open(input_t* in)
 extern void	input_close(input_t* in)
 {
 	assert(in);
-	assert(in->map);
 
-	if (munmap(in->map, in->fsize) == -1)
+	if (in->packed)
+	{
+		munmap(in->packed, in->fsize);
+	}
+	if (in->map && munmap(in->map, in->map_size) == -1)
 	{
 		fatal_err("Cannot unmap input file");
 	}
@@ -156,30 +300,39 @@ extern void	input_close(input_t* in)
 		}
 	}
 
-	in->fd = 0;
+	in->fd = -1;
 	in->map = NULL;
+	in->map_size = 0;
+	in->packed = NULL;
+	in->is_image = false;
 }
 
+#define READER_FUNCS(nn)	{ .find_sections = find_sections_##nn, .read_symtab = read_in_symtab_##nn,		\
+				  .process_relocations = process_relocations_##nn,				\
+				  .summarize_relocations = summarize_relocations_##nn,				\
+				  .spill_relocations = spill_relocations_##nn,					\
+				  .process_symbol_relocations = process_symbol_relocations_##nn,		\
+				  .stream_relocations = stream_relocations_##nn,				\
+				  .find_section = find_section_##nn, .read_section_relocs = read_section_relocs_##nn }
+
+/**
+ * Reader functions by bitness and byte order: each set is specialized for one of them at compile time (see
+ * depinput.inc), so the input's properties are only looked at here, once per file.
+ */
+static const struct reader_funcs	readers[2][2] =
+{
+	// 32-bit ELF of our byte order and of the other one
+	{ READER_FUNCS(32), READER_FUNCS(32x) },
+	// 64-bit ELF
+	{ READER_FUNCS(64), READER_FUNCS(64x) },
+};
+
 /**
  * Returns the set of reader functions appropriate for the input given.
  */
 static struct reader_funcs	input_init_reader_funcs(input_t * in)
 {
-	struct reader_funcs rdr;
-	if (in->is_64) // input is 64-bit ELF
-	{
-		rdr.find_sections = find_sections_64;
-		rdr.process_relocations = process_relocations_64;
-		rdr.read_symtab = read_in_symtab_64;
-	}
-	else // input is 32-bit ELF
-	{
-		rdr.find_sections = find_sections_32;
-		rdr.process_relocations = process_relocations_32;
-		rdr.read_symtab = read_in_symtab_32;
-	}
-
-	return rdr;
+	return readers[in->is_64][!in->same_endian];
 }
 
 static const char*	elf_describe(int type)
@@ -227,9 +380,10 @@ extern struct reader_funcs	input_read_elf_header(input_t* in)
 	in->same_endian = (input_big_endian == host_big_endian);
 
 	int typ = in->same_endian ? ehdr->e_type : get_uint16(&ehdr->e_type);
+	in->machine = in->same_endian ? ehdr->e_machine : get_uint16(&ehdr->e_machine);
 	const char *descr = elf_describe(typ);
 	report(NORM, "Input (%s) is a %s-bit %s endian ELF %s.",
-	       args_get_input_file_name(),
+	       in->fname,
 	       in->is_64 ? "64" : "32",
 	       input_big_endian ? "big" : "little",
 	       descr);
@@ -237,6 +391,55 @@ extern struct reader_funcs	input_read_elf_header(input_t* in)
 	return input_init_reader_funcs(in);
 }
 
+/**
+ * Opens the given file and reads in its symbols with the relocations attributed to them. The input is left
+ * open as the returned symbol table refers to its contents. Unlike the rest of the functions here, does not
+ * exit on a bad file: returns NULL with the reason put into err and the input closed instead.
+ */
+extern symtab_t *	input_read_refs(input_t* in, const char* fname, char* err, size_t err_size)
+{
+	symtab_t * volatile		st = NULL;
+	elf_sections_t * volatile	sec = NULL;
+
+	jmp_buf * const prev_env = errors_get_fatal_handler();
+	jmp_buf env;
+	if (setjmp(env))
+	{
+		errors_set_fatal_handler(prev_env);
+		snprintf(err, err_size, "%s", errors_get_fatal_message());
+
+		free(sec);
+		if (st)
+		{
+			symtab_free(st);
+		}
+		input_close(in);
+		return NULL;
+	}
+	errors_set_fatal_handler(&env);
+
+	input_open(in, fname);
+
+	struct reader_funcs rdr = input_read_elf_header(in);
+	sec = rdr.find_sections(in);
+	st = rdr.read_symtab(in, sec);
+	if (st)
+	{
+		rdr.process_relocations(in, sec, st);
+	}
+
+	errors_set_fatal_handler(prev_env);
+	free(sec);
+
+	if (!st)
+	{
+		snprintf(err, err_size, "No symbols found in .symtab and .dynsym");
+		input_close(in);
+	}
+
+	return st;
+}
+
 ////////////////////// Input file reader functions ////////////////////////////
 ///////////////////////////////////////////////////////////////////////////////
 /**
@@ -292,3 +495,20 @@ extern uint16_t		get_uint16(void* vp)
 	u.c[0] = *(p + 1);
 	return u.i;
 }
+
+/**
+ * Returns the field of size bytes pointed to by vp in the byte order given, wherever it is aligned.
+ */
+extern uint64_t		get_field(const void* vp, size_t size, bool big_endian)
+{
+	const unsigned char *p = vp;
+	uint64_t v = 0;
+	for (size_t i = 0; i < size; ++i)
+	{
+		if (big_endian)
+			v = (v << 8) | p[i];
+		else
+			v |= (uint64_t)p[i] << (8*i);
+	}
+	return v;
+}
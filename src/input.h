@@ -30,20 +30,51 @@
 
 #include <stdbool.h>
 #include <elf.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 
 typedef	struct symtab_s		symtab_t;
 typedef	struct input_s		input_t;
 typedef struct elf_sections_s 	elf_sections_t;
+typedef struct summary_s	summary_t;
+typedef struct spill_s		spill_t;
+typedef struct symtab_filter	symtab_filter_t;
+typedef struct archive_member	archive_member_t;
 
 input_t *	input_init(void);
-void 		input_open(input_t* in);
+void		input_free(input_t* in);
+void 		input_open(input_t* in, const char* fname);
+void		input_open_member(input_t* in, const archive_member_t* member);
 void		input_close(input_t* in);
 
+/**
+ * Describes an ELF section's content (see reader_funcs.find_section).
+ */
+typedef struct input_section
+{
+	const char *	data;		// in the input's mapping
+	size_t		size;
+	size_t		addr;		// where the section is loaded
+	uint64_t	flags;		// SHF_*
+} input_section_t;
+
+/**
+ * Describes a relocation applied to a section (see reader_funcs.read_section_relocs).
+ */
+typedef struct input_reloc
+{
+	size_t		offset;		// within the section
+	size_t		value;		// of the referenced symbol
+	int64_t		addend;
+	bool		is_rela;	// false if the addend is stored at the offset instead
+} input_reloc_t;
+
 // Bitness-independent functions to read input
 struct 	reader_funcs
 {
 	/// Function that locates the necessary sections of the ELF file.
-	/// Note: not re-entrant, returns pointer to static memory.
+	/// The result must be released with free().
 	elf_sections_t * 	(*find_sections)(input_t*);
 
 	/// Functions that reads in symbol tables of the ELF file.
@@ -51,18 +82,51 @@ struct 	reader_funcs
 
 	/// Function that reads  in relocation information of the ELF file and updates symtab with it.
 	void			(*process_relocations)(input_t*, elf_sections_t*, symtab_t*);
+
+	/// Function that counts relocations of the ELF file in the summary instead of keeping them in symtab.
+	void			(*summarize_relocations)(input_t*, elf_sections_t*, symtab_t*, summary_t*);
+
+	/// Function that passes relocations of the ELF file to an external sort instead of keeping them in symtab.
+	void			(*spill_relocations)(input_t*, elf_sections_t*, symtab_t*, spill_t*);
+
+	/// Function that updates symtab only with the relocations within the symbols named exactly as given.
+	void			(*process_symbol_relocations)(input_t*, elf_sections_t*, symtab_t*, const char* name);
+
+	/// Function that reads in relocation information and prints out symbols as soon as their references are
+	/// complete; returns false without doing anything if the relocations are not sorted by offset.
+	bool			(*stream_relocations)(input_t*, elf_sections_t*, symtab_t*, FILE* out,
+						      const symtab_filter_t* filter, size_t* nrefs);
+
+	/// Function that finds the named section; returns false if there is no such section.
+	bool			(*find_section)(input_t*, elf_sections_t*, const char* name, input_section_t* sec);
+
+	/// Function that collects the relocations applied to the named section, sorted by offset.
+	/// Returns their number; the result must be released with free().
+	size_t			(*read_section_relocs)(input_t*, elf_sections_t*, const char* name, input_reloc_t** relocs);
 };
 struct reader_funcs	input_read_elf_header(input_t* in);
+symtab_t *		input_read_refs(input_t* in, const char* fname, char* err, size_t err_size);
 
 // Input file properties and content access functions
+const char *		input_get_file_name(input_t* in);
 unsigned long long	input_get_file_size(input_t* in);
 char *			input_get_mem_map(input_t* in);
+bool			input_get_is_archive(input_t* in);
+void			input_advise(input_t* in, size_t off, size_t size, int advice);
 bool			input_get_is_same_endian(input_t* in);
+uint16_t		input_get_machine(input_t* in);
 
 // Helper reader functions
 uint16_t	get_uint16(void* ptr);
 uint32_t	get_uint32(void* ptr);
 uint64_t	get_uint64(void* ptr);
+uint64_t	get_field(const void* ptr, size_t size, bool big_endian);
+
+// Fetch a field of an ELF structure of either class and endianness from where it lies in a file that is
+// looked into without converting it, such as ELF_FIELD(shdr, Shdr, sh_size, is64, be)
+#define ELF_FIELD(p, type, f, is64, be) ((is64) \
+	? get_field((const char*)(p) + offsetof(Elf64_##type, f), sizeof(((Elf64_##type*)0)->f), be) \
+	: get_field((const char*)(p) + offsetof(Elf32_##type, f), sizeof(((Elf32_##type*)0)->f), be))
 
 #endif
 
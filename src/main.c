@@ -31,24 +31,347 @@
 #include "errors.h"
 #include "perf.h"
 #include "symtab.h"
+#include "server.h"
+#include "index.h"
+#include "scan.h"
+#include "dwarf.h"
+#include "prefetch.h"
+#include "diff.h"
+#include "summary.h"
+#include "spill.h"
+#include "graph.h"
+#include "archive.h"
+#include "trace.h"
 
 #include <assert.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <setjmp.h>
 
-static void	print_refs(input_t* in)
+/**
+ * Converts the address given by the user, which is a hex number possibly preceded by a section name
+ * and '+' (as in .text+0x1a2c), and stores it in *addr. Returns false if the address is malformed.
+ */
+static bool	parse_addr(input_t* in, struct reader_funcs* rdr, elf_sections_t* sec, const char* str, size_t* addr)
+{
+	size_t base = 0;
+	const char *off = str;
+
+	const char *plus = strrchr(str, '+');
+	if (plus && plus != str)
+	{
+		char sec_name[256];
+		snprintf(sec_name, sizeof(sec_name), "%.*s", (int)(plus - str), str);
+		input_section_t is;
+		if (!rdr->find_section(in, sec, sec_name, &is))
+		{
+			error("No section %s in %s", sec_name, input_get_file_name(in));
+			return false;
+		}
+		base = is.addr;
+		off = plus + 1;
+	}
+
+	if (!isxdigit((unsigned char)*off))
+	{
+		error("Malformed address %s", str);
+		return false;
+	}
+
+	char *end = NULL;
+	errno = 0;
+	const unsigned long long n = strtoull(off, &end, 16);
+	if (*end != 0 || errno != 0)
+	{
+		error("Malformed address %s", str);
+		return false;
+	}
+
+	*addr = base + n;
+	return true;
+}
+
+/**
+ * Prints out the symbols containing the addresses given on the command line or,
+ * if there are none, read from the standard input, along with their references.
+ */
+static void	print_addrs(input_t* in, struct reader_funcs* rdr, elf_sections_t* sec, symtab_t* st,
+			    const symtab_filter_t* filter)
+{
+	size_t naddrs = 0;
+	const char **addrs = args_get_addrs(&naddrs);
+	size_t addr = 0;
+
+	for (size_t i = 0; i < naddrs; ++i)
+	{
+		if (parse_addr(in, rdr, sec, addrs[i], &addr))
+			symtab_dump_addr(st, stdout, filter, addr);
+	}
+
+	if (naddrs == 0)
+	{
+		char *line = NULL;
+		size_t line_size = 0;
+		while (getline(&line, &line_size, stdin) > 0)
+		{
+			char *save = NULL;
+			for (char *tok = strtok_r(line, " \t\n", &save); tok; tok = strtok_r(NULL, " \t\n", &save))
+			{
+				if (parse_addr(in, rdr, sec, tok, &addr))
+					symtab_dump_addr(st, stdout, filter, addr);
+			}
+		}
+		free(line);
+	}
+}
+
+static bool	print_members(input_t* in, const char* fname);
+
+/**
+ * Opens the given file, or the archive member if one is given, and prints out its symbols and references.
+ * With keep_going, a bad file is reported as an error and false is returned (like input_read_refs() does);
+ * otherwise, the program exits on it.
+ */
+static bool	print_refs(input_t* in, const char* fname, const archive_member_t* member, bool keep_going)
 {
 	assert(in);
 
+	symtab_t * volatile		st = NULL;
+	elf_sections_t * volatile	sec = NULL;
+	dwarf_lines_t * volatile	lines = NULL;
+	summary_t * volatile		summary = NULL;
+	spill_t * volatile		spill = NULL;
+	graph_t * volatile		graph = NULL;
+
+	// A member of an archive is printed while the handler of the archive is set, which must be put back
+	jmp_buf * const prev_env = errors_get_fatal_handler();
+	jmp_buf env;
+	if (keep_going && setjmp(env))
+	{
+		errors_set_fatal_handler(prev_env);
+		error("%s: %s", fname, errors_get_fatal_message());
+
+		graph_free(graph);
+		spill_free(spill);
+		summary_free(summary);
+		dwarf_lines_free(lines);
+		if (st)
+		{
+			symtab_free(st);
+		}
+		free(sec);
+		input_close(in);
+		return false;
+	}
+	if (keep_going)
+	{
+		errors_set_fatal_handler(&env);
+	}
+
+	uint64_t span = trace_begin();
+	if (member)
+	{
+		input_open_member(in, member);
+	}
+	else
+	{
+		input_open(in, fname);
+	}
+	trace_end(span, "input", "open", fname, input_get_file_size(in));
+
+	if (!member && input_get_is_archive(in))
+	{
+		const bool ok = print_members(in, fname);
+
+		errors_set_fatal_handler(prev_env);
+		input_close(in);
+		return ok;
+	}
+
+	span = trace_begin();
 	struct reader_funcs rdr = input_read_elf_header(in);
+	trace_end(span, "input", "read_elf_header", fname, 0);
 
-	elf_sections_t * sec = rdr.find_sections(in);
-	symtab_t *st = rdr.read_symtab(in, sec);
-	if (st)
+	span = trace_begin();
+	sec = rdr.find_sections(in);
+	trace_end(span, "input", "find_sections", fname, 0);
+
+	span = trace_begin();
+	st = rdr.read_symtab(in, sec);
+	trace_end(span, "input", "read_symtab", fname, 0);
+	if (st && args_get_is_summary())
+	{
+		summary = summary_alloc(args_get_filter());
+		if (args_get_sample_rate() < 1)
+		{
+			summary_set_sample(summary, args_get_sample_rate(), args_get_seed());
+		}
+		rdr.summarize_relocations(in, sec, st, summary);
+		summary_print(summary, st, stdout, args_get_top());
+	}
+	else if (st && (args_get_reach_from() || args_get_path_to()))
 	{
 		rdr.process_relocations(in, sec, st);
-		symtab_dump(st);
+
+		graph = graph_build(st);
+		if (args_get_path_to())
+		{
+			graph_print_path(graph, stdout, args_get_reach_from(), args_get_path_to());
+		}
+		else
+		{
+			graph_print_reach(graph, stdout, args_get_filter(), args_get_reach_from());
+		}
+	}
+	else if (st)
+	{
+		symtab_filter_t filter = *args_get_filter();
+		if (args_get_is_lines())
+		{
+			lines = dwarf_lines_alloc(in, &rdr, sec);
+			filter.lines = lines;
+		}
+
+		size_t nrefs = 0;
+		if (args_get_is_addr_mode())
+		{
+			rdr.process_relocations(in, sec, st);
+			print_addrs(in, &rdr, sec, st, &filter);
+		}
+		else if (filter.name_exact)
+		{
+			rdr.process_symbol_relocations(in, sec, st, filter.name_pattern);
+			symtab_dump(st, &filter);
+		}
+		else if (rdr.stream_relocations(in, sec, st, stdout, &filter, &nrefs))
+		{
+			if (nrefs == 0)
+			{
+				symtab_report_empty(&filter);
+			}
+		}
+		else if (args_get_mem_limit())
+		{
+			spill = spill_alloc(args_get_mem_limit());
+			rdr.spill_relocations(in, sec, st, spill);
+			if (spill_dump(spill, st, stdout, &filter) == 0)
+			{
+				symtab_report_empty(&filter);
+			}
+		}
+		else
+		{
+			rdr.process_relocations(in, sec, st);
+			symtab_dump(st, &filter);
+		}
+	}
+
+	perf_print_memstats(); // do it here before we have free'ed everything
+
+	errors_set_fatal_handler(prev_env);
+
+	graph_free(graph);
+	spill_free(spill);
+	summary_free(summary);
+	dwarf_lines_free(lines);
+	if (st)
+	{
 		symtab_free(st);
 	}
+	free(sec);
+	input_close(in);
+
+	return true;
+}
+
+/**
+ * Prints out the references of the members of the archive open as in, each preceded by its name as
+ * archive(member). The members that can not have anything to show for the filter are not read at all.
+ */
+static bool	print_members(input_t* in, const char* fname)
+{
+	if (args_get_is_addr_mode())
+	{
+		fatal("--addr does not work with archives; extract the member first");
+	}
+
+	archive_t *ar = archive_open(input_get_mem_map(in), input_get_file_size(in), fname);
+
+	const archive_member_t *members = NULL;
+	const size_t n = archive_get_members(ar, &members);
+
+	input_t *member_in = input_init();
+	bool ok = true;
+	size_t nread = 0;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (!archive_member_may_match(ar, i, args_get_filter()))
+			continue;
+
+		printf("\n%s:\n", members[i].name);
+		fflush(stdout); // keep it ahead of the diagnostics
+
+		const uint64_t span = trace_begin();
+		if (!print_refs(member_in, members[i].name, &members[i], true))
+		{
+			ok = false;
+		}
+		fflush(stdout);
+		trace_end(span, "file", members[i].name, fname, members[i].size);
+		++nread;
+	}
+
+	report(VERB, "Read %zu of %zu members of %s", nread, n, fname);
+	if (nread == 0)
+	{
+		symtab_report_empty(args_get_filter());
+	}
+
+	input_free(member_in);
+	archive_free(ar);
+
+	return ok;
+}
+
+/**
+ * Prints out the references of all the input files, reading the files ahead as the --io option says.
+ * Several files are each preceded by their name, like nm(1) does.
+ */
+static int	print_files(input_t* in)
+{
+	int rc = EXIT_SUCCESS;
+
+	size_t n = 0;
+	const char **fnames = args_get_input_files(&n);
+
+	prefetch_t *pf = prefetch_start(args_get_io_engine(), fnames, n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		prefetch_wait(pf, i);
+
+		if (n > 1)
+		{
+			printf("\n%s:\n", fnames[i]);
+			fflush(stdout); // keep it ahead of the diagnostics
+		}
+
+		const uint64_t span = trace_begin();
+		if (!print_refs(in, fnames[i], NULL, n > 1))
+		{
+			rc = EXIT_FAILURE;
+		}
+		fflush(stdout);
+		trace_end(span, "file", fnames[i], NULL, 0);
+	}
+
+	prefetch_stop(pf);
+
+	return rc;
 }
 
 extern int	main(int argc, char* argv[])
@@ -62,13 +385,38 @@ extern int	main(int argc, char* argv[])
 
 	if (args_parse(argc, argv, in))
 	{
-		input_open(in);
-
-		print_refs(in);
-
-		perf_print_memstats(); // do it here before we have free'ed everything
+		if (args_get_trace_file())
+		{
+			trace_start(args_get_trace_file());
+		}
+		glob_set_threads(args_get_threads());
 
-		input_close(in);
+		if (args_get_serve_socket())
+		{
+			server_run(args_get_serve_socket(), args_get_cache_mem());
+		}
+		else if (args_get_index_dir())
+		{
+			index_run(args_get_index_dir(), args_get_db_name(), args_get_filter(), args_get_is_watch());
+		}
+		else if (args_get_scan_dir())
+		{
+			rc = scan_run(args_get_scan_dir(), args_get_input_file_name(), args_get_filter());
+		}
+		else if (args_get_connect_socket())
+		{
+			rc = server_query(args_get_connect_socket(), args_get_input_file_name(), args_get_filter());
+		}
+		else if (args_get_is_diff_mode())
+		{
+			size_t n = 0;
+			const char **fnames = args_get_input_files(&n);
+			rc = diff_run(fnames[0], fnames[1], args_get_filter());
+		}
+		else
+		{
+			rc = print_files(in);
+		}
 	}
 	else
 	{
@@ -76,5 +424,8 @@ extern int	main(int argc, char* argv[])
 		rc = EXIT_FAILURE;
 	}
 
+	trace_stop();
+	input_free(in);
+
 	return rc;
 }
@@ -39,10 +39,10 @@ extern void	perf_print_memstats()
     if ( args_get_verbosity() < DBG ) 
 	return;
 
-    struct mallinfo mi = mallinfo();
+    struct mallinfo2 mi = mallinfo2();
 
     fprintf(stderr, "Memory stats:\n");
-    fprintf(stderr, "Total allocated heap: %dK\n", mi.uordblks/1024);
-    fprintf(stderr, "Total free (unused) heap: %dK\n", mi.fordblks/1024);
+    fprintf(stderr, "Total allocated heap: %zuK\n", mi.uordblks/1024);
+    fprintf(stderr, "Total free (unused) heap: %zuK\n", mi.fordblks/1024);
 }
 
@@ -0,0 +1,736 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// Reading of the input files ahead of parsing them.
+//
+// The parser accesses an input file through its mapping, so the sections it
+// reads are brought in by page faults that get served one after another. When
+// there are many files, a prefetching thread reads what the parser is going to
+// need into the page cache while the parser is busy with the preceding files:
+// the ELF header first, then the section header table and, as soon as that is
+// parsed, the symbol tables with their strings and the relocation sections.
+// With io_uring, the reads for up to AHEAD files are all in flight at once,
+// which keeps the device queue full. The data read is thrown away, it's the
+// page cache that we're after.
+
+#include "prefetch.h"
+#include "errors.h"
+#include "args.h"
+#include "input.h"
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define AHEAD		32			// files prefetched ahead of the one being parsed
+#define CHUNK		((size_t)1 << 20)	// max bytes per read of a range
+#define RING_ENTRIES	64
+
+// What a read is for, kept in the low bits of its user_data along with the file index
+#define RD_EHDR		0
+#define RD_SHDRS	1
+#define RD_RANGE	2
+#define RD_BITS		2
+
+/**
+ * A range of a file to prefetch.
+ */
+typedef struct range
+{
+	uint64_t	off;
+	uint64_t	len;
+} range;
+
+/**
+ * Prefetching state of a file.
+ */
+typedef struct job
+{
+	int		fd;
+	uint64_t	fsize;
+	unsigned char	ehdr[sizeof(Elf64_Ehdr)];
+	unsigned char *	shdrs;		// section header table, once known where it is
+	size_t		shdrs_size;
+	range *		ranges;		// what to read, once the section header table is read
+	size_t		nranges;
+	size_t		next_range;	// the range to read next...
+	uint64_t	next_off;	// ...from this offset into it
+	unsigned int	inflight;	// reads submitted but not complete
+} job;
+
+struct prefetch_s
+{
+	prefetch_engine_t	engine;
+	const char **		paths;
+	size_t			n;
+	job *			jobs;
+	char *			scratch;	// CHUNK bytes to read the ranges into
+
+	pthread_t		thread;
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	bool *			ready;		// file i is prefetched (or failed to be)
+	size_t			consumer;	// the file being parsed
+	bool			stop;
+};
+
+/**
+ * An io_uring instance with its submission and completion queues mapped.
+ */
+typedef struct ring
+{
+	int			fd;
+	unsigned int		entries;
+	unsigned int		inflight;	// submitted or queued, but not complete
+	unsigned int		queued;		// queued but not submitted
+
+	void *			sq_ptr;
+	size_t			sq_size;
+	unsigned int *		sq_tail;
+	unsigned int *		sq_mask;
+	unsigned int *		sq_array;
+	struct io_uring_sqe *	sqes;
+	size_t			sqes_size;
+
+	void *			cq_ptr;
+	size_t			cq_size;
+	unsigned int *		cq_head;
+	unsigned int *		cq_tail;
+	unsigned int *		cq_mask;
+	struct io_uring_cqe *	cqes;
+} ring;
+
+/**
+ * Parses the engine name given by the user. Returns false if there is no such engine.
+ */
+extern bool	prefetch_parse_engine(const char* name, prefetch_engine_t* engine)
+{
+	if (strcmp(name, "mmap") == 0)
+		*engine = PREFETCH_MMAP;
+	else if (strcmp(name, "pread") == 0)
+		*engine = PREFETCH_PREAD;
+	else if (strcmp(name, "uring") == 0)
+		*engine = PREFETCH_URING;
+	else
+		return false;
+
+	return true;
+}
+
+static bool	job_is64(const job* j)
+{
+	return j->ehdr[EI_CLASS] == ELFCLASS64;
+}
+
+static bool	job_is_big_endian(const job* j)
+{
+	return j->ehdr[EI_DATA] == ELFDATA2MSB;
+}
+
+/**
+ * Opens the file i. Returns false if it can't be read.
+ */
+static bool	job_open(prefetch_t* pf, size_t i)
+{
+	job *j = &pf->jobs[i];
+
+	j->fd = open(pf->paths[i], O_RDONLY | O_CLOEXEC);
+	if (j->fd == -1)
+		return false;
+
+	struct stat sb;
+	if (fstat(j->fd, &sb) == -1 || sb.st_size <= 0)
+		return false;
+	j->fsize = (uint64_t)sb.st_size;
+
+	return true;
+}
+
+/**
+ * Finds out where the section header table is from the ELF header read and allocates the space for it.
+ * Returns false if there is nothing to read.
+ */
+static bool	job_parse_ehdr(job* j, uint64_t* off)
+{
+	if (memcmp(j->ehdr, ELFMAG, SELFMAG) != 0
+	    || (j->ehdr[EI_CLASS] != ELFCLASS32 && j->ehdr[EI_CLASS] != ELFCLASS64))
+		return false;
+
+	const bool is64 = job_is64(j);
+	const bool be = job_is_big_endian(j);
+	const uint64_t shoff = ELF_FIELD(j->ehdr, Ehdr, e_shoff, is64, be);
+	const uint64_t shentsize = ELF_FIELD(j->ehdr, Ehdr, e_shentsize, is64, be);
+	uint64_t shnum = ELF_FIELD(j->ehdr, Ehdr, e_shnum, is64, be);
+	const uint64_t min_shentsize = is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr);
+
+	if (shoff == 0 || shentsize < min_shentsize || shoff > j->fsize || shentsize > j->fsize - shoff)
+		return false;
+
+	// With SHN_LORESERVE sections or more, their number is in the first section header. It's read right
+	// away rather than queued: such files are rare, and this is a single small read
+	if (shnum == 0)
+	{
+		unsigned char shdr[sizeof(Elf64_Shdr)];
+		if (pread(j->fd, shdr, (size_t)min_shentsize, (off_t)shoff) != (ssize_t)min_shentsize)
+			return false;
+		shnum = ELF_FIELD(shdr, Shdr, sh_size, is64, be);
+	}
+
+	if (shnum == 0 || shnum > (j->fsize - shoff)/shentsize)
+		return false;
+
+	j->shdrs_size = (size_t)(shentsize*shnum);
+	j->shdrs = malloc(j->shdrs_size);
+	if (!j->shdrs)
+	{
+		fatal_err("Not enough memory");
+	}
+	*off = shoff;
+
+	return true;
+}
+
+static void	job_add_section(job* j, const unsigned char* shdr)
+{
+	const bool is64 = job_is64(j);
+	const bool be = job_is_big_endian(j);
+	const uint64_t off = ELF_FIELD(shdr, Shdr, sh_offset, is64, be);
+	const uint64_t size = ELF_FIELD(shdr, Shdr, sh_size, is64, be);
+
+	if (ELF_FIELD(shdr, Shdr, sh_type, is64, be) == SHT_NOBITS || off >= j->fsize || size == 0)
+		return;
+
+	j->ranges[j->nranges++] = (range){ off, (size < j->fsize - off) ? size : j->fsize - off };
+}
+
+/**
+ * Lists the ranges of the file the parser is going to read, based on the section header table read:
+ * the section names, the symbol tables with their strings and extended section indexes, and the
+ * relocation sections (see process_relocations_$NN() for which of those are read).
+ */
+static void	job_plan(job* j)
+{
+	const bool is64 = job_is64(j);
+	const bool be = job_is_big_endian(j);
+	const size_t shentsize = (size_t)ELF_FIELD(j->ehdr, Ehdr, e_shentsize, is64, be);
+	const size_t shnum = j->shdrs_size / shentsize;
+	size_t shstrndx = (size_t)ELF_FIELD(j->ehdr, Ehdr, e_shstrndx, is64, be);
+
+	// With SHN_LORESERVE sections or more, the index of the one with their names is in the first header
+	if (shstrndx == SHN_XINDEX)
+	{
+		shstrndx = (size_t)ELF_FIELD(j->shdrs, Shdr, sh_link, is64, be);
+	}
+
+	j->ranges = malloc((2*shnum + 1)*sizeof(range));
+	if (!j->ranges)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	if (shstrndx < shnum)
+	{
+		job_add_section(j, j->shdrs + shstrndx*shentsize);
+	}
+
+	for (size_t k = 0; k < shnum; ++k)
+	{
+		const unsigned char *shdr = j->shdrs + k*shentsize;
+		const uint64_t type = ELF_FIELD(shdr, Shdr, sh_type, is64, be);
+		const uint64_t link = ELF_FIELD(shdr, Shdr, sh_link, is64, be);
+		const uint64_t info = ELF_FIELD(shdr, Shdr, sh_info, is64, be);
+
+		if (type == SHT_SYMTAB || type == SHT_DYNSYM)
+		{
+			job_add_section(j, shdr);
+			if (link < shnum)
+				job_add_section(j, j->shdrs + link*shentsize);
+		}
+		else if (type == SHT_SYMTAB_SHNDX)
+		{
+			job_add_section(j, shdr);
+		}
+		else if (type == SHT_REL || type == SHT_RELA)
+		{
+			// Section names are not known here, so all relocation sections are read with --section
+			const bool for_loaded = info == 0 || info >= shnum
+				|| (ELF_FIELD(j->shdrs + info*shentsize, Shdr, sh_flags, is64, be) & SHF_ALLOC);
+			if (for_loaded || args_get_section_pattern())
+				job_add_section(j, shdr);
+		}
+	}
+}
+
+/**
+ * Gets the next piece of the planned ranges to read. Returns false if there is none.
+ */
+static bool	job_next_read(job* j, uint64_t* off, size_t* len)
+{
+	if (j->next_range >= j->nranges)
+		return false;
+
+	const range *r = &j->ranges[j->next_range];
+	*off = r->off + j->next_off;
+	*len = (r->len - j->next_off < CHUNK) ? (size_t)(r->len - j->next_off) : CHUNK;
+
+	j->next_off += *len;
+	if (j->next_off >= r->len)
+	{
+		j->next_range++;
+		j->next_off = 0;
+	}
+
+	return true;
+}
+
+/**
+ * Releases the resources of the job for file i and lets the parser know it can proceed with the file.
+ */
+static void	job_finish(prefetch_t* pf, size_t i)
+{
+	job *j = &pf->jobs[i];
+
+	if (j->fd != -1)
+	{
+		close(j->fd);
+		j->fd = -1;
+	}
+	free(j->shdrs);
+	j->shdrs = NULL;
+	free(j->ranges);
+	j->ranges = NULL;
+	j->nranges = 0;
+
+	pthread_mutex_lock(&pf->lock);
+	pf->ready[i] = true;
+	pthread_cond_broadcast(&pf->cond);
+	pthread_mutex_unlock(&pf->lock);
+}
+
+/**
+ * Waits until file i is within AHEAD files from the one being parsed.
+ * Returns false if prefetching is to stop.
+ */
+static bool	wait_for_window(prefetch_t* pf, size_t i)
+{
+	pthread_mutex_lock(&pf->lock);
+	while (!pf->stop && i >= pf->consumer + AHEAD)
+	{
+		pthread_cond_wait(&pf->cond, &pf->lock);
+	}
+	const bool stop = pf->stop;
+	pthread_mutex_unlock(&pf->lock);
+
+	return !stop;
+}
+
+/**
+ * Prefetches the files one read at a time.
+ */
+static void	pread_run(prefetch_t* pf)
+{
+	for (size_t i = 0; i < pf->n && wait_for_window(pf, i); ++i)
+	{
+		job *j = &pf->jobs[i];
+		uint64_t off = 0;
+		size_t len = 0;
+
+		if (job_open(pf, i)
+		    && pread(j->fd, j->ehdr, sizeof(j->ehdr), 0) == (ssize_t)sizeof(j->ehdr)
+		    && job_parse_ehdr(j, &off)
+		    && pread(j->fd, j->shdrs, j->shdrs_size, (off_t)off) == (ssize_t)j->shdrs_size)
+		{
+			job_plan(j);
+			while (job_next_read(j, &off, &len) && pread(j->fd, pf->scratch, len, (off_t)off) > 0)
+				;
+		}
+
+		job_finish(pf, i);
+	}
+}
+
+static bool	ring_init(ring* r)
+{
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+
+	const long fd = syscall(__NR_io_uring_setup, RING_ENTRIES, &p);
+	if (fd < 0)
+		return false;
+	r->fd = (int)fd;
+	r->entries = p.sq_entries;
+
+	r->sq_size = p.sq_off.array + p.sq_entries*sizeof(unsigned int);
+	r->cq_size = p.cq_off.cqes + p.cq_entries*sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		r->sq_size = r->cq_size = (r->sq_size > r->cq_size) ? r->sq_size : r->cq_size;
+	}
+
+	r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	r->cq_ptr = (p.features & IORING_FEAT_SINGLE_MMAP) ? r->sq_ptr
+		: mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+	r->sqes_size = p.sq_entries*sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sq_ptr == MAP_FAILED || r->cq_ptr == MAP_FAILED || r->sqes == MAP_FAILED)
+	{
+		fatal_err("Cannot map io_uring queues");
+	}
+
+	char *sq = r->sq_ptr;
+	r->sq_tail = (unsigned int*)(sq + p.sq_off.tail);
+	r->sq_mask = (unsigned int*)(sq + p.sq_off.ring_mask);
+	r->sq_array = (unsigned int*)(sq + p.sq_off.array);
+
+	char *cq = r->cq_ptr;
+	r->cq_head = (unsigned int*)(cq + p.cq_off.head);
+	r->cq_tail = (unsigned int*)(cq + p.cq_off.tail);
+	r->cq_mask = (unsigned int*)(cq + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+	return true;
+}
+
+static void	ring_free(ring* r)
+{
+	munmap(r->sqes, r->sqes_size);
+	if (r->cq_ptr != r->sq_ptr)
+		munmap(r->cq_ptr, r->cq_size);
+	munmap(r->sq_ptr, r->sq_size);
+	close(r->fd);
+}
+
+/**
+ * Queues a read; there must be room for it (inflight < entries).
+ */
+static void	ring_read(ring* r, int fd, void* buf, size_t len, uint64_t off, uint64_t user_data)
+{
+	assert(r->inflight < r->entries);
+
+	const unsigned int tail = *r->sq_tail; // only we write it
+	const unsigned int idx = tail & *r->sq_mask;
+
+	struct io_uring_sqe *sqe = &r->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = (uint32_t)len;
+	sqe->off = off;
+	sqe->user_data = user_data;
+
+	r->sq_array[idx] = idx;
+	__atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+	r->inflight++;
+	r->queued++;
+}
+
+/**
+ * Submits the queued reads and waits for at least one of those in flight to complete.
+ */
+static void	ring_enter(ring* r)
+{
+	const unsigned int wait = r->inflight ? 1 : 0;
+	while (syscall(__NR_io_uring_enter, r->fd, r->queued, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0) < 0)
+	{
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		{
+			fatal_err("io_uring_enter() failed");
+		}
+	}
+	r->queued = 0;
+}
+
+/**
+ * Takes the next completion off the ring. Returns false if there is none.
+ */
+static bool	ring_reap(ring* r, uint64_t* user_data, int* res)
+{
+	const unsigned int head = *r->cq_head; // only we write it
+	if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE))
+		return false;
+
+	const struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+	*user_data = cqe->user_data;
+	*res = cqe->res;
+	__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+	r->inflight--;
+
+	return true;
+}
+
+/**
+ * Deals with the completion of a read for file i. The follow-up reads are queued: the section header
+ * table after the ELF header, the planned ranges after the table.
+ */
+static void	uring_complete(prefetch_t* pf, ring* r, size_t i, unsigned int what, int res)
+{
+	job *j = &pf->jobs[i];
+	j->inflight--;
+
+	uint64_t off = 0;
+	if (what == RD_EHDR)
+	{
+		if (res == (int)sizeof(j->ehdr) && job_parse_ehdr(j, &off))
+		{
+			ring_read(r, j->fd, j->shdrs, j->shdrs_size, off, (i << RD_BITS) | RD_SHDRS);
+			j->inflight++;
+		}
+	}
+	else if (what == RD_SHDRS)
+	{
+		if (res == (int)j->shdrs_size)
+			job_plan(j);
+	}
+	else if (res <= 0)
+	{
+		j->next_range = j->nranges; // give up on the rest of the file
+	}
+
+	if (j->inflight == 0 && j->next_range >= j->nranges)
+	{
+		job_finish(pf, i);
+	}
+}
+
+/**
+ * Checks if any of the files from first up to next has pieces of ranges left to read.
+ */
+static bool	has_pending(const prefetch_t* pf, size_t first, size_t next)
+{
+	for (size_t i = first; i < next; ++i)
+	{
+		if (pf->jobs[i].next_range < pf->jobs[i].nranges)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Prefetches the files with all the reads for up to AHEAD files in flight.
+ */
+static void	uring_run(prefetch_t* pf, ring* r)
+{
+	size_t next = 0;	// the file to start prefetching next
+	size_t first = 0;	// the first file not prefetched yet
+
+	for (;;)
+	{
+		while (first < next && pf->ready[first])
+			first++;
+
+		const bool busy = r->inflight > 0 || has_pending(pf, first, next);
+
+		pthread_mutex_lock(&pf->lock);
+		while (!pf->stop && !busy && next < pf->n && next >= pf->consumer + AHEAD)
+		{
+			pthread_cond_wait(&pf->cond, &pf->lock);
+		}
+		const bool stop = pf->stop;
+		const size_t limit = (pf->consumer + AHEAD < pf->n) ? pf->consumer + AHEAD : pf->n;
+		pthread_mutex_unlock(&pf->lock);
+
+		if (stop || (next >= pf->n && !busy))
+			break;
+
+		for (; next < limit && r->inflight < r->entries; ++next)
+		{
+			job *j = &pf->jobs[next];
+			if (!job_open(pf, next))
+			{
+				job_finish(pf, next);
+				continue;
+			}
+			ring_read(r, j->fd, j->ehdr, sizeof(j->ehdr), 0, (next << RD_BITS) | RD_EHDR);
+			j->inflight++;
+		}
+
+		// Keep the ring full with the pieces of the ranges planned, earlier files first
+		for (size_t i = first; i < next && r->inflight < r->entries; ++i)
+		{
+			job *j = &pf->jobs[i];
+			uint64_t off = 0;
+			size_t len = 0;
+			while (r->inflight < r->entries && job_next_read(j, &off, &len))
+			{
+				ring_read(r, j->fd, pf->scratch, len, off, (i << RD_BITS) | RD_RANGE);
+				j->inflight++;
+			}
+		}
+
+		ring_enter(r);
+
+		uint64_t user_data = 0;
+		int res = 0;
+		while (ring_reap(r, &user_data, &res))
+		{
+			uring_complete(pf, r, (size_t)(user_data >> RD_BITS), (unsigned int)(user_data & ((1 << RD_BITS) - 1)), res);
+		}
+	}
+
+	// The buffers must stay around until the kernel is done with them
+	while (r->inflight > 0)
+	{
+		ring_enter(r);
+
+		uint64_t user_data = 0;
+		int res = 0;
+		while (ring_reap(r, &user_data, &res))
+			;
+	}
+}
+
+static void *	prefetch_thread(void* arg)
+{
+	prefetch_t *pf = arg;
+
+	ring r;
+	memset(&r, 0, sizeof(r));
+	if (pf->engine == PREFETCH_URING && ring_init(&r))
+	{
+		uring_run(pf, &r);
+		ring_free(&r);
+	}
+	else
+	{
+		if (pf->engine == PREFETCH_URING)
+			report(VERB, "io_uring is not available (%s), prefetching with pread()", strerror(errno));
+
+		pread_run(pf);
+	}
+
+	return NULL;
+}
+
+/**
+ * Starts prefetching the given files in that order with the given engine. The files are expected
+ * to be parsed in the same order, each after prefetch_wait() for it. Returns NULL if the engine
+ * does not prefetch (PREFETCH_MMAP); the other functions accept that.
+ */
+extern prefetch_t *	prefetch_start(prefetch_engine_t engine, const char** paths, size_t n)
+{
+	if (engine == PREFETCH_MMAP || n == 0)
+		return NULL;
+
+	prefetch_t *pf = calloc(1, sizeof(prefetch_t));
+	if (!pf)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	pf->engine = engine;
+	pf->paths = paths;
+	pf->n = n;
+	pf->jobs = calloc(n, sizeof(job));
+	pf->ready = calloc(n, sizeof(bool));
+	pf->scratch = malloc(CHUNK);
+	if (!pf->jobs || !pf->ready || !pf->scratch)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		pf->jobs[i].fd = -1;
+	}
+
+	pthread_mutex_init(&pf->lock, NULL);
+	pthread_cond_init(&pf->cond, NULL);
+
+	const int rc = pthread_create(&pf->thread, NULL, prefetch_thread, pf);
+	if (rc != 0)
+	{
+		errno = rc;
+		fatal_err("Cannot start prefetching thread");
+	}
+
+	return pf;
+}
+
+/**
+ * Waits until file i (see prefetch_start()) is prefetched. That also lets the prefetching
+ * proceed with the files further down the list.
+ */
+extern void	prefetch_wait(prefetch_t* pf, size_t i)
+{
+	if (!pf)
+		return;
+
+	assert(i < pf->n);
+
+	pthread_mutex_lock(&pf->lock);
+	pf->consumer = i;
+	pthread_cond_broadcast(&pf->cond);
+	while (!pf->ready[i])
+	{
+		pthread_cond_wait(&pf->cond, &pf->lock);
+	}
+	pthread_mutex_unlock(&pf->lock);
+}
+
+/**
+ * Stops prefetching and releases the resources.
+ */
+extern void	prefetch_stop(prefetch_t* pf)
+{
+	if (!pf)
+		return;
+
+	pthread_mutex_lock(&pf->lock);
+	pf->stop = true;
+	pthread_cond_broadcast(&pf->cond);
+	pthread_mutex_unlock(&pf->lock);
+
+	pthread_join(pf->thread, NULL);
+
+	for (size_t i = 0; i < pf->n; ++i)
+	{
+		job *j = &pf->jobs[i];
+		if (j->fd != -1)
+			close(j->fd);
+		free(j->shdrs);
+		free(j->ranges);
+	}
+
+	pthread_cond_destroy(&pf->cond);
+	pthread_mutex_destroy(&pf->lock);
+	free(pf->scratch);
+	free(pf->ready);
+	free(pf->jobs);
+	free(pf);
+}
@@ -0,0 +1,51 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef PREFETCH_H_
+#define PREFETCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct prefetch_s	prefetch_t;
+
+/**
+ * How the input files are brought into memory.
+ */
+typedef enum prefetch_engine
+{
+	PREFETCH_MMAP,		// on demand, by page faults on the mapping
+	PREFETCH_PREAD,		// ahead of parsing, by a thread issuing pread(2) one at a time
+	PREFETCH_URING		// ahead of parsing, by io_uring with many reads in flight
+} prefetch_engine_t;
+
+bool		prefetch_parse_engine(const char* name, prefetch_engine_t* engine);
+prefetch_t *	prefetch_start(prefetch_engine_t engine, const char** paths, size_t n);
+void		prefetch_wait(prefetch_t* pf, size_t i);
+void		prefetch_stop(prefetch_t* pf);
+
+#endif
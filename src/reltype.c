@@ -0,0 +1,781 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+
+// Relocation types of the machines we know, by the number, with their names and
+// what they make of the symbol referred to (see reltype_kind_t).
+//
+// The tables are looked up once per file (reltype_table()), so deciding the kind
+// of a relocation is an array access (reltype_kind()), cheap enough to be done
+// for every record before anything else is done with it. Types are numbered
+// explicitly rather than with the <elf.h> macros as older headers lack some of
+// them; their names are those of the macros all the same.
+//
+// Branches other than calls (jumps, conditional and tail calls) count as calls:
+// either is an edge of the call graph. References to the GOT and the TOC, as well
+// as GOT-relative ones, are GOT references unless they are for thread-local
+// variables, which are all TLS ones whatever the access model.
+
+#include "reltype.h"
+
+#include <assert.h>
+#include <elf.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Relocation types of x86-64.
+ */
+static const reltype_t	x86_64_types[] =
+{
+	[   0] = { "R_X86_64_NONE", RELTYPE_OTHER },
+	[   1] = { "R_X86_64_64", RELTYPE_DATA },
+	[   2] = { "R_X86_64_PC32", RELTYPE_DATA },
+	[   3] = { "R_X86_64_GOT32", RELTYPE_GOT },
+	[   4] = { "R_X86_64_PLT32", RELTYPE_CALL },
+	[   5] = { "R_X86_64_COPY", RELTYPE_OTHER },
+	[   6] = { "R_X86_64_GLOB_DAT", RELTYPE_GOT },
+	[   7] = { "R_X86_64_JUMP_SLOT", RELTYPE_CALL },
+	[   8] = { "R_X86_64_RELATIVE", RELTYPE_DATA },
+	[   9] = { "R_X86_64_GOTPCREL", RELTYPE_GOT },
+	[  10] = { "R_X86_64_32", RELTYPE_DATA },
+	[  11] = { "R_X86_64_32S", RELTYPE_DATA },
+	[  12] = { "R_X86_64_16", RELTYPE_DATA },
+	[  13] = { "R_X86_64_PC16", RELTYPE_DATA },
+	[  14] = { "R_X86_64_8", RELTYPE_DATA },
+	[  15] = { "R_X86_64_PC8", RELTYPE_DATA },
+	[  16] = { "R_X86_64_DTPMOD64", RELTYPE_TLS },
+	[  17] = { "R_X86_64_DTPOFF64", RELTYPE_TLS },
+	[  18] = { "R_X86_64_TPOFF64", RELTYPE_TLS },
+	[  19] = { "R_X86_64_TLSGD", RELTYPE_TLS },
+	[  20] = { "R_X86_64_TLSLD", RELTYPE_TLS },
+	[  21] = { "R_X86_64_DTPOFF32", RELTYPE_TLS },
+	[  22] = { "R_X86_64_GOTTPOFF", RELTYPE_TLS },
+	[  23] = { "R_X86_64_TPOFF32", RELTYPE_TLS },
+	[  24] = { "R_X86_64_PC64", RELTYPE_DATA },
+	[  25] = { "R_X86_64_GOTOFF64", RELTYPE_GOT },
+	[  26] = { "R_X86_64_GOTPC32", RELTYPE_GOT },
+	[  27] = { "R_X86_64_GOT64", RELTYPE_GOT },
+	[  28] = { "R_X86_64_GOTPCREL64", RELTYPE_GOT },
+	[  29] = { "R_X86_64_GOTPC64", RELTYPE_GOT },
+	[  30] = { "R_X86_64_GOTPLT64", RELTYPE_GOT },
+	[  31] = { "R_X86_64_PLTOFF64", RELTYPE_CALL },
+	[  32] = { "R_X86_64_SIZE32", RELTYPE_OTHER },
+	[  33] = { "R_X86_64_SIZE64", RELTYPE_OTHER },
+	[  34] = { "R_X86_64_GOTPC32_TLSDESC", RELTYPE_TLS },
+	[  35] = { "R_X86_64_TLSDESC_CALL", RELTYPE_TLS },
+	[  36] = { "R_X86_64_TLSDESC", RELTYPE_TLS },
+	[  37] = { "R_X86_64_IRELATIVE", RELTYPE_OTHER },
+	[  38] = { "R_X86_64_RELATIVE64", RELTYPE_DATA },
+	[  41] = { "R_X86_64_GOTPCRELX", RELTYPE_GOT },
+	[  42] = { "R_X86_64_REX_GOTPCRELX", RELTYPE_GOT },
+	[  43] = { "R_X86_64_CODE_4_GOTPCRELX", RELTYPE_GOT },
+	[  44] = { "R_X86_64_CODE_4_GOTTPOFF", RELTYPE_TLS },
+	[  45] = { "R_X86_64_CODE_4_GOTPC32_TLSDESC", RELTYPE_TLS },
+};
+
+/**
+ * Relocation types of i386.
+ */
+static const reltype_t	i386_types[] =
+{
+	[   0] = { "R_386_NONE", RELTYPE_OTHER },
+	[   1] = { "R_386_32", RELTYPE_DATA },
+	[   2] = { "R_386_PC32", RELTYPE_CALL },
+	[   3] = { "R_386_GOT32", RELTYPE_GOT },
+	[   4] = { "R_386_PLT32", RELTYPE_CALL },
+	[   5] = { "R_386_COPY", RELTYPE_OTHER },
+	[   6] = { "R_386_GLOB_DAT", RELTYPE_GOT },
+	[   7] = { "R_386_JMP_SLOT", RELTYPE_CALL },
+	[   8] = { "R_386_RELATIVE", RELTYPE_DATA },
+	[   9] = { "R_386_GOTOFF", RELTYPE_GOT },
+	[  10] = { "R_386_GOTPC", RELTYPE_GOT },
+	[  11] = { "R_386_32PLT", RELTYPE_CALL },
+	[  14] = { "R_386_TLS_TPOFF", RELTYPE_TLS },
+	[  15] = { "R_386_TLS_IE", RELTYPE_TLS },
+	[  16] = { "R_386_TLS_GOTIE", RELTYPE_TLS },
+	[  17] = { "R_386_TLS_LE", RELTYPE_TLS },
+	[  18] = { "R_386_TLS_GD", RELTYPE_TLS },
+	[  19] = { "R_386_TLS_LDM", RELTYPE_TLS },
+	[  20] = { "R_386_16", RELTYPE_DATA },
+	[  21] = { "R_386_PC16", RELTYPE_DATA },
+	[  22] = { "R_386_8", RELTYPE_DATA },
+	[  23] = { "R_386_PC8", RELTYPE_DATA },
+	[  24] = { "R_386_TLS_GD_32", RELTYPE_TLS },
+	[  25] = { "R_386_TLS_GD_PUSH", RELTYPE_TLS },
+	[  26] = { "R_386_TLS_GD_CALL", RELTYPE_TLS },
+	[  27] = { "R_386_TLS_GD_POP", RELTYPE_TLS },
+	[  28] = { "R_386_TLS_LDM_32", RELTYPE_TLS },
+	[  29] = { "R_386_TLS_LDM_PUSH", RELTYPE_TLS },
+	[  30] = { "R_386_TLS_LDM_CALL", RELTYPE_TLS },
+	[  31] = { "R_386_TLS_LDM_POP", RELTYPE_TLS },
+	[  32] = { "R_386_TLS_LDO_32", RELTYPE_TLS },
+	[  33] = { "R_386_TLS_IE_32", RELTYPE_TLS },
+	[  34] = { "R_386_TLS_LE_32", RELTYPE_TLS },
+	[  35] = { "R_386_TLS_DTPMOD32", RELTYPE_TLS },
+	[  36] = { "R_386_TLS_DTPOFF32", RELTYPE_TLS },
+	[  37] = { "R_386_TLS_TPOFF32", RELTYPE_TLS },
+	[  38] = { "R_386_SIZE32", RELTYPE_OTHER },
+	[  39] = { "R_386_TLS_GOTDESC", RELTYPE_TLS },
+	[  40] = { "R_386_TLS_DESC_CALL", RELTYPE_TLS },
+	[  41] = { "R_386_TLS_DESC", RELTYPE_TLS },
+	[  42] = { "R_386_IRELATIVE", RELTYPE_OTHER },
+	[  43] = { "R_386_GOT32X", RELTYPE_GOT },
+};
+
+/**
+ * Relocation types of AArch64 (including the ILP32 ones).
+ */
+static const reltype_t	aarch64_types[] =
+{
+	[   0] = { "R_AARCH64_NONE", RELTYPE_OTHER },
+	[   1] = { "R_AARCH64_P32_ABS32", RELTYPE_DATA },
+	[ 180] = { "R_AARCH64_P32_COPY", RELTYPE_OTHER },
+	[ 181] = { "R_AARCH64_P32_GLOB_DAT", RELTYPE_GOT },
+	[ 182] = { "R_AARCH64_P32_JUMP_SLOT", RELTYPE_CALL },
+	[ 183] = { "R_AARCH64_P32_RELATIVE", RELTYPE_DATA },
+	[ 184] = { "R_AARCH64_P32_TLS_DTPMOD", RELTYPE_TLS },
+	[ 185] = { "R_AARCH64_P32_TLS_DTPREL", RELTYPE_TLS },
+	[ 186] = { "R_AARCH64_P32_TLS_TPREL", RELTYPE_TLS },
+	[ 187] = { "R_AARCH64_P32_TLSDESC", RELTYPE_TLS },
+	[ 188] = { "R_AARCH64_P32_IRELATIVE", RELTYPE_OTHER },
+	[ 257] = { "R_AARCH64_ABS64", RELTYPE_DATA },
+	[ 258] = { "R_AARCH64_ABS32", RELTYPE_DATA },
+	[ 259] = { "R_AARCH64_ABS16", RELTYPE_DATA },
+	[ 260] = { "R_AARCH64_PREL64", RELTYPE_DATA },
+	[ 261] = { "R_AARCH64_PREL32", RELTYPE_DATA },
+	[ 262] = { "R_AARCH64_PREL16", RELTYPE_DATA },
+	[ 263] = { "R_AARCH64_MOVW_UABS_G0", RELTYPE_DATA },
+	[ 264] = { "R_AARCH64_MOVW_UABS_G0_NC", RELTYPE_DATA },
+	[ 265] = { "R_AARCH64_MOVW_UABS_G1", RELTYPE_DATA },
+	[ 266] = { "R_AARCH64_MOVW_UABS_G1_NC", RELTYPE_DATA },
+	[ 267] = { "R_AARCH64_MOVW_UABS_G2", RELTYPE_DATA },
+	[ 268] = { "R_AARCH64_MOVW_UABS_G2_NC", RELTYPE_DATA },
+	[ 269] = { "R_AARCH64_MOVW_UABS_G3", RELTYPE_DATA },
+	[ 270] = { "R_AARCH64_MOVW_SABS_G0", RELTYPE_DATA },
+	[ 271] = { "R_AARCH64_MOVW_SABS_G1", RELTYPE_DATA },
+	[ 272] = { "R_AARCH64_MOVW_SABS_G2", RELTYPE_DATA },
+	[ 273] = { "R_AARCH64_LD_PREL_LO19", RELTYPE_DATA },
+	[ 274] = { "R_AARCH64_ADR_PREL_LO21", RELTYPE_DATA },
+	[ 275] = { "R_AARCH64_ADR_PREL_PG_HI21", RELTYPE_DATA },
+	[ 276] = { "R_AARCH64_ADR_PREL_PG_HI21_NC", RELTYPE_DATA },
+	[ 277] = { "R_AARCH64_ADD_ABS_LO12_NC", RELTYPE_DATA },
+	[ 278] = { "R_AARCH64_LDST8_ABS_LO12_NC", RELTYPE_DATA },
+	[ 279] = { "R_AARCH64_TSTBR14", RELTYPE_CALL },
+	[ 280] = { "R_AARCH64_CONDBR19", RELTYPE_CALL },
+	[ 282] = { "R_AARCH64_JUMP26", RELTYPE_CALL },
+	[ 283] = { "R_AARCH64_CALL26", RELTYPE_CALL },
+	[ 284] = { "R_AARCH64_LDST16_ABS_LO12_NC", RELTYPE_DATA },
+	[ 285] = { "R_AARCH64_LDST32_ABS_LO12_NC", RELTYPE_DATA },
+	[ 286] = { "R_AARCH64_LDST64_ABS_LO12_NC", RELTYPE_DATA },
+	[ 287] = { "R_AARCH64_MOVW_PREL_G0", RELTYPE_DATA },
+	[ 288] = { "R_AARCH64_MOVW_PREL_G0_NC", RELTYPE_DATA },
+	[ 289] = { "R_AARCH64_MOVW_PREL_G1", RELTYPE_DATA },
+	[ 290] = { "R_AARCH64_MOVW_PREL_G1_NC", RELTYPE_DATA },
+	[ 291] = { "R_AARCH64_MOVW_PREL_G2", RELTYPE_DATA },
+	[ 292] = { "R_AARCH64_MOVW_PREL_G2_NC", RELTYPE_DATA },
+	[ 293] = { "R_AARCH64_MOVW_PREL_G3", RELTYPE_DATA },
+	[ 299] = { "R_AARCH64_LDST128_ABS_LO12_NC", RELTYPE_DATA },
+	[ 300] = { "R_AARCH64_MOVW_GOTOFF_G0", RELTYPE_GOT },
+	[ 301] = { "R_AARCH64_MOVW_GOTOFF_G0_NC", RELTYPE_GOT },
+	[ 302] = { "R_AARCH64_MOVW_GOTOFF_G1", RELTYPE_GOT },
+	[ 303] = { "R_AARCH64_MOVW_GOTOFF_G1_NC", RELTYPE_GOT },
+	[ 304] = { "R_AARCH64_MOVW_GOTOFF_G2", RELTYPE_GOT },
+	[ 305] = { "R_AARCH64_MOVW_GOTOFF_G2_NC", RELTYPE_GOT },
+	[ 306] = { "R_AARCH64_MOVW_GOTOFF_G3", RELTYPE_GOT },
+	[ 307] = { "R_AARCH64_GOTREL64", RELTYPE_GOT },
+	[ 308] = { "R_AARCH64_GOTREL32", RELTYPE_GOT },
+	[ 309] = { "R_AARCH64_GOT_LD_PREL19", RELTYPE_GOT },
+	[ 310] = { "R_AARCH64_LD64_GOTOFF_LO15", RELTYPE_GOT },
+	[ 311] = { "R_AARCH64_ADR_GOT_PAGE", RELTYPE_GOT },
+	[ 312] = { "R_AARCH64_LD64_GOT_LO12_NC", RELTYPE_GOT },
+	[ 313] = { "R_AARCH64_LD64_GOTPAGE_LO15", RELTYPE_GOT },
+	[ 314] = { "R_AARCH64_PLT32", RELTYPE_CALL },
+	[ 315] = { "R_AARCH64_GOTPCREL32", RELTYPE_GOT },
+	[ 512] = { "R_AARCH64_TLSGD_ADR_PREL21", RELTYPE_TLS },
+	[ 513] = { "R_AARCH64_TLSGD_ADR_PAGE21", RELTYPE_TLS },
+	[ 514] = { "R_AARCH64_TLSGD_ADD_LO12_NC", RELTYPE_TLS },
+	[ 515] = { "R_AARCH64_TLSGD_MOVW_G1", RELTYPE_TLS },
+	[ 516] = { "R_AARCH64_TLSGD_MOVW_G0_NC", RELTYPE_TLS },
+	[ 517] = { "R_AARCH64_TLSLD_ADR_PREL21", RELTYPE_TLS },
+	[ 518] = { "R_AARCH64_TLSLD_ADR_PAGE21", RELTYPE_TLS },
+	[ 519] = { "R_AARCH64_TLSLD_ADD_LO12_NC", RELTYPE_TLS },
+	[ 520] = { "R_AARCH64_TLSLD_MOVW_G1", RELTYPE_TLS },
+	[ 521] = { "R_AARCH64_TLSLD_MOVW_G0_NC", RELTYPE_TLS },
+	[ 522] = { "R_AARCH64_TLSLD_LD_PREL19", RELTYPE_TLS },
+	[ 523] = { "R_AARCH64_TLSLD_MOVW_DTPREL_G2", RELTYPE_TLS },
+	[ 524] = { "R_AARCH64_TLSLD_MOVW_DTPREL_G1", RELTYPE_TLS },
+	[ 525] = { "R_AARCH64_TLSLD_MOVW_DTPREL_G1_NC", RELTYPE_TLS },
+	[ 526] = { "R_AARCH64_TLSLD_MOVW_DTPREL_G0", RELTYPE_TLS },
+	[ 527] = { "R_AARCH64_TLSLD_MOVW_DTPREL_G0_NC", RELTYPE_TLS },
+	[ 528] = { "R_AARCH64_TLSLD_ADD_DTPREL_HI12", RELTYPE_TLS },
+	[ 529] = { "R_AARCH64_TLSLD_ADD_DTPREL_LO12", RELTYPE_TLS },
+	[ 530] = { "R_AARCH64_TLSLD_ADD_DTPREL_LO12_NC", RELTYPE_TLS },
+	[ 531] = { "R_AARCH64_TLSLD_LDST8_DTPREL_LO12", RELTYPE_TLS },
+	[ 532] = { "R_AARCH64_TLSLD_LDST8_DTPREL_LO12_NC", RELTYPE_TLS },
+	[ 533] = { "R_AARCH64_TLSLD_LDST16_DTPREL_LO12", RELTYPE_TLS },
+	[ 534] = { "R_AARCH64_TLSLD_LDST16_DTPREL_LO12_NC", RELTYPE_TLS },
+	[ 535] = { "R_AARCH64_TLSLD_LDST32_DTPREL_LO12", RELTYPE_TLS },
+	[ 536] = { "R_AARCH64_TLSLD_LDST32_DTPREL_LO12_NC", RELTYPE_TLS },
+	[ 537] = { "R_AARCH64_TLSLD_LDST64_DTPREL_LO12", RELTYPE_TLS },
+	[ 538] = { "R_AARCH64_TLSLD_LDST64_DTPREL_LO12_NC", RELTYPE_TLS },
+	[ 539] = { "R_AARCH64_TLSIE_MOVW_GOTTPREL_G1", RELTYPE_TLS },
+	[ 540] = { "R_AARCH64_TLSIE_MOVW_GOTTPREL_G0_NC", RELTYPE_TLS },
+	[ 541] = { "R_AARCH64_TLSIE_ADR_GOTTPREL_PAGE21", RELTYPE_TLS },
+	[ 542] = { "R_AARCH64_TLSIE_LD64_GOTTPREL_LO12_NC", RELTYPE_TLS },
+	[ 543] = { "R_AARCH64_TLSIE_LD_GOTTPREL_PREL19", RELTYPE_TLS },
+	[ 544] = { "R_AARCH64_TLSLE_MOVW_TPREL_G2", RELTYPE_TLS },
+	[ 545] = { "R_AARCH64_TLSLE_MOVW_TPREL_G1", RELTYPE_TLS },
+	[ 546] = { "R_AARCH64_TLSLE_MOVW_TPREL_G1_NC", RELTYPE_TLS },
+	[ 547] = { "R_AARCH64_TLSLE_MOVW_TPREL_G0", RELTYPE_TLS },
+	[ 548] = { "R_AARCH64_TLSLE_MOVW_TPREL_G0_NC", RELTYPE_TLS },
+	[ 549] = { "R_AARCH64_TLSLE_ADD_TPREL_HI12", RELTYPE_TLS },
+	[ 550] = { "R_AARCH64_TLSLE_ADD_TPREL_LO12", RELTYPE_TLS },
+	[ 551] = { "R_AARCH64_TLSLE_ADD_TPREL_LO12_NC", RELTYPE_TLS },
+	[ 552] = { "R_AARCH64_TLSLE_LDST8_TPREL_LO12", RELTYPE_TLS },
+	[ 553] = { "R_AARCH64_TLSLE_LDST8_TPREL_LO12_NC", RELTYPE_TLS },
+	[ 554] = { "R_AARCH64_TLSLE_LDST16_TPREL_LO12", RELTYPE_TLS },
+	[ 555] = { "R_AARCH64_TLSLE_LDST16_TPREL_LO12_NC", RELTYPE_TLS },
+	[ 556] = { "R_AARCH64_TLSLE_LDST32_TPREL_LO12", RELTYPE_TLS },
+	[ 557] = { "R_AARCH64_TLSLE_LDST32_TPREL_LO12_NC", RELTYPE_TLS },
+	[ 558] = { "R_AARCH64_TLSLE_LDST64_TPREL_LO12", RELTYPE_TLS },
+	[ 559] = { "R_AARCH64_TLSLE_LDST64_TPREL_LO12_NC", RELTYPE_TLS },
+	[ 560] = { "R_AARCH64_TLSDESC_LD_PREL19", RELTYPE_TLS },
+	[ 561] = { "R_AARCH64_TLSDESC_ADR_PREL21", RELTYPE_TLS },
+	[ 562] = { "R_AARCH64_TLSDESC_ADR_PAGE21", RELTYPE_TLS },
+	[ 563] = { "R_AARCH64_TLSDESC_LD64_LO12", RELTYPE_TLS },
+	[ 564] = { "R_AARCH64_TLSDESC_ADD_LO12", RELTYPE_TLS },
+	[ 565] = { "R_AARCH64_TLSDESC_OFF_G1", RELTYPE_TLS },
+	[ 566] = { "R_AARCH64_TLSDESC_OFF_G0_NC", RELTYPE_TLS },
+	[ 567] = { "R_AARCH64_TLSDESC_LDR", RELTYPE_TLS },
+	[ 568] = { "R_AARCH64_TLSDESC_ADD", RELTYPE_TLS },
+	[ 569] = { "R_AARCH64_TLSDESC_CALL", RELTYPE_TLS },
+	[ 570] = { "R_AARCH64_TLSLE_LDST128_TPREL_LO12", RELTYPE_TLS },
+	[ 571] = { "R_AARCH64_TLSLE_LDST128_TPREL_LO12_NC", RELTYPE_TLS },
+	[ 572] = { "R_AARCH64_TLSLD_LDST128_DTPREL_LO12", RELTYPE_TLS },
+	[ 573] = { "R_AARCH64_TLSLD_LDST128_DTPREL_LO12_NC", RELTYPE_TLS },
+	[1024] = { "R_AARCH64_COPY", RELTYPE_OTHER },
+	[1025] = { "R_AARCH64_GLOB_DAT", RELTYPE_GOT },
+	[1026] = { "R_AARCH64_JUMP_SLOT", RELTYPE_CALL },
+	[1027] = { "R_AARCH64_RELATIVE", RELTYPE_DATA },
+	[1028] = { "R_AARCH64_TLS_DTPMOD", RELTYPE_TLS },
+	[1029] = { "R_AARCH64_TLS_DTPREL", RELTYPE_TLS },
+	[1030] = { "R_AARCH64_TLS_TPREL", RELTYPE_TLS },
+	[1031] = { "R_AARCH64_TLSDESC", RELTYPE_TLS },
+	[1032] = { "R_AARCH64_IRELATIVE", RELTYPE_OTHER },
+};
+
+/**
+ * Relocation types of 32-bit ARM.
+ */
+static const reltype_t	arm_types[] =
+{
+	[   0] = { "R_ARM_NONE", RELTYPE_OTHER },
+	[   1] = { "R_ARM_PC24", RELTYPE_CALL },
+	[   2] = { "R_ARM_ABS32", RELTYPE_DATA },
+	[   3] = { "R_ARM_REL32", RELTYPE_DATA },
+	[   4] = { "R_ARM_PC13", RELTYPE_DATA },
+	[   5] = { "R_ARM_ABS16", RELTYPE_DATA },
+	[   6] = { "R_ARM_ABS12", RELTYPE_DATA },
+	[   7] = { "R_ARM_THM_ABS5", RELTYPE_DATA },
+	[   8] = { "R_ARM_ABS8", RELTYPE_DATA },
+	[   9] = { "R_ARM_SBREL32", RELTYPE_DATA },
+	[  10] = { "R_ARM_THM_PC22", RELTYPE_CALL },
+	[  11] = { "R_ARM_THM_PC8", RELTYPE_CALL },
+	[  12] = { "R_ARM_AMP_VCALL9", RELTYPE_OTHER },
+	[  13] = { "R_ARM_TLS_DESC", RELTYPE_TLS },
+	[  14] = { "R_ARM_THM_SWI8", RELTYPE_OTHER },
+	[  15] = { "R_ARM_XPC25", RELTYPE_CALL },
+	[  16] = { "R_ARM_THM_XPC22", RELTYPE_CALL },
+	[  17] = { "R_ARM_TLS_DTPMOD32", RELTYPE_TLS },
+	[  18] = { "R_ARM_TLS_DTPOFF32", RELTYPE_TLS },
+	[  19] = { "R_ARM_TLS_TPOFF32", RELTYPE_TLS },
+	[  20] = { "R_ARM_COPY", RELTYPE_OTHER },
+	[  21] = { "R_ARM_GLOB_DAT", RELTYPE_GOT },
+	[  22] = { "R_ARM_JUMP_SLOT", RELTYPE_CALL },
+	[  23] = { "R_ARM_RELATIVE", RELTYPE_DATA },
+	[  24] = { "R_ARM_GOTOFF", RELTYPE_GOT },
+	[  25] = { "R_ARM_GOTPC", RELTYPE_GOT },
+	[  26] = { "R_ARM_GOT32", RELTYPE_GOT },
+	[  27] = { "R_ARM_PLT32", RELTYPE_CALL },
+	[  28] = { "R_ARM_CALL", RELTYPE_CALL },
+	[  29] = { "R_ARM_JUMP24", RELTYPE_CALL },
+	[  30] = { "R_ARM_THM_JUMP24", RELTYPE_CALL },
+	[  31] = { "R_ARM_BASE_ABS", RELTYPE_GOT },
+	[  32] = { "R_ARM_ALU_PCREL_7_0", RELTYPE_DATA },
+	[  33] = { "R_ARM_ALU_PCREL_15_8", RELTYPE_DATA },
+	[  34] = { "R_ARM_ALU_PCREL_23_15", RELTYPE_DATA },
+	[  35] = { "R_ARM_LDR_SBREL_11_0", RELTYPE_DATA },
+	[  36] = { "R_ARM_ALU_SBREL_19_12", RELTYPE_DATA },
+	[  37] = { "R_ARM_ALU_SBREL_27_20", RELTYPE_DATA },
+	[  38] = { "R_ARM_TARGET1", RELTYPE_DATA },
+	[  39] = { "R_ARM_SBREL31", RELTYPE_DATA },
+	[  40] = { "R_ARM_V4BX", RELTYPE_OTHER },
+	[  41] = { "R_ARM_TARGET2", RELTYPE_DATA },
+	[  42] = { "R_ARM_PREL31", RELTYPE_DATA },
+	[  43] = { "R_ARM_MOVW_ABS_NC", RELTYPE_DATA },
+	[  44] = { "R_ARM_MOVT_ABS", RELTYPE_DATA },
+	[  45] = { "R_ARM_MOVW_PREL_NC", RELTYPE_DATA },
+	[  46] = { "R_ARM_MOVT_PREL", RELTYPE_DATA },
+	[  47] = { "R_ARM_THM_MOVW_ABS_NC", RELTYPE_DATA },
+	[  48] = { "R_ARM_THM_MOVT_ABS", RELTYPE_DATA },
+	[  49] = { "R_ARM_THM_MOVW_PREL_NC", RELTYPE_DATA },
+	[  50] = { "R_ARM_THM_MOVT_PREL", RELTYPE_DATA },
+	[  51] = { "R_ARM_THM_JUMP19", RELTYPE_CALL },
+	[  52] = { "R_ARM_THM_JUMP6", RELTYPE_CALL },
+	[  53] = { "R_ARM_THM_ALU_PREL_11_0", RELTYPE_DATA },
+	[  54] = { "R_ARM_THM_PC12", RELTYPE_DATA },
+	[  55] = { "R_ARM_ABS32_NOI", RELTYPE_DATA },
+	[  56] = { "R_ARM_REL32_NOI", RELTYPE_DATA },
+	[  57] = { "R_ARM_ALU_PC_G0_NC", RELTYPE_DATA },
+	[  58] = { "R_ARM_ALU_PC_G0", RELTYPE_DATA },
+	[  59] = { "R_ARM_ALU_PC_G1_NC", RELTYPE_DATA },
+	[  60] = { "R_ARM_ALU_PC_G1", RELTYPE_DATA },
+	[  61] = { "R_ARM_ALU_PC_G2", RELTYPE_DATA },
+	[  62] = { "R_ARM_LDR_PC_G1", RELTYPE_DATA },
+	[  63] = { "R_ARM_LDR_PC_G2", RELTYPE_DATA },
+	[  64] = { "R_ARM_LDRS_PC_G0", RELTYPE_DATA },
+	[  65] = { "R_ARM_LDRS_PC_G1", RELTYPE_DATA },
+	[  66] = { "R_ARM_LDRS_PC_G2", RELTYPE_DATA },
+	[  67] = { "R_ARM_LDC_PC_G0", RELTYPE_DATA },
+	[  68] = { "R_ARM_LDC_PC_G1", RELTYPE_DATA },
+	[  69] = { "R_ARM_LDC_PC_G2", RELTYPE_DATA },
+	[  70] = { "R_ARM_ALU_SB_G0_NC", RELTYPE_DATA },
+	[  71] = { "R_ARM_ALU_SB_G0", RELTYPE_DATA },
+	[  72] = { "R_ARM_ALU_SB_G1_NC", RELTYPE_DATA },
+	[  73] = { "R_ARM_ALU_SB_G1", RELTYPE_DATA },
+	[  74] = { "R_ARM_ALU_SB_G2", RELTYPE_DATA },
+	[  75] = { "R_ARM_LDR_SB_G0", RELTYPE_DATA },
+	[  76] = { "R_ARM_LDR_SB_G1", RELTYPE_DATA },
+	[  77] = { "R_ARM_LDR_SB_G2", RELTYPE_DATA },
+	[  78] = { "R_ARM_LDRS_SB_G0", RELTYPE_DATA },
+	[  79] = { "R_ARM_LDRS_SB_G1", RELTYPE_DATA },
+	[  80] = { "R_ARM_LDRS_SB_G2", RELTYPE_DATA },
+	[  81] = { "R_ARM_LDC_SB_G0", RELTYPE_DATA },
+	[  82] = { "R_ARM_LDC_SB_G1", RELTYPE_DATA },
+	[  83] = { "R_ARM_LDC_SB_G2", RELTYPE_DATA },
+	[  84] = { "R_ARM_MOVW_BREL_NC", RELTYPE_DATA },
+	[  85] = { "R_ARM_MOVT_BREL", RELTYPE_DATA },
+	[  86] = { "R_ARM_MOVW_BREL", RELTYPE_DATA },
+	[  87] = { "R_ARM_THM_MOVW_BREL_NC", RELTYPE_DATA },
+	[  88] = { "R_ARM_THM_MOVT_BREL", RELTYPE_DATA },
+	[  89] = { "R_ARM_THM_MOVW_BREL", RELTYPE_DATA },
+	[  90] = { "R_ARM_TLS_GOTDESC", RELTYPE_TLS },
+	[  91] = { "R_ARM_TLS_CALL", RELTYPE_TLS },
+	[  92] = { "R_ARM_TLS_DESCSEQ", RELTYPE_TLS },
+	[  93] = { "R_ARM_THM_TLS_CALL", RELTYPE_TLS },
+	[  94] = { "R_ARM_PLT32_ABS", RELTYPE_CALL },
+	[  95] = { "R_ARM_GOT_ABS", RELTYPE_GOT },
+	[  96] = { "R_ARM_GOT_PREL", RELTYPE_GOT },
+	[  97] = { "R_ARM_GOT_BREL12", RELTYPE_GOT },
+	[  98] = { "R_ARM_GOTOFF12", RELTYPE_GOT },
+	[  99] = { "R_ARM_GOTRELAX", RELTYPE_GOT },
+	[ 100] = { "R_ARM_GNU_VTENTRY", RELTYPE_OTHER },
+	[ 101] = { "R_ARM_GNU_VTINHERIT", RELTYPE_OTHER },
+	[ 102] = { "R_ARM_THM_PC11", RELTYPE_CALL },
+	[ 103] = { "R_ARM_THM_PC9", RELTYPE_CALL },
+	[ 104] = { "R_ARM_TLS_GD32", RELTYPE_TLS },
+	[ 105] = { "R_ARM_TLS_LDM32", RELTYPE_TLS },
+	[ 106] = { "R_ARM_TLS_LDO32", RELTYPE_TLS },
+	[ 107] = { "R_ARM_TLS_IE32", RELTYPE_TLS },
+	[ 108] = { "R_ARM_TLS_LE32", RELTYPE_TLS },
+	[ 109] = { "R_ARM_TLS_LDO12", RELTYPE_TLS },
+	[ 110] = { "R_ARM_TLS_LE12", RELTYPE_TLS },
+	[ 111] = { "R_ARM_TLS_IE12GP", RELTYPE_TLS },
+	[ 128] = { "R_ARM_ME_TOO", RELTYPE_OTHER },
+	[ 129] = { "R_ARM_THM_TLS_DESCSEQ", RELTYPE_TLS },
+	[ 130] = { "R_ARM_THM_TLS_DESCSEQ32", RELTYPE_TLS },
+	[ 131] = { "R_ARM_THM_GOT_BREL12", RELTYPE_GOT },
+	[ 160] = { "R_ARM_IRELATIVE", RELTYPE_OTHER },
+	[ 249] = { "R_ARM_RXPC25", RELTYPE_OTHER },
+	[ 250] = { "R_ARM_RSBREL32", RELTYPE_OTHER },
+	[ 251] = { "R_ARM_THM_RPC22", RELTYPE_OTHER },
+	[ 252] = { "R_ARM_RREL32", RELTYPE_OTHER },
+	[ 253] = { "R_ARM_RABS22", RELTYPE_OTHER },
+	[ 254] = { "R_ARM_RPC24", RELTYPE_OTHER },
+	[ 255] = { "R_ARM_RBASE", RELTYPE_OTHER },
+};
+
+/**
+ * Relocation types of 64-bit PowerPC.
+ */
+static const reltype_t	ppc64_types[] =
+{
+	[   0] = { "R_PPC64_NONE", RELTYPE_OTHER },
+	[   1] = { "R_PPC64_ADDR32", RELTYPE_DATA },
+	[   2] = { "R_PPC64_ADDR24", RELTYPE_CALL },
+	[   3] = { "R_PPC64_ADDR16", RELTYPE_DATA },
+	[   4] = { "R_PPC64_ADDR16_LO", RELTYPE_DATA },
+	[   5] = { "R_PPC64_ADDR16_HI", RELTYPE_DATA },
+	[   6] = { "R_PPC64_ADDR16_HA", RELTYPE_DATA },
+	[   7] = { "R_PPC64_ADDR14", RELTYPE_CALL },
+	[   8] = { "R_PPC64_ADDR14_BRTAKEN", RELTYPE_CALL },
+	[   9] = { "R_PPC64_ADDR14_BRNTAKEN", RELTYPE_CALL },
+	[  10] = { "R_PPC64_REL24", RELTYPE_CALL },
+	[  11] = { "R_PPC64_REL14", RELTYPE_CALL },
+	[  12] = { "R_PPC64_REL14_BRTAKEN", RELTYPE_CALL },
+	[  13] = { "R_PPC64_REL14_BRNTAKEN", RELTYPE_CALL },
+	[  14] = { "R_PPC64_GOT16", RELTYPE_GOT },
+	[  15] = { "R_PPC64_GOT16_LO", RELTYPE_GOT },
+	[  16] = { "R_PPC64_GOT16_HI", RELTYPE_GOT },
+	[  17] = { "R_PPC64_GOT16_HA", RELTYPE_GOT },
+	[  19] = { "R_PPC64_COPY", RELTYPE_OTHER },
+	[  20] = { "R_PPC64_GLOB_DAT", RELTYPE_GOT },
+	[  21] = { "R_PPC64_JMP_SLOT", RELTYPE_CALL },
+	[  22] = { "R_PPC64_RELATIVE", RELTYPE_DATA },
+	[  24] = { "R_PPC64_UADDR32", RELTYPE_DATA },
+	[  25] = { "R_PPC64_UADDR16", RELTYPE_DATA },
+	[  26] = { "R_PPC64_REL32", RELTYPE_DATA },
+	[  27] = { "R_PPC64_PLT32", RELTYPE_CALL },
+	[  28] = { "R_PPC64_PLTREL32", RELTYPE_CALL },
+	[  29] = { "R_PPC64_PLT16_LO", RELTYPE_CALL },
+	[  30] = { "R_PPC64_PLT16_HI", RELTYPE_CALL },
+	[  31] = { "R_PPC64_PLT16_HA", RELTYPE_CALL },
+	[  33] = { "R_PPC64_SECTOFF", RELTYPE_DATA },
+	[  34] = { "R_PPC64_SECTOFF_LO", RELTYPE_DATA },
+	[  35] = { "R_PPC64_SECTOFF_HI", RELTYPE_DATA },
+	[  36] = { "R_PPC64_SECTOFF_HA", RELTYPE_DATA },
+	[  37] = { "R_PPC64_ADDR30", RELTYPE_DATA },
+	[  38] = { "R_PPC64_ADDR64", RELTYPE_DATA },
+	[  39] = { "R_PPC64_ADDR16_HIGHER", RELTYPE_DATA },
+	[  40] = { "R_PPC64_ADDR16_HIGHERA", RELTYPE_DATA },
+	[  41] = { "R_PPC64_ADDR16_HIGHEST", RELTYPE_DATA },
+	[  42] = { "R_PPC64_ADDR16_HIGHESTA", RELTYPE_DATA },
+	[  43] = { "R_PPC64_UADDR64", RELTYPE_DATA },
+	[  44] = { "R_PPC64_REL64", RELTYPE_DATA },
+	[  45] = { "R_PPC64_PLT64", RELTYPE_CALL },
+	[  46] = { "R_PPC64_PLTREL64", RELTYPE_CALL },
+	[  47] = { "R_PPC64_TOC16", RELTYPE_DATA },
+	[  48] = { "R_PPC64_TOC16_LO", RELTYPE_DATA },
+	[  49] = { "R_PPC64_TOC16_HI", RELTYPE_DATA },
+	[  50] = { "R_PPC64_TOC16_HA", RELTYPE_DATA },
+	[  51] = { "R_PPC64_TOC", RELTYPE_GOT },
+	[  52] = { "R_PPC64_PLTGOT16", RELTYPE_GOT },
+	[  53] = { "R_PPC64_PLTGOT16_LO", RELTYPE_GOT },
+	[  54] = { "R_PPC64_PLTGOT16_HI", RELTYPE_GOT },
+	[  55] = { "R_PPC64_PLTGOT16_HA", RELTYPE_GOT },
+	[  56] = { "R_PPC64_ADDR16_DS", RELTYPE_DATA },
+	[  57] = { "R_PPC64_ADDR16_LO_DS", RELTYPE_DATA },
+	[  58] = { "R_PPC64_GOT16_DS", RELTYPE_GOT },
+	[  59] = { "R_PPC64_GOT16_LO_DS", RELTYPE_GOT },
+	[  60] = { "R_PPC64_PLT16_LO_DS", RELTYPE_CALL },
+	[  61] = { "R_PPC64_SECTOFF_DS", RELTYPE_DATA },
+	[  62] = { "R_PPC64_SECTOFF_LO_DS", RELTYPE_DATA },
+	[  63] = { "R_PPC64_TOC16_DS", RELTYPE_DATA },
+	[  64] = { "R_PPC64_TOC16_LO_DS", RELTYPE_DATA },
+	[  65] = { "R_PPC64_PLTGOT16_DS", RELTYPE_GOT },
+	[  66] = { "R_PPC64_PLTGOT16_LO_DS", RELTYPE_GOT },
+	[  67] = { "R_PPC64_TLS", RELTYPE_TLS },
+	[  68] = { "R_PPC64_DTPMOD64", RELTYPE_TLS },
+	[  69] = { "R_PPC64_TPREL16", RELTYPE_TLS },
+	[  70] = { "R_PPC64_TPREL16_LO", RELTYPE_TLS },
+	[  71] = { "R_PPC64_TPREL16_HI", RELTYPE_TLS },
+	[  72] = { "R_PPC64_TPREL16_HA", RELTYPE_TLS },
+	[  73] = { "R_PPC64_TPREL64", RELTYPE_TLS },
+	[  74] = { "R_PPC64_DTPREL16", RELTYPE_TLS },
+	[  75] = { "R_PPC64_DTPREL16_LO", RELTYPE_TLS },
+	[  76] = { "R_PPC64_DTPREL16_HI", RELTYPE_TLS },
+	[  77] = { "R_PPC64_DTPREL16_HA", RELTYPE_TLS },
+	[  78] = { "R_PPC64_DTPREL64", RELTYPE_TLS },
+	[  79] = { "R_PPC64_GOT_TLSGD16", RELTYPE_TLS },
+	[  80] = { "R_PPC64_GOT_TLSGD16_LO", RELTYPE_TLS },
+	[  81] = { "R_PPC64_GOT_TLSGD16_HI", RELTYPE_TLS },
+	[  82] = { "R_PPC64_GOT_TLSGD16_HA", RELTYPE_TLS },
+	[  83] = { "R_PPC64_GOT_TLSLD16", RELTYPE_TLS },
+	[  84] = { "R_PPC64_GOT_TLSLD16_LO", RELTYPE_TLS },
+	[  85] = { "R_PPC64_GOT_TLSLD16_HI", RELTYPE_TLS },
+	[  86] = { "R_PPC64_GOT_TLSLD16_HA", RELTYPE_TLS },
+	[  87] = { "R_PPC64_GOT_TPREL16_DS", RELTYPE_TLS },
+	[  88] = { "R_PPC64_GOT_TPREL16_LO_DS", RELTYPE_TLS },
+	[  89] = { "R_PPC64_GOT_TPREL16_HI", RELTYPE_TLS },
+	[  90] = { "R_PPC64_GOT_TPREL16_HA", RELTYPE_TLS },
+	[  91] = { "R_PPC64_GOT_DTPREL16_DS", RELTYPE_TLS },
+	[  92] = { "R_PPC64_GOT_DTPREL16_LO_DS", RELTYPE_TLS },
+	[  93] = { "R_PPC64_GOT_DTPREL16_HI", RELTYPE_TLS },
+	[  94] = { "R_PPC64_GOT_DTPREL16_HA", RELTYPE_TLS },
+	[  95] = { "R_PPC64_TPREL16_DS", RELTYPE_TLS },
+	[  96] = { "R_PPC64_TPREL16_LO_DS", RELTYPE_TLS },
+	[  97] = { "R_PPC64_TPREL16_HIGHER", RELTYPE_TLS },
+	[  98] = { "R_PPC64_TPREL16_HIGHERA", RELTYPE_TLS },
+	[  99] = { "R_PPC64_TPREL16_HIGHEST", RELTYPE_TLS },
+	[ 100] = { "R_PPC64_TPREL16_HIGHESTA", RELTYPE_TLS },
+	[ 101] = { "R_PPC64_DTPREL16_DS", RELTYPE_TLS },
+	[ 102] = { "R_PPC64_DTPREL16_LO_DS", RELTYPE_TLS },
+	[ 103] = { "R_PPC64_DTPREL16_HIGHER", RELTYPE_TLS },
+	[ 104] = { "R_PPC64_DTPREL16_HIGHERA", RELTYPE_TLS },
+	[ 105] = { "R_PPC64_DTPREL16_HIGHEST", RELTYPE_TLS },
+	[ 106] = { "R_PPC64_DTPREL16_HIGHESTA", RELTYPE_TLS },
+	[ 107] = { "R_PPC64_TLSGD", RELTYPE_TLS },
+	[ 108] = { "R_PPC64_TLSLD", RELTYPE_TLS },
+	[ 109] = { "R_PPC64_TOCSAVE", RELTYPE_OTHER },
+	[ 110] = { "R_PPC64_ADDR16_HIGH", RELTYPE_DATA },
+	[ 111] = { "R_PPC64_ADDR16_HIGHA", RELTYPE_DATA },
+	[ 112] = { "R_PPC64_TPREL16_HIGH", RELTYPE_TLS },
+	[ 113] = { "R_PPC64_TPREL16_HIGHA", RELTYPE_TLS },
+	[ 114] = { "R_PPC64_DTPREL16_HIGH", RELTYPE_TLS },
+	[ 115] = { "R_PPC64_DTPREL16_HIGHA", RELTYPE_TLS },
+	[ 116] = { "R_PPC64_REL24_NOTOC", RELTYPE_CALL },
+	[ 117] = { "R_PPC64_ADDR64_LOCAL", RELTYPE_DATA },
+	[ 118] = { "R_PPC64_ENTRY", RELTYPE_OTHER },
+	[ 119] = { "R_PPC64_PLTSEQ", RELTYPE_CALL },
+	[ 120] = { "R_PPC64_PLTCALL", RELTYPE_CALL },
+	[ 132] = { "R_PPC64_PCREL34", RELTYPE_DATA },
+	[ 133] = { "R_PPC64_GOT_PCREL34", RELTYPE_GOT },
+	[ 134] = { "R_PPC64_PLT_PCREL34", RELTYPE_CALL },
+	[ 135] = { "R_PPC64_PLT_PCREL34_NOTOC", RELTYPE_CALL },
+	[ 247] = { "R_PPC64_JMP_IREL", RELTYPE_OTHER },
+	[ 248] = { "R_PPC64_IRELATIVE", RELTYPE_OTHER },
+	[ 249] = { "R_PPC64_REL16", RELTYPE_DATA },
+	[ 250] = { "R_PPC64_REL16_LO", RELTYPE_DATA },
+	[ 251] = { "R_PPC64_REL16_HI", RELTYPE_DATA },
+	[ 252] = { "R_PPC64_REL16_HA", RELTYPE_DATA },
+};
+
+/**
+ * Relocation types of s390 and s390x.
+ */
+static const reltype_t	s390_types[] =
+{
+	[   0] = { "R_390_NONE", RELTYPE_OTHER },
+	[   1] = { "R_390_8", RELTYPE_DATA },
+	[   2] = { "R_390_12", RELTYPE_DATA },
+	[   3] = { "R_390_16", RELTYPE_DATA },
+	[   4] = { "R_390_32", RELTYPE_DATA },
+	[   5] = { "R_390_PC32", RELTYPE_DATA },
+	[   6] = { "R_390_GOT12", RELTYPE_GOT },
+	[   7] = { "R_390_GOT32", RELTYPE_GOT },
+	[   8] = { "R_390_PLT32", RELTYPE_CALL },
+	[   9] = { "R_390_COPY", RELTYPE_OTHER },
+	[  10] = { "R_390_GLOB_DAT", RELTYPE_GOT },
+	[  11] = { "R_390_JMP_SLOT", RELTYPE_CALL },
+	[  12] = { "R_390_RELATIVE", RELTYPE_DATA },
+	[  13] = { "R_390_GOTOFF32", RELTYPE_GOT },
+	[  14] = { "R_390_GOTPC", RELTYPE_GOT },
+	[  15] = { "R_390_GOT16", RELTYPE_GOT },
+	[  16] = { "R_390_PC16", RELTYPE_DATA },
+	[  17] = { "R_390_PC16DBL", RELTYPE_CALL },
+	[  18] = { "R_390_PLT16DBL", RELTYPE_CALL },
+	[  19] = { "R_390_PC32DBL", RELTYPE_DATA },
+	[  20] = { "R_390_PLT32DBL", RELTYPE_CALL },
+	[  21] = { "R_390_GOTPCDBL", RELTYPE_GOT },
+	[  22] = { "R_390_64", RELTYPE_DATA },
+	[  23] = { "R_390_PC64", RELTYPE_DATA },
+	[  24] = { "R_390_GOT64", RELTYPE_GOT },
+	[  25] = { "R_390_PLT64", RELTYPE_CALL },
+	[  26] = { "R_390_GOTENT", RELTYPE_GOT },
+	[  27] = { "R_390_GOTOFF16", RELTYPE_GOT },
+	[  28] = { "R_390_GOTOFF64", RELTYPE_GOT },
+	[  29] = { "R_390_GOTPLT12", RELTYPE_GOT },
+	[  30] = { "R_390_GOTPLT16", RELTYPE_GOT },
+	[  31] = { "R_390_GOTPLT32", RELTYPE_GOT },
+	[  32] = { "R_390_GOTPLT64", RELTYPE_GOT },
+	[  33] = { "R_390_GOTPLTENT", RELTYPE_GOT },
+	[  34] = { "R_390_PLTOFF16", RELTYPE_CALL },
+	[  35] = { "R_390_PLTOFF32", RELTYPE_CALL },
+	[  36] = { "R_390_PLTOFF64", RELTYPE_CALL },
+	[  37] = { "R_390_TLS_LOAD", RELTYPE_TLS },
+	[  38] = { "R_390_TLS_GDCALL", RELTYPE_TLS },
+	[  39] = { "R_390_TLS_LDCALL", RELTYPE_TLS },
+	[  40] = { "R_390_TLS_GD32", RELTYPE_TLS },
+	[  41] = { "R_390_TLS_GD64", RELTYPE_TLS },
+	[  42] = { "R_390_TLS_GOTIE12", RELTYPE_TLS },
+	[  43] = { "R_390_TLS_GOTIE32", RELTYPE_TLS },
+	[  44] = { "R_390_TLS_GOTIE64", RELTYPE_TLS },
+	[  45] = { "R_390_TLS_LDM32", RELTYPE_TLS },
+	[  46] = { "R_390_TLS_LDM64", RELTYPE_TLS },
+	[  47] = { "R_390_TLS_IE32", RELTYPE_TLS },
+	[  48] = { "R_390_TLS_IE64", RELTYPE_TLS },
+	[  49] = { "R_390_TLS_IEENT", RELTYPE_TLS },
+	[  50] = { "R_390_TLS_LE32", RELTYPE_TLS },
+	[  51] = { "R_390_TLS_LE64", RELTYPE_TLS },
+	[  52] = { "R_390_TLS_LDO32", RELTYPE_TLS },
+	[  53] = { "R_390_TLS_LDO64", RELTYPE_TLS },
+	[  54] = { "R_390_TLS_DTPMOD", RELTYPE_TLS },
+	[  55] = { "R_390_TLS_DTPOFF", RELTYPE_TLS },
+	[  56] = { "R_390_TLS_TPOFF", RELTYPE_TLS },
+	[  57] = { "R_390_20", RELTYPE_DATA },
+	[  58] = { "R_390_GOT20", RELTYPE_GOT },
+	[  59] = { "R_390_GOTPLT20", RELTYPE_GOT },
+	[  60] = { "R_390_TLS_GOTIE20", RELTYPE_TLS },
+	[  61] = { "R_390_IRELATIVE", RELTYPE_OTHER },
+};
+
+/**
+ * Relocation types of RISC-V.
+ */
+static const reltype_t	riscv_types[] =
+{
+	[   0] = { "R_RISCV_NONE", RELTYPE_OTHER },
+	[   1] = { "R_RISCV_32", RELTYPE_DATA },
+	[   2] = { "R_RISCV_64", RELTYPE_DATA },
+	[   3] = { "R_RISCV_RELATIVE", RELTYPE_DATA },
+	[   4] = { "R_RISCV_COPY", RELTYPE_OTHER },
+	[   5] = { "R_RISCV_JUMP_SLOT", RELTYPE_CALL },
+	[   6] = { "R_RISCV_TLS_DTPMOD32", RELTYPE_TLS },
+	[   7] = { "R_RISCV_TLS_DTPMOD64", RELTYPE_TLS },
+	[   8] = { "R_RISCV_TLS_DTPREL32", RELTYPE_TLS },
+	[   9] = { "R_RISCV_TLS_DTPREL64", RELTYPE_TLS },
+	[  10] = { "R_RISCV_TLS_TPREL32", RELTYPE_TLS },
+	[  11] = { "R_RISCV_TLS_TPREL64", RELTYPE_TLS },
+	[  16] = { "R_RISCV_BRANCH", RELTYPE_CALL },
+	[  17] = { "R_RISCV_JAL", RELTYPE_CALL },
+	[  18] = { "R_RISCV_CALL", RELTYPE_CALL },
+	[  19] = { "R_RISCV_CALL_PLT", RELTYPE_CALL },
+	[  20] = { "R_RISCV_GOT_HI20", RELTYPE_GOT },
+	[  21] = { "R_RISCV_TLS_GOT_HI20", RELTYPE_TLS },
+	[  22] = { "R_RISCV_TLS_GD_HI20", RELTYPE_TLS },
+	[  23] = { "R_RISCV_PCREL_HI20", RELTYPE_DATA },
+	[  24] = { "R_RISCV_PCREL_LO12_I", RELTYPE_DATA },
+	[  25] = { "R_RISCV_PCREL_LO12_S", RELTYPE_DATA },
+	[  26] = { "R_RISCV_HI20", RELTYPE_DATA },
+	[  27] = { "R_RISCV_LO12_I", RELTYPE_DATA },
+	[  28] = { "R_RISCV_LO12_S", RELTYPE_DATA },
+	[  29] = { "R_RISCV_TPREL_HI20", RELTYPE_TLS },
+	[  30] = { "R_RISCV_TPREL_LO12_I", RELTYPE_TLS },
+	[  31] = { "R_RISCV_TPREL_LO12_S", RELTYPE_TLS },
+	[  32] = { "R_RISCV_TPREL_ADD", RELTYPE_TLS },
+	[  33] = { "R_RISCV_ADD8", RELTYPE_OTHER },
+	[  34] = { "R_RISCV_ADD16", RELTYPE_OTHER },
+	[  35] = { "R_RISCV_ADD32", RELTYPE_OTHER },
+	[  36] = { "R_RISCV_ADD64", RELTYPE_OTHER },
+	[  37] = { "R_RISCV_SUB8", RELTYPE_OTHER },
+	[  38] = { "R_RISCV_SUB16", RELTYPE_OTHER },
+	[  39] = { "R_RISCV_SUB32", RELTYPE_OTHER },
+	[  40] = { "R_RISCV_SUB64", RELTYPE_OTHER },
+	[  41] = { "R_RISCV_GNU_VTINHERIT", RELTYPE_OTHER },
+	[  42] = { "R_RISCV_GNU_VTENTRY", RELTYPE_OTHER },
+	[  43] = { "R_RISCV_ALIGN", RELTYPE_OTHER },
+	[  44] = { "R_RISCV_RVC_BRANCH", RELTYPE_CALL },
+	[  45] = { "R_RISCV_RVC_JUMP", RELTYPE_CALL },
+	[  46] = { "R_RISCV_RVC_LUI", RELTYPE_DATA },
+	[  47] = { "R_RISCV_GPREL_I", RELTYPE_DATA },
+	[  48] = { "R_RISCV_GPREL_S", RELTYPE_DATA },
+	[  49] = { "R_RISCV_TPREL_I", RELTYPE_TLS },
+	[  50] = { "R_RISCV_TPREL_S", RELTYPE_TLS },
+	[  51] = { "R_RISCV_RELAX", RELTYPE_OTHER },
+	[  52] = { "R_RISCV_SUB6", RELTYPE_OTHER },
+	[  53] = { "R_RISCV_SET6", RELTYPE_OTHER },
+	[  54] = { "R_RISCV_SET8", RELTYPE_OTHER },
+	[  55] = { "R_RISCV_SET16", RELTYPE_OTHER },
+	[  56] = { "R_RISCV_SET32", RELTYPE_OTHER },
+	[  57] = { "R_RISCV_32_PCREL", RELTYPE_DATA },
+	[  58] = { "R_RISCV_IRELATIVE", RELTYPE_OTHER },
+	[  59] = { "R_RISCV_PLT32", RELTYPE_CALL },
+	[  60] = { "R_RISCV_SET_ULEB128", RELTYPE_OTHER },
+	[  61] = { "R_RISCV_SUB_ULEB128", RELTYPE_OTHER },
+	[  62] = { "R_RISCV_TLSDESC_HI20", RELTYPE_TLS },
+	[  63] = { "R_RISCV_TLSDESC_LOAD_LO12", RELTYPE_TLS },
+	[  64] = { "R_RISCV_TLSDESC_ADD_LO12", RELTYPE_TLS },
+	[  65] = { "R_RISCV_TLSDESC_CALL", RELTYPE_TLS },
+};
+
+#define TABLE(m, types)	{ m, sizeof(types)/sizeof(types[0]), types }
+
+static const reltype_table_t	tables[] =
+{
+	TABLE(EM_X86_64, x86_64_types),
+	TABLE(EM_386, i386_types),
+	TABLE(EM_AARCH64, aarch64_types),
+	TABLE(EM_ARM, arm_types),
+	TABLE(EM_PPC64, ppc64_types),
+	TABLE(EM_S390, s390_types),
+	TABLE(EM_RISCV, riscv_types),
+};
+
+/**
+ * Returns the relocation types of the given machine (e_machine) or NULL if it is not known to us.
+ */
+extern const reltype_table_t *	reltype_table(uint16_t machine)
+{
+	for (size_t i = 0; i < sizeof(tables)/sizeof(tables[0]); ++i)
+	{
+		if (tables[i].machine == machine)
+			return &tables[i];
+	}
+
+	return NULL;
+}
+
+/**
+ * Returns the kind of the relocation type in the given table; types that are not known,
+ * as well as those of machines not known (t is NULL), are RELTYPE_OTHER.
+ */
+extern reltype_kind_t	reltype_kind(const reltype_table_t* t, uint32_t type)
+{
+	if (!t || type >= t->ntypes || !t->types[type].name)
+		return RELTYPE_OTHER;
+
+	return t->types[type].kind;
+}
+
+/**
+ * Returns the name of the relocation type in the given table or NULL if it is not known.
+ */
+extern const char *	reltype_name(const reltype_table_t* t, uint32_t type)
+{
+	if (!t || type >= t->ntypes)
+		return NULL;
+
+	return t->types[type].name;
+}
+
+/**
+ * Parses a comma-separated list of relocation kinds (call, data, got, tls, other) into a mask of them.
+ * Returns false if there is a kind not known in the list.
+ */
+extern bool	reltype_parse_kinds(const char* list, unsigned* kinds)
+{
+	assert(list && kinds);
+
+	static const struct { const char *name; reltype_kind_t kind; } names[] =
+	{
+		{ "call", RELTYPE_CALL },
+		{ "data", RELTYPE_DATA },
+		{ "got", RELTYPE_GOT },
+		{ "tls", RELTYPE_TLS },
+		{ "other", RELTYPE_OTHER },
+	};
+
+	*kinds = 0;
+	for (const char *s = list; ; ++s)
+	{
+		const size_t len = strcspn(s, ",");
+
+		size_t i = 0;
+		while (i < sizeof(names)/sizeof(names[0]) && (strlen(names[i].name) != len || strncmp(s, names[i].name, len) != 0))
+			++i;
+		if (i == sizeof(names)/sizeof(names[0]))
+			return false;
+		*kinds |= (unsigned)names[i].kind;
+
+		s += len;
+		if (*s == 0)
+			break;
+	}
+
+	return true;
+}
@@ -0,0 +1,74 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+
+#ifndef RELTYPE_H_
+#define RELTYPE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * What a relocation makes of the symbol it refers to. These are bits, so that a set of kinds
+ * (see reltype_parse_kinds()) is a mask of them.
+ */
+typedef enum reltype_kind
+{
+	RELTYPE_CALL	= 1 << 0,	// a call or a branch to it, possibly through the PLT
+	RELTYPE_DATA	= 1 << 1,	// its address, absolute or relative, taken or loaded directly
+	RELTYPE_GOT	= 1 << 2,	// its GOT entry or the GOT itself
+	RELTYPE_TLS	= 1 << 3,	// a thread-local variable
+	RELTYPE_OTHER	= 1 << 4	// anything else: copies, ifuncs, linker hints, unknown types
+} reltype_kind_t;
+
+#define RELTYPE_ALL	((unsigned)(RELTYPE_CALL | RELTYPE_DATA | RELTYPE_GOT | RELTYPE_TLS | RELTYPE_OTHER))
+
+/**
+ * Describes a relocation type of some machine.
+ */
+typedef struct reltype
+{
+	const char *	name;		// as in <elf.h>, NULL if the type is not known
+	reltype_kind_t	kind;
+} reltype_t;
+
+/**
+ * The relocation types of a machine (e_machine), indexed by the type number.
+ */
+typedef struct reltype_table
+{
+	uint16_t		machine;
+	uint32_t		ntypes;
+	const reltype_t *	types;
+} reltype_table_t;
+
+const reltype_table_t *	reltype_table(uint16_t machine);
+reltype_kind_t		reltype_kind(const reltype_table_t* t, uint32_t type);
+const char *		reltype_name(const reltype_table_t* t, uint32_t type);
+bool			reltype_parse_kinds(const char* list, unsigned* kinds);
+
+#endif
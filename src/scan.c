@@ -0,0 +1,633 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// Finding the ELF files under a directory that refer to a symbol (--scan-dir).
+//
+// Most files under a sysroot do not refer to any given symbol, and reading in
+// the symbols and relocations of each to find that out is what makes running
+// elfref on every one of them slow. Instead, each file's dynamic symbol table
+// is looked up first, by several threads at once. A search of .dynstr for the
+// name rules out most files without looking anything up. The SysV hash table
+// (DT_HASH) has all the dynamic symbols; .gnu.hash only has the defined ones,
+// its bloom filter ruling most of those out, and the undefined (imported)
+// ones precede them in .dynsym, where they are searched through. A file with
+// no dynamic symbol of that name, and version if given as SYMBOL@VERSION, is
+// not read any further. Files with no dynamic symbols at all (object files,
+// static executables) are only searched for the name. The rest are read in
+// full one after another, and their references to the symbol are printed as
+// they are for several files given on the command line.
+
+#include "scan.h"
+#include "input.h"
+#include "symtab.h"
+#include "errors.h"
+#include "globals.h"
+#include "trace.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <assert.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_THREADS	16
+
+/**
+ * The symbol looked for and the files to look for it in, shared by the scanning threads.
+ */
+typedef struct scan
+{
+	const char *	name;		// the symbol's name...
+	size_t		name_len;
+	const char *	version;	// ...and version, NULL if any will do
+	uint32_t	sysv_hash;	// of the name, as DT_HASH has it
+	uint32_t	gnu_hash;	// and as .gnu.hash has it
+
+	char **		paths;		// files found, sorted
+	size_t		npaths;
+	size_t		paths_size;
+	bool *		may_refer;	// whether each file can refer to the symbol
+	size_t		next;		// the next file to look into, taken by the threads in turn
+} scan;
+
+/**
+ * An ELF file mapped for looking into.
+ */
+typedef struct elf_file
+{
+	const char *	p;
+	size_t		size;
+	bool		is64;
+	bool		be;
+	size_t		shoff;
+	size_t		shentsize;
+	size_t		shnum;
+} elf_file;
+
+/**
+ * A section of the ELF file looked into.
+ */
+typedef struct section
+{
+	const char *	data;
+	size_t		size;
+	size_t		entsize;
+	size_t		link;
+} section;
+
+/**
+ * Returns the SysV hash of the name (see DT_HASH).
+ */
+static uint32_t	sysv_hash(const char* name)
+{
+	uint32_t h = 0;
+	for (const unsigned char *c = (const unsigned char *)name; *c; ++c)
+	{
+		h = (h << 4) + *c;
+		const uint32_t g = h & 0xf0000000;
+		h ^= g >> 24;
+		h &= ~g;
+	}
+	return h;
+}
+
+/**
+ * Returns the GNU hash of the name (see DT_GNU_HASH).
+ */
+static uint32_t	gnu_hash(const char* name)
+{
+	uint32_t h = 5381;
+	for (const unsigned char *c = (const unsigned char *)name; *c; ++c)
+	{
+		h = h*33 + *c;
+	}
+	return h;
+}
+
+/**
+ * Stores the i-th section of the file in *s; returns false if there is no such section or it is not in the file.
+ */
+static bool	get_section(const elf_file* f, size_t i, section* s)
+{
+	if (i == 0 || i >= f->shnum)
+		return false;
+
+	const char *shdr = f->p + f->shoff + i*f->shentsize;
+	const uint64_t type = ELF_FIELD(shdr, Shdr, sh_type, f->is64, f->be);
+	const uint64_t off = ELF_FIELD(shdr, Shdr, sh_offset, f->is64, f->be);
+	const uint64_t size = ELF_FIELD(shdr, Shdr, sh_size, f->is64, f->be);
+	if (type == SHT_NOBITS || off > f->size || size > f->size - off)
+		return false;
+
+	s->data = f->p + off;
+	s->size = (size_t)size;
+	s->entsize = (size_t)ELF_FIELD(shdr, Shdr, sh_entsize, f->is64, f->be);
+	s->link = (size_t)ELF_FIELD(shdr, Shdr, sh_link, f->is64, f->be);
+	return true;
+}
+
+/**
+ * Stores the first section of the given type in *s; returns false if there is none.
+ */
+static bool	find_section(const elf_file* f, uint32_t type, section* s)
+{
+	for (size_t i = 1; i < f->shnum; ++i)
+	{
+		const char *shdr = f->p + f->shoff + i*f->shentsize;
+		if (ELF_FIELD(shdr, Shdr, sh_type, f->is64, f->be) == type)
+			return get_section(f, i, s);
+	}
+	return false;
+}
+
+/**
+ * Returns true if the string at offset off in the string table is str.
+ */
+static bool	str_is(const section* strtab, uint64_t off, const char* str, size_t len)
+{
+	return off < strtab->size && strtab->size - off > len && memcmp(strtab->data + off, str, len + 1) == 0;
+}
+
+/**
+ * Returns true if the version of the i-th dynamic symbol is the one looked for: the version index kept
+ * in .gnu.version names a version needed (.gnu.version_r) or defined (.gnu.version_d) by the file.
+ */
+static bool	version_is(const scan* sc, const elf_file* f, size_t i)
+{
+	section versym;
+	if (!find_section(f, SHT_GNU_versym, &versym) || versym.size/2 <= i)
+		return false;
+
+	const uint64_t vidx = get_field(versym.data + 2*i, 2, f->be) & 0x7fff;
+	if (vidx < 2)
+		return false; // local or global, that is not versioned
+
+	const size_t vlen = strlen(sc->version);
+	section vneed, vdef, vstr;
+	if (find_section(f, SHT_GNU_verneed, &vneed) && get_section(f, vneed.link, &vstr))
+	{
+		size_t off = 0;
+		for (size_t n = 0; n < vneed.size && off <= vneed.size - sizeof(Elf64_Verneed); ++n)
+		{
+			const char *vn = vneed.data + off;
+			size_t aux = off + (size_t)ELF_FIELD(vn, Verneed, vn_aux, f->is64, f->be);
+			const uint64_t cnt = ELF_FIELD(vn, Verneed, vn_cnt, f->is64, f->be);
+			for (uint64_t j = 0; j < cnt && aux <= vneed.size - sizeof(Elf64_Vernaux); ++j)
+			{
+				const char *vna = vneed.data + aux;
+				if (ELF_FIELD(vna, Vernaux, vna_other, f->is64, f->be) == vidx)
+				{
+					const uint64_t name = ELF_FIELD(vna, Vernaux, vna_name, f->is64, f->be);
+					return str_is(&vstr, name, sc->version, vlen);
+				}
+
+				const uint64_t next = ELF_FIELD(vna, Vernaux, vna_next, f->is64, f->be);
+				if (next == 0 || next > vneed.size)
+					break;
+				aux += (size_t)next;
+			}
+
+			const uint64_t next = ELF_FIELD(vn, Verneed, vn_next, f->is64, f->be);
+			if (next == 0 || next > vneed.size)
+				break;
+			off += (size_t)next;
+		}
+	}
+
+	if (find_section(f, SHT_GNU_verdef, &vdef) && get_section(f, vdef.link, &vstr))
+	{
+		size_t off = 0;
+		for (size_t n = 0; n < vdef.size && off <= vdef.size - sizeof(Elf64_Verdef); ++n)
+		{
+			const char *vd = vdef.data + off;
+			const size_t aux = off + (size_t)ELF_FIELD(vd, Verdef, vd_aux, f->is64, f->be);
+			const uint64_t ndx = ELF_FIELD(vd, Verdef, vd_ndx, f->is64, f->be);
+			if (ndx == vidx && aux <= vdef.size - sizeof(Elf64_Verdaux))
+			{
+				const uint64_t name = ELF_FIELD(vdef.data + aux, Verdaux, vda_name, f->is64, f->be);
+				return str_is(&vstr, name, sc->version, vlen);
+			}
+
+			const uint64_t next = ELF_FIELD(vd, Verdef, vd_next, f->is64, f->be);
+			if (next == 0 || next > vdef.size)
+				break;
+			off += (size_t)next;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Returns true if the i-th dynamic symbol is the one looked for.
+ */
+static bool	sym_is(const scan* sc, const elf_file* f, const section* dynsym, const section* dynstr, size_t i)
+{
+	const size_t sym_size = f->is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+	if (i >= dynsym->size/sym_size)
+		return false;
+
+	const char *sym = dynsym->data + i*sym_size;
+	if (!str_is(dynstr, ELF_FIELD(sym, Sym, st_name, f->is64, f->be), sc->name, sc->name_len))
+		return false;
+
+	return !sc->version || version_is(sc, f, i);
+}
+
+/**
+ * Looks the symbol up in the SysV hash table, which has all the dynamic symbols.
+ */
+static bool	sysv_lookup(const scan* sc, const elf_file* f, const section* hash, const section* dynsym,
+			    const section* dynstr)
+{
+	if (hash->size < 8)
+		return false;
+
+	const uint64_t nbucket = get_field(hash->data, 4, f->be);
+	const uint64_t nchain = get_field(hash->data + 4, 4, f->be);
+	if (nbucket == 0 || nbucket + nchain > hash->size/4 - 2)
+		return false;
+
+	const char *buckets = hash->data + 8;
+	const char *chains = buckets + 4*nbucket;
+	uint64_t i = get_field(buckets + 4*(sc->sysv_hash % nbucket), 4, f->be);
+	for (uint64_t n = 0; i != 0 && i < nchain && n < nchain; ++n)
+	{
+		if (sym_is(sc, f, dynsym, dynstr, (size_t)i))
+			return true;
+		i = get_field(chains + 4*i, 4, f->be);
+	}
+	return false;
+}
+
+/**
+ * Looks the symbol up in the GNU hash table, which only has the defined dynamic symbols; the undefined ones,
+ * which precede them in .dynsym, are searched through.
+ */
+static bool	gnu_lookup(const scan* sc, const elf_file* f, const section* hash, const section* dynsym,
+			   const section* dynstr)
+{
+	if (hash->size < 16)
+		return false;
+
+	const uint64_t nbuckets = get_field(hash->data, 4, f->be);
+	const uint64_t symoffset = get_field(hash->data + 4, 4, f->be);
+	const uint64_t bloom_size = get_field(hash->data + 8, 4, f->be);
+	const uint64_t bloom_shift = get_field(hash->data + 12, 4, f->be);
+	const size_t word = f->is64 ? 8 : 4;
+	const uint64_t bits = 8*word;
+	if (nbuckets == 0 || bloom_size > (hash->size - 16)/word || nbuckets > (hash->size - 16 - bloom_size*word)/4)
+		return false;
+
+	const char *bloom = hash->data + 16;
+	const char *buckets = bloom + bloom_size*word;
+	const char *chains = buckets + 4*nbuckets;
+	const size_t nchains = (size_t)(hash->data + hash->size - chains)/4;
+	const uint32_t h = sc->gnu_hash;
+
+	// The bloom filter rules out most of the files that do not define the symbol, the chain has it if they do
+	bool maybe_defined = true;
+	if (bloom_size && bloom_shift < 32)
+	{
+		const uint64_t mask = ((uint64_t)1 << (h % bits)) | ((uint64_t)1 << ((h >> bloom_shift) % bits));
+		maybe_defined = (get_field(bloom + word*((h/bits) % bloom_size), word, f->be) & mask) == mask;
+	}
+	if (maybe_defined)
+	{
+		uint64_t i = get_field(buckets + 4*(h % nbuckets), 4, f->be);
+		for (; i >= symoffset && i - symoffset < nchains; ++i)
+		{
+			const uint64_t h2 = get_field(chains + 4*(i - symoffset), 4, f->be);
+			if ((h2 | 1) == (h | 1) && sym_is(sc, f, dynsym, dynstr, (size_t)i))
+				return true;
+			if (h2 & 1)
+				break; // the end of the chain
+		}
+	}
+
+	// The symbols not in the chains (those before symoffset, all of them if the table is left empty)
+	const size_t nsyms = dynsym->size/(f->is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym));
+	for (size_t i = 1; i < nsyms; ++i)
+	{
+		if (i >= symoffset && i - symoffset < nchains)
+		{
+			i = (size_t)symoffset + nchains - 1;
+			continue;
+		}
+		if (sym_is(sc, f, dynsym, dynstr, i))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Returns true if the ELF file mapped at p can refer to the symbol looked for, that is it has a dynamic symbol
+ * of that name or, if it has no dynamic symbols, the name is in its string table.
+ */
+static bool	elf_may_refer(const scan* sc, const char* p, size_t size)
+{
+	if (size < EI_NIDENT || memcmp(p, ELFMAG, SELFMAG) != 0 || (p[EI_CLASS] != ELFCLASS32 && p[EI_CLASS] != ELFCLASS64))
+		return false;
+
+	elf_file f = { .p = p, .size = size, .is64 = (p[EI_CLASS] == ELFCLASS64), .be = (p[EI_DATA] == ELFDATA2MSB) };
+	if (size < (f.is64 ? sizeof(Elf64_Ehdr) : sizeof(Elf32_Ehdr)))
+		return false;
+
+	const uint64_t shoff = ELF_FIELD(p, Ehdr, e_shoff, f.is64, f.be);
+	const uint64_t shentsize = ELF_FIELD(p, Ehdr, e_shentsize, f.is64, f.be);
+	uint64_t shnum = ELF_FIELD(p, Ehdr, e_shnum, f.is64, f.be);
+	if (shentsize < (f.is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr)) || shoff > size || size - shoff < shentsize)
+		return false; // can't be read anyway
+	if (shnum == 0 && shoff != 0)
+	{
+		shnum = ELF_FIELD(p + shoff, Shdr, sh_size, f.is64, f.be); // extended numbering
+	}
+	if (shnum > (size - shoff)/shentsize)
+		return false;
+	f.shoff = (size_t)shoff;
+	f.shentsize = (size_t)shentsize;
+	f.shnum = (size_t)shnum;
+
+	section dynsym, dynstr, hash;
+	if (!find_section(&f, SHT_DYNSYM, &dynsym))
+	{
+		section symtab, strtab;
+		return find_section(&f, SHT_SYMTAB, &symtab) && get_section(&f, symtab.link, &strtab)
+			&& memmem(strtab.data, strtab.size, sc->name, sc->name_len + 1);
+	}
+
+	// The name (possibly the tail of a longer one) must be there for the file to have the symbol
+	if (!get_section(&f, dynsym.link, &dynstr))
+		return true;
+	if (!memmem(dynstr.data, dynstr.size, sc->name, sc->name_len + 1))
+		return false;
+
+	if (find_section(&f, SHT_HASH, &hash) && hash.entsize == 4)
+		return sysv_lookup(sc, &f, &hash, &dynsym, &dynstr);
+	if (find_section(&f, SHT_GNU_HASH, &hash))
+		return gnu_lookup(sc, &f, &hash, &dynsym, &dynstr);
+
+	const size_t nsyms = dynsym.size/(f.is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym));
+	for (size_t i = 1; i < nsyms; ++i)
+	{
+		if (sym_is(sc, &f, &dynsym, &dynstr, i))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * Returns true if the file at the given path is an ELF file that can refer to the symbol looked for.
+ */
+static bool	file_may_refer(const scan* sc, const char* path)
+{
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	bool may_refer = false;
+	struct stat sb;
+	if (fstat(fd, &sb) == 0 && sb.st_size >= EI_NIDENT)
+	{
+		const size_t size = (size_t)sb.st_size;
+		const char *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p != MAP_FAILED)
+		{
+			may_refer = elf_may_refer(sc, p, size);
+			munmap((void *)p, size);
+		}
+	}
+
+	close(fd);
+	return may_refer;
+}
+
+/**
+ * Looks into the files not yet taken by the other threads.
+ */
+static void *	scan_files(void* arg)
+{
+	scan *sc = arg;
+
+	for (;;)
+	{
+		const size_t i = __atomic_fetch_add(&sc->next, 1, __ATOMIC_RELAXED);
+		if (i >= sc->npaths)
+			break;
+
+		const uint64_t span = trace_begin();
+		sc->may_refer[i] = file_may_refer(sc, sc->paths[i]);
+		trace_end(span, "scan", "lookup", sc->paths[i], 0);
+	}
+
+	return NULL;
+}
+
+static scan *	found_scan;	// nftw() callbacks take no context
+
+static int	add_file(const char* path, const struct stat* sb, int type, struct FTW* ftw __attribute__((unused)))
+{
+	if (type != FTW_F || !S_ISREG(sb->st_mode))
+		return 0;
+
+	scan *sc = found_scan;
+	if (sc->npaths == sc->paths_size)
+	{
+		sc->paths_size = sc->paths_size ? 2*sc->paths_size : 256;
+		char **paths = realloc(sc->paths, sc->paths_size*sizeof(char *));
+		if (!paths)
+		{
+			fatal_err("Not enough memory");
+		}
+		sc->paths = paths;
+	}
+
+	sc->paths[sc->npaths] = strdup(path);
+	if (!sc->paths[sc->npaths])
+	{
+		fatal_err("Not enough memory");
+	}
+	sc->npaths++;
+
+	return 0;
+}
+
+static int	path_compare(const void* p1, const void* p2)
+{
+	return strcmp(*(char * const *)p1, *(char * const *)p2);
+}
+
+struct print_ctx
+{
+	const char *		path;
+	const symtab_filter_t *	filter;
+	bool			printed;	// the file name has been printed
+};
+
+static void	print_ref(void* vctx, const symtab_ref_t* ref)
+{
+	struct print_ctx *ctx = vctx;
+	if (!ctx->printed)
+	{
+		printf("\n%s:\n", ctx->path);
+		ctx->printed = true;
+	}
+	symtab_print_ref(stdout, ctx->filter, ref, ref->first);
+}
+
+/**
+ * Reads in the file and prints out its references that pass the filter, preceded by the file's name if there
+ * are any. Returns the number of references printed.
+ */
+static size_t	print_file(const char* path, const symtab_filter_t* filter)
+{
+	char err[256];
+
+	input_t *in = input_init();
+	symtab_t *st = input_read_refs(in, path, err, sizeof(err));
+	if (!st)
+	{
+		error("%s: %s", path, err);
+		input_free(in);
+		return 0;
+	}
+
+	struct print_ctx ctx = { .path = path, .filter = filter };
+	const size_t nrefs = symtab_walk(st, filter, print_ref, &ctx);
+	fflush(stdout);
+
+	symtab_free(st);
+	input_close(in);
+	input_free(in);
+
+	return nrefs;
+}
+
+/**
+ * Prints out the references to the symbol (given as NAME or NAME@VERSION) made in the files under dir,
+ * only reading in full those that can make them. Returns the exit code of the program.
+ */
+extern int	scan_run(const char* dir, const char* symbol, const symtab_filter_t* filter)
+{
+	assert(dir);
+	assert(symbol);
+	assert(filter);
+
+	char *name = strdup(symbol);
+	if (!name)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	scan sc = { .name = name };
+	char *at = strchr(name, '@');
+	if (at)
+	{
+		*at = 0;
+		sc.version = (at[1] == '@') ? at + 2 : at + 1; // NAME@@VERSION is the default one, just as good
+	}
+	sc.name_len = strlen(name);
+	sc.sysv_hash = sysv_hash(name);
+	sc.gnu_hash = gnu_hash(name);
+
+	found_scan = &sc;
+	if (nftw(dir, add_file, 64, FTW_PHYS) == -1)
+	{
+		error("Cannot scan %s (%s)", dir, strerror(errno));
+		free(sc.paths);
+		free(name);
+		return EXIT_FAILURE;
+	}
+	qsort(sc.paths, sc.npaths, sizeof(char *), path_compare);
+
+	sc.may_refer = calloc(sc.npaths + 1, sizeof(bool));
+	if (!sc.may_refer)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	size_t nthreads = glob_get_threads();
+	nthreads = (nthreads < MAX_THREADS) ? nthreads : MAX_THREADS;
+	nthreads = (nthreads < sc.npaths) ? nthreads : 1;
+
+	pthread_t tids[MAX_THREADS];
+	size_t nstarted = 1;
+	for (; nstarted < nthreads; ++nstarted)
+	{
+		if (pthread_create(&tids[nstarted], NULL, scan_files, &sc) != 0)
+			break; // the threads that started, and this one, do the rest
+	}
+	scan_files(&sc);
+	for (size_t t = 1; t < nstarted; ++t)
+	{
+		pthread_join(tids[t], NULL);
+	}
+
+	size_t ncandidates = 0;
+	for (size_t i = 0; i < sc.npaths; ++i)
+	{
+		ncandidates += sc.may_refer[i];
+	}
+	report(VERB, "%zu of %zu files under %s may refer to %s", ncandidates, sc.npaths, dir, symbol);
+
+	symtab_filter_t f = *filter;
+	f.ref_pattern = name;
+	f.ref_exact = true;
+
+	size_t nfiles = 0;
+	for (size_t i = 0; i < sc.npaths; ++i)
+	{
+		if (sc.may_refer[i] && print_file(sc.paths[i], &f) > 0)
+		{
+			nfiles++;
+		}
+	}
+	if (nfiles == 0)
+	{
+		report(NORM, "No files under %s refer to %s", dir, symbol);
+	}
+
+	for (size_t i = 0; i < sc.npaths; ++i)
+	{
+		free(sc.paths[i]);
+	}
+	free(sc.paths);
+	free(sc.may_refer);
+	free(name);
+
+	return EXIT_SUCCESS;
+}
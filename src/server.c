@@ -0,0 +1,472 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// The query server (--serve) and its client (--connect).
+//
+// The server keeps the files it was asked about in memory (see cache.c) and
+// answers each query with what "elfref OPTIONS FILE" would print. A query is
+// one line consisting of the command line arguments separated by tabs; the
+// response is a status line ("OK" or "ERR message") followed by the output.
+// Each connection carries one query and is served by a thread of its own.
+
+#include "server.h"
+#include "cache.h"
+#include "symtab.h"
+#include "args.h"
+#include "errors.h"
+#include "globals.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#define MAX_QUERY_LEN	(PATH_MAX + 4096)
+#define MAX_QUERY_ARGS	16
+
+static volatile sig_atomic_t	stop_requested;
+
+static void	on_stop_signal(int sig __attribute__((unused)))
+{
+	stop_requested = 1;
+}
+
+/**
+ * Describes a connected client.
+ */
+typedef struct client
+{
+	int		fd;
+	cache_t *	cache;
+} client;
+
+static bool	write_all(int fd, const char* buf, size_t len)
+{
+	while (len > 0)
+	{
+		const ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		buf += n;
+		len -= (size_t)n;
+	}
+
+	return true;
+}
+
+static void	respond_error(int fd, const char* msg)
+{
+	char line[512];
+	const int n = snprintf(line, sizeof(line), "ERR %s\n", msg);
+	if (n > 0)
+	{
+		write_all(fd, line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+	}
+}
+
+/**
+ * Reads one query line from the client into buf; returns false if there is none.
+ */
+static bool	read_query(int fd, char* buf, size_t size)
+{
+	size_t len = 0;
+	while (len < size - 1)
+	{
+		const ssize_t n = read(fd, buf + len, size - 1 - len);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+
+		char *nl = memchr(buf + len, '\n', (size_t)n);
+		len += (size_t)n;
+		if (nl)
+		{
+			*nl = 0;
+			return true;
+		}
+	}
+
+	buf[len] = 0;
+	return len > 0 && len < size - 1;
+}
+
+static double	elapsed_ms(const struct timeval* start)
+{
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (double)(now.tv_sec - start->tv_sec)*1e3 + (double)(now.tv_usec - start->tv_usec)/1e3;
+}
+
+/**
+ * Parses and answers one query of the client.
+ */
+static void	serve_query(client* cl, char* query)
+{
+	struct timeval start;
+	gettimeofday(&start, NULL);
+
+	// Split the query into arguments, keeping argv[0] for the program name as main() would
+	char *argv[MAX_QUERY_ARGS + 1] = { (char *)glob_get_program_name() };
+	int argc = 1;
+	const size_t query_len = strlen(query);
+	char *query_key = strndupa(query, query_len);
+	for (char *save = NULL, *arg = strtok_r(query, "\t", &save); arg; arg = strtok_r(NULL, "\t", &save))
+	{
+		if (argc == MAX_QUERY_ARGS)
+		{
+			respond_error(cl->fd, "Too many arguments");
+			return;
+		}
+		argv[argc++] = arg;
+	}
+
+	symtab_filter_t filter = {0};
+	const char *fname = NULL;
+	for (int i = 1; i < argc; ++i)
+	{
+		const int filter_opt = args_parse_filter_opt(argc, argv, &i, &filter);
+		if (filter_opt < 0)
+		{
+			respond_error(cl->fd, "Malformed option");
+			return;
+		}
+		else if (filter_opt == 0)
+		{
+			if (fname || argv[i][0] == '-')
+			{
+				respond_error(cl->fd, "Unrecognized argument");
+				return;
+			}
+			fname = argv[i];
+		}
+	}
+
+	if (!fname)
+	{
+		respond_error(cl->fd, "ELF file name required");
+		return;
+	}
+
+	char err[256];
+	cache_entry_t *e = cache_acquire(cl->cache, fname, err, sizeof(err));
+	if (!e)
+	{
+		respond_error(cl->fd, err);
+		return;
+	}
+
+	size_t len = 0;
+	char *text = cache_entry_get_response(cl->cache, e, query_key, &len);
+	const bool cached = (text != NULL);
+	if (!cached)
+	{
+		FILE *out = open_memstream(&text, &len);
+		if (!out)
+		{
+			fatal_err("Not enough memory");
+		}
+		symtab_dump_to(cache_entry_get_symtab(e), out, &filter);
+		fclose(out);
+
+		cache_entry_add_response(cl->cache, e, query_key, text, len);
+	}
+	cache_release(cl->cache, e);
+
+	if (write_all(cl->fd, "OK\n", 3))
+	{
+		write_all(cl->fd, text, len);
+	}
+	free(text);
+
+	report(VERB, "Query for %s answered in %.3fms%s", fname, elapsed_ms(&start), cached ? " (cached)" : "");
+}
+
+static void *	client_thread(void* arg)
+{
+	client *cl = arg;
+
+	char *query = malloc(MAX_QUERY_LEN);
+	if (!query)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	if (read_query(cl->fd, query, MAX_QUERY_LEN))
+	{
+		serve_query(cl, query);
+	}
+	else
+	{
+		respond_error(cl->fd, "Malformed query");
+	}
+
+	free(query);
+	close(cl->fd);
+	free(cl);
+	return NULL;
+}
+
+static void	fill_sock_addr(struct sockaddr_un* addr, const char* sock_name)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(sock_name) >= sizeof(addr->sun_path))
+	{
+		fatal("Socket name too long (%s)", sock_name);
+	}
+	strcpy(addr->sun_path, sock_name);
+}
+
+/**
+ * Listens on the given UNIX socket and answers queries until interrupted with SIGINT or SIGTERM.
+ * The files queried are kept in memory as long as they fit into cache_mem bytes.
+ */
+extern void	server_run(const char* sock_name, size_t cache_mem)
+{
+	assert(sock_name);
+
+	struct sockaddr_un addr;
+	fill_sock_addr(&addr, sock_name);
+
+	int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (lfd == -1)
+	{
+		fatal_err("Cannot create socket");
+	}
+
+	// The socket may be left over from a server that is not running anymore, which is replaced below
+	int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+	const bool in_use = (probe != -1) && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+	close(probe);
+	if (in_use)
+	{
+		fatal("Cannot bind to socket %s (a server is running on it)", sock_name);
+	}
+
+	// Bound under a name of its own, the socket is given its name once listening, so that a client
+	// seeing it never has its connection refused
+	char tmp_name[sizeof(addr.sun_path) + 32];
+	snprintf(tmp_name, sizeof(tmp_name), "%s.%ld", sock_name, (long)getpid());
+	struct sockaddr_un tmp_addr;
+	fill_sock_addr(&tmp_addr, tmp_name);
+	unlink(tmp_name);
+	if (bind(lfd, (struct sockaddr *)&tmp_addr, sizeof(tmp_addr)) == -1)
+	{
+		fatal("Cannot bind to socket %s (%s)", tmp_name, strerror(errno));
+	}
+
+	if (listen(lfd, SOMAXCONN) == -1 || rename(tmp_name, sock_name) == -1)
+	{
+		const int err = errno;
+		unlink(tmp_name);
+		fatal("Cannot listen on socket %s (%s)", sock_name, strerror(err));
+	}
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_stop_signal; // no SA_RESTART: accept() must return
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	// Only this thread is to handle the stop signals
+	sigset_t stop_sigs, old_sigs;
+	sigemptyset(&stop_sigs);
+	sigaddset(&stop_sigs, SIGINT);
+	sigaddset(&stop_sigs, SIGTERM);
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	cache_t *cache = cache_alloc(cache_mem);
+
+	report(NORM, "Serving queries on %s (cache budget %zuK)", sock_name, cache_mem >> 10);
+
+	while (!stop_requested)
+	{
+		const int fd = accept(lfd, NULL, NULL);
+		if (fd == -1)
+		{
+			if (errno != EINTR && errno != ECONNABORTED)
+			{
+				error("accept() failed (%s)", strerror(errno));
+			}
+			continue;
+		}
+
+		client *cl = malloc(sizeof(client));
+		if (!cl)
+		{
+			fatal_err("Not enough memory");
+		}
+		cl->fd = fd;
+		cl->cache = cache;
+
+		pthread_t tid;
+		pthread_sigmask(SIG_BLOCK, &stop_sigs, &old_sigs);
+		const int rc = pthread_create(&tid, &attr, client_thread, cl);
+		pthread_sigmask(SIG_SETMASK, &old_sigs, NULL);
+		if (rc != 0)
+		{
+			error("Cannot create thread (%s)", strerror(rc));
+			close(fd);
+			free(cl);
+		}
+	}
+
+	report(NORM, "Stopping the server");
+
+	// Client threads may still be using the cache, so it is left for exit() to reclaim
+	pthread_attr_destroy(&attr);
+	close(lfd);
+	unlink(sock_name);
+}
+
+/**
+ * Appends the argument to the query being composed in buf of the given size.
+ */
+static void	append_arg(char* buf, size_t size, size_t* len, const char* arg)
+{
+	if (strchr(arg, '\t') || strchr(arg, '\n'))
+	{
+		fatal("Arguments with tabs or newlines can not be sent to the server");
+	}
+
+	const int n = snprintf(buf + *len, size - *len, "%s\t", arg);
+	if (n < 0 || (size_t)n >= size - *len)
+	{
+		fatal("Query too long");
+	}
+	*len += (size_t)n;
+}
+
+/**
+ * Sends the query for the given file to the server listening on the socket and prints the response out.
+ * Returns the exit code for the program.
+ */
+extern int	server_query(const char* sock_name, const char* fname, const symtab_filter_t* filter)
+{
+	assert(sock_name && fname && filter);
+
+	// The server may run in another directory
+	char path[PATH_MAX];
+	if (!realpath(fname, path))
+	{
+		fatal("Cannot open input file (%s)", fname);
+	}
+
+	char query[MAX_QUERY_LEN];
+	size_t len = 0;
+	if (filter->funcs_only)
+		append_arg(query, sizeof(query), &len, "-f");
+	if (filter->offsets_decimal)
+		append_arg(query, sizeof(query), &len, "-d");
+	if (filter->show_types)
+		append_arg(query, sizeof(query), &len, "-t");
+	if (filter->name_pattern)
+	{
+		append_arg(query, sizeof(query), &len, filter->name_exact ? "-S" : "-s");
+		append_arg(query, sizeof(query), &len, filter->name_pattern);
+	}
+	if (filter->ref_pattern)
+	{
+		append_arg(query, sizeof(query), &len, "-r");
+		append_arg(query, sizeof(query), &len, filter->ref_pattern);
+	}
+	append_arg(query, sizeof(query), &len, path);
+	query[len - 1] = '\n'; // the last separator ends the query
+
+	struct sockaddr_un addr;
+	fill_sock_addr(&addr, sock_name);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd == -1)
+	{
+		fatal_err("Cannot create socket");
+	}
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+	{
+		fatal_err("Cannot connect to the server");
+	}
+	if (!write_all(fd, query, len))
+	{
+		fatal_err("Cannot send the query");
+	}
+
+	FILE *resp = fdopen(fd, "r");
+	if (!resp)
+	{
+		fatal_err("Cannot read the response");
+	}
+
+	char status[512];
+	if (!fgets(status, sizeof(status), resp))
+	{
+		fatal("No response from the server");
+	}
+	status[strcspn(status, "\n")] = 0;
+	if (strncmp(status, "ERR ", 4) == 0)
+	{
+		fatal("%s", status + 4);
+	}
+	if (strcmp(status, "OK") != 0)
+	{
+		fatal("Malformed response from the server");
+	}
+
+	bool empty_output = true;
+	char buf[BUFSIZ];
+	while ((len = fread(buf, 1, sizeof(buf), resp)) > 0)
+	{
+		fwrite(buf, 1, len, stdout);
+		empty_output = false;
+	}
+	fclose(resp);
+
+	if (empty_output)
+	{
+		symtab_report_empty(filter);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,250 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// LSD radix sort of 64-bit keys, one byte per pass. Stable, so elements with
+// equal keys keep their relative order. Large arrays are sorted by several
+// threads: each counts the digits in its own part of the array, and then
+// scatters that part to the positions that follow those of the preceding
+// threads' elements with the same digit.
+
+#include "sort.h"
+#include "errors.h"
+#include "globals.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RADIX_BITS		8
+#define RADIX			(1 << RADIX_BITS)
+#define NPASSES			(64 / RADIX_BITS)
+#define MIN_PER_THREAD		(64*1024)	// don't bother with threads for less than this
+#define MAX_THREADS		16
+
+/**
+ * Describes the sort shared by all threads.
+ */
+typedef struct sorter
+{
+	sort_kv_t *		src;		// the pass reads from here...
+	sort_kv_t *		dst;		// ...and writes here
+	size_t			n;
+	unsigned int		nthreads;
+	pthread_barrier_t	barrier;
+	pthread_mutex_t		lock;		// the threads wait under it until nthreads is known
+	pthread_cond_t		cond;
+	bool			go;
+	size_t			(*counts)[RADIX];	// per thread digit counts, then output positions
+	bool			skip;		// all keys have the same digit in this pass
+} sorter;
+
+/**
+ * Describes the part of the sort done by one thread.
+ */
+typedef struct worker
+{
+	sorter *	s;
+	unsigned int	id;
+} worker;
+
+static inline unsigned int	digit(uint64_t key, unsigned int pass)
+{
+	return (unsigned int)(key >> (pass*RADIX_BITS)) & (RADIX - 1);
+}
+
+/**
+ * Turns per thread digit counts into the positions each thread writes its elements with
+ * the given digit to; decides if the pass can be skipped.
+ */
+static void	compute_positions(sorter* s)
+{
+	size_t pos = 0;
+	s->skip = false;
+	for (unsigned int d = 0; d < RADIX; ++d)
+	{
+		size_t total = 0;
+		for (unsigned int t = 0; t < s->nthreads; ++t)
+		{
+			const size_t cnt = s->counts[t][d];
+			s->counts[t][d] = pos;
+			pos += cnt;
+			total += cnt;
+		}
+		if (total == s->n)
+		{
+			s->skip = true;
+		}
+	}
+}
+
+static void *	sort_part(void* arg)
+{
+	worker *w = arg;
+	sorter *s = w->s;
+
+	const size_t per_thread = (s->n + s->nthreads - 1) / s->nthreads;
+	const size_t lo = w->id*per_thread < s->n ? w->id*per_thread : s->n;
+	const size_t hi = lo + per_thread < s->n ? lo + per_thread : s->n;
+
+	for (unsigned int pass = 0; pass < NPASSES; ++pass)
+	{
+		size_t *counts = s->counts[w->id];
+		memset(counts, 0, RADIX*sizeof(size_t));
+		for (size_t i = lo; i < hi; ++i)
+		{
+			counts[digit(s->src[i].key, pass)]++;
+		}
+
+		if (s->nthreads > 1)
+			pthread_barrier_wait(&s->barrier);
+		if (w->id == 0)
+			compute_positions(s);
+		if (s->nthreads > 1)
+			pthread_barrier_wait(&s->barrier);
+
+		if (s->skip)
+			continue;
+
+		for (size_t i = lo; i < hi; ++i)
+		{
+			s->dst[counts[digit(s->src[i].key, pass)]++] = s->src[i];
+		}
+
+		if (s->nthreads > 1)
+			pthread_barrier_wait(&s->barrier);
+		if (w->id == 0)
+		{
+			sort_kv_t *tmp = s->src;
+			s->src = s->dst;
+			s->dst = tmp;
+		}
+		if (s->nthreads > 1)
+			pthread_barrier_wait(&s->barrier);
+	}
+
+	return NULL;
+}
+
+/**
+ * The start routine of the threads other than the first: waits until it is known how many were started.
+ */
+static void *	sort_thread(void* arg)
+{
+	sorter *s = ((worker*)arg)->s;
+
+	pthread_mutex_lock(&s->lock);
+	while (!s->go)
+	{
+		pthread_cond_wait(&s->cond, &s->lock);
+	}
+	pthread_mutex_unlock(&s->lock);
+
+	return sort_part(arg);
+}
+
+/**
+ * Sorts the array by key in the ascending order keeping the order of the elements with equal keys.
+ */
+extern void	sort_radix_kv(sort_kv_t* v, size_t n)
+{
+	assert(v || n == 0);
+
+	if (n < 2)
+		return;
+
+	sorter s = { .src = v, .n = n, .nthreads = 1 };
+
+	const size_t ncpus = glob_get_threads();
+	if (ncpus > 1 && n >= 2*MIN_PER_THREAD)
+	{
+		const size_t by_size = n / MIN_PER_THREAD;
+		s.nthreads = (unsigned int)(by_size < ncpus ? by_size : ncpus);
+		if (s.nthreads > MAX_THREADS)
+			s.nthreads = MAX_THREADS;
+	}
+
+	s.dst = malloc(n*sizeof(sort_kv_t));
+	s.counts = malloc(s.nthreads*sizeof(*s.counts));
+	if (!s.dst || !s.counts)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	worker workers[MAX_THREADS];
+	for (unsigned int t = 0; t < s.nthreads; ++t)
+	{
+		workers[t].s = &s;
+		workers[t].id = t;
+	}
+
+	if (s.nthreads == 1)
+	{
+		sort_part(&workers[0]);
+	}
+	else
+	{
+		pthread_t tids[MAX_THREADS];
+		pthread_mutex_init(&s.lock, NULL);
+		pthread_cond_init(&s.cond, NULL);
+		unsigned int nstarted = 1;
+		for (; nstarted < s.nthreads; ++nstarted)
+		{
+			if (pthread_create(&tids[nstarted], NULL, sort_thread, &workers[nstarted]) != 0)
+				break; // the threads that started sort the parts
+		}
+
+		// The parts and the barrier are for as many threads as started
+		pthread_mutex_lock(&s.lock);
+		s.nthreads = nstarted;
+		if (s.nthreads > 1)
+			pthread_barrier_init(&s.barrier, NULL, s.nthreads);
+		s.go = true;
+		pthread_cond_broadcast(&s.cond);
+		pthread_mutex_unlock(&s.lock);
+
+		sort_part(&workers[0]);
+		for (unsigned int t = 1; t < nstarted; ++t)
+		{
+			pthread_join(tids[t], NULL);
+		}
+		if (s.nthreads > 1)
+			pthread_barrier_destroy(&s.barrier);
+		pthread_cond_destroy(&s.cond);
+		pthread_mutex_destroy(&s.lock);
+	}
+
+	// After an odd number of passes made the result is in the scratch array
+	if (s.src != v)
+	{
+		memcpy(v, s.src, n*sizeof(sort_kv_t));
+		s.dst = s.src;
+	}
+	free(s.dst);
+	free(s.counts);
+}
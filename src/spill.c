@@ -0,0 +1,504 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+
+// External sort of the references (--mem-limit), for when they do not fit in
+// memory and the relocations are not in the order of their offsets to be
+// printed as they are read.
+//
+// The references are gathered in a buffer as large as the memory budget
+// allows. Once it is full, it is sorted by offset and written out to a
+// temporary file as a run. In the end, the runs are merged and the references
+// go to the symbol table in the order of their offsets, each symbol being
+// printed out and released as soon as its references are all there (see
+// symtab_dump_upto()). The sort is stable and the runs are merged in the
+// order they were written in, so references with the same offset keep the
+// order they were added in and the output is that of symtab_dump().
+
+#include "spill.h"
+#include "symtab.h"
+#include "sort.h"
+#include "errors.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHUNK_REFS	2048		// references written out or read in at a time, at most
+#define MAX_RUNS	128		// merged at once
+
+/**
+ * A reference as it is kept in the buffer and in the temporary files.
+ */
+typedef struct spill_ref
+{
+	size_t		offset;
+	const char *	sym_name;	// in the input's mapping, which outlives the spill
+	int64_t		addend;
+	uint32_t	type;
+	bool		is_func;
+} spill_ref;
+
+/**
+ * A sorted run of references being merged: in a temporary file or, if there are none, in the buffer.
+ */
+typedef struct run
+{
+	int			fd;		// -1 for the buffer
+	spill_ref *		chunk;		// read in from fd
+	size_t			chunk_refs;
+	const sort_kv_t *	kv;		// the buffer in the order of offsets
+	const spill_ref *	refs;
+	size_t			pos;		// of the next reference in chunk or kv
+	size_t			end;
+	spill_ref		ref;		// the reference read last
+	size_t			idx;		// of the run, breaks ties in the merge
+} run;
+
+struct spill_s
+{
+	size_t		mem_limit;	// bytes
+	size_t		max_refs;	// in the buffer, as the memory budget allows
+	spill_ref *	refs;		// the buffer
+	size_t		nrefs;
+	size_t		size;		// references allocated
+	sort_kv_t *	kv;		// sort keys of the buffer
+	size_t		kv_size;
+	int *		fds;		// the temporary files, one per run
+	size_t		nfds;
+	size_t		nspilled;	// references written out
+};
+
+/**
+ * Allocates an external sort of references that keeps no more than about mem_limit bytes of them in memory.
+ * The allocated resources must be released with spill_free().
+ */
+extern spill_t *	spill_alloc(size_t mem_limit)
+{
+	spill_t *sp = calloc(1, sizeof(spill_t));
+	if (!sp)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	sp->mem_limit = mem_limit;
+
+	// A reference takes its sort key and the key's copy sort_radix_kv() makes besides itself
+	sp->max_refs = mem_limit / (sizeof(spill_ref) + 2*sizeof(sort_kv_t));
+	if (sp->max_refs < 1)
+	{
+		sp->max_refs = 1;
+	}
+
+	return sp;
+}
+
+/**
+ * Releases the resources of the external sort and removes its temporary files.
+ */
+extern void	spill_free(spill_t* sp)
+{
+	if (!sp)
+		return;
+
+	for (size_t i = 0; i < sp->nfds; ++i)
+	{
+		close(sp->fds[i]);
+	}
+	free(sp->fds);
+	free(sp->kv);
+	free(sp->refs);
+	free(sp);
+}
+
+/**
+ * Returns a new temporary file in $TMPDIR or /tmp, already unlinked so that it goes away once closed.
+ */
+static int	temp_file(void)
+{
+	const char *dir = getenv("TMPDIR");
+	if (!dir || !*dir)
+	{
+		dir = "/tmp";
+	}
+
+	const size_t len = strlen(dir) + sizeof("/elfref-XXXXXX");
+	char *path = malloc(len);
+	if (!path)
+	{
+		fatal_err("Not enough memory");
+	}
+	snprintf(path, len, "%s/elfref-XXXXXX", dir);
+
+	const int fd = mkstemp(path);
+	if (fd < 0)
+	{
+		fatal_err("Unable to create a temporary file");
+	}
+	unlink(path);
+	free(path);
+
+	return fd;
+}
+
+/**
+ * Sorts the buffer by offset: the result is in sp->kv.
+ */
+static void	sort_buffer(spill_t* sp)
+{
+	if (sp->kv_size < sp->size)
+	{
+		free(sp->kv);
+		sp->kv_size = sp->size;
+		sp->kv = malloc(sp->kv_size*sizeof(sort_kv_t));
+		if (!sp->kv)
+		{
+			fatal_err("Not enough memory");
+		}
+	}
+
+	for (size_t i = 0; i < sp->nrefs; ++i)
+	{
+		sp->kv[i].key = sp->refs[i].offset;
+		sp->kv[i].idx = i;
+	}
+	sort_radix_kv(sp->kv, sp->nrefs);
+}
+
+static void	write_all(int fd, const void* data, size_t size)
+{
+	for (const char *p = data; size; )
+	{
+		const ssize_t n = write(fd, p, size);
+		if (n < 0)
+		{
+			fatal_err("Unable to write a temporary file");
+		}
+		p += n;
+		size -= (size_t)n;
+	}
+}
+
+/**
+ * Adds a new temporary file for a run at the given position among the runs, returning its descriptor.
+ */
+static int	insert_run(spill_t* sp, size_t pos)
+{
+	int *fds = realloc(sp->fds, (sp->nfds + 1)*sizeof(int));
+	if (!fds)
+	{
+		fatal_err("Not enough memory");
+	}
+	sp->fds = fds;
+
+	memmove(&sp->fds[pos + 1], &sp->fds[pos], (sp->nfds - pos)*sizeof(int));
+	sp->fds[pos] = temp_file();
+	sp->nfds++;
+
+	return sp->fds[pos];
+}
+
+/**
+ * Sorts the buffer and writes it out to a new temporary file as the last run, emptying the buffer.
+ */
+static void	write_run(spill_t* sp)
+{
+	sort_buffer(sp);
+
+	const int fd = insert_run(sp, sp->nfds);
+
+	spill_ref chunk[CHUNK_REFS];
+	for (size_t i = 0; i < sp->nrefs; )
+	{
+		size_t n = 0;
+		for (; n < CHUNK_REFS && i < sp->nrefs; ++n, ++i)
+		{
+			chunk[n] = sp->refs[sp->kv[i].idx];
+		}
+		write_all(fd, chunk, n*sizeof(spill_ref));
+	}
+
+	sp->nspilled += sp->nrefs;
+	sp->nrefs = 0;
+}
+
+/**
+ * Adds a reference made at the given offset; see symtab_add_reloc() for the rest of the arguments.
+ */
+extern void	spill_add(spill_t* sp, size_t offset, const char* sym_name, bool is_func, uint32_t type, int64_t addend)
+{
+	assert(sp);
+
+	if (sp->nrefs == sp->max_refs)
+	{
+		write_run(sp);
+	}
+
+	if (sp->nrefs == sp->size)
+	{
+		const size_t size = sp->size ? 2*sp->size : 1024;
+		sp->size = (size < sp->max_refs) ? size : sp->max_refs;
+		sp->refs = realloc(sp->refs, sp->size*sizeof(spill_ref));
+		if (!sp->refs)
+		{
+			fatal_err("Not enough memory");
+		}
+	}
+
+	sp->refs[sp->nrefs++] = (spill_ref){ .offset = offset, .sym_name = sym_name, .addend = addend,
+					     .type = type, .is_func = is_func };
+}
+
+/**
+ * Reads the next reference of the run into r->ref. Returns false if the run is over.
+ */
+static bool	run_next(run* r)
+{
+	if (r->fd < 0)
+	{
+		if (r->pos == r->end)
+			return false;
+
+		r->ref = r->refs[r->kv[r->pos++].idx];
+		return true;
+	}
+
+	if (r->pos == r->end)
+	{
+		const ssize_t n = read(r->fd, r->chunk, r->chunk_refs*sizeof(spill_ref));
+		if (n < 0 || (size_t)n % sizeof(spill_ref) != 0)
+		{
+			fatal_err("Unable to read a temporary file");
+		}
+		r->pos = 0;
+		r->end = (size_t)n / sizeof(spill_ref);
+		if (r->end == 0)
+			return false;
+	}
+
+	r->ref = r->chunk[r->pos++];
+	return true;
+}
+
+static bool	run_less(const run* a, const run* b)
+{
+	return a->ref.offset < b->ref.offset || (a->ref.offset == b->ref.offset && a->idx < b->idx);
+}
+
+static void	heap_sift_down(run** heap, size_t n, size_t i)
+{
+	for (size_t least = i; ; i = least)
+	{
+		const size_t l = 2*i + 1;
+		const size_t r = l + 1;
+		if (l < n && run_less(heap[l], heap[least]))
+			least = l;
+		if (r < n && run_less(heap[r], heap[least]))
+			least = r;
+		if (least == i)
+			break;
+
+		run *t = heap[i];
+		heap[i] = heap[least];
+		heap[least] = t;
+	}
+}
+
+/**
+ * Merges sorted runs, taking the references with the same offset from the runs in their order.
+ */
+typedef struct merge
+{
+	run *		runs;
+	run **		heap;
+	size_t		n;		// runs in the heap
+	spill_ref *	chunks;		// of the runs in files
+	spill_ref	ref;		// the reference taken last
+} merge;
+
+/**
+ * Starts merging the runs in the given files, each read in a chunk of its share of the memory budget, or, if
+ * there are none, the only run in the buffer.
+ */
+static void	merge_init(merge* m, spill_t* sp, const int* fds, size_t nfds)
+{
+	const size_t nruns = nfds ? nfds : 1;
+	size_t chunk_refs = sp->mem_limit / nruns / sizeof(spill_ref);
+	chunk_refs = (chunk_refs < 16) ? 16 : (chunk_refs > CHUNK_REFS) ? CHUNK_REFS : chunk_refs;
+
+	m->runs = calloc(nruns, sizeof(run));
+	m->heap = malloc(nruns*sizeof(run*));
+	m->chunks = nfds ? malloc(nfds*chunk_refs*sizeof(spill_ref)) : NULL;
+	if (!m->runs || !m->heap || (nfds && !m->chunks))
+	{
+		fatal_err("Not enough memory");
+	}
+
+	m->n = 0;
+	for (size_t i = 0; i < nruns; ++i)
+	{
+		run *r = &m->runs[i];
+		r->idx = i;
+		if (nfds)
+		{
+			r->fd = fds[i];
+			r->chunk = &m->chunks[i*chunk_refs];
+			r->chunk_refs = chunk_refs;
+			if (lseek(r->fd, 0, SEEK_SET) != 0)
+			{
+				fatal_err("Unable to read a temporary file");
+			}
+		}
+		else
+		{
+			r->fd = -1;
+			r->kv = sp->kv;
+			r->refs = sp->refs;
+			r->end = sp->nrefs;
+		}
+
+		if (run_next(r))
+		{
+			m->heap[m->n++] = r;
+		}
+	}
+
+	for (size_t i = m->n; i-- > 0; )
+	{
+		heap_sift_down(m->heap, m->n, i);
+	}
+}
+
+/**
+ * Returns the next reference in the order of offsets or NULL if there are no more.
+ */
+static const spill_ref *	merge_next(merge* m)
+{
+	if (m->n == 0)
+		return NULL;
+
+	m->ref = m->heap[0]->ref;
+	if (!run_next(m->heap[0]))
+	{
+		m->heap[0] = m->heap[--m->n];
+	}
+	heap_sift_down(m->heap, m->n, 0);
+
+	return &m->ref;
+}
+
+static void	merge_free(merge* m)
+{
+	free(m->chunks);
+	free(m->heap);
+	free(m->runs);
+}
+
+/**
+ * Merges the runs in files that are over MAX_RUNS, MAX_RUNS at a time, so that the number of files open and
+ * chunks read in at once stays limited. The merged run takes the place of those it is made of.
+ */
+static void	reduce_runs(spill_t* sp)
+{
+	while (sp->nfds > MAX_RUNS)
+	{
+		const int fd = insert_run(sp, 0);
+
+		merge m;
+		merge_init(&m, sp, &sp->fds[1], MAX_RUNS);
+
+		spill_ref chunk[CHUNK_REFS];
+		size_t n = 0;
+		for (const spill_ref *ref; (ref = merge_next(&m)) != NULL; )
+		{
+			chunk[n++] = *ref;
+			if (n == CHUNK_REFS)
+			{
+				write_all(fd, chunk, n*sizeof(spill_ref));
+				n = 0;
+			}
+		}
+		write_all(fd, chunk, n*sizeof(spill_ref));
+		merge_free(&m);
+
+		for (size_t i = 1; i <= MAX_RUNS; ++i)
+		{
+			close(sp->fds[i]);
+		}
+		memmove(&sp->fds[1], &sp->fds[1 + MAX_RUNS], (sp->nfds - 1 - MAX_RUNS)*sizeof(int));
+		sp->nfds -= MAX_RUNS;
+	}
+}
+
+/**
+ * Adds the references to the symbol table in the order of their offsets and prints out the symbols as
+ * symtab_dump_to() does, releasing each once printed. Returns the number of references printed.
+ */
+extern size_t	spill_dump(spill_t* sp, symtab_t* st, FILE* out, const symtab_filter_t* filter)
+{
+	assert(sp);
+	assert(st);
+	assert(out);
+	assert(filter);
+
+	// Either all the runs are in the files or the only one is in the buffer
+	if (sp->nfds)
+	{
+		if (sp->nrefs)
+		{
+			write_run(sp);
+		}
+		free(sp->kv);
+		free(sp->refs);
+		sp->kv = NULL;
+		sp->refs = NULL;
+		sp->kv_size = sp->size = 0;
+
+		report(VERB, "Sorted %zu references in %zu runs in temporary files", sp->nspilled, sp->nfds);
+		reduce_runs(sp);
+	}
+	else
+	{
+		sort_buffer(sp);
+	}
+
+	merge m;
+	merge_init(&m, sp, sp->fds, sp->nfds);
+
+	size_t nrefs = 0;
+	for (const spill_ref *ref; (ref = merge_next(&m)) != NULL; )
+	{
+		// The symbols before the one this reference is made from are complete
+		nrefs += symtab_dump_upto(st, out, filter, ref->offset);
+		symtab_add_reloc(st, ref->offset, ref->sym_name, ref->is_func, ref->type, ref->addend);
+	}
+	nrefs += symtab_dump_upto(st, out, filter, SIZE_MAX);
+
+	merge_free(&m);
+	return nrefs;
+}
@@ -0,0 +1,447 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+// Reference statistics (--summary): the most referenced symbols (fan-in), the
+// symbols making the most references (fan-out) and the number of references
+// to each section.
+//
+// The relocations are counted as they are read rather than kept: fan-out goes
+// to a counter of the referring symbol in the symbol table, fan-in to a hash
+// table of the referenced names, so memory is proportional to the number of
+// distinct symbols and not to the number of relocations.
+//
+// With --sample, each relocation is counted with probability RATE independently
+// of the others: the gaps between the ones counted are drawn from the geometric
+// distribution, so the records skipped are never read. A count c of those then
+// estimates c/RATE references with the standard error sqrt(c*(1 - RATE))/RATE.
+
+#include "summary.h"
+#include "symtab.h"
+#include "errors.h"
+
+#include <assert.h>
+#include <elf.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * A counter keyed by a name (a referenced symbol or a section).
+ */
+typedef struct counter
+{
+	const char *	name;		// NULL in an empty slot
+	uint64_t	hash;
+	size_t		count;
+	bool		is_func;
+} counter;
+
+/**
+ * Open addressing hash table of counters.
+ */
+typedef struct counters
+{
+	counter *	slots;
+	size_t		nslots;		// a power of 2
+	size_t		n;		// used slots
+} counters;
+
+struct summary_s
+{
+	const symtab_filter_t *	filter;
+	counters		refs;		// fan-in, keyed by the referenced name
+	counters		secs;		// keyed by the referenced section
+	size_t			nrefs;		// references counted
+	size_t			nunattributed;	// of those, not made from within any symbol
+	double			rate;		// the share of relocations counted (see summary_set_sample())
+	double			log_skip;	// log(1 - rate)
+	uint64_t		rng;		// state of the pseudo-random choice of the relocations counted
+};
+
+static uint64_t	hash_name(const char* s)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (; *s; ++s)
+	{
+		h = (h ^ (unsigned char)*s) * 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static void	counters_init(counters* c, size_t nslots)
+{
+	c->slots = calloc(nslots, sizeof(counter));
+	if (!c->slots)
+	{
+		fatal_err("Not enough memory");
+	}
+	c->nslots = nslots;
+	c->n = 0;
+}
+
+/**
+ * Returns the counter of the given name, adding one if there is none.
+ */
+static counter *	counters_get(counters* c, const char* name)
+{
+	if (2*(c->n + 1) > c->nslots)
+	{
+		counters old = *c;
+		counters_init(c, 2*old.nslots);
+		for (size_t i = 0; i < old.nslots; ++i)
+		{
+			if (old.slots[i].name)
+			{
+				size_t k = old.slots[i].hash & (c->nslots - 1);
+				while (c->slots[k].name)
+					k = (k + 1) & (c->nslots - 1);
+				c->slots[k] = old.slots[i];
+			}
+		}
+		c->n = old.n;
+		free(old.slots);
+	}
+
+	const uint64_t h = hash_name(name);
+	size_t k = h & (c->nslots - 1);
+	for (; c->slots[k].name; k = (k + 1) & (c->nslots - 1))
+	{
+		// Names come from the same string table, so the pointers most often match
+		if (c->slots[k].hash == h && (c->slots[k].name == name || strcmp(c->slots[k].name, name) == 0))
+			return &c->slots[k];
+	}
+
+	c->slots[k] = (counter){ .name = name, .hash = h };
+	c->n++;
+	return &c->slots[k];
+}
+
+/**
+ * Allocates the counters for references that pass the given filter.
+ * The allocated resources must be released with summary_free().
+ */
+extern summary_t *	summary_alloc(const symtab_filter_t* filter)
+{
+	assert(filter);
+
+	summary_t *sm = calloc(1, sizeof(summary_t));
+	if (!sm)
+	{
+		fatal_err("Not enough memory");
+	}
+	sm->filter = filter;
+	sm->rate = 1;
+	counters_init(&sm->refs, 1024);
+	counters_init(&sm->secs, 64);
+
+	return sm;
+}
+
+/**
+ * Releases resources associated with the given summary.
+ */
+extern void	summary_free(summary_t* sm)
+{
+	if (!sm)
+		return;
+
+	free(sm->secs.slots);
+	free(sm->refs.slots);
+	free(sm);
+}
+
+/**
+ * Makes the statistics estimates from a pseudo-random sample of the given share of relocations, the same
+ * one for the same seed. The relocations to count are chosen with summary_sample_gap().
+ */
+extern void	summary_set_sample(summary_t* sm, double rate, uint64_t seed)
+{
+	assert(sm);
+	assert(rate > 0 && rate <= 1);
+
+	sm->rate = rate;
+	sm->log_skip = log1p(-rate);
+	sm->rng = seed;
+}
+
+/**
+ * Returns true if the statistics are estimated from a sample of the relocations.
+ */
+extern bool	summary_is_sampled(const summary_t* sm)
+{
+	assert(sm);
+
+	return sm->rate < 1;
+}
+
+/**
+ * Returns how many relocations to skip before the next one to count.
+ */
+extern size_t	summary_sample_gap(summary_t* sm)
+{
+	assert(sm);
+
+	if (sm->rate >= 1)
+		return 0;
+
+	// splitmix64
+	uint64_t z = (sm->rng += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	z ^= z >> 31;
+
+	const double u = (double)((z >> 11) + 1) / 9007199254740992.0; // uniform in (0, 1]
+	const double gap = floor(log(u) / sm->log_skip);
+	return (gap < (double)(SIZE_MAX >> 1)) ? (size_t)gap : SIZE_MAX >> 1;
+}
+
+/**
+ * Counts the reference made from offset (which determines the referring symbol in st) to the given symbol,
+ * if any, in the given section.
+ */
+extern void	summary_add_ref(summary_t* sm, symtab_t* st, size_t offset, const char* ref_name, bool ref_is_func,
+				const char* target_sec)
+{
+	assert(sm);
+	assert(st);
+	assert(target_sec);
+
+	if (!symtab_filter_match_ref(sm->filter, ref_name))
+		return;
+
+	sm->nrefs++;
+	if (!symtab_count_reloc(st, offset))
+	{
+		sm->nunattributed++;
+	}
+
+	if (ref_name && *ref_name)
+	{
+		counter *c = counters_get(&sm->refs, ref_name);
+		c->count++;
+		c->is_func = ref_is_func;
+	}
+
+	counters_get(&sm->secs, target_sec)->count++;
+}
+
+/**
+ * An entry of a top-N list.
+ */
+typedef struct top_item
+{
+	const char *	name;
+	size_t		count;
+	size_t		addr;
+	bool		is_func;
+} top_item;
+
+/**
+ * Returns true if a goes before b in a top-N list: the higher count first, then by name.
+ */
+static bool	top_before(const top_item* a, const top_item* b)
+{
+	return a->count > b->count || (a->count == b->count && strcmp(a->name, b->name) < 0);
+}
+
+/**
+ * Keeps the best (see top_before()) items in a min-heap of up to max elements: the worst of those at the root.
+ */
+typedef struct top_list
+{
+	top_item *	heap;
+	size_t		n;
+	size_t		max;
+} top_list;
+
+static void	top_init(top_list* t, size_t max)
+{
+	t->heap = malloc((max ? max : 1)*sizeof(top_item));
+	if (!t->heap)
+	{
+		fatal_err("Not enough memory");
+	}
+	t->n = 0;
+	t->max = max;
+}
+
+static void	top_sift_down(top_list* t, size_t i)
+{
+	for (;;)
+	{
+		size_t worst = i;
+		const size_t l = 2*i + 1;
+		const size_t r = 2*i + 2;
+		if (l < t->n && top_before(&t->heap[worst], &t->heap[l]))
+			worst = l;
+		if (r < t->n && top_before(&t->heap[worst], &t->heap[r]))
+			worst = r;
+		if (worst == i)
+			break;
+
+		const top_item tmp = t->heap[i];
+		t->heap[i] = t->heap[worst];
+		t->heap[worst] = tmp;
+		i = worst;
+	}
+}
+
+static void	top_add(top_list* t, const top_item* item)
+{
+	if (t->n < t->max)
+	{
+		// Sift up
+		size_t i = t->n++;
+		t->heap[i] = *item;
+		while (i > 0 && top_before(&t->heap[(i - 1)/2], &t->heap[i]))
+		{
+			const top_item tmp = t->heap[i];
+			t->heap[i] = t->heap[(i - 1)/2];
+			t->heap[(i - 1)/2] = tmp;
+			i = (i - 1)/2;
+		}
+	}
+	else if (t->n > 0 && top_before(item, &t->heap[0]))
+	{
+		t->heap[0] = *item;
+		top_sift_down(t, 0);
+	}
+}
+
+/**
+ * Empties the heap into its array best first; t->n items are there afterwards.
+ */
+static void	top_sort(top_list* t)
+{
+	const size_t n = t->n;
+	while (t->n > 1)
+	{
+		const top_item worst = t->heap[0];
+		t->heap[0] = t->heap[--t->n];
+		top_sift_down(t, 0);
+		t->heap[t->n] = worst;
+	}
+	t->n = n;
+}
+
+static void	top_add_counters(top_list* t, const counters* c)
+{
+	for (size_t i = 0; i < c->nslots; ++i)
+	{
+		if (c->slots[i].name)
+		{
+			const top_item item = { .name = c->slots[i].name, .count = c->slots[i].count, .is_func = c->slots[i].is_func };
+			top_add(t, &item);
+		}
+	}
+}
+
+static void	top_add_sym(void* ctx, const char* name, int type, size_t addr, size_t nrefs)
+{
+	const top_item item = { .name = name, .count = nrefs, .addr = addr, .is_func = (type == STT_FUNC) };
+	top_add(ctx, &item);
+}
+
+/**
+ * Prints out a count or, if the relocations were sampled, the estimate of it and its 95% confidence bounds.
+ */
+static void	print_count(FILE* out, const summary_t* sm, size_t count)
+{
+	if (sm->rate >= 1)
+	{
+		fprintf(out, "\t%10zu  ", count);
+		return;
+	}
+
+	const double c = (double)count;
+	fprintf(out, "\t%10.0f +-%-8.0f ", c/sm->rate, 1.96*sqrt(c*(1 - sm->rate))/sm->rate);
+}
+
+/**
+ * Prints out the statistics: up to top symbols of the highest fan-in and fan-out each, and the number
+ * of references to every section.
+ */
+extern void	summary_print(summary_t* sm, symtab_t* st, FILE* out, size_t top)
+{
+	assert(sm);
+	assert(st);
+	assert(out);
+
+	top_list t;
+
+	if (sm->rate < 1)
+	{
+		fprintf(out, "Estimated from %zu references sampled at rate %g (95%% confidence bounds):\n", sm->nrefs,
+			sm->rate);
+	}
+
+	fprintf(out, "Most referenced symbols:\n");
+	top_init(&t, top);
+	top_add_counters(&t, &sm->refs);
+	top_sort(&t);
+	for (size_t i = 0; i < t.n; ++i)
+	{
+		print_count(out, sm, t.heap[i].count);
+		fprintf(out, "%s%s\n", t.heap[i].name, t.heap[i].is_func ? "()" : "");
+	}
+	free(t.heap);
+
+	fprintf(out, "Symbols making the most references:\n");
+	top_init(&t, top);
+	const size_t nsyms = symtab_walk_syms(st, sm->filter, top_add_sym, &t);
+	top_sort(&t);
+	for (size_t i = 0; i < t.n; ++i)
+	{
+		print_count(out, sm, t.heap[i].count);
+		fprintf(out, "%s (addr 0x%08lx)\n", t.heap[i].name, t.heap[i].addr);
+	}
+	free(t.heap);
+
+	fprintf(out, "References by target section:\n");
+	top_init(&t, sm->secs.n);
+	top_add_counters(&t, &sm->secs);
+	top_sort(&t);
+	for (size_t i = 0; i < t.n; ++i)
+	{
+		print_count(out, sm, t.heap[i].count);
+		fprintf(out, "%s\n", t.heap[i].name);
+	}
+	free(t.heap);
+
+	if (sm->rate < 1)
+	{
+		// Symbols and names that none of the sampled references involve are not seen at all
+		fprintf(out, "Total: %.0f references (%.0f not from within a symbol) from at least %zu symbols to at least "
+			"%zu names\n", (double)sm->nrefs/sm->rate, (double)sm->nunattributed/sm->rate, nsyms, sm->refs.n);
+	}
+	else
+	{
+		fprintf(out, "Total: %zu references (%zu not from within a symbol) from %zu symbols to %zu names\n",
+			sm->nrefs, sm->nunattributed, nsyms, sm->refs.n);
+	}
+}
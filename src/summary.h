@@ -0,0 +1,49 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+#ifndef SUMMARY_H_
+#define SUMMARY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct summary_s	summary_t;
+typedef struct symtab_s		symtab_t;
+typedef struct symtab_filter	symtab_filter_t;
+
+summary_t *	summary_alloc(const symtab_filter_t* filter);
+void		summary_free(summary_t* sm);
+void		summary_set_sample(summary_t* sm, double rate, uint64_t seed);
+bool		summary_is_sampled(const summary_t* sm);
+size_t		summary_sample_gap(summary_t* sm);
+void		summary_add_ref(summary_t* sm, symtab_t* st, size_t offset, const char* ref_name, bool ref_is_func,
+				const char* target_sec);
+void		summary_print(summary_t* sm, symtab_t* st, FILE* out, size_t top);
+
+#endif
@@ -27,64 +27,355 @@
 
 #include "symtab.h"
 #include "errors.h"
-#include "args.h"
+#include "globals.h"
+#include "sort.h"
+#include "dwarf.h"
+#include "reltype.h"
+#include "trace.h"
 
 #include <stdlib.h>
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <elf.h>
+#include <pthread.h>
+
+#define MAX_STRINGS	8		// string tables of which names are kept as offsets (see symtab_add_strings())
+#define NAME_NONE	0		// name of a reference to no symbol
+#define REF_TYPE	0x3fff		// in the type column of a reference: its type (R_*) if it fits...
+#define REF_WIDE	0x4000		// ...or else, this flag and the index of its wide_ref in the addend column
+#define REF_FUNC	0x8000		// ...and whether the referenced symbol is a function
+#define MAX_THREADS	16		// formatting the output of symtab_dump_to()
+#define CHUNK_REFS	65536		// references a thread formats at a time, at least
+#define CHUNKS_AHEAD	4		// chunks per thread formatted ahead of the one being written out
 
 /**
- * Describes the properties of a relocation that are of interest. Keeps a linkd list of such records.
+ * A string table the names of symbols and references are in; a name is kept as the offset of its first
+ * character from the start of the first table, as if the tables went one after another.
  */
-typedef struct reloc
+typedef struct strings
 {
-	const char *	sym_name;	// refers this symbol name
-	bool		is_func;	// symbol is function?
-	size_t		offset;		// from the patched sym
-	int64_t		addend;		// relocation's addend, if rela
-	struct reloc *	next;		// linked list of relocations
-} reloc;
+	const char *	data;
+	size_t		size;
+	uint32_t	start;		// the name offset of data[0]
+} strings;
 
 /**
- * Describes the properties of an ELF symbol that are of interest.
+ * The type and addend of a reference that do not fit the columns (see REF_WIDE).
  */
-typedef struct sym
+typedef struct wide_ref
 {
-	size_t		offset;	// address of the sym
-	int 		type;	// type of the sym
-	const char *	name;	// symbol's name
-	struct reloc *	relocs;	// relocs that reference this symbol
-} sym;
+	int64_t		addend;
+	uint32_t	type;
+} wide_ref;
 
 /**
- * Describes a collection of ELF symbols (symtab).
+ * Describes a collection of ELF symbols (symtab) and the references made from them. Each property is kept
+ * in an array of its own (a column), so that the loops over them go through memory sequentially.
+ *
+ * The symbols sharing the same address (aliases, weak/strong pairs, section symbols) make a group once sorted;
+ * the relocations are attributed to the group and reported under every symbol in it. In a relocatable file,
+ * where every section starts at 0, the symbols of different sections make different groups. References are appended
+ * to the columns as they are added, along with their groups; once walked, they are put in rows by group and
+ * offset (CSR), the group column is dropped, and each takes 14 bytes.
  */
 typedef struct symtab_s
 {
-	sym *	syms;		// array of nsyms (or more) elements
-	size_t	nsyms;		// number of actual symbols in the syms array
-	size_t 	free_idx;	// index of the next "free" slot in the syms array
+	size_t *	sym_addr;	// address of each symbol, sorted by symtab_sort()
+	uint32_t *	sym_name;	// name of each symbol (see name_get())
+	uint8_t *	sym_type;	// type of each symbol (STT_*)
+	uint32_t *	sym_shndx;	// section each symbol is defined in, SHN_UNDEF if it is not
+	size_t *	sym_size;	// size of each symbol, 0 if not known
+	size_t		nsyms;		// number of symbols the columns have room for
+	size_t 		free_idx;	// index of the next "free" slot in them
+
+	size_t *	group_addr;	// address of the symbols of each group, available once sorted
+	uint32_t *	group_first;	// index of the first symbol of each group; group_first[ngroups] is nsyms
+	uint32_t *	group_count;	// relocs counted with symtab_count_reloc() rather than kept, if any
+	size_t		ngroups;
+	size_t *	eyt;		// groups' offsets in Eytzinger order (eyt[1] is the root), see locate_group()
+	size_t *	eyt_rank;	// index into groups of each eyt element
+	uint32_t *	name_index;	// symbols by name, see symtab_find_ranges(); NULL until needed
+	size_t		name_index_size;
+
+	uint32_t *	ref_group;	// group of each reference, until the rows are built
+	uint32_t *	ref_offset;	// offset of each reference from its group's address
+	uint32_t *	ref_name;	// name of the symbol each refers to or NAME_NONE
+	int32_t *	ref_addend;	// relocation's addend, if rela (or see REF_WIDE)
+	uint16_t *	ref_type;	// relocation's type and REF_* flags
+	size_t		nrefs;
+	size_t		refs_size;	// number of references the columns have room for
+	uint32_t *	row_start;	// references of group i are from row_start[i] to row_start[i + 1]; NULL until built
+	bool		ordered;	// references have been added in the order of group and offset
+	wide_ref *	wide;
+	size_t		nwide;
+	size_t		wide_size;
+
+	strings		strs[MAX_STRINGS];
+	size_t		nstrs;
+	uint32_t	strs_end;	// names from here on are kept in foreign
+	const char **	foreign;	// names that are not in the string tables
+	size_t		nforeign;
+	size_t		foreign_size;
+
+	size_t	nrelocs;	// number of relocations attributed to the symbols
+	const reltype_table_t *reltypes;	// relocation types of the file's machine, NULL if unknown
+	size_t	ndumped;	// groups printed and released by symtab_dump_upto()
+	size_t	refs_dumped;	// and their references
+	size_t	last_g;		// the group a relocation was added to last (see find_group())
 } symtab_s;
 
-static int	sym_compare(const void* s1, const void* s2)
+/**
+ * Grows the array at *p of elements of the given size to hold n of them.
+ */
+static void	grow(void* p, size_t n, size_t elem_size)
+{
+	void **pp = p;
+	void *grown = realloc(*pp, n*elem_size + 1);
+	if (!grown)
+	{
+		fatal_err("Not enough memory");
+	}
+	*pp = grown;
+}
+
+/**
+ * Tells the symbol table where the names of the symbols and references to be added to it lie, so that it keeps
+ * them as 32-bit offsets. Names elsewhere are kept too, but take a pointer more. Must be called before any
+ * symbols are added.
+ */
+extern void		symtab_add_strings(symtab_t* st, const char* data, size_t size)
+{
+	assert(st);
+	assert(st->free_idx == 0 && st->nforeign == 0);
+
+	if (st->nstrs == MAX_STRINGS || size >= UINT32_MAX - st->strs_end)
+		return;
+
+	st->strs[st->nstrs++] = (strings){ .data = data, .size = size, .start = st->strs_end };
+	st->strs_end += (uint32_t)size;
+}
+
+/**
+ * Returns the name offset to keep for the given name.
+ */
+static uint32_t	name_put(symtab_s* st, const char* name)
+{
+	if (!name)
+		return NAME_NONE;
+
+	const uintptr_t p = (uintptr_t)name;
+	for (size_t k = 0; k < st->nstrs; ++k)
+	{
+		const uintptr_t data = (uintptr_t)st->strs[k].data;
+		if (p >= data && p - data < st->strs[k].size)
+			return st->strs[k].start + (uint32_t)(p - data);
+	}
+
+	if (st->nforeign >= UINT32_MAX - st->strs_end)
+	{
+		fatal("Too many symbol names");
+	}
+	if (st->nforeign == st->foreign_size)
+	{
+		st->foreign_size = st->foreign_size ? 2*st->foreign_size : 64;
+		grow(&st->foreign, st->foreign_size, sizeof(const char *));
+	}
+	st->foreign[st->nforeign] = name;
+	return st->strs_end + (uint32_t)st->nforeign++;
+}
+
+/**
+ * Returns the name kept as the given offset by name_put().
+ */
+static const char *	name_get(const symtab_s* st, uint32_t name)
+{
+	if (name == NAME_NONE)
+		return NULL;
+
+	if (name >= st->strs_end)
+		return st->foreign[name - st->strs_end];
+
+	size_t k = st->nstrs - 1;
+	while (st->strs[k].start > name)
+	{
+		--k;
+	}
+	return st->strs[k].data + (name - st->strs[k].start);
+}
+
+/**
+ * Lays out sorted groups' offsets starting from index i in the Eytzinger order: the subtree
+ * rooted at k is placed in eyt. Returns the index of the next group to place.
+ */
+static size_t	eyt_fill(symtab_s* st, size_t i, size_t k)
+{
+	if (k <= st->ngroups)
+	{
+		i = eyt_fill(st, i, 2*k);
+		st->eyt[k] = st->group_addr[i];
+		st->eyt_rank[k] = i;
+		i = eyt_fill(st, i + 1, 2*k + 1);
+	}
+	return i;
+}
+
+/**
+ * Builds the search index over the groups' offsets (see locate_group()).
+ */
+static void	build_index(symtab_s* st)
+{
+	// Cache line aligned, so that the prefetch in locate_group() brings in whole descendant levels
+	const size_t size = ((st->ngroups + 1)*sizeof(size_t) + 63) & ~(size_t)63;
+	st->eyt = aligned_alloc(64, size);
+	st->eyt_rank = malloc((st->ngroups + 1)*sizeof(size_t));
+	if (!st->eyt || !st->eyt_rank)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	st->eyt[0] = 0; // unused
+	eyt_fill(st, 0, 1);
+}
+
+/**
+ * Returns how likely a symbol of the given type is to be the one the code or data at its offset is of.
+ */
+static uint64_t	sym_rank(int type)
+{
+	switch (type)
+	{
+	case STT_FUNC:
+	case STT_GNU_IFUNC:
+		return 2;
+	case STT_OBJECT:
+	case STT_COMMON:
+	case STT_TLS:
+		return 1;
+	default: // STT_NOTYPE, STT_SECTION, STT_FILE
+		return 0;
+	}
+}
+
+/**
+ * Orders kv, the symbols of a relocatable file, by their offset and at the same offset by their section,
+ * the sections being ordered by sym_rank() of their symbols there. The last of them is then the section of
+ * the symbol a relocation at that offset is likely to be in, which locate_group() gives.
+ */
+static void	sort_by_section(const symtab_s* st, sort_kv_t* kv, size_t n)
 {
-	const sym *sym1 = (const sym *)s1;
-	const sym *sym2 = (const sym *)s2;
+	// The sort is stable: sorted by offset, the symbols stay in the order of their sections
+	for (size_t i = 0; i < n; ++i)
+	{
+		kv[i].key = st->sym_shndx[kv[i].idx];
+	}
+	sort_radix_kv(kv, n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		kv[i].key = st->sym_addr[kv[i].idx];
+	}
+	sort_radix_kv(kv, n);
 
-	return  (sym1->offset > sym2->offset)
-		? 1
-		: (sym1->offset == sym2->offset ? 0 : -1);
+	for (size_t i = 0, j = 0; i < n; i = j)
+	{
+		const size_t addr = st->sym_addr[kv[i].idx];
+		const uint32_t shndx = st->sym_shndx[kv[i].idx];
+		uint64_t rank = 0;
+		for (j = i; j < n && st->sym_addr[kv[j].idx] == addr && st->sym_shndx[kv[j].idx] == shndx; ++j)
+		{
+			const uint64_t r = sym_rank(st->sym_type[kv[j].idx]);
+			rank = (r > rank) ? r : rank;
+		}
+		for (size_t k = i; k < j; ++k)
+		{
+			kv[k].key = rank;
+		}
+	}
+	sort_radix_kv(kv, n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		kv[i].key = st->sym_addr[kv[i].idx];
+	}
+	sort_radix_kv(kv, n);
 }
 
 /**
- * Sorts the given symbol table based on symbols offset.
+ * Sorts the given symbol table based on symbols offset and groups the symbols having the same offset.
+ * The symbols with the same offset stay in the order they were added in.
+ *
+ * If by_section is set (a relocatable file), where every section starts at 0, the symbols having the same
+ * offset are grouped by their sections as well (see sort_by_section()).
  */
-extern void	symtab_sort(symtab_t* st)
+extern void	symtab_sort(symtab_t* st, bool by_section)
 {
 	assert(st);
 	assert(st->free_idx > 0);
+	assert(!st->group_addr);
+
+	const size_t n = st->free_idx;
+	const uint64_t span = trace_begin();
+
+	sort_kv_t *kv = malloc(n*sizeof(sort_kv_t));
+	size_t *addr = malloc(n*sizeof(size_t));
+	uint32_t *name = malloc(n*sizeof(uint32_t));
+	uint8_t *type = malloc(n*sizeof(uint8_t));
+	uint32_t *shndx = malloc(n*sizeof(uint32_t));
+	size_t *size = malloc(n*sizeof(size_t));
+	st->group_addr = malloc(n*sizeof(size_t));
+	st->group_first = malloc((n + 1)*sizeof(uint32_t));
+	if (!kv || !addr || !name || !type || !shndx || !size || !st->group_addr || !st->group_first)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		kv[i].key = st->sym_addr[i];
+		kv[i].idx = i;
+	}
+	if (by_section)
+	{
+		sort_by_section(st, kv, n);
+	}
+	else
+	{
+		sort_radix_kv(kv, n);
+	}
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		const size_t k = kv[i].idx;
+		addr[i] = st->sym_addr[k];
+		name[i] = st->sym_name[k];
+		type[i] = st->sym_type[k];
+		shndx[i] = st->sym_shndx[k];
+		size[i] = st->sym_size[k];
+
+		if (i == 0 || addr[i] != addr[i - 1] || (by_section && shndx[i] != shndx[i - 1]))
+		{
+			st->group_addr[st->ngroups] = addr[i];
+			st->group_first[st->ngroups] = (uint32_t)i;
+			st->ngroups++;
+		}
+	}
+	st->group_first[st->ngroups] = (uint32_t)n;
+
+	free(kv);
+	free(st->sym_addr);
+	free(st->sym_name);
+	free(st->sym_type);
+	free(st->sym_shndx);
+	free(st->sym_size);
+	st->sym_addr = addr;
+	st->sym_name = name;
+	st->sym_type = type;
+	st->sym_shndx = shndx;
+	st->sym_size = size;
+	st->nsyms = n;
 
-	qsort(st->syms, st->free_idx, sizeof(sym), sym_compare);
+	build_index(st);
+	trace_end(span, "symtab", "sort", NULL, n);
 }
 
 /**
@@ -93,25 +384,53 @@ extern void	symtab_sort(symtab_t* st)
  */
 extern symtab_t*	symtab_alloc(size_t nsyms)
 {
-	sym *syms = calloc(nsyms, sizeof(sym));
-	if (!syms)
+	if (nsyms >= UINT32_MAX)
 	{
-		fatal_err("Not enough memory");
+		fatal("Too many symbols (%zu)", nsyms);
 	}
 
-	symtab_s *st = malloc(sizeof(symtab_s));
+	symtab_s *st = calloc(1, sizeof(symtab_s));
 	if (!st)
 	{
 		fatal_err("Not enough memory");
 	}
 
-	st->syms = syms;
+	st->sym_addr = malloc(nsyms*sizeof(size_t) + 1);
+	st->sym_name = malloc(nsyms*sizeof(uint32_t) + 1);
+	st->sym_type = malloc(nsyms*sizeof(uint8_t) + 1);
+	st->sym_shndx = malloc(nsyms*sizeof(uint32_t) + 1);
+	st->sym_size = malloc(nsyms*sizeof(size_t) + 1);
+	if (!st->sym_addr || !st->sym_name || !st->sym_type || !st->sym_shndx || !st->sym_size)
+	{
+		fatal_err("Not enough memory");
+	}
+
 	st->nsyms = nsyms;
-	st->free_idx = 0;
+	st->strs_end = NAME_NONE + 1;
+	st->ordered = true;
+	st->last_g = SIZE_MAX;
 
 	return st;
 }
 
+/**
+ * Returns the approximate amount of heap memory (in bytes) occupied by the symbol table.
+ * The symbol names are not included as they reside in the input file's mapping.
+ */
+extern size_t		symtab_get_mem_usage(symtab_t* s)
+{
+	assert(s);
+
+	const size_t sym_size = 2*sizeof(size_t) + 2*sizeof(uint32_t) + sizeof(uint8_t);
+	const size_t group_size = 3*sizeof(size_t) + sizeof(uint32_t) + (s->group_count ? sizeof(uint32_t) : 0)
+		+ (s->row_start ? sizeof(uint32_t) : 0);
+	const size_t ref_size = 3*sizeof(uint32_t) + sizeof(uint16_t) + (s->ref_group ? sizeof(uint32_t) : 0);
+
+	return sizeof(symtab_s) + s->nsyms*sym_size + s->ngroups*group_size + s->refs_size*ref_size
+		+ s->wide_size*sizeof(wide_ref) + s->foreign_size*sizeof(const char *)
+		+ s->name_index_size*sizeof(uint32_t);
+}
+
 /**
  * Releases the resources allocated for the symbol table (see symtab_alloc()).
  */
@@ -119,212 +438,1145 @@ extern void		symtab_free(symtab_t* s)
 {
 	assert(s);
 
-	for (size_t i = 0; i < s->free_idx; ++i)
-	{
-		reloc *relocs = s->syms[i].relocs;
-		while (relocs)
-		{
-			reloc *next_reloc = relocs->next;
-			free(relocs);
-			relocs = next_reloc;
-		}
-		s->syms[i].relocs = NULL;
-	}
-
-	free(s->syms);
+	free(s->ref_group);
+	free(s->ref_offset);
+	free(s->ref_name);
+	free(s->ref_addend);
+	free(s->ref_type);
+	free(s->row_start);
+	free(s->wide);
+	free(s->foreign);
+	free(s->eyt);
+	free(s->eyt_rank);
+	free(s->name_index);
+	free(s->group_addr);
+	free(s->group_first);
+	free(s->group_count);
+	free(s->sym_addr);
+	free(s->sym_name);
+	free(s->sym_type);
+	free(s->sym_shndx);
+	free(s->sym_size);
 	free(s);
 }
 
 /**
- * Returns symbol, which offset is not less than the given offset and is nearest
- * to it. If not found, returns NULL.
+ * Returns the index of the group of symbols which offset is not greater than the given offset and is nearest
+ * to it. If not found, returns SIZE_MAX.
+ *
+ * The search goes down the implicit binary tree kept in the Eytzinger order, which has no
+ * unpredictable branches and touches memory in a prefetch-friendly way: the descendants four
+ * levels down from k are adjacent at 16*k.
  */
-static sym*	locate_sym(symtab_t* st, size_t offset)
+static size_t	locate_group(const symtab_t* st, size_t offset)
 {
-	sym *ret = NULL;
+	const size_t *eyt = st->eyt;
+	const size_t n = st->ngroups;
 
-	size_t upper = st->nsyms;
-	size_t lower = 0;
-	size_t prev_i = upper;
-	size_t i = 0;
-
-	while (i != prev_i)
+	size_t k = 1;
+	while (k <= n)
 	{
-		assert(upper > lower);
-		prev_i = i;
-		i = (upper - lower) / 2 + lower;
+		__builtin_prefetch(eyt + 16*k);
+		k = 2*k + (eyt[k] <= offset);
+	}
 
-		ret = &st->syms[i];
-		if (offset < ret->offset)
-		{
-			upper = i;
-		}
-		else if (offset > ret->offset)
-		{
-			lower = i;
-		}
+	// Undo the right turns made after the last left one: that's the first element
+	// greater than offset, or 0 if there is no such
+	k >>= __builtin_ffsl((long)~k);
+
+	const size_t upper = (k == 0) ? n : st->eyt_rank[k];
+	return upper > 0 ? upper - 1 : SIZE_MAX;
+}
+
+/**
+ * Returns the group of the k-th symbol, which locate_group() may not give for the symbols of a relocatable
+ * file: several groups can be at their offset.
+ */
+static size_t	sym_group(const symtab_s* st, size_t k)
+{
+	size_t lo = 0;
+	size_t hi = st->ngroups;
+	while (hi - lo > 1)
+	{
+		const size_t mid = lo + (hi - lo)/2;
+		if (st->group_first[mid] <= k)
+			lo = mid;
 		else
-		{
-			break; // exact match
-		}
+			hi = mid;
 	}
+	return lo;
+}
+
+/**
+ * Returns the group a relocation at the given offset is attributed to (see locate_group()). Relocations
+ * mostly come in the order of their offsets, so the group of the last one is tried first.
+ */
+static size_t	find_group(symtab_t* st, size_t offset)
+{
+	const size_t g = st->last_g;
+	if (g < st->ngroups && st->group_addr[g] <= offset && (g + 1 == st->ngroups || offset < st->group_addr[g + 1]))
+		return g;
+
+	st->last_g = locate_group(st, offset);
+	return st->last_g;
+}
+
+/**
+ * Sets the relocation types of the file's machine, by which the types of the relocations added are named.
+ */
+extern void		symtab_set_reltypes(symtab_t* symtab, const reltype_table_t* reltypes)
+{
+	assert(symtab);
 
-	return ret;
+	symtab->reltypes = reltypes;
 }
 
 /**
  * Adds a symbol with the given properties to the given symbol table.
  */
-extern size_t		symtab_add_sym(symtab_t* symtab, size_t offset, int type, const char* sym_name)
+extern size_t		symtab_add_sym(symtab_t* symtab, size_t offset, size_t size, int type, uint32_t shndx,
+				       const char* sym_name)
 {
 	assert(symtab);
-	assert(symtab->syms);
+	assert(symtab->sym_addr);
 	assert(symtab->free_idx < symtab->nsyms);
 
-	symtab->syms[symtab->free_idx].offset = offset;
-	symtab->syms[symtab->free_idx].type = type;
-	symtab->syms[symtab->free_idx].name = sym_name;
-	symtab->syms[symtab->free_idx].relocs = NULL;
+	const size_t i = symtab->free_idx;
+	symtab->sym_addr[i] = offset;
+	symtab->sym_type[i] = (uint8_t)type;
+	symtab->sym_shndx[i] = shndx;
+	symtab->sym_size[i] = size;
+	symtab->sym_name[i] = name_put(symtab, sym_name);
 
 	return ++symtab->free_idx;
 }
 
 /**
- * Adds relocation information to the appropriate symbol (determined by the offset) in the given symbol table.
+ * Returns the FNV-1a hash of the name.
  */
-extern void		symtab_add_reloc(symtab_t* st, size_t offset, const char* sym_name, bool is_func, int64_t addend)
+static uint32_t	name_hash(const char* name)
 {
-	assert(st);
+	uint32_t h = 2166136261u;
+	for (const unsigned char* p = (const unsigned char*)name; *p; ++p)
+	{
+		h = (h ^ *p)*16777619u;
+	}
+	return h;
+}
 
-	sym *s = locate_sym(st, offset);
-	if (s)
+/**
+ * Builds the open addressing hash table of the symbols by name (see symtab_find_ranges()); each slot
+ * holds the index of a symbol plus one, or 0 if it is free.
+ */
+static void	build_name_index(symtab_s* st)
+{
+	size_t size = 16;
+	while (size < 2*st->nsyms)
+	{
+		size *= 2;
+	}
+	st->name_index = calloc(size, sizeof(uint32_t));
+	if (!st->name_index)
 	{
-		// We're supposed to have found a relocation pointing into the symbol
-		// 's', not before it
-		assert(offset >= s->offset);
+		fatal_err("Not enough memory");
+	}
+	st->name_index_size = size;
 
-		reloc *new_r = malloc(sizeof(reloc));
-		if (!new_r)
-		{
-			fatal("Out of memory");
-		}
-		new_r->sym_name = sym_name;
-		new_r->is_func = is_func;
-		new_r->offset = offset - s->offset;
-		new_r->addend = addend;
-		new_r->next = NULL;
+	for (size_t k = 0; k < st->nsyms; ++k)
+	{
+		const char *name = name_get(st, st->sym_name[k]);
+		if (!name || !*name)
+			continue;
 
-		// Find where to place this new relocation
-		if (!s->relocs)
+		size_t slot = name_hash(name) & (size - 1);
+		while (st->name_index[slot])
 		{
-			s->relocs = new_r;
+			slot = (slot + 1) & (size - 1);
 		}
-		else
+		st->name_index[slot] = (uint32_t)(k + 1);
+	}
+}
+
+/**
+ * Finds the functions and objects defined with exactly the given name and stores the address ranges they take,
+ * along with the sections they are in, in *ranges, which must be released with free(). The range of a symbol
+ * of unknown size extends up to the next symbol. Returns the number of the ranges, which are distinct.
+ */
+extern size_t		symtab_find_ranges(symtab_t* st, const char* name, symtab_range_t** ranges)
+{
+	assert(st);
+	assert(st->group_addr); // must be sorted
+	assert(name);
+	assert(ranges);
+
+	if (!st->name_index)
+	{
+		build_name_index(st);
+	}
+
+	size_t n = 0, size = 0;
+	*ranges = NULL;
+
+	const size_t mask = st->name_index_size - 1;
+	for (size_t slot = name_hash(name) & mask; st->name_index[slot]; slot = (slot + 1) & mask)
+	{
+		const size_t k = st->name_index[slot] - 1;
+		const int type = st->sym_type[k];
+		if ((type != STT_FUNC && type != STT_OBJECT) || st->sym_shndx[k] == SHN_UNDEF
+		    || strcmp(name_get(st, st->sym_name[k]), name) != 0)
+			continue;
+
+		const size_t g = sym_group(st, k);
+		symtab_range_t r = { .begin = st->sym_addr[k], .end = st->sym_addr[k] + st->sym_size[k],
+				     .shndx = st->sym_shndx[k], .group = g };
+		if (st->sym_size[k] == 0)
 		{
-			struct reloc *r = s->relocs;
-			struct reloc *last_r = NULL;
-			for (; r && r->offset < new_r->offset; r = r->next)
+			size_t h = g + 1;
+			while (h < st->ngroups && st->group_addr[h] == st->group_addr[g])
 			{
-				last_r = r;
+				++h;
 			}
+			r.end = (h < st->ngroups) ? st->group_addr[h] : SIZE_MAX;
+		}
 
-			if (last_r)
-			{
-				last_r->next = new_r;
-			}
-			else
-			{
-				s->relocs = new_r; // add to the head
-			}
-			new_r->next = r;
+		bool seen = false;
+		for (size_t i = 0; i < n && !seen; ++i)
+		{
+			seen = ((*ranges)[i].begin == r.begin && (*ranges)[i].end == r.end && (*ranges)[i].shndx == r.shndx);
 		}
+		if (seen)
+			continue;
+
+		if (n == size)
+		{
+			size = size ? 2*size : 4;
+			grow(ranges, size, sizeof(symtab_range_t));
+		}
+		(*ranges)[n++] = r;
 	}
-	else
-	{
-		error("unable to locate sym corresponding to offset 0x%0lx", offset);
-	}
+
+	return n;
 }
 
 /**
- * Prints out the legend in symbol table output format.
+ * Appends a reference made at the given offset to the columns, attributing it to group g.
  */
-extern void	symtab_print_legend()
+static void	add_ref(symtab_s* st, size_t g, size_t offset, const char* sym_name, bool is_func, uint32_t type,
+			int64_t addend)
 {
-	fprintf(stdout, "sym-name (addr sym-value)    <-- symbol name and address\n");
-	fprintf(stdout, " (+offset-from-sym) -> [sym-name[()]] [+addend]\n");
-	fprintf(stdout, " ^                     ^               ^       \n");
-	fprintf(stdout, " +- offset from sym    |               +- addend (for RELA relocations)\n");
-	fprintf(stdout, "    start              +- name of referenced symbol; () means it's a function\n");
-}
+	if (st->nrefs == st->refs_size)
+	{
+		if (st->nrefs >= UINT32_MAX)
+		{
+			fatal("Too many relocations");
+		}
+		st->refs_size = st->refs_size ? 2*st->refs_size : 1024;
+		st->refs_size = (st->refs_size < UINT32_MAX) ? st->refs_size : UINT32_MAX;
+		grow(&st->ref_group, st->refs_size, sizeof(uint32_t));
+		grow(&st->ref_offset, st->refs_size, sizeof(uint32_t));
+		grow(&st->ref_name, st->refs_size, sizeof(uint32_t));
+		grow(&st->ref_addend, st->refs_size, sizeof(int32_t));
+		grow(&st->ref_type, st->refs_size, sizeof(uint16_t));
+	}
 
-static void	dump_reloc(reloc *r)
-{
-	if (args_get_is_offsets_decimal())
+	const size_t i = st->nrefs++;
+	st->ref_group[i] = (uint32_t)g;
+	st->ref_offset[i] = (uint32_t)(offset - st->group_addr[g]);
+	st->ref_name[i] = name_put(st, sym_name);
+	st->ref_type[i] = is_func ? REF_FUNC : 0;
+	if (type <= REF_TYPE && addend >= INT32_MIN && addend <= INT32_MAX)
 	{
-		fprintf(stdout, "\t(+%ld)-> ", r->offset);
+		st->ref_type[i] |= (uint16_t)type;
+		st->ref_addend[i] = (int32_t)addend;
 	}
 	else
 	{
-		fprintf(stdout, "\t(+0x%04lx)-> ", r->offset);
+		if (st->nwide == st->wide_size)
+		{
+			if (st->nwide >= INT32_MAX)
+			{
+				fatal("Too many relocations");
+			}
+			st->wide_size = st->wide_size ? 2*st->wide_size : 64;
+			grow(&st->wide, st->wide_size, sizeof(wide_ref));
+		}
+		st->wide[st->nwide] = (wide_ref){ .addend = addend, .type = type };
+		st->ref_type[i] |= REF_WIDE;
+		st->ref_addend[i] = (int32_t)st->nwide++;
 	}
 
-	if (r->sym_name)
+	if (i > st->refs_dumped && (st->ref_group[i] < st->ref_group[i - 1]
+				    || (st->ref_group[i] == st->ref_group[i - 1] && st->ref_offset[i] < st->ref_offset[i - 1])))
 	{
-		fprintf(stdout, "%s", r->sym_name);
-
-		if (r->is_func)
-			fprintf(stdout, "()");
+		st->ordered = false;
 	}
+	st->nrelocs++;
+}
 
-	// Not interested in seeing zero addend; but if it's
-	// all there is, print it anyway
-	const bool show_addend = (r->addend != 0) || !r->sym_name;
-	if (show_addend)
+/**
+ * Adds relocation information to the appropriate symbol (determined by the offset) in the given symbol table.
+ * Must not be called once the references have been walked.
+ */
+extern void		symtab_add_reloc(symtab_t* st, size_t offset, const char* sym_name, bool is_func, uint32_t type,
+					 int64_t addend)
+{
+	assert(st);
+	assert(st->group_addr); // must be sorted
+	assert(!st->row_start);
+
+	const size_t g = find_group(st, offset);
+	if (g == SIZE_MAX || offset - st->group_addr[g] > UINT32_MAX)
 	{
-		fprintf(stdout, "%+ld", r->addend);
+		error("unable to locate sym corresponding to offset 0x%0lx", offset);
+		return;
 	}
 
-	fprintf(stdout, "\n");
+	add_ref(st, g, offset, sym_name, is_func, type, addend);
 }
 
-static void	dump_sym(sym* s)
+/**
+ * Adds relocation information to the symbol the given range was found for by symtab_find_ranges(), whatever
+ * other symbols there are in the range: those of a relocatable file may be of other sections.
+ */
+extern void		symtab_add_range_reloc(symtab_t* st, const symtab_range_t* range, size_t offset,
+					       const char* sym_name, bool is_func, uint32_t type, int64_t addend)
 {
-	fprintf(stdout, "%s (addr 0x%08lx)\n", s->name, s->offset);
+	assert(st);
+	assert(range);
+	assert(!st->row_start);
+	assert(offset >= range->begin && offset < range->end);
 
-	for (reloc *r = s->relocs; r; r = r->next)
+	if (offset - st->group_addr[range->group] > UINT32_MAX)
 	{
-		dump_reloc(r);
+		error("unable to locate sym corresponding to offset 0x%0lx", offset);
+		return;
 	}
+
+	add_ref(st, range->group, offset, sym_name, is_func, type, addend);
 }
 
 /**
- * Prints out the contents of the symbol table, excluding symbols that are not of interest to the user based on the options given.
- * See args_sym_is_interesting().
+ * Swaps references i and j.
  */
-extern void	symtab_dump(symtab_t* st)
+static void	swap_refs(symtab_s* st, size_t i, size_t j)
 {
-	assert(st);
+#define SWAP(col)	do { __typeof__(st->col[0]) t = st->col[i]; st->col[i] = st->col[j]; st->col[j] = t; } while (0)
+	SWAP(ref_offset);
+	SWAP(ref_name);
+	SWAP(ref_addend);
+	SWAP(ref_type);
+	if (st->ref_group)
+		SWAP(ref_group);
+#undef SWAP
+}
 
-	bool empty_output = true;
-	for (size_t i = 0; i < st->free_idx; ++i)
+/**
+ * Reverses each run of the references from begin to end that have the same group and offset. References are
+ * kept sorted by offset, and those at the same offset have always been listed the last added first.
+ */
+static void	reverse_ties(symtab_s* st, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; )
 	{
-		sym *s = &st->syms[i];
-
-		if (args_sym_is_interesting(s->name, s->type))
+		size_t j = i + 1;
+		while (j < end && st->ref_offset[j] == st->ref_offset[i] && st->ref_group[j] == st->ref_group[i])
 		{
-			if (s->relocs)
-			{
-				dump_sym(s);
-				empty_output = false;
-			}
+			++j;
+		}
+		for (size_t lo = i, hi = j - 1; lo < hi; ++lo, --hi)
+		{
+			swap_refs(st, lo, hi);
 		}
+		i = j;
 	}
+}
 
-	if (empty_output)
+/**
+ * Puts the references added in rows by group and offset, unless they have already been added that way,
+ * and drops the group column, which the rows make unnecessary.
+ */
+static void	build_rows(symtab_s* st)
+{
+	assert(st->ndumped == 0); // not after symtab_dump_upto()
+
+	const size_t n = st->nrefs;
+
+	st->row_start = calloc(st->ngroups + 1, sizeof(uint32_t));
+	if (!st->row_start)
 	{
-		if (args_get_is_funcs_only() || args_get_name_pattern())
+		fatal_err("Not enough memory");
+	}
+	for (size_t i = 0; i < n; ++i)
+	{
+		st->row_start[st->ref_group[i] + 1]++;
+	}
+	for (size_t g = 0; g < st->ngroups; ++g)
+	{
+		st->row_start[g + 1] += st->row_start[g];
+	}
+
+	if (st->ordered)
+	{
+		reverse_ties(st, 0, n);
+	}
+	else
+	{
+		// Listed backwards for the stable sort to keep the last added first among equal offsets
+		sort_kv_t *kv = malloc(n*sizeof(sort_kv_t) + 1);
+		if (!kv)
+		{
+			fatal_err("Not enough memory");
+		}
+		for (size_t i = 0; i < n; ++i)
+		{
+			const size_t k = n - 1 - i;
+			kv[i].key = ((uint64_t)st->ref_group[k] << 32) | st->ref_offset[k];
+			kv[i].idx = k;
+		}
+		sort_radix_kv(kv, n);
+		free(st->ref_group);
+		st->ref_group = NULL;
+
+		// Put one column in order at a time, so that at most one extra is needed
+		uint32_t *u32 = malloc(n*sizeof(uint32_t) + 1);
+		uint16_t *u16 = malloc(n*sizeof(uint16_t) + 1);
+		if (!u32 || !u16)
 		{
-			report(NORM, "No symbols that match pattern found in .symtab and .dynsym; nothing to do.");
+			fatal_err("Not enough memory");
 		}
+		for (size_t i = 0; i < n; ++i)
+			u32[i] = st->ref_offset[kv[i].idx];
+		memcpy(st->ref_offset, u32, n*sizeof(uint32_t));
+		for (size_t i = 0; i < n; ++i)
+			u32[i] = st->ref_name[kv[i].idx];
+		memcpy(st->ref_name, u32, n*sizeof(uint32_t));
+		for (size_t i = 0; i < n; ++i)
+			u32[i] = (uint32_t)st->ref_addend[kv[i].idx];
+		for (size_t i = 0; i < n; ++i)
+			st->ref_addend[i] = (int32_t)u32[i];
+		for (size_t i = 0; i < n; ++i)
+			u16[i] = st->ref_type[kv[i].idx];
+		memcpy(st->ref_type, u16, n*sizeof(uint16_t));
+
+		free(u16);
+		free(u32);
+		free(kv);
+	}
+
+	free(st->ref_group);
+	st->ref_group = NULL;
+
+	// No more references are going to be added
+	st->refs_size = n;
+	grow(&st->ref_offset, n, sizeof(uint32_t));
+	grow(&st->ref_name, n, sizeof(uint32_t));
+	grow(&st->ref_addend, n, sizeof(int32_t));
+	grow(&st->ref_type, n, sizeof(uint16_t));
+}
+
+/**
+ * Counts a relocation against the appropriate symbol (determined by the offset) in the given symbol table
+ * without keeping it (see symtab_walk_syms()). Returns false if there is no such symbol.
+ */
+extern bool		symtab_count_reloc(symtab_t* st, size_t offset)
+{
+	assert(st);
+	assert(st->group_addr); // must be sorted
+
+	const size_t g = find_group(st, offset);
+	if (g == SIZE_MAX)
+		return false;
+
+	if (!st->group_count)
+	{
+		st->group_count = calloc(st->ngroups, sizeof(uint32_t));
+		if (!st->group_count)
+		{
+			fatal_err("Not enough memory");
+		}
+	}
+
+	st->group_count[g]++;
+	st->nrelocs++;
+	return true;
+}
+
+/**
+ * Prints out the legend in symbol table output format.
+ */
+extern void	symtab_print_legend()
+{
+	fprintf(stdout, "sym-name (addr sym-value)    <-- symbol name and address\n");
+	fprintf(stdout, " (+offset-from-sym) -> [sym-name[()]] [+addend]\n");
+	fprintf(stdout, " ^                     ^               ^       \n");
+	fprintf(stdout, " +- offset from sym    |               +- addend (for RELA relocations)\n");
+	fprintf(stdout, "    start              +- name of referenced symbol; () means it's a function\n");
+	fprintf(stdout, "References to a section plus an addend, as object files mostly make, are shown as ones\n");
+	fprintf(stdout, "to the symbol of the section at that point, if there is one.\n");
+	fprintf(stdout, "With -t, each reference is followed by the type of its relocation (R_X86_64_PLT32);\n");
+	fprintf(stdout, "with -l, by file:line of the code that makes it.\n");
+}
+
+/**
+ * Returns true if the symbol name and type satisfy the filter given.
+ */
+static bool	sym_is_interesting(const symtab_filter_t* filter, const char *name, int type)
+{
+	if (type != STT_FUNC && type != STT_OBJECT)
+		return false;
+
+	if (filter->funcs_only && type != STT_FUNC)
+		return false;
+
+	if (filter->name_pattern && filter->name_exact)
+		return strcmp(name, filter->name_pattern) == 0;
+
+	if (filter->name_pattern && strstr(name, filter->name_pattern) == NULL)
+		return false;
+
+	return true;
+}
+
+/**
+ * Returns true if the referenced symbol name satisfies the filter given.
+ */
+static bool	ref_is_interesting(const symtab_filter_t* filter, const char *ref_name)
+{
+	if (!filter->ref_pattern)
+		return true;
+
+	if (filter->ref_exact)
+		return ref_name && strcmp(ref_name, filter->ref_pattern) == 0;
+
+	return ref_name && strstr(ref_name, filter->ref_pattern) != NULL;
+}
+
+/**
+ * Returns true if the referenced symbol name alone satisfies the filter given.
+ */
+extern bool	symtab_filter_match_ref(const symtab_filter_t* filter, const char* ref_name)
+{
+	assert(filter);
+
+	return ref_is_interesting(filter, ref_name);
+}
+
+/**
+ * Returns true if the reference (and the symbol it is made from) satisfy the filter given.
+ */
+extern bool	symtab_filter_match(const symtab_filter_t* filter, const symtab_ref_t* ref)
+{
+	assert(filter);
+	assert(ref);
+
+	return sym_is_interesting(filter, ref->sym_name, ref->sym_type)
+		&& ref_is_interesting(filter, ref->ref_name);
+}
+
+/**
+ * Prints out the source file:line of the code at the given address, if the filter asks for that.
+ */
+static void	print_line(FILE* out, const symtab_filter_t* filter, size_t addr)
+{
+	if (!filter->lines)
+		return;
+
+	const char *file = NULL;
+	unsigned int line = 0;
+	if (dwarf_lines_find(filter->lines, addr, &file, &line))
+	{
+		fprintf(out, "\t%s:%u", file, line);
+	}
+	else
+	{
+		fprintf(out, "\t??:0");
+	}
+}
+
+/**
+ * Prints out the reference in the format described by symtab_print_legend(), preceded by the line
+ * describing the referring symbol if this is the first reference of the symbol printed.
+ */
+extern void	symtab_print_ref(FILE* out, const symtab_filter_t* filter, const symtab_ref_t* ref, bool first)
+{
+	if (first)
+	{
+		fprintf(out, "%s (addr 0x%08lx)\n", ref->sym_name, ref->sym_addr);
+	}
+
+	if (filter->offsets_decimal)
+	{
+		fprintf(out, "\t(+%ld)-> ", ref->offset);
+	}
+	else
+	{
+		fprintf(out, "\t(+0x%04lx)-> ", ref->offset);
+	}
+
+	if (ref->ref_name)
+	{
+		fprintf(out, "%s", ref->ref_name);
+
+		if (ref->ref_is_func)
+			fprintf(out, "()");
+	}
+
+	// Not interested in seeing zero addend; but if it's
+	// all there is, print it anyway
+	const bool show_addend = (ref->addend != 0) || !ref->ref_name;
+	if (show_addend)
+	{
+		fprintf(out, "%+ld", ref->addend);
+	}
+
+	if (filter->show_types)
+	{
+		if (ref->type_name)
+			fprintf(out, "\t%s", ref->type_name);
+		else
+			fprintf(out, "\t%u", ref->type);
+	}
+
+	print_line(out, filter, ref->sym_addr + ref->offset);
+
+	fprintf(out, "\n");
+}
+
+/**
+ * Puts the references added in rows now rather than on the first walk, which changes the table: to be called
+ * once all of them are added and before the table is shared by threads that walk it, such as those of --serve.
+ */
+extern void	symtab_build_rows(symtab_t* st)
+{
+	assert(st);
+
+	if (!st->row_start)
+	{
+		build_rows(st);
+	}
+}
+
+/**
+ * Returns the references of group g as the range from *begin to *end, putting them in rows if not done yet.
+ */
+static void	row_bounds(symtab_s* st, size_t g, size_t* begin, size_t* end)
+{
+	if (!st->row_start)
+	{
+		build_rows(st);
+	}
+	*begin = st->row_start[g];
+	*end = st->row_start[g + 1];
+}
+
+/**
+ * Calls fn for every reference from begin to end that passes the filter, as made from the symbol described
+ * by ref. Returns the number of references fn was called for.
+ */
+static size_t	walk_refs(const symtab_s* st, size_t begin, size_t end, const symtab_filter_t* filter,
+			  symtab_ref_t* ref, symtab_walk_fn fn, void* ctx)
+{
+	size_t nrefs = 0;
+
+	for (size_t i = begin; i < end; ++i)
+	{
+		const char *ref_name = name_get(st, st->ref_name[i]);
+		if (!ref_is_interesting(filter, ref_name))
+			continue;
+
+		const uint16_t type = st->ref_type[i];
+		const wide_ref *w = (type & REF_WIDE) ? &st->wide[st->ref_addend[i]] : NULL;
+		ref->offset = st->ref_offset[i];
+		ref->ref_name = ref_name;
+		ref->ref_is_func = (type & REF_FUNC) != 0;
+		ref->addend = w ? w->addend : st->ref_addend[i];
+		ref->type = w ? w->type : (type & REF_TYPE);
+		ref->type_name = reltype_name(st->reltypes, ref->type);
+		fn(ctx, ref);
+		ref->first = false;
+		nrefs++;
+	}
+
+	return nrefs;
+}
+
+/**
+ * Calls fn for every reference of group g, from begin to end, that passes the filter, under each of the group's
+ * symbols. Returns the number of references fn was called for.
+ */
+static size_t	walk_group(const symtab_s* st, size_t g, size_t begin, size_t end, const symtab_filter_t* filter,
+			   symtab_walk_fn fn, void* ctx)
+{
+	size_t nrefs = 0;
+
+	// Each alias gets to report the group's relocations
+	for (size_t k = st->group_first[g]; begin < end && k < st->group_first[g + 1]; ++k)
+	{
+		const char *name = name_get(st, st->sym_name[k]);
+		if (!sym_is_interesting(filter, name, st->sym_type[k]))
+			continue;
+
+		symtab_ref_t ref = { .sym_name = name, .sym_type = st->sym_type[k], .sym_addr = st->sym_addr[k], .first = true };
+		nrefs += walk_refs(st, begin, end, filter, &ref, fn, ctx);
+	}
+
+	return nrefs;
+}
+
+/**
+ * Calls fn for every reference that passes the filter, in the order symtab_dump_to() prints them.
+ * Returns the number of references fn was called for.
+ */
+extern size_t	symtab_walk(symtab_t* st, const symtab_filter_t* filter, symtab_walk_fn fn, void* ctx)
+{
+	assert(st);
+	assert(filter);
+	assert(fn);
+
+	size_t nrefs = 0;
+	for (size_t g = 0; g < st->ngroups; ++g)
+	{
+		size_t begin = 0, end = 0;
+		row_bounds(st, g, &begin, &end);
+		nrefs += walk_group(st, g, begin, end, filter, fn, ctx);
+	}
+
+	return nrefs;
+}
+
+/**
+ * Calls fn for every symbol that passes the filter and has relocations counted with symtab_count_reloc(),
+ * once for all its aliases. Returns the number of symbols fn was called for.
+ */
+extern size_t	symtab_walk_syms(symtab_t* st, const symtab_filter_t* filter, symtab_sym_fn fn, void* ctx)
+{
+	assert(st);
+	assert(filter);
+	assert(fn);
+
+	size_t nsyms = 0;
+	for (size_t g = 0; st->group_count && g < st->ngroups; ++g)
+	{
+		if (st->group_count[g] == 0)
+			continue;
+
+		for (size_t k = st->group_first[g]; k < st->group_first[g + 1]; ++k)
+		{
+			const char *name = name_get(st, st->sym_name[k]);
+			if (sym_is_interesting(filter, name, st->sym_type[k]))
+			{
+				fn(ctx, name, st->sym_type[k], st->sym_addr[k], st->group_count[g]);
+				nsyms++;
+				break;
+			}
+		}
+	}
+
+	return nsyms;
+}
+
+/**
+ * Calls sym_fn, if given, for every symbol with the index of its group (the symbols sharing its address) and
+ * then ref_fn, if given, for every relocation attributed to the group. Returns the number of groups.
+ */
+extern size_t	symtab_walk_groups(symtab_t* st, symtab_group_sym_fn sym_fn, symtab_group_ref_fn ref_fn, void* ctx)
+{
+	assert(st);
+	assert(st->group_addr); // must be sorted
+
+	for (size_t g = 0; g < st->ngroups; ++g)
+	{
+		for (size_t k = st->group_first[g]; sym_fn && k < st->group_first[g + 1]; ++k)
+		{
+			sym_fn(ctx, g, name_get(st, st->sym_name[k]), st->sym_type[k], st->sym_shndx[k] != SHN_UNDEF,
+			       st->sym_addr[k]);
+		}
+
+		size_t begin = 0, end = 0;
+		if (ref_fn)
+		{
+			row_bounds(st, g, &begin, &end);
+		}
+		for (size_t i = begin; i < end; ++i)
+		{
+			ref_fn(ctx, g, name_get(st, st->ref_name[i]), (st->ref_type[i] & REF_FUNC) != 0);
+		}
+	}
+
+	return st->ngroups;
+}
+
+struct dump_ctx
+{
+	FILE *			out;
+	const symtab_filter_t *	filter;
+};
+
+static void	dump_ref(void* vctx, const symtab_ref_t* ref)
+{
+	struct dump_ctx *ctx = vctx;
+	symtab_print_ref(ctx->out, ctx->filter, ref, ref->first);
+}
+
+/**
+ * Prints out, as symtab_dump_to() does, the groups of symbols that precede the one containing offset
+ * and have not been printed yet, then releases their relocations. This lets the output go as soon as
+ * the relocations are added, provided they are added in the order of their offsets: relocations
+ * must not be added to the groups printed. Returns the number of references printed.
+ */
+extern size_t	symtab_dump_upto(symtab_t* st, FILE* out, const symtab_filter_t* filter, size_t offset)
+{
+	assert(st);
+	assert(st->group_addr); // must be sorted
+	assert(!st->row_start);
+	assert(out);
+	assert(filter);
+
+	struct dump_ctx ctx = { out, filter };
+	size_t nrefs = 0;
+	for (; st->ndumped < st->ngroups; ++st->ndumped)
+	{
+		const size_t g = st->ndumped;
+		const bool last = (g + 1 == st->ngroups);
+		if (!last && st->group_addr[g + 1] > offset)
+			break;
+		if (last && offset != SIZE_MAX)
+			break;
+
+		// The group's references are the next ones added, those added to the groups printed aside
+		size_t begin = st->refs_dumped;
+		while (begin < st->nrefs && st->ref_group[begin] < g)
+		{
+			++begin;
+		}
+		size_t end = begin;
+		while (end < st->nrefs && st->ref_group[end] == g)
+		{
+			++end;
+		}
+
+		reverse_ties(st, begin, end);
+		nrefs += walk_group(st, g, begin, end, filter, dump_ref, &ctx);
+
+		st->nrelocs -= end - st->refs_dumped;
+		st->refs_dumped = end;
+	}
+
+	// Release the references printed, keeping the room they took for those to come
+	if (st->refs_dumped == st->nrefs)
+	{
+		st->nrefs = 0;
+		st->refs_dumped = 0;
+		st->nwide = 0;
+	}
+	else if (st->refs_dumped > st->nrefs/2)
+	{
+		const size_t n = st->nrefs - st->refs_dumped;
+		const size_t from = st->refs_dumped;
+		memmove(st->ref_group, st->ref_group + from, n*sizeof(uint32_t));
+		memmove(st->ref_offset, st->ref_offset + from, n*sizeof(uint32_t));
+		memmove(st->ref_name, st->ref_name + from, n*sizeof(uint32_t));
+		memmove(st->ref_addend, st->ref_addend + from, n*sizeof(int32_t));
+		memmove(st->ref_type, st->ref_type + from, n*sizeof(uint16_t));
+		st->nrefs = n;
+		st->refs_dumped = 0;
+	}
+
+	return nrefs;
+}
+
+/**
+ * A run of groups which output is formatted in a buffer of its own (see symtab_dump_to()).
+ */
+typedef struct dump_chunk
+{
+	size_t		first;		// group
+	size_t		end;		// past the last one
+	char *		buf;
+	size_t		size;
+	size_t		nrefs;		// printed
+	bool		done;		// formatted, buf can be written out
+	bool		failed;		// out of memory formatting it, buf is not to be written out
+} dump_chunk;
+
+/**
+ * The chunks to format in parallel, taken by the threads one at a time in order. A thread only takes a chunk
+ * that is less than ahead chunks past the one being written out, so that the buffers do not pile up.
+ * The threads do not issue fatal errors, which only the calling one can handle (see errors_set_fatal_handler()),
+ * but mark the chunk failed.
+ */
+typedef struct dump_job
+{
+	symtab_s *		st;
+	const symtab_filter_t *	filter;
+	dump_chunk *		chunks;
+	size_t			nchunks;
+	size_t			next;		// the chunk to be taken next
+	size_t			written;	// chunks written out
+	size_t			ahead;
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;		// signalled when a chunk is formatted or written out
+} dump_job;
+
+static void *	format_chunks(void* arg)
+{
+	dump_job *job = arg;
+
+	for (;;)
+	{
+		pthread_mutex_lock(&job->lock);
+		while (job->next < job->nchunks && job->next >= job->written + job->ahead)
+		{
+			pthread_cond_wait(&job->cond, &job->lock);
+		}
+		const size_t i = job->next++;
+		pthread_mutex_unlock(&job->lock);
+		if (i >= job->nchunks)
+			break;
+
+		dump_chunk *c = &job->chunks[i];
+		const uint64_t span = trace_begin();
+		FILE *f = open_memstream(&c->buf, &c->size);
+		if (f)
+		{
+			struct dump_ctx ctx = { f, job->filter };
+			for (size_t g = c->first; g < c->end; ++g)
+			{
+				c->nrefs += walk_group(job->st, g, job->st->row_start[g], job->st->row_start[g + 1],
+						       job->filter, dump_ref, &ctx);
+			}
+			const bool write_failed = (ferror(f) != 0);
+			c->failed = (fclose(f) != 0) || write_failed;
+		}
+		else
+		{
+			c->failed = true;
+		}
+		trace_end(span, "dump", "format", NULL, c->nrefs);
+
+		pthread_mutex_lock(&job->lock);
+		c->done = true;
+		pthread_cond_broadcast(&job->cond);
+		pthread_mutex_unlock(&job->lock);
+	}
+
+	return NULL;
+}
+
+/**
+ * Splits the groups into chunks of about CHUNK_REFS references each. Returns their number.
+ */
+static size_t	split_chunks(const symtab_s* st, dump_chunk** chunks)
+{
+	const size_t nrefs = st->row_start[st->ngroups];
+	const size_t size = nrefs/CHUNK_REFS + 2;
+	*chunks = calloc(size, sizeof(dump_chunk));
+	if (!*chunks)
+	{
+		fatal_err("Not enough memory");
+	}
+
+	size_t n = 0;
+	for (size_t g = 0; g < st->ngroups; )
+	{
+		const size_t first = g;
+		while (g < st->ngroups && (st->row_start[g] - st->row_start[first] < CHUNK_REFS || g == first))
+		{
+			++g;
+		}
+		assert(n < size);
+		(*chunks)[n++] = (dump_chunk){ .first = first, .end = g };
+	}
+
+	return n;
+}
+
+/**
+ * Returns the number of threads symtab_dump_to() formats nrefs references with. The source lines (the -l option)
+ * are looked up as they are needed, which is not for several threads to do at once.
+ */
+extern size_t	symtab_dump_threads(const symtab_filter_t* filter, size_t nrefs)
+{
+	assert(filter);
+
+	if (filter->lines || nrefs < 2*CHUNK_REFS)
+		return 1;
+
+	const size_t nthreads = glob_get_threads();
+	return (nthreads < MAX_THREADS) ? nthreads : MAX_THREADS;
+}
+
+/**
+ * Prints out the contents of the symbol table to the given stream, excluding symbols and references
+ * that do not pass the filter. Returns false if nothing was printed.
+ *
+ * A large table is formatted by several threads (see symtab_dump_threads()), each into a buffer of its own for
+ * a chunk of groups, while this one writes out the chunks formatted in order; the output is the same.
+ */
+extern bool	symtab_dump_to(symtab_t* st, FILE* out, const symtab_filter_t* filter)
+{
+	assert(st);
+	assert(out);
+	assert(filter);
+
+	const uint64_t span = trace_begin();
+	if (!st->row_start)
+	{
+		build_rows(st);
+	}
+
+	const size_t nthreads = symtab_dump_threads(filter, st->row_start[st->ngroups]);
+	dump_job job = { .st = st, .filter = filter, .ahead = CHUNKS_AHEAD*nthreads };
+	pthread_t tids[MAX_THREADS];
+	size_t nstarted = 0;
+	if (nthreads > 1)
+	{
+		job.nchunks = split_chunks(st, &job.chunks);
+		pthread_mutex_init(&job.lock, NULL);
+		pthread_cond_init(&job.cond, NULL);
+		for (; nstarted < nthreads; ++nstarted)
+		{
+			if (pthread_create(&tids[nstarted], NULL, format_chunks, &job) != 0)
+				break;
+		}
+		report(VERB, "Formatting %zu references with %zu threads", st->row_start[st->ngroups], nstarted);
+	}
+
+	size_t nrefs = 0;
+	if (nstarted == 0)
+	{
+		struct dump_ctx ctx = { out, filter };
+		nrefs = symtab_walk(st, filter, dump_ref, &ctx);
+	}
+
+	bool failed = false;
+	for (size_t i = 0; i < job.nchunks && nstarted > 0 && !failed; ++i)
+	{
+		dump_chunk *c = &job.chunks[i];
+		pthread_mutex_lock(&job.lock);
+		while (!c->done)
+		{
+			pthread_cond_wait(&job.cond, &job.lock);
+		}
+		failed = c->failed;
+		if (failed)
+		{
+			job.next = job.nchunks; // have the threads stop after the chunks they are at
+		}
+		else
+		{
+			fwrite(c->buf, 1, c->size, out);
+			nrefs += c->nrefs;
+			free(c->buf);
+			c->buf = NULL;
+			job.written++;
+		}
+		pthread_cond_broadcast(&job.cond);
+		pthread_mutex_unlock(&job.lock);
+	}
+
+	for (size_t t = 0; t < nstarted; ++t)
+	{
+		pthread_join(tids[t], NULL);
+	}
+	if (nthreads > 1)
+	{
+		for (size_t i = 0; failed && i < job.nchunks; ++i)
+		{
+			free(job.chunks[i].buf);
+		}
+		pthread_cond_destroy(&job.cond);
+		pthread_mutex_destroy(&job.lock);
+		free(job.chunks);
+	}
+	if (failed)
+	{
+		errno = ENOMEM; // that of the thread that failed is its own
+		fatal_err("Not enough memory");
+	}
+	trace_end(span, "dump", "dump", NULL, nrefs);
+
+	return nrefs > 0;
+}
+
+/**
+ * Prints out the symbol which the given address belongs to, that is the nearest one at or below it,
+ * followed by the symbol's references. Symbols and references that do not pass the filter are
+ * left out. Returns false (having printed "??" for the symbol) if no such symbol was found.
+ */
+extern bool	symtab_dump_addr(symtab_t* st, FILE* out, const symtab_filter_t* filter, size_t addr)
+{
+	assert(st);
+	assert(st->group_addr); // must be sorted
+	assert(out);
+	assert(filter);
+
+	bool found = false;
+
+	const size_t g = locate_group(st, addr);
+	size_t begin = 0, end = 0;
+	if (g != SIZE_MAX)
+	{
+		row_bounds(st, g, &begin, &end);
+	}
+
+	struct dump_ctx ctx = { out, filter };
+	for (size_t k = (g != SIZE_MAX) ? st->group_first[g] : 0; g != SIZE_MAX && k < st->group_first[g + 1]; ++k)
+	{
+		const char *name = name_get(st, st->sym_name[k]);
+		if (!sym_is_interesting(filter, name, st->sym_type[k]))
+			continue;
+
+		const size_t sym_addr = st->sym_addr[k];
+		const size_t delta = addr - sym_addr;
+		if (filter->offsets_decimal)
+		{
+			fprintf(out, "0x%08lx: %s+%lu (addr 0x%08lx)", addr, name, delta, sym_addr);
+		}
+		else
+		{
+			fprintf(out, "0x%08lx: %s+0x%lx (addr 0x%08lx)", addr, name, delta, sym_addr);
+		}
+		print_line(out, filter, addr);
+		fprintf(out, "\n");
+
+		symtab_ref_t ref = { .sym_name = name, .sym_type = st->sym_type[k], .sym_addr = sym_addr };
+		walk_refs(st, begin, end, filter, &ref, dump_ref, &ctx);
+		found = true;
+	}
+
+	if (!found)
+	{
+		fprintf(out, "0x%08lx: ??\n", addr);
+	}
+
+	return found;
+}
+
+/**
+ * Prints out the contents of the symbol table, excluding symbols that are not of interest to the user
+ * based on the filter given, and lets the user know if nothing got printed.
+ */
+extern void	symtab_dump(symtab_t* st, const symtab_filter_t* filter)
+{
+	assert(st);
+
+	const bool empty_output = !symtab_dump_to(st, stdout, filter);
+	if (empty_output)
+	{
+		symtab_report_empty(filter);
+	}
+}
+
+/**
+ * Lets the user know why symtab_dump_to() with the given filter has printed nothing.
+ */
+extern void	symtab_report_empty(const symtab_filter_t* filter)
+{
+	assert(filter);
+
+	if (filter->funcs_only || filter->name_pattern || filter->ref_pattern)
+	{
+		report(NORM, "No symbols that match pattern found in .symtab and .dynsym; nothing to do.");
 	}
 }
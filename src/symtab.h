@@ -29,19 +29,93 @@
 #define SYMTAB_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 
+#include <stdio.h>
+
 typedef struct symtab_s		symtab_t;
+typedef struct dwarf_lines_s	dwarf_lines_t;
+typedef struct reltype_table	reltype_table_t;
+
+/**
+ * Selects which symbols and references are shown by symtab_dump_to() and how.
+ */
+typedef struct symtab_filter
+{
+	const char *	name_pattern;		// only symbols of which this is a substring
+	bool		name_exact;		// ...or, if set, that are named exactly that
+	const char *	ref_pattern;		// only references to symbols of which this is a substring
+	bool		ref_exact;		// ...or, if set, that are named exactly that
+	bool		funcs_only;		// only functions (symbol type FUNC)
+	bool		offsets_decimal;	// print offsets in decimal rather than hex
+	bool		show_types;		// print the relocation type of each reference
+	dwarf_lines_t *	lines;			// if set, print the source line of each reference
+} symtab_filter_t;
+
+/**
+ * Describes a reference made from a symbol (see symtab_walk()).
+ */
+typedef struct symtab_ref
+{
+	const char *	sym_name;	// the referring symbol
+	int		sym_type;	// its type (STT_FUNC, STT_OBJECT)
+	size_t		sym_addr;	// its address
+	bool		first;		// this is the first reference of the symbol walked
+	size_t		offset;		// of the reference from the symbol's address
+	const char *	ref_name;	// the referenced symbol or NULL
+	bool		ref_is_func;	// the referenced symbol is a function
+	int64_t		addend;		// relocation's addend, if rela
+	uint32_t	type;		// relocation's type (R_*)
+	const char *	type_name;	// its name or NULL if not known
+} symtab_ref_t;
+
+/**
+ * Describes the address range taken by a symbol (see symtab_find_ranges()).
+ */
+typedef struct symtab_range
+{
+	size_t		begin;
+	size_t		end;		// past the last byte
+	uint32_t	shndx;		// section the symbol is defined in
+	size_t		group;		// of the symbol (see symtab_add_range_reloc())
+} symtab_range_t;
+
+typedef void	(*symtab_walk_fn)(void* ctx, const symtab_ref_t* ref);
+typedef void	(*symtab_sym_fn)(void* ctx, const char* name, int type, size_t addr, size_t nrefs);
+typedef void	(*symtab_group_sym_fn)(void* ctx, size_t group, const char* name, int type, bool defined, size_t addr);
+typedef void	(*symtab_group_ref_fn)(void* ctx, size_t group, const char* ref_name, bool ref_is_func);
 
 symtab_t *	symtab_alloc(size_t nsyms);
 void		symtab_free(symtab_t* s);
+size_t		symtab_get_mem_usage(symtab_t* s);
 
-void		symtab_sort(symtab_t* s);
-void		symtab_dump(symtab_t* s);
+void		symtab_sort(symtab_t* s, bool by_section);
+void		symtab_build_rows(symtab_t* s);
+void		symtab_dump(symtab_t* s, const symtab_filter_t* filter);
+bool		symtab_dump_to(symtab_t* s, FILE* out, const symtab_filter_t* filter);
+size_t		symtab_dump_threads(const symtab_filter_t* filter, size_t nrefs);
+size_t		symtab_dump_upto(symtab_t* s, FILE* out, const symtab_filter_t* filter, size_t offset);
+bool		symtab_dump_addr(symtab_t* s, FILE* out, const symtab_filter_t* filter, size_t addr);
+void		symtab_report_empty(const symtab_filter_t* filter);
+size_t		symtab_walk(symtab_t* s, const symtab_filter_t* filter, symtab_walk_fn fn, void* ctx);
+size_t		symtab_walk_syms(symtab_t* s, const symtab_filter_t* filter, symtab_sym_fn fn, void* ctx);
+size_t		symtab_walk_groups(symtab_t* s, symtab_group_sym_fn sym_fn, symtab_group_ref_fn ref_fn, void* ctx);
+bool		symtab_filter_match(const symtab_filter_t* filter, const symtab_ref_t* ref);
+bool		symtab_filter_match_ref(const symtab_filter_t* filter, const char* ref_name);
+void		symtab_print_ref(FILE* out, const symtab_filter_t* filter, const symtab_ref_t* ref, bool first);
 void		symtab_print_legend();
 
-size_t		symtab_add_sym(symtab_t* symtab, size_t offset, int type, const char* sym_name);
-void		symtab_add_reloc(symtab_t* symtab, size_t offset, const char* sym_name, bool is_func, int64_t addend);
+void		symtab_set_reltypes(symtab_t* symtab, const reltype_table_t* reltypes);
+void		symtab_add_strings(symtab_t* symtab, const char* data, size_t size);
+size_t		symtab_add_sym(symtab_t* symtab, size_t offset, size_t size, int type, uint32_t shndx,
+			       const char* sym_name);
+size_t		symtab_find_ranges(symtab_t* symtab, const char* name, symtab_range_t** ranges);
+void		symtab_add_reloc(symtab_t* symtab, size_t offset, const char* sym_name, bool is_func, uint32_t type,
+				 int64_t addend);
+void		symtab_add_range_reloc(symtab_t* symtab, const symtab_range_t* range, size_t offset,
+				       const char* sym_name, bool is_func, uint32_t type, int64_t addend);
+bool		symtab_count_reloc(symtab_t* symtab, size_t offset);
 
 #endif
 
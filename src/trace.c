@@ -0,0 +1,253 @@
+/*
+  This is free and unencumbered software released into the public domain.
+
+  Anyone is free to copy, modify, publish, use, compile, sell, or
+  distribute this software, either in source code form or as a compiled
+  binary, for any purpose, commercial or non-commercial, and by any
+  means.
+
+  In jurisdictions that recognize copyright laws, the author or authors
+  of this software dedicate any and all copyright interest in the
+  software to the public domain. We make this dedication for the benefit
+  of the public at large and to the detriment of our heirs and
+  successors. We intend this dedication to be an overt act of
+  relinquishment in perpetuity of all present and future rights to this
+  software under copyright law.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+  EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+  MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+  IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+  OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+  ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+  OTHER DEALINGS IN THE SOFTWARE.
+
+  For more information, please refer to <http://unlicense.org/>
+*/
+
+
+// Timeline of the work done, in the Trace Event Format (--trace FILE).
+//
+// Each stage of reading an input (opening it, finding its sections, reading
+// its symbols, each relocation section, printing) is a span from
+// trace_begin() to trace_end(), written out as a complete ("X") event with
+// the thread that ran it, the input and a size: of the file, or the number of
+// records or references. Chrome's about://tracing and Perfetto load the file
+// as it is. The events are formatted into a buffer of the thread's own, so
+// the threads do not wait for each other; each buffer is put on a list the
+// first time its thread records an event, and the list is written out by
+// trace_stop() once the other threads are done. Nothing is recorded unless
+// trace_start() has been called, which costs a test of a flag per span.
+
+#include "trace.h"
+#include "errors.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The events recorded by a thread, each a JSON object preceded by a comma.
+ */
+typedef struct trace_buf
+{
+	char *			data;
+	size_t			len;
+	size_t			size;
+	pid_t			tid;
+	struct trace_buf *	next;
+} trace_buf;
+
+static bool			enabled;
+static const char *		out_name;
+static uint64_t			t0;		// of trace_start(), ns
+static trace_buf *		bufs;		// of all the threads that recorded events
+static _Thread_local trace_buf *	own;
+
+static uint64_t	now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Starts recording the events, to be written to the file of the given name by trace_stop().
+ */
+extern void	trace_start(const char* fname)
+{
+	assert(fname);
+
+	out_name = fname;
+	t0 = now_ns();
+	enabled = true;
+}
+
+/**
+ * Returns the time a span starts at, to be passed to trace_end(), or 0 if nothing is recorded.
+ */
+extern uint64_t	trace_begin(void)
+{
+	return enabled ? now_ns() : 0;
+}
+
+/**
+ * Makes room for n more bytes in the thread's buffer, setting it up if needed.
+ */
+static trace_buf *	reserve(size_t n)
+{
+	trace_buf *b = own;
+	if (!b)
+	{
+		b = calloc(1, sizeof(trace_buf));
+		if (!b)
+		{
+			fatal_err("Not enough memory");
+		}
+		b->tid = gettid();
+
+		b->next = __atomic_load_n(&bufs, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&bufs, &b->next, b, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+			;
+		own = b;
+	}
+
+	if (b->len + n > b->size)
+	{
+		size_t size = b->size ? 2*b->size : 4096;
+		while (size < b->len + n)
+		{
+			size *= 2;
+		}
+		char *data = realloc(b->data, size);
+		if (!data)
+		{
+			fatal_err("Not enough memory");
+		}
+		b->data = data;
+		b->size = size;
+	}
+	return b;
+}
+
+/**
+ * Appends the string to the thread's buffer as a JSON string.
+ */
+static void	put_str(const char* s)
+{
+	trace_buf *b = reserve(2 + 6*strlen(s));
+	b->data[b->len++] = '"';
+	for (const unsigned char* p = (const unsigned char*)s; *p; ++p)
+	{
+		if (*p == '"' || *p == '\\')
+		{
+			b->data[b->len++] = '\\';
+			b->data[b->len++] = (char)*p;
+		}
+		else if (*p < 0x20)
+		{
+			b->len += (size_t)sprintf(b->data + b->len, "\\u%04x", *p);
+		}
+		else
+		{
+			b->data[b->len++] = (char)*p;
+		}
+	}
+	b->data[b->len++] = '"';
+}
+
+/**
+ * Appends the formatted text, which must take less than 256 bytes, to the thread's buffer.
+ */
+static void	put_fmt(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+static void	put_fmt(const char* fmt, ...)
+{
+	trace_buf *b = reserve(256);
+	va_list ap;
+	va_start(ap, fmt);
+	const int n = vsnprintf(b->data + b->len, 256, fmt, ap);
+	va_end(ap);
+	assert(n >= 0 && n < 256);
+	b->len += (size_t)n;
+}
+
+/**
+ * Records the span from start (see trace_begin()) till now as the named event of the given category, made
+ * for the input of the given name, if any, and of the given size, if not 0.
+ */
+extern void	trace_end(uint64_t start, const char* cat, const char* name, const char* input, size_t size)
+{
+	if (!enabled || start == 0)
+		return;
+
+	const uint64_t end = now_ns();
+	const uint64_t from = (start > t0) ? start - t0 : 0;
+	const trace_buf *b = reserve(0);
+	put_fmt(",\n{\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"cat\":", (int)getpid(), (int)b->tid,
+		(double)from/1000, (double)(end - start)/1000);
+	put_str(cat);
+	put_fmt(",\"name\":");
+	put_str(name);
+	put_fmt(",\"args\":{");
+	if (input)
+	{
+		put_fmt("\"input\":");
+		put_str(input);
+	}
+	if (size)
+	{
+		put_fmt("%s\"size\":%zu", input ? "," : "", size);
+	}
+	put_fmt("}}");
+}
+
+/**
+ * Writes out the events recorded by all the threads, which must be done with recording, and stops recording.
+ */
+extern void	trace_stop(void)
+{
+	if (!enabled)
+		return;
+	enabled = false;
+
+	FILE *out = fopen(out_name, "w");
+	if (!out)
+	{
+		error("Cannot write trace to %s", out_name);
+	}
+
+	const int pid = (int)getpid();
+	if (out)
+	{
+		fprintf(out, "{\"traceEvents\":[\n");
+		fprintf(out, "{\"ph\":\"M\",\"pid\":%d,\"name\":\"process_name\",\"args\":{\"name\":\"elfref\"}}", pid);
+	}
+	for (trace_buf *b = bufs, *next = NULL; b; b = next)
+	{
+		next = b->next;
+		if (out)
+		{
+			fprintf(out, ",\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+				pid, (int)b->tid, (b->tid == pid) ? "main" : "worker");
+			fwrite(b->data, 1, b->len, out);
+		}
+		free(b->data);
+		free(b);
+	}
+	bufs = NULL;
+	own = NULL;
+
+	if (out)
+	{
+		fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+		if (fclose(out) != 0)
+		{
+			error("Cannot write trace to %s", out_name);
+		}
+	}
+}